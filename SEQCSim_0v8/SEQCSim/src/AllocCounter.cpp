@@ -0,0 +1,76 @@
+//========================================================================
+// SEQCSim version 0.8 - The Space-Efficient Quantum Computer Simulator
+// By Michael P. Frank, Liviu Oniciuc, Uwe Meyer-Baese, and Liviu Oniciuc.
+// Copyright (C) 2008-2009  Florida State University Board of Trustees
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// 
+// You may contact the author at michael.patrick.frank@gmail.com, or at
+// Michael P. Frank, PO Box 025250 #24985, Miami, FL  33102-5250.
+//========================================================================
+
+// AllocCounter.cpp - Replacement global operator new/delete, with allocation counting.
+
+#include <new>				// std::bad_alloc, std::nothrow_t
+#include <stdlib.h>			// malloc(), free()
+#include "AllocCounter.h"
+
+// Dynamic exception specifications are deprecated from C++11 on (and gone in C++17), so the
+// replacements use noexcept where it's available, and throw() only for older compilers.
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1900)	// (Visual C++ 2015 and up.)
+	#define ALLOC_NOTHROW				noexcept
+	#define ALLOC_THROWS_BAD_ALLOC
+#else
+	#define ALLOC_NOTHROW				throw()
+	#define ALLOC_THROWS_BAD_ALLOC		throw(std::bad_alloc)
+#endif
+
+namespace ns_alloc {
+	static unsigned long	n_allocations = 0;		// Number of calls to operator new so far.
+
+	unsigned long	allocation_count(void) { return n_allocations; }
+
+	// Count an allocation, and make it.  Returns NULL if there's no memory left.
+	static void* counted_malloc(size_t size) {
+		#pragma omp atomic
+		n_allocations++;
+		return malloc(size ? size : 1);			// Must return a unique pointer even for size 0.
+	}
+}
+
+void* operator new(size_t size) ALLOC_THROWS_BAD_ALLOC {
+	void*	p = ns_alloc::counted_malloc(size);
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](size_t size) ALLOC_THROWS_BAD_ALLOC {
+	void*	p = ns_alloc::counted_malloc(size);
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) ALLOC_NOTHROW { return ns_alloc::counted_malloc(size); }
+void* operator new[](size_t size, const std::nothrow_t&) ALLOC_NOTHROW { return ns_alloc::counted_malloc(size); }
+
+void operator delete(void* p) ALLOC_NOTHROW { free(p); }
+void operator delete[](void* p) ALLOC_NOTHROW { free(p); }
+void operator delete(void* p, const std::nothrow_t&) ALLOC_NOTHROW { free(p); }
+void operator delete[](void* p, const std::nothrow_t&) ALLOC_NOTHROW { free(p); }
+
+// C++14 added sized forms of delete, which a program replacing delete should replace too.
+#if __cplusplus >= 201402L || (defined(_MSC_VER) && _MSC_VER >= 1900)
+void operator delete(void* p, size_t) ALLOC_NOTHROW { free(p); }
+void operator delete[](void* p, size_t) ALLOC_NOTHROW { free(p); }
+#endif
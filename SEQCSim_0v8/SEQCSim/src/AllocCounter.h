@@ -0,0 +1,38 @@
+//========================================================================
+// SEQCSim version 0.8 - The Space-Efficient Quantum Computer Simulator
+// By Michael P. Frank, Liviu Oniciuc, Uwe Meyer-Baese, and Liviu Oniciuc.
+// Copyright (C) 2008-2009  Florida State University Board of Trustees
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// 
+// You may contact the author at michael.patrick.frank@gmail.com, or at
+// Michael P. Frank, PO Box 025250 #24985, Miami, FL  33102-5250.
+//========================================================================
+
+// AllocCounter.h - Counts heap allocations, so we can check that the simulator's
+// inner loops don't do any.
+//
+// AllocCounter.cpp replaces the global operator new (and operator new[], and their
+// nothrow forms) with versions that just increment a counter before calling
+// malloc().  The cost is one integer increment per allocation (an atomic one, so
+// that the count stays right even if something allocates inside an OpenMP
+// parallel region;  the engines themselves set up their per-thread scratch before
+// entering those).  To see how many allocations some piece of code does, take the
+// difference of allocation_count() before and after.
+
+#pragma once
+
+namespace ns_alloc {
+	unsigned long	allocation_count(void);		// Total number of heap allocations since the program started.
+}
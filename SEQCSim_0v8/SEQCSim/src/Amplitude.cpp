@@ -0,0 +1,63 @@
+//========================================================================
+// SEQCSim version 0.8 - The Space-Efficient Quantum Computer Simulator
+// By Michael P. Frank, Liviu Oniciuc, Uwe Meyer-Baese, and Liviu Oniciuc.
+// Copyright (C) 2008-2009  Florida State University Board of Trustees
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// 
+// You may contact the author at michael.patrick.frank@gmail.com, or at
+// Michael P. Frank, PO Box 025250 #24985, Miami, FL  33102-5250.
+//========================================================================
+
+// Amplitude.cpp - Non-inline parts of the alternative amplitude types in Amplitude.h.
+
+#include <math.h>			// log(), atan2(), floor(), fabs()
+#include "Amplitude.h"
+
+using namespace std;
+
+// Try to recognize the given complex number as  w^phase / sqrt(2)^sqrt2_exp,  where w is
+// the max_root_order-th root of unity.  The operator files give matrix elements as decimals,
+// so we only require agreement to within a small tolerance.
+
+RootOfUnityElem::RootOfUnityElem(const Complex& c) : recognized(false), zero(false), phase(0), sqrt2_exp(0) {
+	static const double	tolerance	= 1e-9;
+	static const double	two_pi		= 6.28318530717958647692;
+
+	if (c.isZero()) { recognized = true;  zero = true;  return; }
+
+	// The magnitude must be a power of 1/sqrt(2) (we allow up to 1/16).
+	double	mag = c.norm();
+	int		h = (int)floor(-2*log(mag)/log(2.0) + 0.5);
+	if (h < 0 || h > 8 || fabs(mag - pow(0.70710678118654752440, h)) > tolerance) return;
+
+	// The phase must be a multiple of 2*pi/max_root_order.
+	double	angle = atan2(c.I, c.R);
+	if (angle < 0) angle += two_pi;
+	int		p = (int)floor(angle/two_pi*ns_amplitude::max_root_order + 0.5);
+	if (fabs(angle - p*two_pi/ns_amplitude::max_root_order) > tolerance) return;
+
+	phase = p % ns_amplitude::max_root_order;
+	sqrt2_exp = h;
+	recognized = true;
+}
+
+// The smallest N (a power of 2, at least 8) such that w_N^j = w^phase for some integer j.
+
+int RootOfUnityElem::min_root_order(void) const {
+	int		n = 8;
+	if (zero) return n;
+	while (n < ns_amplitude::max_root_order && phase % (ns_amplitude::max_root_order / n) != 0) n *= 2;
+	return n;
+}
@@ -0,0 +1,424 @@
+//========================================================================
+// SEQCSim version 0.8 - The Space-Efficient Quantum Computer Simulator
+// By Michael P. Frank, Liviu Oniciuc, Uwe Meyer-Baese, and Liviu Oniciuc.
+// Copyright (C) 2008-2009  Florida State University Board of Trustees
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// 
+// You may contact the author at michael.patrick.frank@gmail.com, or at
+// Michael P. Frank, PO Box 025250 #24985, Miami, FL  33102-5250.
+//========================================================================
+
+//-------------------------------------------------------------------------
+// Amplitude.h - Alternative number types for representing amplitudes.
+//
+// The simulation engine (SEQCSim::Bohm_step_forwards() and
+// SEQCSim::recalc_amplitude()) is templated on the type it uses to hold
+// amplitudes.  The default is our ordinary double-precision Complex class,
+// but a circuit whose operator matrices are all real can be simulated
+// with purely real arithmetic (half the multiplies, half the storage), and
+// a run that doesn't need double precision can be done in single precision
+// (halving the size of every cached amplitude and the memory bandwidth).
+//
+// Every amplitude type must provide the same little interface as Complex:
+//
+//		Amp()						- Construct a zero amplitude.
+//		Amp(double), Amp(Complex)	- Convert from a (matrix element) value.
+//		a * b,  a + b,  a - b		- Arithmetic.
+//		a *= b,  a += b				- In-place arithmetic.
+//		a.squared_norm()			- |a|^2, as a double.
+//		a.isZero()					- Is the amplitude exactly zero?
+//		a.toComplex()				- Convert back to a double-precision Complex.
+//		a.putTo(os)					- Print the amplitude.
+//-------------------------------------------------------------------------
+
+#pragma once
+
+#include <iostream>			// ostream, for putTo()
+#include <math.h>			// frexp(), ldexp(), fabs() used by ExtComplex; cos(), sin() by CyclotomicAmp.
+#include <stdlib.h>			// exit()
+#include "Complex.h"		// Our double-precision Complex class.
+
+using namespace std;
+
+// A complex number whose real and imaginary parts are of type T (normally float).
+
+template<class T>
+class ComplexOf {
+public:
+	T	R, I;		// Real and imaginary parts.
+
+	ComplexOf(void) : R(0), I(0) {}
+	ComplexOf(double r) : R((T)r), I(0) {}
+	ComplexOf(T r, T i) : R(r), I(i) {}
+	ComplexOf(const Complex& c) : R((T)c.R), I((T)c.I) {}
+
+	ComplexOf operator*(const ComplexOf& m) const { return ComplexOf(R*m.R - I*m.I, R*m.I + I*m.R); }
+	ComplexOf operator+(const ComplexOf& a) const { return ComplexOf(R + a.R, I + a.I); }
+	ComplexOf operator-(const ComplexOf& s) const { return ComplexOf(R - s.R, I - s.I); }
+	ComplexOf& operator*=(const ComplexOf& m) { (*this) = (*this)*m;  return *this; }
+	ComplexOf& operator+=(const ComplexOf& a) { R += a.R;  I += a.I;  return *this; }
+
+	double	squared_norm(void) const { return (double)R*R + (double)I*I; }
+	bool	isZero(void) const { return R == 0 && I == 0; }
+	Complex	toComplex(void) const { return Complex(R, I); }
+	void	putTo(ostream& os) { os << "(" << R << " + i*" << I << ")"; }
+};
+
+// A purely real amplitude, of type T (float or double).  This is sufficient for
+// circuits all of whose operator matrices (and the input amplitude) are real.
+
+template<class T>
+class RealOf {
+public:
+	T	R;			// The value.  (Named R, like the real part of a Complex.)
+
+	RealOf(void) : R(0) {}
+	RealOf(double r) : R((T)r) {}
+	RealOf(const Complex& c) : R((T)c.R) {}		// Drops the imaginary part, which should be 0!
+
+	RealOf operator*(const RealOf& m) const { return RealOf(R*m.R); }
+	RealOf operator+(const RealOf& a) const { return RealOf(R + a.R); }
+	RealOf operator-(const RealOf& s) const { return RealOf(R - s.R); }
+	RealOf& operator*=(const RealOf& m) { R *= m.R;  return *this; }
+	RealOf& operator+=(const RealOf& a) { R += a.R;  return *this; }
+
+	double	squared_norm(void) const { return (double)R*R; }
+	bool	isZero(void) const { return R == 0; }
+	Complex	toComplex(void) const { return Complex(R, 0); }
+	void	putTo(ostream& os) { os << "(" << R << ")"; }
+};
+
+typedef ComplexOf<float>	ComplexF;		// Single-precision complex amplitudes.
+typedef RealOf<double>		RealD;			// Double-precision real amplitudes.
+typedef RealOf<float>		RealF;			// Single-precision real amplitudes.
+
+// An extended-range complex amplitude.  Every off-axis (branching) operation, such as
+// a Hadamard, scales the path contributions by about 1/sqrt(2), so after roughly 2,000
+// of them the individual contributions summed in recalc_amplitude() drop below the
+// normal range of a double (about 2^-1022) and are silently lost.  An ExtComplex
+// holds a double-precision complex mantissa (R + i*I) together with a separate
+// binary exponent E; its value is (R + i*I) * 2^E.  The exponent is an int, so the
+// representable range is effectively unlimited.
+//
+// Renormalization (moving the mantissa back to magnitude ~1 and adjusting E) is
+// done lazily:  only when the mantissa's magnitude leaves [2^-64, 2^64], which
+// takes dozens of multiplications, so most operations are just ordinary complex
+// arithmetic plus an integer addition.
+
+class ExtComplex {
+public:
+	double	R, I;		// Mantissa (real and imaginary parts).
+	int		E;			// Binary exponent.  The value is (R + i*I) * 2^E.
+
+	ExtComplex(void) : R(0), I(0), E(0) {}
+	ExtComplex(double r) : R(r), I(0), E(0) { normalize(); }
+	ExtComplex(double r, double i, int e) : R(r), I(i), E(e) { renormalize(); }
+	ExtComplex(const Complex& c) : R(c.R), I(c.I), E(0) { normalize(); }
+
+	// Unconditionally rescale the mantissa so that its larger component has magnitude in [0.5,1).
+	void normalize(void) {
+		double	m = (fabs(R) > fabs(I)) ? fabs(R) : fabs(I);
+		if (m == 0) { E = 0;  return; }		// Keep zero in a canonical form.
+		int		e;
+		frexp(m, &e);
+		R = ldexp(R, -e);  I = ldexp(I, -e);  E += e;
+	}
+
+	// Rescale the mantissa only if it has drifted far from magnitude 1.  This is the cheap check
+	// done after each arithmetic operation.
+	void renormalize(void) {
+		double	m = (fabs(R) > fabs(I)) ? fabs(R) : fabs(I);
+		if (m < 5.4210108624275222e-20 || m > 1.8446744073709552e19) normalize();	// 2^-64, 2^64
+	}
+
+	ExtComplex operator*(const ExtComplex& m) const {
+		return ExtComplex(R*m.R - I*m.I, R*m.I + I*m.R, E + m.E);
+	}
+
+	// Addition has to align the two mantissas to a common exponent first.  If the exponents
+	// are very different, the smaller term is below the larger one's precision and is dropped.
+	ExtComplex operator+(const ExtComplex& a) const {
+		if (a.isZero()) return *this;
+		if (isZero()) return a;
+		int		d = E - a.E;
+		if (d > 256)	return *this;
+		if (d < -256)	return a;
+		if (d >= 0)	return ExtComplex(R + ldexp(a.R, -d), I + ldexp(a.I, -d), E);
+		else		return ExtComplex(ldexp(R, d) + a.R, ldexp(I, d) + a.I, a.E);
+	}
+	ExtComplex operator-(const ExtComplex& s) const { return (*this) + ExtComplex(-s.R, -s.I, s.E); }
+	ExtComplex& operator*=(const ExtComplex& m) { (*this) = (*this)*m;  return *this; }
+	ExtComplex& operator+=(const ExtComplex& a) { (*this) = (*this)+a;  return *this; }
+
+	// The squared norm, as an ordinary double.  This underflows (to 0) for very small amplitudes;
+	// code that needs to compare the norms of such amplitudes should use squared_norm_scaled().
+	double	squared_norm(void) const { return ldexp(R*R + I*I, 2*E); }
+
+	// The squared norm divided by 2^(2*e), which stays in range when e is near E.
+	double	squared_norm_scaled(int e) const { return ldexp(R*R + I*I, 2*(E - e)); }
+
+	bool	isZero(void) const { return R == 0 && I == 0; }
+	Complex	toComplex(void) const { return Complex(ldexp(R, E), ldexp(I, E)); }
+
+	// Print as an ordinary complex number if that's representable, else as mantissa*2^exponent.
+	void	putTo(ostream& os) {
+		if (isZero() || (E > -1000 && E < 1000)) { Complex c = toComplex();  c.putTo(os); }
+		else { ExtComplex n = *this;  n.normalize();  os << "(" << n.R << " + i*" << n.I << ")*2^" << n.E; }
+	}
+};
+
+//-------------------------------------------------------------------------
+// Exact arithmetic for circuits built from Hadamards and phase rotations by
+// rational multiples of pi (such as our QFT adders and Shor circuits).
+//
+// Every matrix element of such a circuit is of the form  w^p / sqrt(2)^h,
+// where w = exp(2*pi*i/N) is a primitive N-th root of unity (N a power of 2)
+// and h is a small nonnegative integer.  It follows that every amplitude is
+// an element of the ring Z[w] divided by a power of sqrt(2), that is, it
+// can be written exactly as
+//
+//		(a_0 + a_1*w + a_2*w^2 + ... + a_{M-1}*w^{M-1}) / sqrt(2)^h
+//
+// with integer coefficients a_j, where M = N/2.  (Higher powers aren't
+// needed since w^M = -1.)  With this representation, sums have no rounding
+// or cancellation error at all, and an amplitude that should be zero is
+// exactly zero, so branches that interfere destructively are pruned exactly.
+//-------------------------------------------------------------------------
+
+namespace ns_amplitude {
+	// The finest root of unity that RootOfUnityElem will recognize.  Phases are
+	// stored as multiples of 2*pi/max_root_order.
+	static const int max_root_order = 65536;
+
+	// The largest N for which we instantiate the exact amplitude type.
+	static const int max_exact_root_order = 64;
+}
+
+// A matrix element of the form  w^phase / sqrt(2)^sqrt2_exp,  where w = exp(2*pi*i/max_root_order),
+// if the given complex number is (to within rounding error) of that form.  This is worked out once,
+// when the operator matrices are loaded (see SmartComplexVector and MatrixBlock).
+
+class RootOfUnityElem {
+public:
+	bool	recognized;		// Is the element of the above form (or zero)?
+	bool	zero;			// Is the element exactly zero?
+	int		phase;			// Its phase, in units of 2*pi/max_root_order.  (0 <= phase < max_root_order.)
+	int		sqrt2_exp;		// The power of 1/sqrt(2) in its magnitude.
+
+	RootOfUnityElem(void) : recognized(true), zero(true), phase(0), sqrt2_exp(0) {}
+	RootOfUnityElem(const Complex& c);		// Try to recognize the given complex number.
+
+	// The smallest N (a power of 2, and at least 8) such that this element is in Z[exp(2*pi*i/N)]/sqrt(2)^h.
+	int		min_root_order(void) const;
+};
+
+// Helper for multiplying two polynomials in w modulo w^M + 1 (a "negacyclic convolution"),
+// which is how elements of Z[w] are multiplied.  The general version is a double loop.
+
+template<int M>
+struct CyclotomicMul {
+	static void mul(const long long* a, const long long* b, long long* c) {
+		for (int k = 0;  k < M;  k++) c[k] = 0;
+		for (int i = 0;  i < M;  i++) {
+			if (a[i] == 0) continue;
+			for (int j = 0;  j < M;  j++) {
+				if (i + j < M)	c[i+j]		+= a[i]*b[j];
+				else			c[i+j-M]	-= a[i]*b[j];		// Since w^M = -1.
+			}
+		}
+	}
+};
+
+// The M=4 (N=8) case, which covers everything built from H, S, T and their controlled
+// versions, is fully unrolled.  (This is straight-line integer code, which the compiler
+// can vectorize, and is considerably cheaper than the general loop.)
+
+template<>
+struct CyclotomicMul<4> {
+	static void mul(const long long* a, const long long* b, long long* c) {
+		c[0] = a[0]*b[0] - a[1]*b[3] - a[2]*b[2] - a[3]*b[1];
+		c[1] = a[0]*b[1] + a[1]*b[0] - a[2]*b[3] - a[3]*b[2];
+		c[2] = a[0]*b[2] + a[1]*b[1] + a[2]*b[0] - a[3]*b[3];
+		c[3] = a[0]*b[3] + a[1]*b[2] + a[2]*b[1] + a[3]*b[0];
+	}
+};
+
+// An exact amplitude in Z[w]/sqrt(2)^h, where w = exp(2*pi*i/N) and N = 2*M.  The
+// coefficients are 64-bit integers; if they ever grow too large (which would take a
+// very deep circuit), we stop with an error rather than silently losing precision.
+
+template<int M>
+class CyclotomicAmp {
+public:
+	long long	a[M];		// Coefficients of 1, w, w^2, ..., w^(M-1).
+	int			h;			// The value is (sum of a[j]*w^j) / sqrt(2)^h.
+
+	CyclotomicAmp(void) : h(0) { for (int j = 0;  j < M;  j++) a[j] = 0; }
+	CyclotomicAmp(double r) : h(0) { setFrom(RootOfUnityElem(Complex(r))); }
+	CyclotomicAmp(const Complex& c) : h(0) { setFrom(RootOfUnityElem(c)); }
+	CyclotomicAmp(const RootOfUnityElem& e) : h(0) { setFrom(e); }
+
+	// Set this amplitude to the value of the given (recognized) matrix element.
+	void setFrom(const RootOfUnityElem& e) {
+		for (int j = 0;  j < M;  j++) a[j] = 0;
+		h = 0;
+		if (e.zero) return;
+		if (!e.recognized || e.min_root_order() > 2*M) {
+			cout << "CyclotomicAmp::setFrom(): Error!  Matrix element isn't in Z[exp(2*pi*i/" << 2*M << ")]/sqrt(2)^h.\n";
+			exit(1);
+		}
+		int		j = e.phase / (ns_amplitude::max_root_order / (2*M));	// The power of w.
+		if (j < M)	a[j]	= 1;
+		else		a[j-M]	= -1;			// w^j = -w^(j-M).
+		h = e.sqrt2_exp;
+	}
+
+	// The largest magnitude of any coefficient.
+	long long	max_coeff(void) const {
+		long long	m = 0;
+		for (int j = 0;  j < M;  j++) { long long v = a[j] < 0 ? -a[j] : a[j];  if (v > m) m = v; }
+		return m;
+	}
+
+	// Stop if coefficients of the given size could overflow when combined.
+	static void check_range(double bound) {
+		if (bound >= 4.6e18) {		// About 2^62.
+			cout << "CyclotomicAmp: Error!  Exact amplitude coefficients have overflowed 64 bits.\n";
+			exit(1);
+		}
+	}
+
+	// Multiply the numerator by sqrt(2) = w^(N/8) - w^(3N/8), in place.  (Doesn't change h.)
+	void mul_sqrt2(void) {
+		long long	t[M];
+		int			s1 = M/4,  s3 = 3*M/4;		// N/8 and 3N/8.
+		check_range(2.0*(double)max_coeff());
+		for (int j = 0;  j < M;  j++) t[j] = 0;
+		for (int j = 0;  j < M;  j++) {
+			if (a[j] == 0) continue;
+			if (j + s1 < M) t[j+s1] += a[j];  else t[j+s1-M] -= a[j];
+			if (j + s3 < M) t[j+s3] -= a[j];  else t[j+s3-M] += a[j];
+		}
+		for (int j = 0;  j < M;  j++) a[j] = t[j];
+	}
+
+	// Bring the representation to lowest terms:  Divide out factors of sqrt(2) from the
+	// numerator for as long as the denominator still has them.  This keeps the coefficients
+	// (and h) small.
+	void reduce(void) {
+		if (isZero()) { h = 0;  return; }
+		while (h >= 1) {
+			CyclotomicAmp	t = *this;
+			t.mul_sqrt2();						// x/sqrt(2) = (x*sqrt(2))/2, so check whether x*sqrt(2) is even.
+			bool	even = true;
+			for (int j = 0;  j < M;  j++) if (t.a[j] & 1) { even = false;  break; }
+			if (!even) break;
+			for (int j = 0;  j < M;  j++) a[j] = t.a[j] / 2;
+			h--;
+		}
+	}
+
+	CyclotomicAmp operator*(const CyclotomicAmp& m) const {
+		CyclotomicAmp	p;
+		check_range((double)max_coeff() * (double)m.max_coeff() * M);
+		CyclotomicMul<M>::mul(a, m.a, p.a);
+		p.h = h + m.h;
+		p.reduce();
+		return p;
+	}
+
+	// To add, first bring both terms to a common denominator (the larger power of sqrt(2)).
+	CyclotomicAmp operator+(const CyclotomicAmp& s) const {
+		if (s.isZero()) return *this;
+		if (isZero()) return s;
+		CyclotomicAmp	x = *this,  y = s;
+		CyclotomicAmp&	lo = (x.h < y.h) ? x : y;		// The one with the smaller denominator.
+		int				hi_h = (x.h < y.h) ? y.h : x.h;
+		int				d = hi_h - lo.h;
+		if (d & 1) lo.mul_sqrt2();
+		check_range((double)lo.max_coeff() * ldexp(1.0, d/2));
+		for (int j = 0;  j < M;  j++) lo.a[j] *= (1LL << (d/2));
+		lo.h = hi_h;
+		check_range((double)x.max_coeff() + (double)y.max_coeff());
+		for (int j = 0;  j < M;  j++) x.a[j] += y.a[j];
+		x.reduce();
+		return x;
+	}
+	CyclotomicAmp operator-(const CyclotomicAmp& s) const {
+		CyclotomicAmp	n = s;
+		for (int j = 0;  j < M;  j++) n.a[j] = -n.a[j];
+		return (*this) + n;
+	}
+	CyclotomicAmp& operator*=(const CyclotomicAmp& m) { (*this) = (*this)*m;  return *this; }
+	CyclotomicAmp& operator+=(const CyclotomicAmp& s) { (*this) = (*this)+s;  return *this; }
+
+	bool	isZero(void) const { for (int j = 0;  j < M;  j++) if (a[j]) return false;  return true; }
+
+	// Convert to an ordinary (approximate) double-precision complex number.
+	Complex	toComplex(void) const {
+		static double	cos_w[M], sin_w[M];		// Table of the real & imaginary parts of the powers of w.
+		static bool		table_ready = false;
+		if (!table_ready) {
+			// Fill in the first octant directly, and the rest by symmetry, so that w^(N/8) has
+			// equal real & imaginary parts and w^(N/4) = i exactly, as in the Complex arithmetic.
+			for (int j = 0;  j < M;  j++) {
+				int		k = (j <= M/2) ? j : j - M/2;			// Rotate back by 90 degrees if needed.
+				int		o = (k <= M/4) ? k : M/2 - k;			// Reflect into the first octant.
+				double	c = cos(3.14159265358979323846*o/M),  s = sin(3.14159265358979323846*o/M);
+				if (o == 0) { c = 1;  s = 0; }
+				if (2*o == M/2) s = c;
+				if (k > M/4) { double t = c;  c = s;  s = t; }
+				if (j > M/2) { cos_w[j] = -s;  sin_w[j] = c; }
+				else		 { cos_w[j] = c;   sin_w[j] = s; }
+			}
+			table_ready = true;
+		}
+		double	re = 0, im = 0;
+		for (int j = 0;  j < M;  j++) { re += a[j]*cos_w[j];  im += a[j]*sin_w[j]; }
+		double	scale = ldexp((h & 1) ? 0.70710678118654752440 : 1.0, -(h/2));
+		return Complex(re*scale, im*scale);
+	}
+
+	double	squared_norm(void) const { return toComplex().squared_norm(); }
+	void	putTo(ostream& os) { Complex c = toComplex();  c.putTo(os); }
+};
+
+// An AmpAccumulator adds up a sequence of amplitudes.  If it is constructed with
+// compensated=true, it uses Kahan's compensated summation algorithm, which keeps a
+// running correction term for the low-order bits lost in each addition.  That bounds
+// the accumulated rounding error independently of the number of terms, which matters
+// when summing many path contributions in single precision.
+
+template<class Amp>
+class AmpAccumulator {
+	Amp		sum;			// The running sum.
+	Amp		correction;		// Running compensation for lost low-order bits (Kahan summation only).
+	bool	compensated;	// Are we using compensated summation?
+public:
+	AmpAccumulator(bool use_compensation) : compensated(use_compensation) {}
+
+	void add(const Amp& term) {
+		if (!compensated) {
+			sum += term;
+		} else {
+			Amp	y = term - correction;			// Re-inject the bits lost last time.
+			Amp	t = sum + y;					// Low-order bits of y may be lost here...
+			correction = (t - sum) - y;			// ...but this recovers them (algebraically 0).
+			sum = t;
+		}
+	}
+
+	Amp value(void) { return sum; }
+};
@@ -0,0 +1,100 @@
+//========================================================================
+// SEQCSim version 0.8 - The Space-Efficient Quantum Computer Simulator
+// By Michael P. Frank, Liviu Oniciuc, Uwe Meyer-Baese, and Liviu Oniciuc.
+// Copyright (C) 2008-2009  Florida State University Board of Trustees
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// 
+// You may contact the author at michael.patrick.frank@gmail.com, or at
+// Michael P. Frank, PO Box 025250 #24985, Miami, FL  33102-5250.
+//========================================================================
+
+//-------------------------------------------------------------------------
+// Approximate.cpp - The small-phase approximation pass, which drops phase
+//   rotations by very small angles (as in the approximate QFT).
+//
+// In the QFT (and the QFT adders), the controlled rotations by 2*pi/2^k for
+// large k hardly change the state, but each one still costs a recursion
+// frame.  With the option "phase_threshold <angle>" (e.g. "phase_threshold
+// pi/64"), every operation whose matrix is diagonal, with all its diagonal
+// elements exp(i*theta) for |theta| <= the threshold, is dropped.  Keeping
+// only the rotations with k <= log2(n)+2 or so leaves O(n log n) operations
+// in an n-qubit QFT, instead of O(n^2), at a small cost in accuracy.
+//
+// An operation U that is dropped is replaced by the identity, which is off
+// by ||U - I|| = max |exp(i*theta) - 1| = max 2*sin(|theta|/2) in operator
+// norm.  Since all the operations are unitary, the errors of the dropped
+// operations add up at worst, so the whole circuit is off by at most the sum
+// of those (or 2, if that's smaller), which is reported, along with the number
+// of operations dropped.
+// Functional phase oracles are left alone.
+//-------------------------------------------------------------------------
+
+#include <iostream>			// cout
+#include <math.h>			// atan2(), sin(), fabs()
+#include "SEQCSim.h"
+#include "debug.h"			// ns_debug::trace
+
+using namespace std;
+
+// If the given operator is diagonal, with every element a phase exp(i*theta), return
+// the largest |theta|.  Otherwise, return a negative number.
+
+static double max_phase_angle(Operator& opr) {
+	if (opr.form != Operator::DIAGONAL) return -1;
+	double	max_angle = 0;
+	for (size_t k = 0;  k < opr.mono_elem.size();  k++) {
+		Complex&	elem = opr.mono_elem[k];
+		if (fabs(elem.norm() - 1) > 1e-12) return -1;		// Not a pure phase.
+		double		angle = fabs(atan2(elem.I, elem.R));
+		if (angle > max_angle) max_angle = angle;
+	}
+	return max_angle;
+}
+
+// Run the small-phase approximation pass over opn_seq (see the top of this file), if
+// it's enabled.
+
+void SEQCSim::drop_small_phases() {
+	if (!qc_config.has_option("phase_threshold")) return;
+
+	string	threshold_text = qc_config.option_string("phase_threshold", "0");
+	double	threshold;
+	if (!ns_operators::parse_angle(threshold_text, threshold)) {
+		cout << "SEQCSim::drop_small_phases(): Error!  Can't parse the phase_threshold angle \"" << threshold_text << "\".\n";
+		exit(1);
+	}
+
+	vector<Operation>	kept_seq;
+	double				error_bound = 0;
+	size_t				n_orig = opn_seq.size();
+
+	for (size_t i = 0;  i < opn_seq.size();  i++) {
+		Operation&	opn = opn_seq[i];
+		double		angle = opn.isFunctional() ? -1 : max_phase_angle(operators.at(opn.operator_id));
+		if (angle >= 0 && angle <= threshold*(1 + 1e-9)) {		// (Allowing for rounding in the angles.)
+			if (ns_debug::trace) cout << "SEQCSim::drop_small_phases(): Dropping operation #" << i << ", with phases up to " << angle << " radians.\n";
+			error_bound += 2*sin(angle/2);
+			continue;
+		}
+		kept_seq.push_back(opn);
+	}
+
+	if (error_bound > 2) error_bound = 2;		// The distance between two unitaries can't be more than 2.
+
+	cout << "SEQCSim::drop_small_phases(): Dropped " << (n_orig - kept_seq.size()) << " of the " << n_orig
+		 << " operations (phases up to " << threshold << " radians); the circuit's error is at most "
+		 << error_bound << " in operator norm.\n";
+	opn_seq.swap(kept_seq);
+}
@@ -0,0 +1,432 @@
+//========================================================================
+// SEQCSim version 0.8 - The Space-Efficient Quantum Computer Simulator
+// By Michael P. Frank, Liviu Oniciuc, Uwe Meyer-Baese, and Liviu Oniciuc.
+// Copyright (C) 2008-2009  Florida State University Board of Trustees
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// 
+// You may contact the author at michael.patrick.frank@gmail.com, or at
+// Michael P. Frank, PO Box 025250 #24985, Miami, FL  33102-5250.
+//========================================================================
+
+//-------------------------------------------------------------------------
+// Clifford.cpp - Recognizing Clifford operations and segments, and the
+//   stabilizer-state arithmetic used to go back through them (see Clifford.h).
+//-------------------------------------------------------------------------
+
+#include <iostream>				// cout
+#include <sstream>				// ostringstream, for the keys of the Clifford tables.
+#include <vector>				// STL vector<> template.
+#include <map>					// STL map<> template.
+#include <algorithm>			// sort(), unique()
+#include <math.h>				// floor(), sqrt(), pow()
+#include "SEQCSim.h"
+#include "Clifford.h"
+#include "OperationMatrix.h"	// ns_opmatrix::embed(), multiply(), qubits_of(), position_of()
+#include "debug.h"				// ns_debug::trace
+
+using namespace std;
+
+namespace ns_clifford {
+
+	// The Clifford operators on 1 and 2 qubits (up to a phase) are found by a breadth-first
+	// search over products of the generators H, S and cNOT.  Each one found is kept, with the
+	// entry it was reached from, and the gate that was applied to get there.  (There are 24 of
+	// them on one qubit, and 11520 on two.)
+	struct TableEntry {
+		vector<Complex>	m;
+		int				parent;		// -1 for the identity.
+		Gate			gate;
+	};
+
+	struct Table {
+		vector<TableEntry>	entries;
+		map<string, size_t>	index;		// By key (see key_of()).
+	};
+
+	// The dense matrix of a gate on n qubits.
+	static void gate_matrix(const Gate& g, size_t n, vector<Complex>& m) {
+		size_t	rank = (size_t)1 << n;
+		double	s = sqrt(0.5);
+		m.assign(rank*rank, Complex(0));
+		for (size_t col = 0;  col < rank;  col++) {
+			switch (g.type) {
+			case GATE_H: {
+				size_t	lo = col & ~((size_t)1 << g.a),  hi = col | ((size_t)1 << g.a);
+				bool	one = ((col >> g.a) & 1) != 0;
+				m[lo*rank + col] = Complex(s);
+				m[hi*rank + col] = Complex(one ? -s : s);
+				break;
+			}
+			case GATE_S:
+				m[col*rank + col] = ((col >> g.a) & 1) ? Complex(0, 1) : Complex(1);
+				break;
+			case GATE_CNOT: {
+				size_t	row = ((col >> g.a) & 1) ? col ^ ((size_t)1 << g.b) : col;
+				m[row*rank + col] = Complex(1);
+				break;
+			}
+			}
+		}
+	}
+
+	// The position of the first element of m that isn't (nearly) zero.
+	static size_t pivot_of(const vector<Complex>& m) {
+		size_t	p = 0;
+		while (p + 1 < m.size() && m[p].squared_norm() < 0.01) p++;
+		return p;
+	}
+
+	// A string identifying m up to a phase:  its elements, divided by the phase of its pivot
+	// element, and rounded.
+	static string key_of(const vector<Complex>& m) {
+		Complex			pivot = m[pivot_of(m)];
+		double			norm = pivot.norm();
+		Complex			unphase(pivot.R/norm, -pivot.I/norm);
+		ostringstream	key;
+		for (size_t i = 0;  i < m.size();  i++) {
+			Complex	e = m[i] * unphase;
+			key << (long)floor(e.R*1e4 + 0.5) << "," << (long)floor(e.I*1e4 + 0.5) << ";";
+		}
+		return key.str();
+	}
+
+	// The table of Clifford operators on n (1 or 2) qubits, built the first time it's needed.
+	static Table& table_for(size_t n) {
+		static Table	tables[3];
+		Table&			table = tables[n];
+		if (!table.entries.empty()) return table;
+
+		vector<Gate>	generators;
+		for (qubit_index_t q = 0;  q < n;  q++) {
+			Gate	h = { GATE_H, q, 0 },  s = { GATE_S, q, 0 };
+			generators.push_back(h);
+			generators.push_back(s);
+		}
+		if (n == 2) {
+			Gate	cnot = { GATE_CNOT, 0, 1 };
+			generators.push_back(cnot);
+		}
+		vector< vector<Complex> >	gen_matrices(generators.size());
+		for (size_t g = 0;  g < generators.size();  g++) gate_matrix(generators[g], n, gen_matrices[g]);
+
+		size_t			rank = (size_t)1 << n;
+		TableEntry		identity;
+		identity.m.assign(rank*rank, Complex(0));
+		for (size_t i = 0;  i < rank;  i++) identity.m[i*rank + i] = Complex(1);
+		identity.parent = -1;
+		table.entries.push_back(identity);
+		table.index[key_of(identity.m)] = 0;
+
+		for (size_t e = 0;  e < table.entries.size();  e++) {
+			for (size_t g = 0;  g < generators.size();  g++) {
+				TableEntry	next;
+				ns_opmatrix::multiply(gen_matrices[g], table.entries[e].m, rank, next.m);
+				string		key = key_of(next.m);
+				if (table.index.count(key)) continue;
+				next.parent = (int)e;
+				next.gate = generators[g];
+				table.index[key] = table.entries.size();
+				table.entries.push_back(next);
+			}
+		}
+		if (ns_debug::trace) cout << "ns_clifford::table_for(): There are " << table.entries.size()
+								  << " Clifford operators on " << n << " qubits.\n";
+		return table;
+	}
+
+	bool decompose(const vector<Complex>& m, size_t n_qubits, vector<Gate>& gates, Complex& phase) {
+		if (n_qubits < 1 || n_qubits > 2) return false;
+		Table&								table = table_for(n_qubits);
+		map<string, size_t>::const_iterator	found = table.index.find(key_of(m));
+		if (found == table.index.end()) return false;
+
+		// Work out the phase from the pivot elements, and check that it really accounts for
+		// the whole difference.
+		const vector<Complex>&	cm = table.entries[found->second].m;
+		size_t					p = pivot_of(m);
+		double					cm_norm = cm[p].squared_norm();
+		phase = m[p] * Complex(cm[p].R/cm_norm, -cm[p].I/cm_norm);
+		for (size_t i = 0;  i < m.size();  i++) {
+			if ((m[i] - phase*cm[i]).squared_norm() > ns_opmatrix::tolerance*ns_opmatrix::tolerance) return false;
+		}
+
+		gates.clear();
+		for (int e = (int)found->second;  table.entries[e].parent >= 0;  e = table.entries[e].parent) {
+			gates.push_back(table.entries[e].gate);
+		}
+		reverse(gates.begin(), gates.end());
+		return true;
+	}
+
+	static inline size_t bit(size_t j) { return (size_t)1 << j; }
+
+	static int popcount(size_t x) {
+		int	n = 0;
+		for (;  x;  x &= x - 1) n++;
+		return n;
+	}
+
+	void AffineState::add_variable(void) {
+		col[r] = 0;  c[r] = 0;  d[r] = 0;
+		r++;
+	}
+
+	// Remove variable z (whose column of A must be zero), by moving the last one into its place.
+	void AffineState::remove_variable(size_t z) {
+		size_t	last = r - 1;
+		if (z != last) {
+			col[z] = col[last];  c[z] = c[last];  d[z] = d[last];
+			for (size_t j = 0;  j < r;  j++) {
+				size_t	bz = (d[j] >> z) & 1,  bl = (d[j] >> last) & 1;
+				d[j] = (d[j] & ~(bit(z) | bit(last))) | (bl << z) | (bz << last);
+			}
+		}
+		for (size_t j = 0;  j < r;  j++) d[j] &= ~bit(last);
+		r--;
+	}
+
+	// Change variables, replacing u_j by u_j XOR u_k.  (So column k of A absorbs column j,
+	// and Q is rewritten to match.)
+	void AffineState::change_variable(size_t j, size_t k) {
+		int		cj = c[j];
+		size_t	djk = (d[j] >> k) & 1;
+		col[k] ^= col[j];
+		c[k] = (c[k] + cj + 2*(int)djk) & 3;
+		if (cj & 1) {
+			d[j] ^= bit(k);
+			d[k] ^= bit(j);
+		}
+		size_t	others = d[j] & ~(bit(j) | bit(k));
+		d[k] ^= others;
+		for (size_t m = 0;  m < r;  m++) if ((others >> m) & 1) d[m] ^= bit(k);
+	}
+
+	// Q += m * (beta XOR the parity of the variables in alpha), where that parity is lifted
+	// from mod 2 to mod 4 as sum_j u_j - 2 sum_j<k u_j u_k.
+	void AffineState::add_linear_phase(size_t alpha, int beta, int m) {
+		int		sign = beta ? -1 : 1;
+		w_exp += 2*m*beta;
+		for (size_t j = 0;  j < r;  j++) {
+			if (!((alpha >> j) & 1)) continue;
+			c[j] = (c[j] + sign*m + 4) & 3;
+			if (m & 1) d[j] ^= alpha & ~bit(j);
+		}
+	}
+
+	// Sum over the values of variable z, whose column of A is zero.  It appears in Q as
+	// u_z (c_z + 2 L(u)), where L is the parity of the variables in d[z], so the sum is a
+	// Gauss sum, 1 + i^(c_z) (-1)^L.  For c_z odd, that's sqrt(2) times a phase that depends
+	// on L;  for c_z even, it's 2 if L = c_z/2 (mod 2), and 0 otherwise, which fixes the value
+	// of one more variable.
+	void AffineState::sum_out(size_t z) {
+		int		cz = c[z];
+		size_t	L = d[z];
+
+		if (cz & 1) {
+			w_exp += (cz == 1) ? 1 : -1;
+			h -= 1;
+			add_linear_phase(L, 0, (cz == 1) ? 3 : 1);
+			remove_variable(z);
+			return;
+		}
+
+		int		v = cz/2;
+		if (L == 0) {
+			if (v) {
+				zero = true;
+			} else {
+				h -= 2;
+				remove_variable(z);
+			}
+			return;
+		}
+
+		// Change variables so that L is just u_p, then fix u_p = v, and drop u_p and u_z.
+		size_t	p = 0;
+		while (!((L >> p) & 1)) p++;
+		for (size_t m = p + 1;  m < r;  m++) if ((L >> m) & 1) change_variable(p, m);
+		if (v) {
+			b ^= col[p];
+			w_exp += 2*c[p];
+			for (size_t m = 0;  m < r;  m++) if ((d[p] >> m) & 1) c[m] = (c[m] + 2) & 3;
+		}
+		h -= 2;
+		col[p] = 0;
+		if (p > z) {
+			remove_variable(p);
+			remove_variable(z);
+		} else {
+			remove_variable(z);
+			remove_variable(p);
+		}
+	}
+
+	// Restore the invariant that A has full column rank, by reducing it to column echelon form
+	// (with changes of variables), and summing out the variables whose columns come out zero.
+	void AffineState::reduce(void) {
+		size_t	pivots = 0;
+		for (size_t row = 0;  row < 8*sizeof(size_t);  row++) {
+			size_t	j = 0;
+			while (j < r && (((pivots >> j) & 1) || !((col[j] >> row) & 1))) j++;
+			if (j == r) continue;
+			pivots |= bit(j);
+			for (size_t k = 0;  k < r;  k++) if (k != j && ((col[k] >> row) & 1)) change_variable(j, k);
+		}
+		for (size_t z = 0;  z < r && !zero;  ) {
+			if (col[z] == 0) {
+				sum_out(z);
+				z = 0;
+			} else {
+				z++;
+			}
+		}
+	}
+
+	// H on qubit q:  x_q is replaced by a new variable v, with a phase (-1)^(v x_q).
+	void AffineState::apply_h(qubit_index_t q) {
+		if (zero) return;
+		size_t	alpha = 0;
+		int		beta = (int)((b >> q) & 1);
+		for (size_t j = 0;  j < r;  j++) {
+			if ((col[j] >> q) & 1) alpha |= bit(j);
+			col[j] &= ~bit(q);
+		}
+		b &= ~bit(q);
+
+		size_t	v = r;
+		add_variable();
+		col[v] = bit(q);
+		c[v] = 2*beta;
+		d[v] = alpha;
+		for (size_t k = 0;  k < v;  k++) if ((alpha >> k) & 1) d[k] |= bit(v);
+		h += 1;
+		reduce();
+	}
+
+	// S on qubit q:  a phase i^(x_q).
+	void AffineState::apply_s(qubit_index_t q) {
+		if (zero) return;
+		size_t	alpha = 0;
+		for (size_t j = 0;  j < r;  j++) if ((col[j] >> q) & 1) alpha |= bit(j);
+		add_linear_phase(alpha, (int)((b >> q) & 1), 1);
+	}
+
+	// cNOT:  x_target ^= x_control.
+	void AffineState::apply_cnot(qubit_index_t control, qubit_index_t target) {
+		for (size_t j = 0;  j < r;  j++) if ((col[j] >> control) & 1) col[j] ^= bit(target);
+		if ((b >> control) & 1) b ^= bit(target);
+	}
+
+	size_t AffineState::term(size_t k, Complex& amp) const {
+		static const double	s = 0.70710678118654752440;
+		static const Complex	w_powers[8] = { Complex(1, 0), Complex(s, s), Complex(0, 1), Complex(-s, s),
+											Complex(-1, 0), Complex(-s, -s), Complex(0, -1), Complex(s, -s) };
+		size_t	y = b;
+		int		q = 0,  pairs = 0;
+		for (size_t j = 0;  j < r;  j++) {
+			if (!((k >> j) & 1)) continue;
+			y ^= col[j];
+			q += c[j];
+			pairs += popcount(d[j] & k);
+		}
+		q += pairs;		// (Each pair was counted twice, and contributes 2 to Q.)
+		amp = w_powers[(((w_exp + 2*q) % 8) + 8) % 8] * Complex(pow(2.0, -h/2.0));
+		return y;
+	}
+}
+
+// Find the maximal runs of Clifford operations in opn_seq (see Clifford.h), and note where
+// each one ends, so recalc_amplitude() can go back through it in one step.
+
+void SEQCSim::find_clifford_segments() {
+	clifford_segments.clear();
+	segment_ending_at.clear();
+	if (!qc_config.option_flag("clifford_segments", true)) return;
+
+	size_t					run_first = 0,  n_branching = 0,  n_covered = 0;
+	vector<ns_clifford::Gate>	run_gates;		// The gates of the run so far, on the actual qubits.
+	vector<qubit_index_t>	run_qubits;
+	Complex					run_phase(1);
+
+	for (size_t pc = 0;  pc <= opn_seq.size();  pc++) {
+		// Is this operation Clifford?
+		vector<qubit_index_t>		qubits;
+		vector<ns_clifford::Gate>	gates;
+		Complex						phase;
+		bool						clifford = false;
+		if (pc < opn_seq.size() && !opn_seq[pc].isFunctional()) {
+			ns_opmatrix::qubits_of(opn_seq[pc], qubits);
+			if (qubits.size() <= 2) {
+				vector<Complex>	m;
+				ns_opmatrix::embed(operators.at(opn_seq[pc].operator_id), opn_seq[pc], qubits, m);
+				clifford = ns_clifford::decompose(m, qubits.size(), gates, phase);
+			}
+		}
+		vector<qubit_index_t>	merged(run_qubits);
+		if (clifford) {
+			merged.insert(merged.end(), qubits.begin(), qubits.end());
+			sort(merged.begin(), merged.end());
+			merged.erase(unique(merged.begin(), merged.end()), merged.end());
+		}
+
+		// If the run ends here, keep it as a segment if it's worth it, then start a new one.
+		if (!clifford || merged.size() > ns_clifford::max_segment_qubits) {
+			if (n_branching >= ns_clifford::min_segment_branching) {
+				CliffordSegment	seg;
+				seg.first = run_first;
+				seg.end = pc;
+				seg.qubits = run_qubits;
+				seg.phase = run_phase;
+				seg.gates = run_gates;
+				for (size_t g = 0;  g < seg.gates.size();  g++) {
+					seg.gates[g].a = ns_opmatrix::position_of(seg.qubits, seg.gates[g].a);
+					seg.gates[g].b = ns_opmatrix::position_of(seg.qubits, seg.gates[g].b);
+				}
+				clifford_segments.push_back(seg);
+				n_covered += pc - run_first;
+
+				if (ns_debug::trace) cout << "SEQCSim::find_clifford_segments(): Operations #" << seg.first << " to #" << seg.end - 1
+										  << " are a Clifford segment on " << seg.qubits.size() << " qubits, with "
+										  << seg.gates.size() << " gates.\n";
+			}
+			run_first = clifford ? pc : pc + 1;
+			run_gates.clear();
+			run_qubits.clear();
+			run_phase = Complex(1);
+			n_branching = 0;
+			if (clifford) merged = qubits;
+		}
+		if (!clifford) continue;
+
+		// Add it to the run, with its gates' qubit positions turned into actual qubits.
+		for (size_t g = 0;  g < gates.size();  g++) {
+			gates[g].a = qubits[gates[g].a];
+			gates[g].b = (gates[g].type == ns_clifford::GATE_CNOT) ? qubits[gates[g].b] : gates[g].a;
+			run_gates.push_back(gates[g]);
+		}
+		run_qubits = merged;
+		sort(run_qubits.begin(), run_qubits.end());
+		run_qubits.erase(unique(run_qubits.begin(), run_qubits.end()), run_qubits.end());
+		run_phase *= phase;
+		if (is_branching(opn_seq[pc])) n_branching++;
+	}
+
+	if (clifford_segments.empty()) return;
+	segment_ending_at.assign(opn_seq.size() + 1, -1);
+	for (size_t i = 0;  i < clifford_segments.size();  i++) segment_ending_at[clifford_segments[i].end] = (int)i;
+
+	cout << "SEQCSim::find_clifford_segments(): Found " << clifford_segments.size() << " Clifford segments, covering "
+		 << n_covered << " of the " << opn_seq.size() << " operations.\n";
+}
@@ -0,0 +1,129 @@
+//========================================================================
+// SEQCSim version 0.8 - The Space-Efficient Quantum Computer Simulator
+// By Michael P. Frank, Liviu Oniciuc, Uwe Meyer-Baese, and Liviu Oniciuc.
+// Copyright (C) 2008-2009  Florida State University Board of Trustees
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// 
+// You may contact the author at michael.patrick.frank@gmail.com, or at
+// Michael P. Frank, PO Box 025250 #24985, Miami, FL  33102-5250.
+//========================================================================
+
+//-------------------------------------------------------------------------
+// Clifford.h - Clifford segments of the circuit, which the engine goes back
+//   through in one step, using a stabilizer representation of the state.
+//
+// Long stretches of our circuits consist only of Clifford operations (H, X,
+// Z, S, cNOT, cZ, swaps, ...).  Going backwards through such a stretch in
+// recalc_amplitude() branches at every H, so the number of paths doubles each
+// time, even though the number of distinct predecessors at the start of the
+// stretch may be much smaller, and their amplitudes can be worked out in
+// polynomial time.  So, when the circuit is loaded, we recognize the Clifford
+// operations (those on at most 2 qubits, including controls, whose matrices
+// are, up to a phase, products of H, S and cNOT), and mark the maximal runs of
+// them in opn_seq as CliffordSegments.  When the recursion reaches the end of
+// a segment, it works out the predecessors of the current state at the start
+// of the segment all at once (see SEQCSim::recalc_through_clifford()).
+//
+// That uses the fact that C^-1|x>, for C a Clifford circuit and x a basis
+// state, is a stabilizer state, and so can be written (Dehaene & De Moor) as
+//
+//		sum_u  w^(2 Q(u)) |A u + b>  /  sqrt(2)^h
+//
+// where u ranges over all r-bit vectors, A is an n x r bit matrix of rank r,
+// b is an n-bit vector, all arithmetic on them is mod 2, w = exp(i pi/4), and
+// Q(u) = q0 + sum_j c_j u_j + 2 sum_j<k d_jk u_j u_k is a quadratic form taken
+// mod 4.  An AffineState keeps A, b, Q and h, and updates them for each H, S
+// and cNOT gate in polynomial time.  Its terms are then just the predecessors
+// y = A u + b, with amplitudes <x|C|y>.  The option "clifford_segments off"
+// turns all this off.
+//-------------------------------------------------------------------------
+
+#pragma once
+
+#include <vector>				// STL vector<> template.
+#include "index_types.h"		// operation_index_t, qubit_index_t
+#include "Complex.h"			// Amplitudes and phases.
+
+using namespace std;
+
+namespace ns_clifford {
+
+	// The bits of a segment's qubits are packed into a size_t (with room for one more, while
+	// an H is being applied), so this is the most qubits a segment can act on.
+	static const size_t		max_segment_qubits = 8*sizeof(size_t) - 1;
+
+	// A segment is only worth going through in one step if it has at least this many branching
+	// operations; shorter runs are left to the ordinary recursion.
+	static const size_t		min_segment_branching = 2;
+
+	// The gates Clifford operations are decomposed into.
+	enum gate_t { GATE_H, GATE_S, GATE_CNOT };
+
+	struct Gate {
+		gate_t			type;
+		qubit_index_t	a;			// The qubit it acts on (the control, for a cNOT).
+		qubit_index_t	b;			// For a cNOT, the target.
+	};
+
+	// If the dense matrix m (as from ns_opmatrix::embed()) on 1 or 2 qubits is a Clifford
+	// operator, set gates to a sequence of H, S and cNOT gates (on qubit positions 0 and 1,
+	// applied in order) and phase to a phase factor such that m = phase times their product,
+	// and return true.  Otherwise return false.
+	bool	decompose(const vector<Complex>& m, size_t n_qubits, vector<Gate>& gates, Complex& phase);
+
+	// The stabilizer state sum_u w^(2 Q(u)) |A u + b> / sqrt(2)^h (see the top of this file),
+	// on up to max_segment_qubits qubits.  It's fixed-size, so it needs no heap memory.
+	class AffineState {
+		size_t	r;							// The number of variables u_j.
+		size_t	col[max_segment_qubits + 1];	// The columns of A, as bit masks over the qubits.
+		size_t	b;							// The offset b.
+		int		c[max_segment_qubits + 1];	// The linear coefficients c_j of Q, mod 4.
+		size_t	d[max_segment_qubits + 1];	// The quadratic coefficients, d_jk = bit k of d[j] (symmetric).
+		int		w_exp;						// The phase w^w_exp, which includes 2*q0.
+		int		h;							// The normalization is 1/sqrt(2)^h.
+		bool	zero;							// Is it the zero vector?
+
+		void	add_variable(void);
+		void	remove_variable(size_t z);
+		void	change_variable(size_t j, size_t k);
+		void	add_linear_phase(size_t alpha, int beta, int m);
+		void	sum_out(size_t z);
+		void	reduce(void);
+
+	public:
+		// The basis state |x>.
+		AffineState(size_t x) : r(0), b(x), w_exp(0), h(0), zero(false) {}
+
+		void	apply_h(qubit_index_t q);
+		void	apply_s(qubit_index_t q);
+		void	apply_cnot(qubit_index_t control, qubit_index_t target);
+
+		// The number of terms (basis states with nonzero amplitudes), and the k'th of them,
+		// with its amplitude.
+		size_t	n_terms(void) const		{ return zero ? 0 : (size_t)1 << r; }
+		size_t	term(size_t k, Complex& amp) const;
+	};
+}
+
+// A maximal run of Clifford operations in opn_seq.
+
+class CliffordSegment {
+public:
+	operation_index_t			first;		// Index in opn_seq of its first operation...
+	operation_index_t			end;		//	...and just past its last one.
+	vector<qubit_index_t>		qubits;		// All the qubits it acts on.
+	vector<ns_clifford::Gate>	gates;		// Its operations, as gates on positions in qubits[], in order.
+	Complex						phase;		// The product of the phase factors of its operations.
+};
@@ -61,8 +61,9 @@ public:
 	
 	// Unary relational operations.
 
-	bool isNonzero(void) { return R || I; }	 // Is this complex number not equal to zero?
-	bool isZero(void) { return !isNonzero(); }	// It's 0 if it's not nonzero.
+	bool isNonzero(void) const { return R || I; }	 // Is this complex number not equal to zero?
+	bool isZero(void) const { return !isNonzero(); }	// It's 0 if it's not nonzero.
+	bool isReal(void) const { return I == 0; }			// Is the imaginary part exactly zero?
 
 	// Comparison relational operators.
 
@@ -72,13 +73,18 @@ public:
 
 	// Arithmetic unary operators.
 
-	double squared_norm() {return R*R + I*I;}		// The square of the norm (magnitude) of this complex number.
-	double norm() { return sqrt(squared_norm()); }	// The norm (magnitude) of this complex number.
+	double squared_norm() const {return R*R + I*I;}		// The square of the norm (magnitude) of this complex number.
+	double norm() const { return sqrt(squared_norm()); }	// The norm (magnitude) of this complex number.
+
+	// Conversion to a plain (double-precision) Complex.  Trivial for this class, but
+	// all the other amplitude types in Amplitude.h provide the same method, and the
+	// templated simulation engine relies on it.
+	Complex toComplex(void) const { return *this; }
 	
 	// Arithmetic binary operators.
 
 	// Multiplication (product) operator. (R1+iI1)(R2+iI2) = (R1*R2 - I1*I2) + i*(R1*I2 + I1*R2)
-	Complex operator*(Complex& multiplicand) {
+	Complex operator*(const Complex& multiplicand) const {
 		Complex product(									// Invokes default (copy-) constructor.
 					R*multiplicand.R - I*multiplicand.I,	// Initialize new R with real part of product.
 					R*multiplicand.I + I*multiplicand.R		// Initialize new I with imaginary part of product.
@@ -86,6 +92,10 @@ public:
 		return product;
 	}
 
+	// Addition and subtraction operators.
+	Complex operator+(const Complex& addend) const     { return Complex(R + addend.R, I + addend.I); }
+	Complex operator-(const Complex& subtrahend) const { return Complex(R - subtrahend.R, I - subtrahend.I); }
+
 	// Modification operators.
 	
 	Complex& operator*=(Complex multiplicand) {					// In-place complex multiplication.
@@ -0,0 +1,350 @@
+//========================================================================
+// SEQCSim version 0.8 - The Space-Efficient Quantum Computer Simulator
+// By Michael P. Frank, Liviu Oniciuc, Uwe Meyer-Baese, and Liviu Oniciuc.
+// Copyright (C) 2008-2009  Florida State University Board of Trustees
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// 
+// You may contact the author at michael.patrick.frank@gmail.com, or at
+// Michael P. Frank, PO Box 025250 #24985, Miami, FL  33102-5250.
+//========================================================================
+
+// ComplexKernels.cpp - Scalar and SIMD implementations of the complex kernels
+//   declared in ComplexKernels.h, plus the CPUID-based runtime dispatch logic.
+
+#include "ComplexKernels.h"
+
+// Figure out which SIMD instruction sets the compiler we're being built with
+// knows how to generate code for.  Note that this is a question about the
+// compiler, not the CPU; whether the CPU can actually execute the resulting
+// code is checked separately, at runtime, by detect_cpu_isa() below.
+
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+	#include <intrin.h>				// __cpuid(), __cpuidex(), _xgetbv()
+	#include <emmintrin.h>			// SSE2 intrinsics.  (Available since Visual C++ 2005.)
+	#define KERNELS_HAVE_SSE2	1
+	#if _MSC_VER >= 1800			// Visual C++ 2013 and up know about AVX2/FMA.
+		#include <immintrin.h>
+		#define KERNELS_HAVE_AVX2	1
+	#endif
+	#if _MSC_VER >= 1910			// Visual C++ 2017 and up know about AVX-512.
+		#define KERNELS_HAVE_AVX512	1
+	#endif
+	#define KERNEL_TARGET(isa)		// Visual C++ lets us use any intrinsics in any function.
+#elif defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+	#include <cpuid.h>				// __get_cpuid(), __cpuid_count()
+	#include <emmintrin.h>
+	#define KERNELS_HAVE_SSE2	1
+	#if (__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)
+		#include <immintrin.h>		// GCC 4.9 and up allow per-function target ISAs.
+		#define KERNELS_HAVE_AVX2	1
+		#define KERNELS_HAVE_AVX512	1
+	#endif
+	#define KERNEL_TARGET(isa)		__attribute__((target(isa)))
+#endif
+
+namespace ns_kernels {
+
+	//-----------------------------------------------------------------------
+	// Portable scalar implementation.  The order of operations here is the
+	// same as in Complex::operator*() followed by Complex::operator+=(), so
+	// that results are bitwise identical to those of the original loops.
+
+	static void cdot_scalar(size_t n,
+							const double* a_re, const double* a_im,
+							const double* x_re, const double* x_im,
+							double* r_re, double* r_im)
+	{
+		double	sum_re = 0, sum_im = 0;
+		for (size_t j = 0; j < n; j++) {
+			sum_re += a_re[j]*x_re[j] - a_im[j]*x_im[j];
+			sum_im += a_re[j]*x_im[j] + a_im[j]*x_re[j];
+		}
+		*r_re = sum_re;  *r_im = sum_im;
+	}
+
+#ifdef KERNELS_HAVE_SSE2
+	//-----------------------------------------------------------------------
+	// SSE2 implementation: processes 2 complex elements per iteration.
+	// We keep four separate partial-sum registers (for the four real products
+	// making up each complex product) and combine them only at the very end.
+	// So the additions are done in a different order than in the scalar code,
+	// and the results can differ from it in the last bits, like those of the
+	// AVX kernels.
+
+	KERNEL_TARGET("sse2")
+	static void cdot_sse2(size_t n,
+						  const double* a_re, const double* a_im,
+						  const double* x_re, const double* x_im,
+						  double* r_re, double* r_im)
+	{
+		__m128d	rr = _mm_setzero_pd(), ii = _mm_setzero_pd();	// Sums of a_re*x_re, a_im*x_im.
+		__m128d	ri = _mm_setzero_pd(), ir = _mm_setzero_pd();	// Sums of a_re*x_im, a_im*x_re.
+		size_t	j = 0;
+		for (; j + 2 <= n; j += 2) {
+			__m128d	ar = _mm_loadu_pd(a_re + j), ai = _mm_loadu_pd(a_im + j);
+			__m128d	xr = _mm_loadu_pd(x_re + j), xi = _mm_loadu_pd(x_im + j);
+			rr = _mm_add_pd(rr, _mm_mul_pd(ar, xr));
+			ii = _mm_add_pd(ii, _mm_mul_pd(ai, xi));
+			ri = _mm_add_pd(ri, _mm_mul_pd(ar, xi));
+			ir = _mm_add_pd(ir, _mm_mul_pd(ai, xr));
+		}
+		double	s_re[2], s_im[2];
+		_mm_storeu_pd(s_re, _mm_sub_pd(rr, ii));
+		_mm_storeu_pd(s_im, _mm_add_pd(ri, ir));
+		double	sum_re = s_re[0] + s_re[1],  sum_im = s_im[0] + s_im[1];
+		for (; j < n; j++) {		// Leftover odd element, if any.
+			sum_re += a_re[j]*x_re[j] - a_im[j]*x_im[j];
+			sum_im += a_re[j]*x_im[j] + a_im[j]*x_re[j];
+		}
+		*r_re = sum_re;  *r_im = sum_im;
+	}
+#endif
+
+#ifdef KERNELS_HAVE_AVX2
+	//-----------------------------------------------------------------------
+	// AVX2 implementation: processes 4 complex elements per iteration, using
+	// fused multiply-add instructions for the accumulation.
+
+	KERNEL_TARGET("avx2,fma")
+	static void cdot_avx2(size_t n,
+						  const double* a_re, const double* a_im,
+						  const double* x_re, const double* x_im,
+						  double* r_re, double* r_im)
+	{
+		__m256d	acc_re = _mm256_setzero_pd(), acc_im = _mm256_setzero_pd();
+		size_t	j = 0;
+		for (; j + 4 <= n; j += 4) {
+			__m256d	ar = _mm256_loadu_pd(a_re + j), ai = _mm256_loadu_pd(a_im + j);
+			__m256d	xr = _mm256_loadu_pd(x_re + j), xi = _mm256_loadu_pd(x_im + j);
+			acc_re = _mm256_fmadd_pd(ar, xr, acc_re);		// acc_re += a_re*x_re
+			acc_re = _mm256_fnmadd_pd(ai, xi, acc_re);		// acc_re -= a_im*x_im
+			acc_im = _mm256_fmadd_pd(ar, xi, acc_im);		// acc_im += a_re*x_im
+			acc_im = _mm256_fmadd_pd(ai, xr, acc_im);		// acc_im += a_im*x_re
+		}
+		double	s_re[4], s_im[4];
+		_mm256_storeu_pd(s_re, acc_re);
+		_mm256_storeu_pd(s_im, acc_im);
+		double	sum_re = (s_re[0] + s_re[1]) + (s_re[2] + s_re[3]);
+		double	sum_im = (s_im[0] + s_im[1]) + (s_im[2] + s_im[3]);
+		for (; j < n; j++) {		// Leftover elements (fewer than 4).
+			sum_re += a_re[j]*x_re[j] - a_im[j]*x_im[j];
+			sum_im += a_re[j]*x_im[j] + a_im[j]*x_re[j];
+		}
+		*r_re = sum_re;  *r_im = sum_im;
+	}
+#endif
+
+#ifdef KERNELS_HAVE_AVX512
+	//-----------------------------------------------------------------------
+	// AVX-512 implementation: processes 8 complex elements per iteration.
+	// The leftover elements are handled by a masked final iteration rather
+	// than by a scalar loop.
+
+	KERNEL_TARGET("avx512f")
+	static void cdot_avx512(size_t n,
+							const double* a_re, const double* a_im,
+							const double* x_re, const double* x_im,
+							double* r_re, double* r_im)
+	{
+		__m512d	acc_re = _mm512_setzero_pd(), acc_im = _mm512_setzero_pd();
+		size_t	j = 0;
+		for (; j + 8 <= n; j += 8) {
+			__m512d	ar = _mm512_loadu_pd(a_re + j), ai = _mm512_loadu_pd(a_im + j);
+			__m512d	xr = _mm512_loadu_pd(x_re + j), xi = _mm512_loadu_pd(x_im + j);
+			acc_re = _mm512_fmadd_pd(ar, xr, acc_re);
+			acc_re = _mm512_fnmadd_pd(ai, xi, acc_re);
+			acc_im = _mm512_fmadd_pd(ar, xi, acc_im);
+			acc_im = _mm512_fmadd_pd(ai, xr, acc_im);
+		}
+		if (j < n) {
+			__mmask8	m  = (__mmask8)((1u << (n - j)) - 1);	// One mask bit per leftover element.
+			__m512d		ar = _mm512_maskz_loadu_pd(m, a_re + j), ai = _mm512_maskz_loadu_pd(m, a_im + j);
+			__m512d		xr = _mm512_maskz_loadu_pd(m, x_re + j), xi = _mm512_maskz_loadu_pd(m, x_im + j);
+			acc_re = _mm512_fmadd_pd(ar, xr, acc_re);
+			acc_re = _mm512_fnmadd_pd(ai, xi, acc_re);
+			acc_im = _mm512_fmadd_pd(ar, xi, acc_im);
+			acc_im = _mm512_fmadd_pd(ai, xr, acc_im);
+		}
+		double	s_re[8], s_im[8];
+		_mm512_storeu_pd(s_re, acc_re);
+		_mm512_storeu_pd(s_im, acc_im);
+		double	sum_re = 0, sum_im = 0;
+		for (int k = 0; k < 8; k++) { sum_re += s_re[k];  sum_im += s_im[k]; }
+		*r_re = sum_re;  *r_im = sum_im;
+	}
+#endif
+
+	//-----------------------------------------------------------------------
+	// Runtime CPU feature detection.
+
+	// Execute the CPUID instruction for the given leaf & subleaf, returning EAX..EDX in regs[0..3].
+	static void cpuid(unsigned int leaf, unsigned int subleaf, unsigned int regs[4]) {
+		regs[0] = regs[1] = regs[2] = regs[3] = 0;
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+		int r[4];
+		__cpuidex(r, (int)leaf, (int)subleaf);
+		for (int i = 0; i < 4; i++) regs[i] = (unsigned int)r[i];
+#elif defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+		if ((unsigned int)__get_cpuid_max(0, 0) >= leaf) {
+			__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+		}
+#else
+		(void)leaf; (void)subleaf;
+#endif
+	}
+
+	// Read the XCR0 register, which tells which register files the OS saves on
+	// context switches.  (Even if the CPU supports AVX, we can't use it unless
+	// the operating system has enabled it.)
+	static unsigned int read_xcr0(void) {
+#if defined(_MSC_VER) && defined(KERNELS_HAVE_AVX2)
+		return (unsigned int)_xgetbv(0);
+#elif defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+		unsigned int eax, edx;
+		__asm__ __volatile__ ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+		return eax;
+#else
+		return 0;
+#endif
+	}
+
+	// Find the best instruction-set level which is supported both by the
+	// compiler (i.e., compiled in) and by the CPU we're running on.
+	static isa_level detect_cpu_isa(void) {
+		isa_level		best = ISA_SCALAR;
+		unsigned int	leaf1[4], leaf7[4];
+		cpuid(1, 0, leaf1);
+		cpuid(7, 0, leaf7);
+
+#ifdef KERNELS_HAVE_SSE2
+		if (leaf1[3] & (1u << 26)) best = ISA_SSE2;					// EDX bit 26: SSE2.
+#endif
+		bool	os_saves_ymm = false, os_saves_zmm = false;
+		if (leaf1[2] & (1u << 27)) {								// ECX bit 27: OSXSAVE.
+			unsigned int	xcr0 = read_xcr0();
+			os_saves_ymm = (xcr0 & 0x06) == 0x06;					// XMM and YMM state.
+			os_saves_zmm = (xcr0 & 0xe6) == 0xe6;					// ... plus opmask and ZMM state.
+		}
+#ifdef KERNELS_HAVE_AVX2
+		if (os_saves_ymm &&
+			(leaf1[2] & (1u << 28)) &&								// ECX bit 28: AVX.
+			(leaf1[2] & (1u << 12)) &&								// ECX bit 12: FMA.
+			(leaf7[1] & (1u << 5)))									// Leaf 7 EBX bit 5: AVX2.
+		{
+			best = ISA_AVX2;
+		}
+#endif
+#ifdef KERNELS_HAVE_AVX512
+		if (os_saves_zmm && (leaf7[1] & (1u << 16))) {				// Leaf 7 EBX bit 16: AVX-512F.
+			best = ISA_AVX512;
+		}
+#endif
+		(void)os_saves_ymm; (void)os_saves_zmm;
+		return best;
+	}
+
+	//-----------------------------------------------------------------------
+	// Dispatching.
+
+	typedef void (*cdot_fn_t)(size_t, const double*, const double*, const double*, const double*, double*, double*);
+
+	static volatile bool	dispatch_initialized	= false;
+	static isa_level		cpu_isa					= ISA_SCALAR;	// Best level the CPU supports.
+	static isa_level		cur_isa					= ISA_SCALAR;	// Level we're currently dispatching to.
+	static cdot_fn_t		cdot_impl				= cdot_scalar;
+	static size_t			min_vector_len			= 0;			// Shorter vectors just use the scalar code.
+
+	// Point the dispatch variables at the implementation for the given level,
+	// stepping down to lower levels until we find one that is compiled in.
+	static void select_isa(isa_level isa) {
+		if (isa > cpu_isa) isa = cpu_isa;
+		cur_isa = ISA_SCALAR;  cdot_impl = cdot_scalar;  min_vector_len = 0;
+#ifdef KERNELS_HAVE_AVX512
+		if (isa >= ISA_AVX512) { cur_isa = ISA_AVX512;  cdot_impl = cdot_avx512;  min_vector_len = 8;  return; }
+#endif
+#ifdef KERNELS_HAVE_AVX2
+		if (isa >= ISA_AVX2)   { cur_isa = ISA_AVX2;    cdot_impl = cdot_avx2;    min_vector_len = 4;  return; }
+#endif
+#ifdef KERNELS_HAVE_SSE2
+		if (isa >= ISA_SSE2)   { cur_isa = ISA_SSE2;    cdot_impl = cdot_sse2;    min_vector_len = 2;  return; }
+#endif
+	}
+
+	// The first call does the detection.  It's in a critical section, since the
+	// first call might come from inside a parallel region (see StateVector.cpp),
+	// and dispatch_initialized is only set once the dispatch variables are.
+	static void init_dispatch(void) {
+		if (dispatch_initialized) return;
+		#pragma omp critical (ns_kernels_dispatch)
+		{
+			if (!dispatch_initialized) {
+				cpu_isa = detect_cpu_isa();
+				select_isa(cpu_isa);
+				#pragma omp flush
+				dispatch_initialized = true;
+			}
+		}
+	}
+
+	isa_level active_isa(void) {
+		init_dispatch();
+		return cur_isa;
+	}
+
+	const char* isa_name(isa_level isa) {
+		switch (isa) {
+			case ISA_SSE2:		return "SSE2";
+			case ISA_AVX2:		return "AVX2+FMA";
+			case ISA_AVX512:	return "AVX-512F";
+			default:			return "scalar";
+		}
+	}
+
+	void limit_isa(isa_level max_isa) {
+		init_dispatch();
+		select_isa(max_isa);
+	}
+
+	//-----------------------------------------------------------------------
+	// Public entry points.
+
+	void cdot(size_t n,
+			  const double* a_re, const double* a_im,
+			  const double* x_re, const double* x_im,
+			  double* r_re, double* r_im)
+	{
+		init_dispatch();
+		if (n < min_vector_len) {
+			cdot_scalar(n, a_re, a_im, x_re, x_im, r_re, r_im);	// Too short to be worth vectorizing.
+		} else {
+			cdot_impl(n, a_re, a_im, x_re, x_im, r_re, r_im);
+		}
+	}
+
+	void cgemv(size_t rows, size_t cols,
+			   const double* a_re, const double* a_im,
+			   const double* x_re, const double* x_im,
+			   double* y_re, double* y_im)
+	{
+		init_dispatch();
+		cdot_fn_t	row_kernel = (cols < min_vector_len) ? cdot_scalar : cdot_impl;
+
+		// Each output element is the dot product of one row of A with x.  The rows
+		// of a block are short enough that x stays in L1 cache throughout.
+		for (size_t i = 0; i < rows; i++) {
+			row_kernel(cols, a_re + i*cols, a_im + i*cols, x_re, x_im, y_re + i, y_im + i);
+		}
+	}
+}
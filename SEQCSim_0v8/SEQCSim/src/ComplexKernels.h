@@ -0,0 +1,93 @@
+//========================================================================
+// SEQCSim version 0.8 - The Space-Efficient Quantum Computer Simulator
+// By Michael P. Frank, Liviu Oniciuc, Uwe Meyer-Baese, and Liviu Oniciuc.
+// Copyright (C) 2008-2009  Florida State University Board of Trustees
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// 
+// You may contact the author at michael.patrick.frank@gmail.com, or at
+// Michael P. Frank, PO Box 025250 #24985, Miami, FL  33102-5250.
+//========================================================================
+
+//-------------------------------------------------------------------------
+// ComplexKernels.h - Declares the vectorized complex linear-algebra kernels
+//   used in the inner loops of the simulator.
+//
+// Once operators of larger arity are in use, the blocks of an operator's
+// (block-diagonal) unitary matrix can have rank up to 2^arity, and the
+// block matrix-vector multiply in SEQCSim::Bohm_step_forwards() and the
+// weighted sum over predecessors in SEQCSim::recalc_amplitude() become
+// genuine complex matrix-vector products.  The kernels declared here do
+// that work on arrays stored in "split" form, that is, with the real parts
+// and the imaginary parts of the complex numbers kept in two separate
+// arrays of doubles, which is the layout that maps best onto SIMD registers.
+//
+// Several implementations of each kernel are compiled (plain scalar code,
+// SSE2, AVX2+FMA, and AVX-512), to the extent that the compiler in use
+// supports the corresponding intrinsics.  The first time a kernel is called,
+// we ask the CPU (via CPUID) which instruction sets it actually supports,
+// and from then on dispatch to the fastest implementation available.
+//-------------------------------------------------------------------------
+
+#pragma once
+
+#include <stddef.h>			// size_t
+
+namespace ns_kernels {
+
+	// Instruction-set levels for which we have kernel implementations,
+	// in increasing order of preference.
+
+	enum isa_level {
+		ISA_SCALAR	= 0,		// Portable C++ code; always available.
+		ISA_SSE2	= 1,		// 128-bit SSE2 (2 doubles per register).
+		ISA_AVX2	= 2,		// 256-bit AVX2 with fused multiply-add (4 doubles per register).
+		ISA_AVX512	= 3			// 512-bit AVX-512F (8 doubles per register).
+	};
+
+	// Returns the instruction-set level that the kernels are dispatching to.
+	// (This is the best level that is both compiled in and supported by the CPU.)
+	isa_level	active_isa(void);
+
+	// Returns a short printable name for the given instruction-set level.
+	const char*	isa_name(isa_level isa);
+
+	// Forces the kernels to dispatch to the given instruction-set level, or to
+	// the best available level below it if the given level isn't available.
+	// (This is mainly useful for checking the vector kernels against the scalar ones.)
+	void		limit_isa(isa_level max_isa);
+
+	// Complex general matrix-vector multiply:  y = A x.
+	//
+	// A is a (rows x cols) complex matrix stored in row-major order as the split
+	// arrays a_re[] and a_im[]; x is a complex vector of length cols, stored as x_re[]
+	// and x_im[]; and the resulting complex vector y, of length rows, is written into
+	// y_re[] and y_im[].  The output arrays must not overlap the input arrays.
+
+	void cgemv(size_t rows, size_t cols,
+			   const double* a_re, const double* a_im,
+			   const double* x_re, const double* x_im,
+			   double* y_re, double* y_im);
+
+	// Complex dot product (without conjugation):  r = sum_j a[j]*x[j].
+	//
+	// This is the same as a one-row cgemv(), and is what we use to accumulate the
+	// amplitudes of a batch of predecessor states, weighted by the corresponding
+	// elements of a row of an operator matrix.
+
+	void cdot(size_t n,
+			  const double* a_re, const double* a_im,
+			  const double* x_re, const double* x_im,
+			  double* r_re, double* r_im);
+}
@@ -24,7 +24,8 @@
 //    of class Configuration.
 
 #include <string>
-#include <sstream>			// istringstream
+#include <sstream>			// istringstream, ostringstream
+#include <stdlib.h>			// exit()
 #include "Configuration.h"
 #include "FileReader.h"
 #include "debug.h"
@@ -75,7 +76,32 @@ void Configuration::initFromFile(const string& filename) {
 		string ignored_word, important_word, ignore_at_sign;
 		lineStream >> ignored_word >> important_word;
 
-		if (important_word.compare("bit:") == 0) {	// This line defines a named bit.
+		if (ignored_word.compare("option:") == 0) {		// This line sets a simulator option.
+
+			// Format is "option: <name> <value>", where the value is the rest of the line.
+			string	value;
+			getline(lineStream, value);
+			size_t	first = value.find_first_not_of(" \t"),  last = value.find_last_not_of(" \t\r");
+			value = (first == string::npos) ? "" : value.substr(first, last - first + 1);
+
+			options[important_word] = value;
+			if (ns_debug::trace) cout << "Configuration::initFromFile(): Option " << important_word << " = [" << value << "].\n";
+
+		} else if (ignored_word.compare("measure:") == 0) {	// This line lists the registers to be measured.
+
+			// Format is "measure: <name1>, <name2>, ...".  We already read the first name
+			// (possibly with a trailing comma); the rest of the line has any others.
+			string	rest, name;
+			getline(lineStream, rest);
+			istringstream	namesStream(important_word + " " + rest);
+			while (getline(namesStream, name, ',')) {
+				size_t	first = name.find_first_not_of(" \t"),  last = name.find_last_not_of(" \t\r");
+				if (first == string::npos) continue;
+				measuredNames.push_back(name.substr(first, last - first + 1));
+				if (ns_debug::trace) cout << "Configuration::initFromFile(): Will measure " << measuredNames.back() << ".\n";
+			}
+
+		} else if (important_word.compare("bit:") == 0) {	// This line defines a named bit.
 
 			nNamedBits++;
 			namedBits.resize(nNamedBits);
@@ -181,3 +207,66 @@ qubit_index_t	Configuration::lookup_byName(const string& bitName){
 		return			namedBit->address;
 	}
 }
+
+// Looks up a given register in the configuration by name.  A register is either
+// a named bit array (e.g. "a", for a[0] through a[n-1]) or a single named bit.
+void	Configuration::lookup_register(const string& regName, vector<qubit_index_t>& regBits){
+	if (ns_debug::trace) cout << "Configuration::lookup_register(): Looking up the register named " << regName << ".\n";
+
+	regBits.clear();
+	NamedBitArray*	bitArray = _lookup_named_bitarray(regName);
+	if (bitArray != NULL) {
+		for (qubit_index_t i = 0;  i < bitArray->length;  i++) regBits.push_back(bitArray->addressOfBit(i));
+		return;
+	}
+	for (qubit_index_t i = 0;  i < namedBits.size();  i++) {
+		if (namedBits[i].name == regName) { regBits.push_back(namedBits[i].address);  return; }
+	}
+	cout << "Configuration::lookup_register(): Error: Unable to locate a register named " << regName << ".\n";
+	exit(1);
+}
+
+// Finds a name for the bit at the given address.  Named bits take priority over bit arrays.
+string	Configuration::name_of_bit(qubit_index_t address){
+	ostringstream	name;
+	for (qubit_index_t i = 0;  i < namedBits.size();  i++) {
+		if (namedBits[i].address == address) return namedBits[i].name;
+	}
+	for (unsigned short i = 0;  i < namedBitArrays.size();  i++) {
+		NamedBitArray&	arr = namedBitArrays[i];
+		if (address >= arr.baseAddress && address < arr.baseAddress + arr.length) {
+			name << arr.name << "[" << (address - arr.baseAddress) << "]";
+			return name.str();
+		}
+	}
+	name << "?" << address;
+	return name.str();
+}
+
+// Returns the value of the named option, or the given default if it wasn't set.
+string	Configuration::option_string(const string& name, const string& default_value) {
+	map<string,string>::iterator	it = options.find(name);
+	return (it == options.end()) ? default_value : it->second;
+}
+
+// Returns the value of the named option, interpreted as a number.
+double	Configuration::option_double(const string& name, double default_value) {
+	map<string,string>::iterator	it = options.find(name);
+	if (it == options.end()) return default_value;
+	istringstream	valueStream(it->second);
+	double			value = default_value;
+	if (!(valueStream >> value)) {
+		cout << "Configuration::option_double(): Error! The value [" << it->second << "] of option " << name 
+			 << " is not a number.  Using the default value " << default_value << ".\n";
+		return default_value;
+	}
+	return value;
+}
+
+// Returns the value of the named option, interpreted as a Boolean flag.
+bool	Configuration::option_flag(const string& name, bool default_value) {
+	map<string,string>::iterator	it = options.find(name);
+	if (it == options.end()) return default_value;
+	const string&	v = it->second;
+	return v == "on" || v == "yes" || v == "true" || v == "1";
+}
@@ -33,6 +33,7 @@
 
 #include <string>			// STL string class
 #include <vector>			// STL vector<> template
+#include <map>				// STL map<> template, for the table of options
 #include "index_types.h"	// qubit_index_t type
 
 using namespace std;		// This line lets us say "string" instead of "std::string"
@@ -82,6 +83,18 @@ public:
 	unsigned short			nNamedBitArrays;	// Number of named qubit arrays.
 	vector<NamedBitArray>	namedBitArrays;		// Named qubit arrays in the quantum computer.
 
+	// Simulator options, given in the configuration file by lines of the form
+	// "option: <name> <value>".  These select among alternative simulation
+	// strategies and tune their parameters; any option that isn't mentioned
+	// in the file takes on a default value chosen by the code that uses it.
+	map<string,string>		options;			// Maps option names to their (textual) values.
+
+	// The registers (or single bits) that will be measured at the end, given in the
+	// configuration file by a line of the form "measure: <name1>, <name2>, ...".  If
+	// there is one, only their (joint) distribution matters, so any operation that can't
+	// affect them is dropped before simulation (see SEQCSim::prune_light_cone()).
+	vector<string>			measuredNames;		// Empty if there's no "measure:" line.
+
 private:
 	// Private member functions.
 	NamedBit*		_lookup_named_bit(const string& bitName);		   // Look up the NamedBit having the given name.
@@ -104,5 +117,20 @@ public:
 
 	// Look up a bit in the configuration, by name.
 	qubit_index_t	lookup_byName(const string& bitName);
+
+	// Look up a whole register (a named bit array, or a single named bit), by name.
+	// Its qubit addresses are stored in regBits, least-significant bit first.
+	void			lookup_register(const string& regName, vector<qubit_index_t>& regBits);
+
+	// The reverse of lookup_byName():  A name for the bit at the given address (e.g. "a[2]"),
+	// suitable for writing out in a qopseq.txt file.  Unnamed bits are called "?<address>".
+	string			name_of_bit(qubit_index_t address);
+
+	// Look up the value of a simulator option, returning the given default value
+	// if the option was not set in the configuration file.
+	bool			has_option(const string& name) { return options.find(name) != options.end(); }
+	string			option_string(const string& name, const string& default_value);
+	double			option_double(const string& name, double default_value);
+	bool			option_flag(const string& name, bool default_value);	// "on"/"yes"/"true"/"1" vs. anything else.
 };
 
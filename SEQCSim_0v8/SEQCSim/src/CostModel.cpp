@@ -0,0 +1,202 @@
+//========================================================================
+// SEQCSim version 0.8 - The Space-Efficient Quantum Computer Simulator
+// By Michael P. Frank, Liviu Oniciuc, Uwe Meyer-Baese, and Liviu Oniciuc.
+// Copyright (C) 2008-2009  Florida State University Board of Trustees
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// 
+// You may contact the author at michael.patrick.frank@gmail.com, or at
+// Michael P. Frank, PO Box 025250 #24985, Miami, FL  33102-5250.
+//========================================================================
+
+//-------------------------------------------------------------------------
+// CostModel.cpp - The static cost model (see CostModel.h), and the automatic
+//   choice of engine.
+//
+// Two bounds, worked out for each PC, go into most of the estimates:
+//
+//	- The recursion frames recalc_amplitude() takes to find an amplitude at
+//		PC t.  Going back through an operation whose blocks have rank (at
+//		most) b, it recurses once for each of up to b predecessors, so
+//
+//			F(t) = b_(t-1) * (1 + F(t-1)),		F(0) = 0,
+//
+//		as in the scheduling pass (see Schedule.cpp), except that where a
+//		subcircuit instance with a transfer table, or a Clifford segment, ends
+//		at t, the recursion jumps back to its start in one step, with one
+//		frame for each predecessor there.  (For an instance, that's at most the
+//		product of its operations' ranks, and at most 2^k for k qubits;  for a
+//		segment, at most 2^h for h Hadamards, and at most 2^k too.)  The
+//		recursion follows every path, even those whose amplitude turns out to
+//		be 0, so light cones don't shorten it.
+//
+//	- The support:  the number of basis states with nonzero amplitudes at PC
+//		t.  Each branching operation multiplies it by (at most) its rank b.
+//		But it's also at most 2^k, for k the qubits in the forward light cone
+//		of the branching operations:  those they act on, plus those acted on
+//		by any later operation (other than a diagonal one, which doesn't change
+//		any values) that involves a qubit already in the light cone.  Every
+//		other qubit has the same value in every basis state of the support.
+//
+// The bounds are clamped to ns_cost::huge, so that they don't overflow.
+//-------------------------------------------------------------------------
+
+#include <iostream>				// cout
+#include <sstream>				// ostringstream
+#include <vector>				// STL vector<> template.
+#include <algorithm>			// min(), max()
+#include <math.h>				// pow()
+#include "SEQCSim.h"
+#include "OperationMatrix.h"	// ns_opmatrix::qubits_of()
+#include "debug.h"				// ns_debug::trace
+
+using namespace std;
+
+// Work out the bounds on the recursion (frame_bounds) and the support (support_bounds) at
+// each PC, as described at the top of this file.
+
+void SEQCSim::find_cost_bounds() {
+	size_t			n_opns = opn_seq.size(),  nbits = qc_config.nbits;
+	vector<bool>	in_cone(nbits, false);
+	size_t			n_in_cone = 0;
+
+	frame_bounds.assign(n_opns + 1, 0);
+	support_bounds.assign(n_opns + 1, 1);
+
+	for (size_t t = 0;  t < n_opns;  t++) {
+		const Operation&		opn = opn_seq[t];
+		double					b = (double)branching_factor(opn);
+		vector<qubit_index_t>	qubits;
+
+		// The recursion going back from t + 1.
+		double	frames = ns_cost::times(b, ns_cost::plus(1, frame_bounds[t]));
+		if (!instance_ending_at.empty() && instance_ending_at[t + 1] >= 0) {
+			const SubcircuitInstance&	inst = subcircuit_instances[instance_ending_at[t + 1]];
+			double						terms = 1;
+			for (size_t i = inst.first;  i < inst.end;  i++) terms = ns_cost::times(terms, (double)branching_factor(opn_seq[i]));
+			terms = min(terms, pow(2.0, (double)inst.qubits.size()));
+			frames = ns_cost::times(terms, ns_cost::plus(1, frame_bounds[inst.first]));
+		} else if (!segment_ending_at.empty() && segment_ending_at[t + 1] >= 0) {
+			const CliffordSegment&	seg = clifford_segments[segment_ending_at[t + 1]];
+			size_t					n_hadamards = 0;
+			for (size_t i = 0;  i < seg.gates.size();  i++) if (seg.gates[i].type == ns_clifford::GATE_H) n_hadamards++;
+			double	terms = pow(2.0, (double)min(n_hadamards, seg.qubits.size()));
+			frames = ns_cost::times(terms, ns_cost::plus(1, frame_bounds[seg.first]));
+		}
+		frame_bounds[t + 1] = frames;
+
+		// The light cone of the branching operations, and the support.
+		ns_opmatrix::qubits_of(opn, qubits);
+		bool	diagonal = opn.isFunctional() ? (functions[opn.function_id].kind == FunctionalOperator::PHASE_ORACLE)
+											  : (operators.at(opn.operator_id).form == Operator::DIAGONAL);
+		bool	touches_cone = false;
+		for (size_t i = 0;  i < qubits.size();  i++) if (in_cone[qubits[i]]) touches_cone = true;
+		if (!diagonal && (b > 1 || touches_cone)) {
+			for (size_t i = 0;  i < opn.operands.size();  i++) {
+				if (!in_cone[opn.operands[i]]) n_in_cone++;
+				in_cone[opn.operands[i]] = true;
+			}
+		}
+		support_bounds[t + 1] = min(ns_cost::times(support_bounds[t], b), min(pow(2.0, (double)n_in_cone), ns_cost::huge));
+
+		if (ns_debug::trace) {
+			cout << "SEQCSim::find_cost_bounds(): At PC " << t + 1 << ", the recursion takes at most " << frame_bounds[t + 1]
+				 << " frames, and the support has at most " << support_bounds[t + 1] << " states.\n";
+		}
+	}
+}
+
+// The cost of running the circuit with the path-integral engine.  Each forward step through
+// a branching operation at PC t finds the amplitudes of (up to) b_t states at t, with
+// F(t) frames each, and so does every shot.  The memory is just the stack of frames.
+
+void SEQCSim::estimate_path_integral(EngineEstimate& est) {
+	double		n_shots = qc_config.option_double("shots", 1);
+	double		frames = (double)opn_seq.size();
+	for (size_t t = 0;  t < opn_seq.size();  t++) {
+		double	b = (double)branching_factor(opn_seq[t]);
+		if (b > 1) frames = ns_cost::plus(frames, ns_cost::times(b, frame_bounds[t]));
+	}
+	est.seconds = ns_cost::times(ns_cost::times(frames, n_shots), ns_cost::seconds_per_frame);
+	est.memory_mb = (opn_seq.size() + 1) * (qc_config.nbits/8 + 64 + 4*max_block_rank*sizeof(Complex)) / (1024.0*1024);
+
+	ostringstream	note;
+	note << "at most " << frames << " recursion frames for each shot";
+	est.note = note.str();
+}
+
+// Estimate the cost of each engine.
+
+void SEQCSim::estimate_costs(vector<EngineEstimate>& estimates) {
+	static const char*	engine_options[] = { "path", "statevector", "sparse", "hybrid", "phasepoly", "tensornet", "mps", "dd" };
+
+	estimates.clear();
+	for (size_t i = 0;  i < sizeof(engine_options)/sizeof(engine_options[0]);  i++) {
+		estimates.push_back(EngineEstimate(engine_options[i]));
+	}
+	estimate_path_integral(estimates[0]);
+	estimate_state_vector(estimates[1]);
+	estimate_sparse(estimates[2]);
+	estimate_hybrid(estimates[3]);
+	estimate_phase_poly(estimates[4]);
+	estimate_tensor_network(estimates[5]);
+	estimate_mps(estimates[6]);
+	estimate_dd(estimates[7]);
+}
+
+// Print the estimates.
+
+void SEQCSim::report_costs(const vector<EngineEstimate>& estimates) {
+	cout << "SEQCSim::report_costs(): Estimated costs of the engines (rough upper bounds):\n";
+	for (size_t i = 0;  i < estimates.size();  i++) {
+		const EngineEstimate&	est = estimates[i];
+		cout << "   " << est.option << ":  ";
+		if (est.possible) {
+			if (est.seconds >= ns_cost::huge)	cout << "more than " << ns_cost::huge << " s";
+			else								cout << est.seconds << " s";
+			cout << ", " << est.memory_mb << " MB" << (est.exact ? "" : ", not exact");
+		} else {
+			cout << "not possible";
+		}
+		cout << " (" << est.note << ").\n";
+	}
+}
+
+// For "option: engine auto", estimate the cost of each engine, and return the option for
+// the one expected to be fastest, of those that are possible and exact.  (There's always
+// one, since the path-integral engine is both.)  If even it would take too long, refuse to
+// run at all.
+
+string SEQCSim::choose_engine_automatically() {
+	vector<EngineEstimate>	estimates;
+	estimate_costs(estimates);
+	report_costs(estimates);
+
+	size_t	best = 0;
+	for (size_t i = 1;  i < estimates.size();  i++) {
+		if (estimates[i].possible && estimates[i].exact && estimates[i].seconds < estimates[best].seconds) best = i;
+	}
+
+	double	max_hours = qc_config.option_double("auto_max_hours", ns_cost::default_max_hours);
+	double	hours = estimates[best].seconds/3600;
+	if (hours > max_hours) {
+		cout << "SEQCSim::choose_engine_automatically(): Error!  Even the fastest engine (" << estimates[best].option
+			 << ") is expected to take about " << hours << " hours, more than the limit of " << max_hours
+			 << " (auto_max_hours).  Not running.\n";
+		exit(1);
+	}
+	cout << "SEQCSim::choose_engine_automatically(): Choosing the " << estimates[best].option
+		 << " engine, which is expected to take about " << estimates[best].seconds << " s.\n";
+	return estimates[best].option;
+}
@@ -0,0 +1,87 @@
+//========================================================================
+// SEQCSim version 0.8 - The Space-Efficient Quantum Computer Simulator
+// By Michael P. Frank, Liviu Oniciuc, Uwe Meyer-Baese, and Liviu Oniciuc.
+// Copyright (C) 2008-2009  Florida State University Board of Trustees
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// 
+// You may contact the author at michael.patrick.frank@gmail.com, or at
+// Michael P. Frank, PO Box 025250 #24985, Miami, FL  33102-5250.
+//========================================================================
+
+//-------------------------------------------------------------------------
+// CostModel.h - The static cost model, which estimates, when the circuit is
+//   loaded, how long each engine would take to run it, and how much memory
+//   it would need.
+//
+// Every engine's cost grows exponentially in something:  the state vector in
+// the number of qubits, the path integral in the number of branching
+// operations, the sparse engine in the size of the support, and so on.  Which
+// one wins depends on the circuit, and a bad choice can mean the difference
+// between seconds and years.  So, before running, we work out bounds on the
+// quantities that matter, and from them, an EngineEstimate for each engine
+// (see CostModel.cpp).  Each engine's estimate is made in its own file, next
+// to the code whose cost it estimates.
+//
+// "option: engine auto" then picks the engine that is expected to be fastest,
+// among those that are possible, exact, and within their memory budgets.  If
+// even that one is expected to take longer than "option: auto_max_hours N"
+// (default ns_cost::default_max_hours), we refuse to run, and print the
+// estimates instead.  "option: cost_report on" prints the estimates whichever
+// engine is used.
+//
+// The times are only rough:  they are counts of basic steps (recursion frames,
+// amplitude updates, ...) times the rough costs per step below, and the counts
+// are mostly upper bounds, which can be far above what a run actually takes.
+//-------------------------------------------------------------------------
+
+#pragma once
+
+#include <string>				// STL string class.
+
+using namespace std;
+
+namespace ns_cost {
+
+	// Rough times for the basic steps of the engines, in seconds.
+	static const double		seconds_per_frame = 2e-7;		// A recursion frame of the path integral.
+	static const double		seconds_per_update = 2e-9;		// Updating an amplitude in a state vector.
+	static const double		seconds_per_entry = 1e-7;		// Updating an entry of a hash table.
+	static const double		seconds_per_flop = 1e-9;		// A complex multiply-add, in a dense kernel.
+	static const double		seconds_per_node = 5e-7;		// Visiting a node of a decision diagram.
+
+	// By default, refuse to run a circuit that is expected to take more than this long.
+	static const double		default_max_hours = 24;
+
+	// Bounds larger than this are just reported as "more than" this.
+	static const double		huge = 1e300;
+
+	// a*b, or a+b, clamped to huge (so that exponentially large bounds don't overflow).
+	inline double	times(double a, double b)	{ return (a > huge/(b > 1 ? b : 1)) ? huge : a*b; }
+	inline double	plus(double a, double b)	{ return (a > huge - b) ? huge : a + b; }
+}
+
+// What it would cost to run the circuit with one of the engines.
+
+class EngineEstimate {
+public:
+	string		option;			// The value of "option: engine" that selects it.
+	bool		possible;		// Can it run the circuit at all, within its memory budget?
+	bool		exact;			// Are its results exact (up to rounding), or might it truncate?
+	double		seconds;		// Rough running time.
+	double		memory_mb;		// Memory needed, in megabytes.
+	string		note;			// Why it isn't possible, or what the estimate depends on.
+
+	EngineEstimate(const string& opt) : option(opt), possible(true), exact(true), seconds(0), memory_mb(0) {}
+};
@@ -0,0 +1,532 @@
+//========================================================================
+// SEQCSim version 0.8 - The Space-Efficient Quantum Computer Simulator
+// By Michael P. Frank, Liviu Oniciuc, Uwe Meyer-Baese, and Liviu Oniciuc.
+// Copyright (C) 2008-2009  Florida State University Board of Trustees
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// 
+// You may contact the author at michael.patrick.frank@gmail.com, or at
+// Michael P. Frank, PO Box 025250 #24985, Miami, FL  33102-5250.
+//========================================================================
+
+//-------------------------------------------------------------------------
+// DecisionDiagram.cpp - A decision-diagram engine, which stores the state
+//   as a QMDD-style graph with shared nodes, so that structured states take
+//   little memory however many qubits they have.
+//
+// The state vector is represented as a binary decision diagram over the
+// qubits, with the most significant qubit at the top.  Each node, at level q,
+// has two edges (for qubit q being 0 or 1), each to a node at level q - 1 (or
+// to the terminal, below level 0), and each with a complex weight.  The
+// amplitude of a basis state is the product of the weights along its path
+// from the root edge down.  A node's weights are normalized so that the
+// larger one is exactly 1 (the factor taken out moves to the edges coming
+// into it), and a unique table makes sure there's only ever one node with a
+// given level, children and weights.  So equal sub-vectors, up to a factor,
+// are stored just once:  a product state takes n nodes, and so does the
+// uniform superposition, or a basis state, and many of the states arithmetic
+// circuits go through take not many more.
+//
+// Each operation is turned into a diagram of the same kind for its matrix
+// (with four edges per node, for the blocks of the matrix), acting as the
+// identity on the qubits it doesn't touch.  Applying it is a recursive
+// matrix-vector product, which is memoized in a compute table keyed on the
+// pair of nodes, and so is the addition it needs, so that shared nodes are
+// only worked on once.  The recursion stops as soon as it reaches the part
+// of the matrix below the operation's lowest qubit, which is the identity.
+//
+// Weights are rounded to a grid of ns_dd::weight_grid, both for looking them
+// up in the tables, and so that nodes which are the same but for rounding
+// errors are shared, and weights below ns_dd::negligible_weight (relative to
+// their neighbours) are set to 0, so that amplitudes which should cancel
+// exactly don't leave a trail of tiny nodes behind.  So the engine is exact
+// only up to that rounding.
+// Nodes that are no longer reachable from the state are only thrown away when
+// their number has doubled since the last time.  If the nodes outgrow "option:
+// dd_memory_mb X" (default ns_dd::default_memory_mb), the engine gives up
+// (between operations), and run() falls back to the path-integral engine.
+//
+// At the end, the final states are listed with their probabilities, by a
+// search down the diagram that skips branches of negligible probability, and
+// the shots are sampled one qubit at a time from the top, using the squared
+// norm under each node.
+//
+// The engine is selected with "option: engine dd".  Operations on more than
+// ns_dd::max_operation_qubits qubits make it fall back too, since their
+// matrices are built densely first.
+//-------------------------------------------------------------------------
+
+#include <iostream>				// cout
+#include <sstream>				// ostringstream
+#include <vector>				// STL vector<> template.
+#include <map>					// For the histogram of final states.
+#include <algorithm>			// sort(), min(), max()
+#include <math.h>				// floor(), pow()
+#include <unordered_map>	// tr1::unordered_map, for the unique and compute tables.
+#include "SEQCSim.h"
+#include "OperationMatrix.h"	// ns_opmatrix::embed(), embed_function(), qubits_of()
+#include "debug.h"				// ns_debug::trace
+
+using namespace std;
+
+namespace ns_dd {
+
+	// Default memory budget for the nodes (and their tables), in megabytes.
+	static const double		default_memory_mb = 1024;
+
+	// About how many bytes each node takes, with its entry in the unique table.
+	static const double		bytes_per_node = 160;
+
+	// Weights are rounded to multiples of this...
+	static const double		weight_grid = 1e-12;
+
+	// ...and those smaller than this (relative to the largest one of the node, or of the sum
+	// they come from) are taken to be rounding errors, and set to 0.
+	static const double		negligible_weight = 1e-9;
+
+	// Operations on more qubits than this (including controls) aren't made into diagrams.
+	static const size_t		max_operation_qubits = 10;
+
+	// Final states less likely than this (relative to the total) aren't listed...
+	static const double		negligible_prob = 1e-12;
+
+	// ...and if there are more than this many that are, none of them are.
+	static const size_t		max_listed_states = 1 << 16;
+
+	// Unreachable nodes aren't collected until there are at least this many nodes.
+	static const size_t		min_collect_nodes = 1 << 16;
+
+	// An edge:  a weight, and the node it leads to.  Node 0 is the terminal, and an edge
+	// with weight 0 (which always leads to the terminal) stands for an all-zero block.
+	struct Edge {
+		size_t		node;
+		Complex		w;
+
+		Edge(void) : node(0), w(0) {}
+		Edge(size_t n, const Complex& weight) : node(n), w(weight) {}
+		bool	isZero(void) const { return w.isZero(); }
+	};
+
+	// A node of a vector diagram (which uses e[0] and e[1]) or a matrix diagram (which
+	// uses all four, e[2*row + col]).  identity is set for matrix nodes that are the
+	// identity on all the levels from theirs down.
+	struct Node {
+		int			level;
+		Edge		e[4];
+		bool		identity;
+	};
+
+	// What the unique table and the compute tables are keyed on:  a level and up to four
+	// node numbers (children, or operands), and up to four rounded weights (real and
+	// imaginary parts, in grid steps).
+	struct Key {
+		size_t		n[5];
+		long long	w[8];
+
+		Key(void) { for (size_t i = 0;  i < 5;  i++) n[i] = 0;  for (size_t i = 0;  i < 8;  i++) w[i] = 0; }
+		bool	operator==(const Key& k) const {
+			for (size_t i = 0;  i < 5;  i++) if (n[i] != k.n[i]) return false;
+			for (size_t i = 0;  i < 8;  i++) if (w[i] != k.w[i]) return false;
+			return true;
+		}
+	};
+
+	struct KeyHash {
+		size_t operator()(const Key& k) const {
+			size_t	h = 0;
+			for (size_t i = 0;  i < 5;  i++) h = (h ^ k.n[i]) * (size_t)2654435761u;
+			for (size_t i = 0;  i < 8;  i++) h = (h ^ (size_t)k.w[i]) * (size_t)2654435761u;
+			return h ^ (h >> 15);
+		}
+	};
+
+	typedef tr1::unordered_map<Key, size_t, KeyHash>	UniqueTable;
+	typedef tr1::unordered_map<Key, Edge, KeyHash>		ComputeTable;
+
+	// A weight (of magnitude at most about 1), as a number of grid steps.
+	static long long grid_steps(double x) { return (long long)floor(x/weight_grid + 0.5); }
+
+	// A weight, rounded to the grid.
+	static Complex snap(const Complex& c) {
+		return Complex(grid_steps(c.R)*weight_grid, grid_steps(c.I)*weight_grid);
+	}
+
+	// a/b, for complex numbers.
+	static Complex divide(const Complex& a, const Complex& b) {
+		double	d = b.squared_norm();
+		return Complex((a.R*b.R + a.I*b.I)/d, (a.I*b.R - a.R*b.I)/d);
+	}
+
+	// The key of a node in the unique table.
+	static Key node_key(const Node& node, size_t arity) {
+		Key		key;
+		key.n[0] = (size_t)node.level;
+		for (size_t i = 0;  i < arity;  i++) {
+			key.n[i + 1] = node.e[i].node;
+			key.w[2*i] = grid_steps(node.e[i].w.R);
+			key.w[2*i + 1] = grid_steps(node.e[i].w.I);
+		}
+		return key;
+	}
+
+	class Diagram {
+	public:
+		vector<Node>	vnodes;			// The vector nodes (vnodes[0] is the terminal).
+		vector<Node>	mnodes;			// The matrix nodes of the current operation (likewise).
+		UniqueTable		vunique,  munique;
+		ComputeTable	products,  sums;
+		size_t			nbits;
+		vector<size_t>	identities;		// The identity matrix nodes for each level made so far, for this operation.
+		size_t			peak_nodes;		// The most vector nodes there have been (reachable or not).
+		size_t			collect_at;		// Collect the unreachable nodes once there are this many.
+
+		Diagram(size_t n) : nbits(n), peak_nodes(0), collect_at(min_collect_nodes) {
+			Node	terminal;
+			terminal.level = -1;
+			terminal.identity = true;
+			vnodes.push_back(terminal);
+			mnodes.push_back(terminal);
+		}
+
+		// The edge to the (unique) node with the given level and children, of which there are
+		// arity (2 for vector nodes, 4 for matrix nodes).  The weights are normalized by the
+		// one of largest magnitude, which becomes the weight of the edge returned.
+		Edge make_node(int level, const Edge* children, size_t arity) {
+			bool			matrix = (arity == 4);
+			vector<Node>&	nodes = matrix ? mnodes : vnodes;
+			UniqueTable&	unique = matrix ? munique : vunique;
+			size_t			top = 0;
+
+			for (size_t i = 1;  i < arity;  i++)
+				if (children[i].w.squared_norm() > children[top].w.squared_norm()) top = i;
+			Complex	factor = children[top].w;
+			if (factor.norm() < negligible_weight) return Edge();
+
+			Node	node;
+			node.level = level;
+			for (size_t i = 0;  i < arity;  i++) {
+				Complex	w = (i == top) ? Complex(1) : snap(divide(children[i].w, factor));
+				node.e[i] = (w.norm() < negligible_weight) ? Edge() : Edge(children[i].node, w);
+			}
+
+			Key						key = node_key(node, arity);
+			UniqueTable::iterator	found = unique.find(key);
+			if (found != unique.end()) return Edge(found->second, factor);
+
+			node.identity = matrix && node.e[1].isZero() && node.e[2].isZero()
+							&& node.e[0].node == node.e[3].node && node.e[0].w == 1.0 && node.e[3].w == 1.0
+							&& nodes[node.e[0].node].identity;
+			nodes.push_back(node);
+			unique[key] = nodes.size() - 1;
+			return Edge(nodes.size() - 1, factor);
+		}
+
+		// The sum of two vector edges at the same level.
+		Edge add(Edge a, Edge b) {
+			if (a.isZero()) return b;
+			if (b.isZero()) return a;
+			if (a.node == b.node) {
+				Complex	w = a.w + b.w;
+				return (w.norm() < negligible_weight*a.w.norm()) ? Edge() : Edge(a.node, w);
+			}
+
+			// Look up the sum of the larger edge's node with the smaller one's times their ratio.
+			bool		a_larger = a.w.squared_norm() >= b.w.squared_norm();
+			Edge		x = a_larger ? a : b;
+			Edge		y = a_larger ? b : a;
+			Complex		ratio = snap(divide(y.w, x.w));
+			Key			key;
+			key.n[0] = x.node;
+			key.n[1] = y.node;
+			key.w[0] = grid_steps(ratio.R);
+			key.w[1] = grid_steps(ratio.I);
+			ComputeTable::iterator	found = sums.find(key);
+			if (found != sums.end()) return Edge(found->second.node, found->second.w * x.w);
+
+			// (The nodes are copied, since making new ones may move them.)
+			Node	xn = vnodes[x.node],  yn = vnodes[y.node];
+			Edge	children[2];
+			for (size_t i = 0;  i < 2;  i++) {
+				yn.e[i].w = yn.e[i].w * ratio;
+				children[i] = add(xn.e[i], yn.e[i]);
+			}
+			Edge	sum = make_node(xn.level, children, 2);
+			sums[key] = sum;
+			return Edge(sum.node, sum.w * x.w);
+		}
+
+		// The product of a matrix edge and a vector edge at the same level.
+		Edge multiply(Edge m, Edge v) {
+			if (m.isZero() || v.isZero()) return Edge();
+			Complex	w = m.w * v.w;
+			if (mnodes[m.node].identity) return Edge(v.node, w);
+
+			Key		key;
+			key.n[0] = m.node;
+			key.n[1] = v.node;
+			ComputeTable::iterator	found = products.find(key);
+			if (found != products.end()) return Edge(found->second.node, found->second.w * w);
+
+			Node		mn = mnodes[m.node],  vn = vnodes[v.node];
+			Edge		children[2];
+			for (size_t row = 0;  row < 2;  row++) {
+				children[row] = add(multiply(mn.e[2*row], vn.e[0]), multiply(mn.e[2*row + 1], vn.e[1]));
+			}
+			Edge	product = make_node(vn.level, children, 2);
+			products[key] = product;
+			return Edge(product.node, product.w * w);
+		}
+
+		// The identity matrix node for the levels from the given one down.
+		size_t identity(int level) {
+			while ((int)identities.size() <= level) {
+				Edge	children[4];
+				children[0] = children[3] = Edge(identities.empty() ? 0 : identities.back(), Complex(1));
+				identities.push_back(make_node((int)identities.size(), children, 4).node);
+			}
+			return (level < 0) ? 0 : identities[level];
+		}
+
+		// The matrix diagram of an operation, from its dense matrix m (see OperationMatrix.h) on
+		// the given qubits (in increasing order).  row and col hold the bits of the matrix
+		// index chosen so far, for the qubits above this level.
+		Edge gate(const vector<Complex>& m, const vector<qubit_index_t>& qubits, int level, size_t row, size_t col) {
+			size_t	rank = (size_t)1 << qubits.size();
+			if (level < (int)qubits[0]) {
+				Complex	elem = m[row*rank + col];
+				return elem.isZero() ? Edge() : Edge(identity(level), elem);
+			}
+
+			size_t	p = ns_opmatrix::position_of(qubits, (qubit_index_t)level);
+			Edge	children[4];
+			if (p == qubits.size()) {
+				children[0] = children[3] = gate(m, qubits, level - 1, row, col);
+			} else {
+				for (size_t r = 0;  r < 2;  r++)
+					for (size_t c = 0;  c < 2;  c++)
+						children[2*r + c] = gate(m, qubits, level - 1, row | (r << p), col | (c << p));
+			}
+			return make_node(level, children, 4);
+		}
+
+		// Apply the operation with the given dense matrix to the state.
+		void apply(const vector<Complex>& m, const vector<qubit_index_t>& qubits, Edge& root) {
+			Edge	g = gate(m, qubits, (int)nbits - 1, 0, 0);
+			root = multiply(g, root);
+
+			// The matrix nodes, and the memoized results, are only good for this operation.
+			mnodes.resize(1);
+			munique.clear();
+			identities.clear();
+			products.clear();
+			sums.clear();
+
+			if (vnodes.size() >= collect_at) collect(root);
+			if (vnodes.size() > peak_nodes) peak_nodes = vnodes.size();
+		}
+
+		// Throw away the nodes that aren't reachable from the root, renumbering the rest.
+		void collect(Edge& root) {
+			vector<size_t>	renumbered(vnodes.size(), 0);
+			vector<Node>	kept(1, vnodes[0]);
+			renumber(root.node, renumbered, kept);
+			root.node = renumbered[root.node];
+			vnodes.swap(kept);
+
+			vunique.clear();
+			for (size_t i = 1;  i < vnodes.size();  i++) vunique[node_key(vnodes[i], 2)] = i;
+			collect_at = max(min_collect_nodes, 2*vnodes.size());
+		}
+
+		// Copy the node (after its children) into kept, if it isn't there yet.
+		void renumber(size_t node, vector<size_t>& renumbered, vector<Node>& kept) {
+			if (node == 0 || renumbered[node] != 0) return;
+			Node	copy = vnodes[node];
+			for (size_t i = 0;  i < 2;  i++) {
+				renumber(copy.e[i].node, renumbered, kept);
+				copy.e[i].node = renumbered[copy.e[i].node];
+			}
+			kept.push_back(copy);
+			renumbered[node] = kept.size() - 1;
+		}
+
+		// The squared norm of the vector under each node (with weight 1 coming into it).
+		void squared_norms(vector<double>& norms) const {
+			norms.assign(vnodes.size(), 0);
+			norms[0] = 1;
+
+			// Children always come before their parents, after collect(), and also in the
+			// order the nodes were made in.
+			for (size_t i = 1;  i < vnodes.size();  i++) {
+				for (size_t j = 0;  j < 2;  j++) norms[i] += vnodes[i].e[j].w.squared_norm() * norms[vnodes[i].e[j].node];
+			}
+		}
+
+		// Depth-first search down from the given edge (with the weights above it multiplied in),
+		// listing every final state (as bits by qubit) with a non-negligible probability.  Returns
+		// false if there are too many.
+		bool list_states(const Edge& e, const vector<double>& norms, size_t bits, double threshold,
+						 vector< pair<size_t, double> >& found) const {
+			if (e.node == 0) {
+				found.push_back(make_pair(bits, e.w.squared_norm()));
+				return found.size() <= max_listed_states;
+			}
+			const Node&	node = vnodes[e.node];
+			for (size_t x = 0;  x < 2;  x++) {
+				Edge	child(node.e[x].node, node.e[x].w * e.w);
+				if (node.e[x].isZero() || child.w.squared_norm() * norms[child.node] <= threshold) continue;
+				if (!list_states(child, norms, bits | (x << node.level), threshold, found)) return false;
+			}
+			return true;
+		}
+	};
+}
+
+// Run the simulation with the decision-diagram engine.  Returns false (having done nothing
+// but print why) if some operation is too big for it, or if the diagram outgrows its budget.
+
+bool SEQCSim::run_dd(void)
+{
+	size_t		nbits = qc_config.nbits;
+	double		budget_mb = qc_config.option_double("dd_memory_mb", ns_dd::default_memory_mb);
+	size_t		max_nodes = (size_t)(budget_mb*1024*1024/ns_dd::bytes_per_node);
+
+	for (size_t pc = 0;  pc < opn_seq.size();  pc++) {
+		vector<qubit_index_t>	qubits;
+		ns_opmatrix::qubits_of(opn_seq[pc], qubits);
+		if (qubits.size() > ns_dd::max_operation_qubits) {
+			cout << "SEQCSim::run_dd(): Operation #" << pc << " acts on " << qubits.size() << " qubits, more than the "
+				 << ns_dd::max_operation_qubits << " the engine can make diagrams of; falling back to the path-integral engine.\n";
+			return false;
+		}
+	}
+	cout << "SEQCSim::run_dd(): Simulating " << nbits << " qubits as a decision diagram, with at most " << max_nodes
+		 << " nodes.\n";
+
+	// Start out in the input state:  a single path, from the top qubit down.
+	ns_dd::Diagram	dd(nbits);
+	ns_dd::Edge		root(0, Complex(1));
+	for (size_t q = 0;  q < nbits;  q++) {
+		ns_dd::Edge	children[2];
+		children[input_state.bits[q] ? 1 : 0] = root;
+		root = dd.make_node((int)q, children, 2);
+	}
+	root.w = input_state.amp;
+
+	for (size_t pc = 0;  pc < opn_seq.size();  pc++) {
+		Operation&				opn = opn_seq[pc];
+		vector<qubit_index_t>	qubits;
+		vector<Complex>			m;
+
+		ns_opmatrix::qubits_of(opn, qubits);
+		sort(qubits.begin(), qubits.end());
+		if (opn.isFunctional()) {
+			ns_opmatrix::embed_function(functions[opn.function_id], opn, qubits, m);
+		} else {
+			ns_opmatrix::embed(operators.at(opn.operator_id), opn, qubits, m);
+		}
+		dd.apply(m, qubits, root);
+
+		if (ns_debug::trace) {
+			cout << "SEQCSim::run_dd(): After operation #" << pc << ", " << opn << ", the diagram has "
+				 << dd.vnodes.size() << " nodes.\n";
+		}
+		if (dd.vnodes.size() > max_nodes) {
+			cout << "SEQCSim::run_dd(): After operation #" << pc << ", the diagram has " << dd.vnodes.size()
+				 << " nodes, more than the " << max_nodes << " that fit in " << budget_mb
+				 << " MB; falling back to the path-integral engine.\n";
+			return false;
+		}
+	}
+
+	dd.collect(root);
+	cout << "SEQCSim::run_dd(): The final diagram has " << dd.vnodes.size() - 1 << " nodes (against " << nbits
+		 << " for a basis state);  at its largest, there were " << max(dd.peak_nodes, dd.vnodes.size()) - 1
+		 << ", counting unreachable ones not yet thrown away.\n";
+
+	vector<double>	norms;
+	dd.squared_norms(norms);
+	double			total = root.w.squared_norm() * norms[root.node];
+
+	// List the most likely final states (or values of the measured registers), with their exact
+	// probabilities, if there aren't too many.
+	vector< pair<size_t, double> >	listed;
+	current_state = input_state;
+	if (nbits < 8*sizeof(size_t) && dd.list_states(root, norms, 0, ns_dd::negligible_prob*total, listed)) {
+		map<string, double>		exact_probs;
+		for (size_t i = 0;  i < listed.size();  i++) {
+			for (size_t q = 0;  q < nbits;  q++) current_state.bits[q] = ((listed[i].first >> q) & 1) != 0;
+			exact_probs[final_state_key()] += listed[i].second/total;
+		}
+		report_final_probabilities("SEQCSim::run_dd()", exact_probs);
+	} else {
+		cout << "SEQCSim::run_dd(): There are too many final states to list their probabilities.\n";
+	}
+
+	// Now sample the shots, one qubit at a time from the top.
+	unsigned long				n_shots = (unsigned long)qc_config.option_double("shots", 1);
+	map<string, unsigned long>	histogram;
+
+	for (unsigned long shot = 1;  shot <= n_shots;  shot++) {
+		ns_dd::Edge	e = root;
+		while (e.node != 0) {
+			const ns_dd::Node&	node = dd.vnodes[e.node];
+			double				weight0 = node.e[0].w.squared_norm() * norms[node.e[0].node];
+			double				weight1 = node.e[1].w.squared_norm() * norms[node.e[1].node];
+			size_t				x = (marker_picker(prng_engine) * (weight0 + weight1) < weight0) ? 0 : 1;
+			current_state.bits[node.level] = (x != 0);
+			e = ns_dd::Edge(node.e[x].node, node.e[x].w * e.w);
+		}
+		current_state.amp = e.w;
+		cout << "SEQCSim::run_dd(): Shot #" << shot << " ended in state " << current_state << ".\n";
+		histogram[final_state_key()]++;
+	}
+
+	report_histogram("SEQCSim::run_dd()", histogram, n_shots);
+	return true;
+}
+
+// The cost of running the circuit with the decision-diagram engine (see CostModel.h).  A
+// diagram has at most one node per qubit for each basis state in the support, and at most
+// 2^(n-q) nodes at level q, so the bound on the support (see CostModel.cpp) bounds its size.
+// Applying an operation on k qubits visits each node with up to 2^k matrix nodes.
+
+void SEQCSim::estimate_dd(EngineEstimate& est)
+{
+	size_t			nbits = qc_config.nbits;
+	double			budget_mb = qc_config.option_double("dd_memory_mb", ns_dd::default_memory_mb);
+	double			max_nodes = 1,  visits = 0;
+	ostringstream	note;
+
+	for (size_t pc = 0;  pc < opn_seq.size();  pc++) {
+		vector<qubit_index_t>	qubits;
+		ns_opmatrix::qubits_of(opn_seq[pc], qubits);
+		if (qubits.size() > ns_dd::max_operation_qubits) {
+			est.possible = false;
+			note << "operation #" << pc << " acts on " << qubits.size() << " qubits, more than the "
+				 << ns_dd::max_operation_qubits << " the engine can make diagrams of";
+			est.note = note.str();
+			return;
+		}
+		double	nodes = min(ns_cost::times((double)nbits, support_bounds[pc + 1]), min(pow(2.0, (double)nbits), ns_cost::huge));
+		max_nodes = max(max_nodes, nodes);
+		visits = ns_cost::plus(visits, ns_cost::times(nodes, pow(2.0, (double)qubits.size())));
+	}
+	est.seconds = ns_cost::times(visits, ns_cost::seconds_per_node);
+	est.memory_mb = ns_cost::times(2*max_nodes, ns_dd::bytes_per_node) / (1024*1024);
+	est.possible = (est.memory_mb <= budget_mb);
+	note << "at most " << max_nodes << " nodes";
+	if (!est.possible) note << ", which might not fit in the budget (dd_memory_mb) of " << budget_mb << " MB";
+	est.note = note.str();
+}
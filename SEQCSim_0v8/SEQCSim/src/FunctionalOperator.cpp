@@ -0,0 +1,211 @@
+//========================================================================
+// SEQCSim version 0.8 - The Space-Efficient Quantum Computer Simulator
+// By Michael P. Frank, Liviu Oniciuc, Uwe Meyer-Baese, and Liviu Oniciuc.
+// Copyright (C) 2008-2009  Florida State University Board of Trustees
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// 
+// You may contact the author at michael.patrick.frank@gmail.com, or at
+// Michael P. Frank, PO Box 025250 #24985, Miami, FL  33102-5250.
+//========================================================================
+
+// FunctionalOperator.cpp - The table of available functional operators, and their implementations.
+
+#include <iostream>				// cout, for error messages.
+#include <sstream>				// istringstream, for parsing parameters.
+#include <math.h>				// cos(), sin()
+#include <algorithm>			// swap()
+#include "FunctionalOperator.h"
+#include "debug.h"				// ns_debug::trace
+
+using namespace std;
+
+namespace ns_functions {
+
+	// Helpers.
+
+	static size_t	mask_of(size_t width) { return (width >= 8*sizeof(size_t)) ? ~(size_t)0 : (((size_t)1 << width) - 1); }
+
+	// (base^exp) mod m, by repeated squaring.  m must be less than 2^32, so products fit in 64 bits.
+	static unsigned long long	pow_mod(unsigned long long base, size_t exp, unsigned long long m) {
+		unsigned long long	result = 1 % m;
+		base %= m;
+		while (exp) {
+			if (exp & 1) result = (result*base) % m;
+			base = (base*base) % m;
+			exp >>= 1;
+		}
+		return result;
+	}
+
+	// The inverse of a modulo m, or 0 if there isn't one (gcd(a,m) != 1).  Extended Euclid.
+	static long long	inverse_mod(long long a, long long m) {
+		long long	g = m, x = 0, g1 = ((a % m) + m) % m, x1 = 1;
+		while (g1) {
+			long long	q = g/g1, t;
+			t = g - q*g1;  g = g1;  g1 = t;
+			t = x - q*x1;  x = x1;  x1 = t;
+		}
+		return (g == 1) ? ((x % m) + m) % m : 0;
+	}
+
+	// modexp_a_N:  (x, y) -> (x, y * a^x mod N), for y < N.  (Values y >= N are left alone,
+	// which keeps it a permutation.)  This is the core of Shor's algorithm.  params[2] holds
+	// the inverse of a mod N, worked out when the operator is set up.
+
+	static void modexp_fwd(size_t* regs, const size_t* /*widths*/, const long long* params) {
+		if (regs[1] < (size_t)params[1])
+			regs[1] = (size_t)((regs[1] * pow_mod(params[0], regs[0], params[1])) % params[1]);
+	}
+	static void modexp_inv(size_t* regs, const size_t* /*widths*/, const long long* params) {
+		if (regs[1] < (size_t)params[1])
+			regs[1] = (size_t)((regs[1] * pow_mod(params[2], regs[0], params[1])) % params[1]);
+	}
+
+	// modmul_a_N:  y -> a*y mod N, for y < N.  params[2] again holds the inverse of a mod N.
+
+	static void modmul_fwd(size_t* regs, const size_t* /*widths*/, const long long* params) {
+		if (regs[0] < (size_t)params[1]) regs[0] = (size_t)((regs[0] * (unsigned long long)params[0]) % params[1]);
+	}
+	static void modmul_inv(size_t* regs, const size_t* /*widths*/, const long long* params) {
+		if (regs[0] < (size_t)params[1]) regs[0] = (size_t)((regs[0] * (unsigned long long)params[2]) % params[1]);
+	}
+
+	// add:  (x, y) -> (x, y + x mod 2^width(y)).
+
+	static void add_fwd(size_t* regs, const size_t* widths, const long long* /*params*/) {
+		regs[1] = (regs[1] + regs[0]) & mask_of(widths[1]);
+	}
+	static void add_inv(size_t* regs, const size_t* widths, const long long* /*params*/) {
+		regs[1] = (regs[1] - regs[0]) & mask_of(widths[1]);
+	}
+
+	// addconst_c:  y -> y + c mod 2^width(y).
+
+	static void addconst_fwd(size_t* regs, const size_t* widths, const long long* params) {
+		regs[0] = (regs[0] + (size_t)params[0]) & mask_of(widths[0]);
+	}
+	static void addconst_inv(size_t* regs, const size_t* widths, const long long* params) {
+		regs[0] = (regs[0] - (size_t)params[0]) & mask_of(widths[0]);
+	}
+
+	// mark_k:  Phase oracle that flips the sign of the amplitude iff x == k (as in Grover's algorithm).
+
+	static Complex mark_phase(const size_t* regs, const size_t* /*widths*/, const long long* params) {
+		return (regs[0] == (size_t)params[0]) ? Complex(-1) : Complex(1);
+	}
+
+	// phase_p_q:  Phase oracle that multiplies the amplitude by exp(2*pi*i * p*x/q).
+
+	static Complex linear_phase(const size_t* regs, const size_t* /*widths*/, const long long* params) {
+		long long	num = (long long)((regs[0] % params[1]) * (params[0] % params[1]) % params[1]);	// p*x mod q
+		double		angle = 6.28318530717958647692 * num / params[1];
+		return Complex(cos(angle), sin(angle));
+	}
+
+	// The table of available functions.
+
+	struct FunctionDef {
+		const char*							base_name;		// Name, without the parameters.
+		FunctionalOperator::kind_t			kind;
+		size_t								n_registers;	// Number of register operands.
+		size_t								n_params;		// Number of integer parameters.
+		perm_function_t						forward, inverse;
+		phase_function_t					phase;
+	};
+
+	static const FunctionDef	function_table[] = {
+		{ "modexp",		FunctionalOperator::PERMUTATION,	2, 2,	modexp_fwd,		modexp_inv,		NULL },
+		{ "modmul",		FunctionalOperator::PERMUTATION,	1, 2,	modmul_fwd,		modmul_inv,		NULL },
+		{ "add",		FunctionalOperator::PERMUTATION,	2, 0,	add_fwd,		add_inv,		NULL },
+		{ "addconst",	FunctionalOperator::PERMUTATION,	1, 1,	addconst_fwd,	addconst_inv,	NULL },
+		{ "mark",		FunctionalOperator::PHASE_ORACLE,	1, 1,	NULL,			NULL,			mark_phase },
+		{ "phase",		FunctionalOperator::PHASE_ORACLE,	1, 2,	NULL,			NULL,			linear_phase },
+	};
+	static const size_t			n_functions = sizeof(function_table)/sizeof(function_table[0]);
+}
+
+bool FunctionalOperator::initFromName(const string& fullName) {
+	if (ns_debug::trace) cout << "FunctionalOperator::initFromName(): Setting up function " << fullName << ".\n";
+
+	name = fullName;
+
+	// A name ending in "^-1" means the inverse of the function named by the rest of it.
+	string			plainName = fullName;
+	inverted = (plainName.size() > 3 && plainName.compare(plainName.size() - 3, 3, "^-1") == 0);
+	if (inverted) plainName.erase(plainName.size() - 3);
+
+	// Split the name at the underscores into the base name and the parameters.
+	istringstream	nameStream(plainName);
+	string			baseName, paramString;
+	getline(nameStream, baseName, '_');
+
+	size_t			n_params = 0;
+	while (getline(nameStream, paramString, '_')) {
+		istringstream	paramStream(paramString);
+		if (n_params >= ns_functions::max_params || !(paramStream >> params[n_params])) {
+			cout << "FunctionalOperator::initFromName(): Error! Bad parameter \"" << paramString << "\" in function name " << fullName << ".\n";
+			return false;
+		}
+		n_params++;
+	}
+
+	// Find the base name in the table.
+	const ns_functions::FunctionDef*	def = NULL;
+	for (size_t i = 0;  i < ns_functions::n_functions;  i++) {
+		if (baseName == ns_functions::function_table[i].base_name) { def = &ns_functions::function_table[i];  break; }
+	}
+	if (def == NULL) {
+		cout << "FunctionalOperator::initFromName(): Error! There is no function named \"" << baseName << "\".\n";
+		return false;
+	}
+	if (n_params != def->n_params) {
+		cout << "FunctionalOperator::initFromName(): Error! Function " << baseName << " takes " << def->n_params
+			 << " parameters, but " << fullName << " gives " << n_params << ".\n";
+		return false;
+	}
+
+	kind = def->kind;  n_registers = def->n_registers;
+	forward = def->forward;  inverse = def->inverse;  phase = def->phase;
+	real_phases = true;  phase_root_order = 2;  modulus_register = -1;
+
+	// Check the parameters, and work out anything else the function needs from them.
+	if (baseName == "modexp" || baseName == "modmul") {
+		if (params[1] < 2 || params[1] >= 0x100000000LL) {
+			cout << "FunctionalOperator::initFromName(): Error! The modulus in " << fullName << " must be between 2 and 2^32-1.\n";
+			return false;
+		}
+		params[2] = ns_functions::inverse_mod(params[0], params[1]);
+		if (params[2] == 0) {
+			cout << "FunctionalOperator::initFromName(): Error! In " << fullName << ", " << params[0]
+				 << " has no inverse mod " << params[1] << ", so this wouldn't be reversible.\n";
+			return false;
+		}
+		modulus_register = (baseName == "modexp") ? 1 : 0;		// The register holding y.
+	} else if (baseName == "phase") {
+		if (params[1] <= 0) {
+			cout << "FunctionalOperator::initFromName(): Error! The denominator in " << fullName << " must be positive.\n";
+			return false;
+		}
+		params[0] = ((params[0] % params[1]) + params[1]) % params[1];		// Reduce p mod q, to 0..q-1.
+		// The phases are real iff 2p/q is an integer, and are powers of a 2^k-th root of unity iff q is a power of 2.
+		real_phases = ((2*params[0]) % params[1] == 0);
+		phase_root_order = ((params[1] & (params[1]-1)) == 0) ? (int)params[1] : 0;
+	}
+
+	// The inverse of a permutation is just its inverse function, run forwards.  (The inverse of
+	// a phase oracle has the conjugate phases; see phase_of().)
+	if (inverted) swap(forward, inverse);
+	return true;
+}
@@ -0,0 +1,103 @@
+//========================================================================
+// SEQCSim version 0.8 - The Space-Efficient Quantum Computer Simulator
+// By Michael P. Frank, Liviu Oniciuc, Uwe Meyer-Baese, and Liviu Oniciuc.
+// Copyright (C) 2008-2009  Florida State University Board of Trustees
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// 
+// You may contact the author at michael.patrick.frank@gmail.com, or at
+// Michael P. Frank, PO Box 025250 #24985, Miami, FL  33102-5250.
+//========================================================================
+
+//-------------------------------------------------------------------------
+// FunctionalOperator.h - Operators defined by C++ code instead of matrices.
+//
+// Many parts of quantum algorithms, such as the modular exponentiation in
+// Shor's algorithm, or an adder, are just classical reversible functions of
+// whole registers.  Writing them as 2^k x 2^k matrices is infeasible beyond a
+// few bits, and decomposing them into gates makes the circuit much deeper.
+// A FunctionalOperator instead applies a registered C++ function directly to
+// the integer values of its register operands.  There are two kinds:
+//
+//	- A permutation maps the register values to new values.  It must be a
+//		bijection, and must come with its inverse, which recalc_amplitude()
+//		uses to find the (unique) predecessor state.
+//
+//	- A phase oracle leaves the register values alone, and multiplies the
+//		amplitude by a phase computed from them.
+//
+// Either way, the operator never branches, so it costs a single recursion
+// frame in the path integral, however many bits it acts on.  In qopseq.txt,
+// they are applied with lines like
+//
+//		operation #5: apply function modexp_7_15 to registers x, y
+//
+// The name consists of the function's base name, followed by its integer
+// parameters (if any), separated by underscores.  The functions available are
+// listed in the table in FunctionalOperator.cpp.  A name ending in "^-1", like
+// modexp_7_15^-1, means the inverse of that function.
+//-------------------------------------------------------------------------
+
+#pragma once
+
+#include <string>				// STL string class.
+#include "Complex.h"			// The phases computed by phase oracles.
+
+using namespace std;
+
+namespace ns_functions {
+	static const size_t	max_registers	= 8;	// Max. number of register operands of a function.
+	static const size_t	max_params		= 4;	// Max. number of integer parameters of a function.
+}
+
+// Signatures of the C++ functions that implement functional operators.  regs[] holds the
+// values of the register operands (in order), and widths[] their widths in bits.
+
+typedef void	(*perm_function_t)(size_t* regs, const size_t* widths, const long long* params);
+typedef Complex	(*phase_function_t)(const size_t* regs, const size_t* widths, const long long* params);
+
+class FunctionalOperator {
+public:
+	enum kind_t { PERMUTATION, PHASE_ORACLE };
+
+	string				name;			// Full name, including parameters (e.g. "modexp_7_15").
+	kind_t				kind;			// Permutation or phase oracle?
+	size_t				n_registers;	// The number of register operands it takes.
+	long long			params[ns_functions::max_params];	// Its integer parameters.
+
+	perm_function_t		forward;		// For a permutation:  The function itself.
+	perm_function_t		inverse;		//		And its inverse.
+	phase_function_t	phase;			// For a phase oracle:  The phase function.
+	bool				inverted;		// Is this the inverse of the function in the table?
+
+	bool				real_phases;		// Are all the phases it can produce real (+1 or -1)?
+	int					phase_root_order;	// If its phases are all powers of exp(2*pi*i/N) for N a power of 2, that N; else 0.
+	int					modulus_register;	// For a function mod params[1] (like modexp), the register holding the values mod it; else -1.
+
+	// Set this operator up from its full name (base name and parameters), checking the
+	// parameters.  If there is no such function, or the parameters are bad, prints an
+	// error message and returns false.
+	bool	initFromName(const string& fullName);
+
+	// Apply the function (or its inverse) to the given register values, in place.
+	void	apply(size_t* regs, const size_t* widths) const			{ if (kind == PERMUTATION) forward(regs, widths, params); }
+	void	apply_inverse(size_t* regs, const size_t* widths) const	{ if (kind == PERMUTATION) inverse(regs, widths, params); }
+
+	// The phase factor the operator applies, for the given register values.  (Always 1 for a permutation.)
+	Complex	phase_of(const size_t* regs, const size_t* widths) const {
+		if (kind != PHASE_ORACLE) return Complex(1);
+		Complex	p = phase(regs, widths, params);
+		return inverted ? Complex(p.R, -p.I) : p;
+	}
+};
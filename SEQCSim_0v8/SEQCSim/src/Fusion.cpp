@@ -0,0 +1,233 @@
+//========================================================================
+// SEQCSim version 0.8 - The Space-Efficient Quantum Computer Simulator
+// By Michael P. Frank, Liviu Oniciuc, Uwe Meyer-Baese, and Liviu Oniciuc.
+// Copyright (C) 2008-2009  Florida State University Board of Trustees
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// 
+// You may contact the author at michael.patrick.frank@gmail.com, or at
+// Michael P. Frank, PO Box 025250 #24985, Miami, FL  33102-5250.
+//========================================================================
+
+//-------------------------------------------------------------------------
+// Fusion.cpp - The gate fusion pass, which merges runs of adjacent
+//   operations into single synthesized operators before simulation.
+//
+// Every operation costs the path-integral engine a recursion frame (in each
+// call of recalc_amplitude() that goes back through it), so a circuit with
+// fewer, larger operations is cheaper to simulate, as long as the larger
+// operators don't branch any more than the ones they replace.  For example,
+// in the QFT, each H is followed by a chain of controlled phases on the same
+// qubit; H times a diagonal matrix still has blocks of rank 2, so the whole
+// chain can be done in one step instead of several.
+//
+// The pass is enabled by the option "fusion_max_arity N" (N >= 2), which also
+// limits the size of the synthesized operators.  Runs of operations are grown
+// greedily from the front of the operation sequence.  Each next operation is
+// added to the current run if it shares a qubit with it, the run's qubits still
+// number at most N, and the cost model accepts the synthesized matrix:
+//
+//	- Its largest block rank must not exceed the largest block rank of any of
+//		the operations in the run.  (So it doesn't branch any more.)
+//
+//	- It must have no more nonzero elements than the matrices of the operations
+//		in the run have in total (each extended to all the run's qubits), so it
+//		stays sparse, and a step through it isn't more work than the steps it
+//		replaces.
+//
+// Functional operations (see FunctionalOperator.h) are never fused.  The fused
+// circuit is written out to qoperators_fused.txt and qopseq_fused.txt, in the
+// usual file formats, for inspection (or to be run directly).
+//-------------------------------------------------------------------------
+
+#include <iostream>			// cout
+#include <fstream>			// ofstream, for writing the fused circuit.
+#include <sstream>			// ostringstream, for naming fused operators.
+#include <iomanip>			// setprecision()
+#include "SEQCSim.h"
+#include "OperationMatrix.h"	// ns_opmatrix::embed(), multiply(), etc.
+#include "debug.h"			// ns_debug::trace
+
+using namespace std;
+
+namespace ns_fusion {
+	static const string		fused_operators_filename	= "..\\data\\qoperators_fused.txt";
+	static const string		fused_opseq_filename		= "..\\data\\qopseq_fused.txt";
+
+	static const size_t		max_fused_arity	= 10;		// Limits the synthesized matrices to 1024x1024.
+}
+
+// Run the gate fusion pass over opn_seq (see the top of this file), if it's enabled.
+
+void SEQCSim::fuse_operations() {
+	size_t	max_arity = (size_t)qc_config.option_double("fusion_max_arity", 0);
+	if (max_arity < 2) return;		// Fusion is off.
+	if (max_arity > ns_fusion::max_fused_arity) {
+		cout << "SEQCSim::fuse_operations(): Limiting fusion_max_arity to " << ns_fusion::max_fused_arity << ".\n";
+		max_arity = ns_fusion::max_fused_arity;
+	}
+
+	vector<Operation>	fused_seq;
+	size_t				n_orig = opn_seq.size(),  n_new_operators = 0;
+
+	for (size_t first = 0;  first < n_orig;  ) {
+		Operation&		first_opn = opn_seq[first];
+		if (first_opn.isFunctional()) { fused_seq.push_back(first_opn);  first++;  continue; }
+
+		// Start a run with the first operation.  Its qubits are its operands, then its controls.
+		vector<qubit_index_t>	run_qubits;
+		ns_opmatrix::qubits_of(first_opn, run_qubits);
+
+		vector<Complex>			run_matrix, opn_matrix, product;
+		Operator&				first_opr = operators.at(first_opn.operator_id);
+		ns_opmatrix::embed(first_opr, first_opn, run_qubits, run_matrix);
+
+		size_t					run_max_block_rank	= first_opr.U.max_block_rank();
+		size_t					run_nonzeros		= ns_opmatrix::count_nonzeros(run_matrix);
+		Operator				run_opr;		// The synthesized operator, as of the last accepted operation.
+		size_t					last = first;
+
+		// Try to extend the run with each following operation in turn.
+		while (last + 1 < n_orig) {
+			Operation&				next_opn = opn_seq[last + 1];
+			if (next_opn.isFunctional()) break;
+
+			// It must share a qubit with the run, and not bring in too many new ones.
+			vector<qubit_index_t>	next_qubits;
+			ns_opmatrix::qubits_of(next_opn, next_qubits);
+			vector<qubit_index_t>	new_run_qubits(run_qubits);
+			bool					overlaps = false;
+			for (size_t k = 0;  k < next_qubits.size();  k++) {
+				if (ns_opmatrix::position_of(run_qubits, next_qubits[k]) < run_qubits.size())	overlaps = true;
+				else																		new_run_qubits.push_back(next_qubits[k]);
+			}
+			if (!overlaps || new_run_qubits.size() > max_arity) break;
+
+			// Work out the synthesized matrix: the next operation's matrix, times the run's
+			// matrix extended to the new qubits.
+			vector<Complex>			new_run_matrix(run_matrix);
+			size_t					new_run_nonzeros = run_nonzeros;
+			for (size_t q = run_qubits.size();  q < new_run_qubits.size();  q++) {
+				ns_opmatrix::extend(new_run_matrix, (size_t)1 << q);
+				new_run_nonzeros *= 2;
+			}
+			size_t					rank = (size_t)1 << new_run_qubits.size();
+			Operator&				next_opr = operators.at(next_opn.operator_id);
+			ns_opmatrix::embed(next_opr, next_opn, new_run_qubits, opn_matrix);
+			ns_opmatrix::multiply(opn_matrix, new_run_matrix, rank, product);
+			new_run_nonzeros += ns_opmatrix::count_nonzeros(opn_matrix);
+
+			// Apply the cost model.
+			Operator				candidate;
+			candidate.initFromElements("candidate", (operand_index_t)new_run_qubits.size(), product);
+			size_t					new_max_block_rank = run_max_block_rank;
+			if (next_opr.U.max_block_rank() > new_max_block_rank) new_max_block_rank = next_opr.U.max_block_rank();
+
+			if (candidate.U.max_block_rank() > new_max_block_rank
+				|| ns_opmatrix::count_nonzeros(product) > new_run_nonzeros) {
+				if (ns_debug::trace) cout << "SEQCSim::fuse_operations(): Not fusing operation #" << last+1 << " into the run starting at #" << first << ".\n";
+				break;
+			}
+
+			// Accept it.
+			run_qubits.swap(new_run_qubits);
+			run_matrix.swap(product);
+			run_max_block_rank	= new_max_block_rank;
+			run_nonzeros		= new_run_nonzeros;
+			run_opr				= candidate;
+			last++;
+		}
+
+		if (last == first) {
+			fused_seq.push_back(first_opn);		// Nothing to fuse it with.
+		} else {
+			ostringstream	name;
+			name << "fused_" << first << "_" << last;
+			run_opr.id		= (operator_index_t)operators.size();
+			run_opr.name	= name.str();
+			operators.push_back(run_opr);
+			n_new_operators++;
+
+			Operation		fused_opn;
+			fused_opn.operator_id	= run_opr.id;
+			fused_opn.operands		= run_qubits;
+			fused_seq.push_back(fused_opn);
+
+			if (ns_debug::trace) cout << "SEQCSim::fuse_operations(): Fused operations #" << first << " through #" << last
+									  << " into operator " << operators.back() << ".\n";
+		}
+		first = last + 1;
+	}
+
+	opn_seq.swap(fused_seq);
+	cout << "SEQCSim::fuse_operations(): Fused the " << n_orig << " operations into " << opn_seq.size()
+		 << ", using " << n_new_operators << " synthesized operators of up to " << max_arity << " bits.\n";
+
+	write_circuit(ns_fusion::fused_operators_filename, ns_fusion::fused_opseq_filename);
+}
+
+// Write out the operators and the operation sequence, in the formats of qoperators.txt
+// and qopseq.txt.  (Used to show the circuit after it has been transformed.)
+
+void SEQCSim::write_circuit(const string& operatorsFilename, const string& opseqFilename) {
+	ofstream	ops(operatorsFilename.c_str());
+	ops << setprecision(17);
+	ops << "qoperators.txt format version 1\n";
+	ops << "operators: " << operators.size() << "\n\n";
+	for (size_t i = 0;  i < operators.size();  i++) {
+		Operator&	opr = operators[i];
+		ops << "operator #: " << i << "\n";
+		ops << "name: " << opr.name << "\n";
+		ops << "size: " << (int)opr.arity << " bits\n";
+		ops << "matrix:\n";
+		for (size_t r = 0;  r < opr.U.rank();  r++) {
+			for (size_t c = 0;  c < opr.U.rank();  c++) {
+				Complex	elem = opr.U.rows[r][c];
+				elem.putTo(ops);  ops << " ";
+			}
+			ops << "\n";
+		}
+		ops << "\n";
+	}
+
+	ofstream	seq(opseqFilename.c_str());
+	seq << "qopseq.txt format version 1\n";
+	seq << "operations: " << opn_seq.size() << "\n\n";
+	for (size_t i = 0;  i < opn_seq.size();  i++) {
+		Operation&	opn = opn_seq[i];
+		seq << "operation #" << i << ": apply ";
+		if (opn.isFunctional()) {
+			seq << "function " << functions[opn.function_id].name << " to registers ";
+			for (size_t r = 0;  r < opn.register_names.size();  r++)
+				seq << opn.register_names[r] << (r+1 < opn.register_names.size() ? ", " : "");
+		} else {
+			// The operands are written most significant first (see read_opseq()).
+			static const char*	type_words[] = { "n-ary", "unary", "binary", "ternary", "quaternary" };
+			size_t				n_opds = opn.operands.size();
+			seq << type_words[n_opds <= 4 ? n_opds : 0] << " operator " << operators.at(opn.operator_id).name << " to bits ";
+			for (size_t k = n_opds;  k > 0;  k--)
+				seq << qc_config.name_of_bit(opn.operands[k-1]) << (k > 1 ? ", " : "");
+		}
+		if (!opn.controls.empty()) {
+			seq << " controlled by ";
+			for (size_t k = 0;  k < opn.controls.size();  k++) {
+				if (!((opn.control_values >> k) & 1)) seq << "!";
+				seq << qc_config.name_of_bit(opn.controls[k]) << (k+1 < opn.controls.size() ? ", " : "");
+			}
+		}
+		seq << "\n";
+	}
+
+	cout << "SEQCSim::write_circuit(): Wrote the circuit to " << operatorsFilename << " and " << opseqFilename << ".\n";
+}
@@ -0,0 +1,643 @@
+//========================================================================
+// SEQCSim version 0.8 - The Space-Efficient Quantum Computer Simulator
+// By Michael P. Frank, Liviu Oniciuc, Uwe Meyer-Baese, and Liviu Oniciuc.
+// Copyright (C) 2008-2009  Florida State University Board of Trustees
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// 
+// You may contact the author at michael.patrick.frank@gmail.com, or at
+// Michael P. Frank, PO Box 025250 #24985, Miami, FL  33102-5250.
+//========================================================================
+
+//-------------------------------------------------------------------------
+// Hybrid.cpp - A Schroedinger-Feynman hybrid engine, which splits the qubits
+//   into two partitions, and keeps a state vector for each one.
+//
+// The state-vector engine (StateVector.cpp) needs memory for 2^nbits
+// amplitudes, and the path-integral engine (SEQCSim.cpp) needs time
+// exponential in the number of branching operations.  In many circuits, the
+// qubits fall into two groups that interact only through a limited number of
+// operations; in a QFT adder, for instance, the two registers interact only
+// through the controlled phase rotations between them.  For these, we split
+// the qubits into two partitions, A and B, each small enough to hold as a
+// state vector, and keep the state as a sum of products of A and B states,
+//
+//		|psi> = sum_r |a_r> (x) |b_r>.
+//
+// An operation within one partition is applied to each term's state vector
+// for that partition, just as in the state-vector engine.  An operation that
+// crosses the cut is split (by a singular value decomposition of its matrix;
+// see LinearAlgebra.h) into a sum of products of operators on the two sides,
+//
+//		U = sum_k A_k (x) B_k,
+//
+// whose number of terms is the operation's Schmidt rank (2 for a controlled
+// phase rotation, say).  Feynman-style, each term of the state branches into
+// one term for each of those.  The branches are then merged back together as
+// far as possible, by orthonormalizing the state vectors of one side and then
+// of the other, which leaves as many terms as the Schmidt rank of the state.
+// That never exceeds the dimension of the smaller side, and it stays at 1 for
+// as long as the two partitions aren't entangled.  Memory thus
+// scales with the number of terms times 2^|A| + 2^|B|, rather than 2^nbits.
+//
+// The engine is selected with "option: engine hybrid".  The partition is
+// chosen automatically when the circuit is loaded (see choose_partition()),
+// to minimize the number of operations crossing the cut, subject to the
+// memory budget, "option: hybrid_memory_mb N" (default ns_hybrid::default_
+// memory_mb).  If no partition is possible, or the number of terms outgrows
+// the budget while running, we fall back to the path-integral engine.
+//
+// The shots are sampled in two stages, using the Gram matrix of the B states,
+// G[q][p] = <b_q|b_p>:  the marginal probability of each value x of the A
+// qubits is sum_pq conj(a_q(x)) G[q][p] a_p(x), and once x has been chosen,
+// the conditional amplitudes of the B qubits are just sum_p a_p(x) b_p.
+//-------------------------------------------------------------------------
+
+#include <iostream>			// cout
+#include <sstream>			// ostringstream
+#include <vector>			// STL vector<> template.
+#include <map>				// For the histogram of final states.
+#include <algorithm>		// sort(), upper_bound()
+#include <math.h>			// pow(), sqrt()
+#include "SEQCSim.h"
+#include "StateVector.h"	// State vectors for each partition.
+#include "LinearAlgebra.h"	// ns_linalg::svd(), for splitting the operations that cross the cut.
+#include "OperationMatrix.h"	// ns_opmatrix::embed(), for their matrices.
+#include "ComplexKernels.h"	// ns_kernels::cgemv()
+#include "debug.h"			// ns_debug::trace
+
+using namespace std;
+
+namespace ns_hybrid {
+
+	// Default memory budget for the terms of the state, in megabytes.
+	static const double		default_memory_mb = 1024;
+
+	// Partitions are chosen so that at least this many terms fit in the budget.
+	static const size_t		min_terms = 16;
+
+	// Operations crossing the cut are only split up if they act on at most this many qubits
+	// (so that their matrices are small enough to decompose); partitions that cut through
+	// bigger ones (or through functional operations) aren't allowed.
+	static const size_t		max_cut_qubits = 10;
+
+	// Singular values, and components of terms, smaller than this (relative to the largest)
+	// are taken to be rounding errors, and dropped.
+	static const double		rank_tolerance = 1e-12;
+
+	// The exact probabilities of the final states are listed only if working them all out
+	// takes at most this many multiply-adds.
+	static const double		max_listing_work = 1 << 26;
+
+	// The cost of a partition that cuts an operation we can't split (see partition_cost()).
+	static const double		forbidden_cost = 1e9;
+
+	// One term of the state:  the state vectors of the two partitions.
+	struct ProductTerm {
+		ns_statevector::Amplitudes	a, b;
+	};
+
+	// One term of the decomposition of an operation crossing the cut:  the (dense, split)
+	// matrices of its factors on the two sides.
+	struct CutTerm {
+		vector<double>	a_re, a_im, b_re, b_im;
+	};
+
+	// An operation that crosses the cut, split up, with the positions (within the state vectors
+	// of the two partitions) of the qubits it acts on.
+	struct CutOperation {
+		vector<qubit_index_t>	a_qubits, b_qubits;
+		vector<CutTerm>			terms;
+	};
+
+	// Apply the dense (2^k x 2^k, split, row-major) matrix m, on the given k operands, to the
+	// state vector psi on nbits qubits.  Unlike ns_statevector::apply_operator(), the matrix
+	// needn't be unitary, or have any particular structure.
+	static void apply_dense(const vector<double>& m_re, const vector<double>& m_im, const vector<qubit_index_t>& operands,
+							size_t nbits, ns_statevector::Amplitudes& psi) {
+		size_t					k = operands.size(),  rank = (size_t)1 << k;
+		int						n_groups = (int)((size_t)1 << (nbits - k));
+		vector<qubit_index_t>	sorted_operands(operands);
+		sort(sorted_operands.begin(), sorted_operands.end());
+		vector<size_t>			offset(rank);
+		for (size_t j = 0;  j < rank;  j++) offset[j] = ns_statevector::scatter_bits(j, operands);
+
+		vector<double>	scratch(4*rank*ns_statevector::n_threads());
+		#pragma omp parallel
+		{
+			double*		x_re = &scratch[4*rank*ns_statevector::thread_num()];
+			double*		x_im = x_re + rank;
+			double*		y_re = x_im + rank;
+			double*		y_im = y_re + rank;
+			#pragma omp for
+			for (int g = 0;  g < n_groups;  g++) {
+				size_t	base = ns_statevector::group_base(g, sorted_operands);
+				for (size_t j = 0;  j < rank;  j++) {
+					x_re[j] = psi.re[base + offset[j]];
+					x_im[j] = psi.im[base + offset[j]];
+				}
+				ns_kernels::cgemv(rank, rank, &m_re[0], &m_im[0], x_re, x_im, y_re, y_im);
+				for (size_t j = 0;  j < rank;  j++) {
+					psi.re[base + offset[j]] = y_re[j];
+					psi.im[base + offset[j]] = y_im[j];
+				}
+			}
+		}
+	}
+
+	// The inner product <x|y>.
+	static Complex inner(const ns_statevector::Amplitudes& x, const ns_statevector::Amplitudes& y) {
+		double	re = 0,  im = 0;
+		for (size_t i = 0;  i < x.re.size();  i++) {
+			re += x.re[i]*y.re[i] + x.im[i]*y.im[i];
+			im += x.re[i]*y.im[i] - x.im[i]*y.re[i];
+		}
+		return Complex(re, im);
+	}
+
+	// y += c*x.
+	static void add_scaled(ns_statevector::Amplitudes& y, const Complex& c, const ns_statevector::Amplitudes& x) {
+		for (size_t i = 0;  i < x.re.size();  i++) {
+			y.re[i] += c.R*x.re[i] - c.I*x.im[i];
+			y.im[i] += c.R*x.im[i] + c.I*x.re[i];
+		}
+	}
+
+	// Merge the terms of the state as far as possible, by orthonormalizing the state vectors
+	// on one side (a, if on_a; else b), with the modified Gram-Schmidt process, and folding
+	// the coefficients into the other side.  Terms that come out zero are dropped.
+	static void merge_terms(vector<ProductTerm>& terms, bool on_a) {
+		vector<ProductTerm>		merged;
+		vector< vector<Complex> >	coeffs(terms.size());		// coeffs[r][k]:  side r = sum_k coeffs[r][k] basis[k].
+
+		for (size_t r = 0;  r < terms.size();  r++) {
+			ns_statevector::Amplitudes	x = on_a ? terms[r].a : terms[r].b;
+			double						orig_norm = sqrt(inner(x, x).R);
+			coeffs[r].assign(merged.size(), Complex());
+
+			// Project out the basis vectors found so far (twice, for numerical stability).
+			for (int pass = 0;  pass < 2;  pass++) {
+				for (size_t k = 0;  k < merged.size();  k++) {
+					ns_statevector::Amplitudes&	e = on_a ? merged[k].a : merged[k].b;
+					Complex						c = inner(e, x);
+					coeffs[r][k] += c;
+					add_scaled(x, Complex(-c.R, -c.I), e);
+				}
+			}
+
+			// Whatever's left is a new basis vector.
+			double	norm = sqrt(inner(x, x).R);
+			if (norm > rank_tolerance*orig_norm) {
+				for (size_t i = 0;  i < x.re.size();  i++) {
+					x.re[i] /= norm;
+					x.im[i] /= norm;
+				}
+				coeffs[r].push_back(Complex(norm));
+				merged.resize(merged.size() + 1);
+				ns_statevector::Amplitudes&	e = on_a ? merged.back().a : merged.back().b;
+				e.re.swap(x.re);
+				e.im.swap(x.im);
+			}
+		}
+
+		// The other side of each merged term is the sum of the other sides of the original
+		// terms, weighted by their components along its basis vector.
+		double	max_norm = 0;
+		for (size_t k = 0;  k < merged.size();  k++) {
+			ns_statevector::Amplitudes&	other = on_a ? merged[k].b : merged[k].a;
+			size_t						dim = (on_a ? terms[0].b : terms[0].a).re.size();
+			other.re.assign(dim, 0.0);
+			other.im.assign(dim, 0.0);
+			for (size_t r = 0;  r < terms.size();  r++) {
+				if (k < coeffs[r].size()) add_scaled(other, coeffs[r][k], on_a ? terms[r].b : terms[r].a);
+			}
+			max_norm = max(max_norm, inner(other, other).R);
+		}
+
+		terms.clear();
+		for (size_t k = 0;  k < merged.size();  k++) {
+			ns_statevector::Amplitudes&	other = on_a ? merged[k].b : merged[k].a;
+			if (inner(other, other).R <= rank_tolerance*rank_tolerance*max_norm) continue;
+			terms.push_back(ProductTerm());
+			terms.back().a.re.swap(merged[k].a.re);  terms.back().a.im.swap(merged[k].a.im);
+			terms.back().b.re.swap(merged[k].b.re);  terms.back().b.im.swap(merged[k].b.im);
+		}
+	}
+
+	// Describe a set of qubits compactly, like "0-3, 8".
+	static string describe_qubits(const vector<qubit_index_t>& qubits) {
+		ostringstream	os;
+		for (size_t i = 0;  i < qubits.size();  ) {
+			size_t	j = i;
+			while (j + 1 < qubits.size() && qubits[j + 1] == qubits[j] + 1) j++;
+			os << (i > 0 ? ", " : "") << qubits[i];
+			if (j > i) os << "-" << qubits[j];
+			i = j + 1;
+		}
+		return os.str();
+	}
+
+	// Set the bits of state from the values xa and xb of the qubits in the two partitions.
+	static void set_state_bits(State& state, size_t xa, size_t xb, const vector<qubit_index_t>* part_qubits) {
+		for (size_t i = 0;  i < part_qubits[0].size();  i++) state.bits[part_qubits[0][i]] = (((xa >> i) & 1) != 0);
+		for (size_t i = 0;  i < part_qubits[1].size();  i++) state.bits[part_qubits[1][i]] = (((xb >> i) & 1) != 0);
+	}
+}
+
+// Do two partitions of the given sizes fit within the hybrid engine's memory budget?
+
+bool SEQCSim::partition_fits(size_t na, size_t nb) {
+	double	budget_mb = qc_config.option_double("hybrid_memory_mb", ns_hybrid::default_memory_mb);
+	if (na == 0 || nb == 0 || na > ns_statevector::max_qubits || nb > ns_statevector::max_qubits) return false;
+	return 16*(pow(2.0, (double)na) + pow(2.0, (double)nb))*ns_hybrid::min_terms <= budget_mb*1024*1024;
+}
+
+// The cost of the partition of the qubits given by side[] (0 for A, 1 for B):  the number
+// of operations crossing the cut, plus ns_hybrid::forbidden_cost for each one that can't be
+// split up, plus a fraction (less than 1) that favors smaller state vectors.
+
+double SEQCSim::partition_cost(const vector<char>& side) {
+	size_t	na = 0,  crossing = 0,  forbidden = 0;
+	for (size_t q = 0;  q < side.size();  q++) if (side[q] == 0) na++;
+
+	vector<qubit_index_t>	qubits;
+	for (size_t i = 0;  i < opn_seq.size();  i++) {
+		ns_opmatrix::qubits_of(opn_seq[i], qubits);
+		bool	in_a = false,  in_b = false;
+		for (size_t k = 0;  k < qubits.size();  k++) (side[qubits[k]] ? in_b : in_a) = true;
+		if (!(in_a && in_b)) continue;
+		if (opn_seq[i].isFunctional() || qubits.size() > ns_hybrid::max_cut_qubits) {
+			forbidden++;
+		} else {
+			crossing++;
+		}
+	}
+	double	n = (double)side.size();
+	return forbidden*ns_hybrid::forbidden_cost + crossing
+		   + (pow(2.0, (double)na) + pow(2.0, n - na))/pow(2.0, n + 1);
+}
+
+// Choose the partition of the qubits for the hybrid engine (setting hybrid_side), to
+// minimize the number of operations crossing the cut, while keeping both partitions
+// within the memory budget.  We start from the best cut between consecutive qubits (the
+// registers are laid out consecutively, so this often separates them), and then move
+// single qubits across the cut, or swap pairs of them, for as long as that helps.  If no
+// partition is possible, returns false; either way, sets why to the reason.
+
+bool SEQCSim::choose_partition(string& why) {
+	size_t			n = qc_config.nbits;
+	vector<char>	side(n),  best;
+	double			best_cost = 0;
+	ostringstream	reason;
+
+	for (size_t cut = 1;  cut < n;  cut++) {
+		if (!partition_fits(cut, n - cut)) continue;
+		for (size_t q = 0;  q < n;  q++) side[q] = (q >= cut);
+		double	cost = partition_cost(side);
+		if (best.empty() || cost < best_cost) {
+			best = side;
+			best_cost = cost;
+		}
+	}
+	if (best.empty()) {
+		reason << "no split of the " << n << " qubits leaves both partitions within the budget (hybrid_memory_mb)";
+		why = reason.str();
+		return false;
+	}
+
+	bool	improved = true;
+	while (improved) {
+		improved = false;
+		size_t	na = 0;
+		for (size_t q = 0;  q < n;  q++) if (best[q] == 0) na++;
+
+		for (size_t q = 0;  q < n;  q++) {
+			side = best;
+			side[q] = !side[q];
+			size_t	new_na = side[q] ? na - 1 : na + 1;
+			if (!partition_fits(new_na, n - new_na)) continue;
+			double	cost = partition_cost(side);
+			if (cost < best_cost) {
+				best = side;  best_cost = cost;  improved = true;
+				na = new_na;
+			}
+		}
+		for (size_t q1 = 0;  q1 < n;  q1++) {
+			for (size_t q2 = q1 + 1;  q2 < n;  q2++) {
+				if (best[q1] == best[q2]) continue;
+				side = best;
+				swap(side[q1], side[q2]);
+				double	cost = partition_cost(side);
+				if (cost < best_cost) {
+					best = side;  best_cost = cost;  improved = true;
+				}
+			}
+		}
+	}
+
+	if (best_cost >= ns_hybrid::forbidden_cost) {
+		reason << "every partition cuts through a functional operation, or one on more than "
+			   << ns_hybrid::max_cut_qubits << " qubits";
+		why = reason.str();
+		return false;
+	}
+
+	hybrid_side = best;
+	vector<qubit_index_t>	part_qubits[2];
+	for (size_t q = 0;  q < n;  q++) part_qubits[(int)best[q]].push_back(q);
+	reason << "partitions " << ns_hybrid::describe_qubits(part_qubits[0]) << " | " << ns_hybrid::describe_qubits(part_qubits[1])
+		   << ", with " << (size_t)best_cost << " operations crossing the cut";
+	why = reason.str();
+	return true;
+}
+
+// Run the simulation with the hybrid engine (see the top of this file).  Returns false,
+// having done nothing visible besides saying so, if the number of terms outgrows the
+// memory budget.
+
+bool SEQCSim::run_hybrid(void)
+{
+	size_t					nbits = qc_config.nbits;
+	vector<qubit_index_t>	part_qubits[2];		// The qubits in each partition.
+	vector<qubit_index_t>	position(nbits);	// The position of each qubit within its partition's state vectors.
+	for (size_t q = 0;  q < nbits;  q++) {
+		position[q] = part_qubits[(int)hybrid_side[q]].size();
+		part_qubits[(int)hybrid_side[q]].push_back(q);
+	}
+	size_t		na = part_qubits[0].size(),  nb = part_qubits[1].size();
+	size_t		dim_a = (size_t)1 << na,  dim_b = (size_t)1 << nb;
+	double		budget_mb = qc_config.option_double("hybrid_memory_mb", ns_hybrid::default_memory_mb);
+	size_t		max_terms = (size_t)(budget_mb*1024*1024 / (16.0*(dim_a + dim_b)));
+
+	// Work out where each operation applies.  Those within a partition are renumbered for its
+	// state vectors (in local_opns[]); those crossing the cut are split up (in cut_opns[]).
+	vector<int>							opn_side(opn_seq.size());	// 0 or 1 for a partition, or -1 if crossing.
+	vector<Operation>					local_opns(opn_seq.size());
+	map<size_t, ns_hybrid::CutOperation>	cut_opns;
+	size_t								max_cut_rank = 0;
+
+	for (size_t pc = 0;  pc < opn_seq.size();  pc++) {
+		Operation&				opn = opn_seq[pc];
+		vector<qubit_index_t>	qubits;
+		ns_opmatrix::qubits_of(opn, qubits);
+		bool	in_a = false,  in_b = false;
+		for (size_t k = 0;  k < qubits.size();  k++) (hybrid_side[qubits[k]] ? in_b : in_a) = true;
+
+		if (!(in_a && in_b)) {
+			opn_side[pc] = in_b ? 1 : 0;
+			Operation&	local = local_opns[pc];
+			local = opn;
+			for (size_t k = 0;  k < local.operands.size();  k++) local.operands[k] = position[local.operands[k]];
+			for (size_t k = 0;  k < local.controls.size();  k++) local.controls[k] = position[local.controls[k]];
+			for (size_t r = 0;  r < local.registers.size();  r++) {
+				for (size_t k = 0;  k < local.registers[r].size();  k++) local.registers[r][k] = position[local.registers[r][k]];
+			}
+			continue;
+		}
+
+		// Split the operation's matrix M (on its A qubits, then its B qubits) into a sum of
+		// products, by an SVD of its rearrangement R[(oA,iA)][(oB,iB)] = M[(oA,oB)][(iA,iB)].
+		opn_side[pc] = -1;
+		ns_hybrid::CutOperation&	cut = cut_opns[pc];
+		vector<qubit_index_t>		ordered;
+		for (size_t s = 0;  s < 2;  s++) {
+			for (size_t k = 0;  k < qubits.size();  k++) {
+				if (hybrid_side[qubits[k]] != (char)s) continue;
+				ordered.push_back(qubits[k]);
+				(s == 0 ? cut.a_qubits : cut.b_qubits).push_back(position[qubits[k]]);
+			}
+		}
+		size_t			da = (size_t)1 << cut.a_qubits.size(),  db = (size_t)1 << cut.b_qubits.size();
+		vector<Complex>	m,  rearranged(da*da*db*db),  u,  v;
+		vector<double>	s;
+		ns_opmatrix::embed(operators.at(opn.operator_id), opn, ordered, m);
+		for (size_t oa = 0;  oa < da;  oa++)  for (size_t ia = 0;  ia < da;  ia++)
+			for (size_t ob = 0;  ob < db;  ob++)  for (size_t ib = 0;  ib < db;  ib++)
+				rearranged[(oa*da + ia)*db*db + ob*db + ib] = m[(oa + da*ob)*da*db + ia + da*ib];
+		ns_linalg::svd(da*da, db*db, rearranged, u, s, v);
+
+		size_t	r = s.size(),  rank = ns_linalg::numerical_rank(s, ns_hybrid::rank_tolerance);
+		cut.terms.resize(rank);
+		for (size_t k = 0;  k < rank;  k++) {
+			ns_hybrid::CutTerm&	term = cut.terms[k];
+			term.a_re.resize(da*da);  term.a_im.resize(da*da);
+			term.b_re.resize(db*db);  term.b_im.resize(db*db);
+			for (size_t i = 0;  i < da*da;  i++) {
+				term.a_re[i] = s[k]*u[i*r + k].R;
+				term.a_im[i] = s[k]*u[i*r + k].I;
+			}
+			for (size_t i = 0;  i < db*db;  i++) {
+				term.b_re[i] = v[i*r + k].R;
+				term.b_im[i] = -v[i*r + k].I;
+			}
+		}
+		max_cut_rank = max(max_cut_rank, rank);
+	}
+
+	cout << "SEQCSim::run_hybrid(): Simulating qubits " << ns_hybrid::describe_qubits(part_qubits[0]) << " and "
+		 << ns_hybrid::describe_qubits(part_qubits[1]) << " as two state vectors, with " << cut_opns.size()
+		 << " operations crossing the cut";
+	if (!cut_opns.empty()) cout << " (of Schmidt rank up to " << max_cut_rank << ")";
+	cout << ", and at most " << max_terms << " terms.\n";
+
+	// Start out in the input state.
+	vector<ns_hybrid::ProductTerm>	terms(1),  branched;
+	ns_statevector::Amplitudes		moved;
+	size_t							xa = 0,  xb = 0,  max_terms_used = 1;
+	for (size_t i = 0;  i < na;  i++) if (input_state.bits[part_qubits[0][i]]) xa |= (size_t)1 << i;
+	for (size_t i = 0;  i < nb;  i++) if (input_state.bits[part_qubits[1][i]]) xb |= (size_t)1 << i;
+	terms[0].a.re.assign(dim_a, 0.0);  terms[0].a.im.assign(dim_a, 0.0);
+	terms[0].b.re.assign(dim_b, 0.0);  terms[0].b.im.assign(dim_b, 0.0);
+	terms[0].a.re[xa] = input_state.amp.R;
+	terms[0].a.im[xa] = input_state.amp.I;
+	terms[0].b.re[xb] = 1;
+
+	for (size_t pc = 0;  pc < opn_seq.size();  pc++) {
+		if (ns_debug::trace) cout << "SEQCSim::run_hybrid(): Applying operation #" << pc << ", " << opn_seq[pc] << ".\n";
+
+		if (opn_side[pc] >= 0) {
+			// Within one partition:  Apply it to that side of each term.
+			Operation&	local = local_opns[pc];
+			size_t		n_side = opn_side[pc] ? nb : na;
+			size_t		ctrl_mask = ns_statevector::mask_of(local.controls);
+			size_t		ctrl_value = ns_statevector::scatter_bits(local.control_values, local.controls);
+			for (size_t t = 0;  t < terms.size();  t++) {
+				ns_statevector::Amplitudes&	psi = opn_side[pc] ? terms[t].b : terms[t].a;
+				if (local.isFunctional()) {
+					ns_statevector::apply_function(functions[local.function_id], local.registers, ctrl_mask, ctrl_value,
+												   n_side, psi, moved);
+				} else {
+					ns_statevector::apply_operator(operators.at(local.operator_id), local.operands, ctrl_mask, ctrl_value,
+												   n_side, psi);
+				}
+			}
+			continue;
+		}
+
+		// Crossing the cut:  Each term branches into one for each term of the operation.
+		ns_hybrid::CutOperation&	cut = cut_opns[pc];
+		if (terms.size()*cut.terms.size() > max_terms) {
+			cout << "SEQCSim::run_hybrid(): The state grew to more than " << max_terms << " terms at operation #" << pc
+				 << ", which is over the memory budget (hybrid_memory_mb = " << budget_mb
+				 << "); falling back to the path-integral engine.\n";
+			return false;
+		}
+		branched.clear();
+		for (size_t t = 0;  t < terms.size();  t++) {
+			for (size_t k = 0;  k < cut.terms.size();  k++) {
+				branched.push_back(terms[t]);
+				ns_hybrid::apply_dense(cut.terms[k].a_re, cut.terms[k].a_im, cut.a_qubits, na, branched.back().a);
+				ns_hybrid::apply_dense(cut.terms[k].b_re, cut.terms[k].b_im, cut.b_qubits, nb, branched.back().b);
+			}
+		}
+		max_terms_used = max(max_terms_used, branched.size());
+		ns_hybrid::merge_terms(branched, true);
+		ns_hybrid::merge_terms(branched, false);
+		terms.swap(branched);
+	}
+	cout << "SEQCSim::run_hybrid(): The final state has " << terms.size() << " terms (and had at most "
+		 << max_terms_used << ").\n";
+
+	// The Gram matrix of the B states, and the marginal probabilities of the values of the A qubits.
+	size_t			R = terms.size();
+	vector<Complex>	gram(R*R);
+	for (size_t q = 0;  q < R;  q++)  for (size_t p = 0;  p < R;  p++) gram[q*R + p] = ns_hybrid::inner(terms[q].b, terms[p].b);
+
+	vector<double>	cumulative_a(dim_a);
+	double			total = 0;
+	for (size_t x = 0;  x < dim_a;  x++) {
+		Complex	sum;
+		for (size_t q = 0;  q < R;  q++) {
+			Complex	aq(terms[q].a.re[x], -terms[q].a.im[x]);
+			for (size_t p = 0;  p < R;  p++) sum += aq * gram[q*R + p] * Complex(terms[p].a.re[x], terms[p].a.im[x]);
+		}
+		total += max(sum.R, 0.0);
+		cumulative_a[x] = total;
+	}
+	cout << "SEQCSim::run_hybrid(): The final state has squared norm " << total << ".\n";
+
+	// The conditional amplitudes of the B qubits, given the value xa of the A qubits.
+	ns_statevector::Amplitudes	phi;
+	vector<double>				cumulative_b(dim_b);
+
+	// List the most likely final states (or values of the measured registers), with their
+	// exact probabilities, if there aren't too many.
+	if (pow(2.0, (double)nbits)*R <= ns_hybrid::max_listing_work) {
+		map<string, double>		exact_probs;
+		current_state = input_state;
+		for (xa = 0;  xa < dim_a;  xa++) {
+			if (cumulative_a[xa] == (xa > 0 ? cumulative_a[xa - 1] : 0)) continue;
+			phi.re.assign(dim_b, 0.0);  phi.im.assign(dim_b, 0.0);
+			for (size_t p = 0;  p < R;  p++) ns_hybrid::add_scaled(phi, Complex(terms[p].a.re[xa], terms[p].a.im[xa]), terms[p].b);
+			for (xb = 0;  xb < dim_b;  xb++) {
+				double	prob = phi.re[xb]*phi.re[xb] + phi.im[xb]*phi.im[xb];
+				if (prob == 0) continue;
+				ns_hybrid::set_state_bits(current_state, xa, xb, part_qubits);
+				exact_probs[final_state_key()] += prob/total;
+			}
+		}
+		report_final_probabilities("SEQCSim::run_hybrid()", exact_probs);
+	} else {
+		cout << "SEQCSim::run_hybrid(): There are too many final states to list their probabilities.\n";
+	}
+
+	// Now sample the shots.  First choose the values of the A qubits for all of them; then, for
+	// each value chosen, work out the conditional amplitudes of the B qubits just once, and
+	// choose their values for each of the shots with that value.
+	unsigned long				n_shots = (unsigned long)qc_config.option_double("shots", 1);
+	vector< pair<size_t, unsigned long> >	shots_by_xa(n_shots);
+	vector<size_t>				shot_xa(n_shots),  shot_xb(n_shots);
+	vector<Complex>				shot_amp(n_shots);
+	map<string, unsigned long>	histogram;
+
+	for (unsigned long shot = 0;  shot < n_shots;  shot++) {
+		double	marker_position = marker_picker(prng_engine) * total;
+		size_t	x = upper_bound(cumulative_a.begin(), cumulative_a.end(), marker_position) - cumulative_a.begin();
+		shots_by_xa[shot] = make_pair(min(x, dim_a - 1), shot);
+	}
+	sort(shots_by_xa.begin(), shots_by_xa.end());
+
+	for (size_t i = 0;  i < shots_by_xa.size();  i++) {
+		xa = shots_by_xa[i].first;
+		if (i == 0 || xa != shots_by_xa[i - 1].first) {
+			phi.re.assign(dim_b, 0.0);  phi.im.assign(dim_b, 0.0);
+			for (size_t p = 0;  p < R;  p++) ns_hybrid::add_scaled(phi, Complex(terms[p].a.re[xa], terms[p].a.im[xa]), terms[p].b);
+			double	sum = 0;
+			for (xb = 0;  xb < dim_b;  xb++) {
+				sum += phi.re[xb]*phi.re[xb] + phi.im[xb]*phi.im[xb];
+				cumulative_b[xb] = sum;
+			}
+		}
+		double	marker_position = marker_picker(prng_engine) * cumulative_b[dim_b - 1];
+		xb = upper_bound(cumulative_b.begin(), cumulative_b.end(), marker_position) - cumulative_b.begin();
+		if (xb >= dim_b) xb = dim_b - 1;
+		shot_xa[shots_by_xa[i].second] = xa;
+		shot_xb[shots_by_xa[i].second] = xb;
+		shot_amp[shots_by_xa[i].second] = Complex(phi.re[xb], phi.im[xb]);
+	}
+
+	// Report them in order.
+	current_state = input_state;
+	for (unsigned long shot = 0;  shot < n_shots;  shot++) {
+		ns_hybrid::set_state_bits(current_state, shot_xa[shot], shot_xb[shot], part_qubits);
+		current_state.amp = shot_amp[shot];
+		cout << "SEQCSim::run_hybrid(): Shot #" << shot + 1 << " ended in state " << current_state << ".\n";
+		histogram[final_state_key()]++;
+	}
+
+	report_histogram("SEQCSim::run_hybrid()", histogram, n_shots);
+	return true;
+}
+
+// The cost of running the circuit with the hybrid engine (see CostModel.h), for the
+// partition choose_partition() picks.  Each operation crossing the cut multiplies the
+// number of terms by (at most) its Schmidt rank, which is at most 4^k if it acts on k
+// qubits on the smaller side of the cut;  but the terms are merged back to at most the
+// dimension of the smaller partition.  Each operation is applied to every term.
+
+void SEQCSim::estimate_hybrid(EngineEstimate& est)
+{
+	if (!choose_partition(est.note)) {
+		est.possible = false;
+		return;
+	}
+	size_t		na = 0,  nb = 0;
+	for (size_t q = 0;  q < hybrid_side.size();  q++) (hybrid_side[q] ? nb : na)++;
+	double		dims = pow(2.0, (double)na) + pow(2.0, (double)nb);
+	double		max_terms = pow(2.0, (double)min(na, nb));
+	double		budget_mb = qc_config.option_double("hybrid_memory_mb", ns_hybrid::default_memory_mb);
+	double		terms = 1,  peak_terms = 1,  flops = 0;
+
+	for (size_t pc = 0;  pc < opn_seq.size();  pc++) {
+		vector<qubit_index_t>	qubits;
+		size_t					ka = 0,  kb = 0;
+		ns_opmatrix::qubits_of(opn_seq[pc], qubits);
+		for (size_t k = 0;  k < qubits.size();  k++) (hybrid_side[qubits[k]] ? kb : ka)++;
+		double	b = (double)branching_factor(opn_seq[pc]);
+		if (ka > 0 && kb > 0) {
+			double	branched = ns_cost::times(terms, pow(4.0, (double)min(ka, kb)));
+			peak_terms = max(peak_terms, branched);
+			// Merging the branches back together takes a Gram matrix of them.
+			flops = ns_cost::plus(flops, ns_cost::times(ns_cost::times(branched, branched), dims));
+			terms = min(branched, max_terms);
+		}
+		flops = ns_cost::plus(flops, ns_cost::times(ns_cost::times(terms, dims), b));
+	}
+	est.seconds = ns_cost::times(flops, ns_cost::seconds_per_update);
+	est.memory_mb = ns_cost::times(ns_cost::times(peak_terms, dims), 16) / (1024*1024);
+	if (est.memory_mb > budget_mb) {
+		est.possible = false;
+		est.note += ", but the terms might not fit in the budget (hybrid_memory_mb)";
+	}
+}
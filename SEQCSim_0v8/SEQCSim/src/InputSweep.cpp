@@ -0,0 +1,343 @@
+//========================================================================
+// SEQCSim version 0.8 - The Space-Efficient Quantum Computer Simulator
+// By Michael P. Frank, Liviu Oniciuc, Uwe Meyer-Baese, and Liviu Oniciuc.
+// Copyright (C) 2008-2009  Florida State University Board of Trustees
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// 
+// You may contact the author at michael.patrick.frank@gmail.com, or at
+// Michael P. Frank, PO Box 025250 #24985, Miami, FL  33102-5250.
+//========================================================================
+//-------------------------------------------------------------------------
+// InputSweep.cpp - Evaluating many input states at once, against shared
+//   backward traversals of the circuit.
+//
+// The only place the input state enters recalc_amplitude() is its base case,
+// at PC 0, where the current state is compared with it.  So if, instead of
+// comparing, the traversal notes down the weight of each path that reaches
+// PC 0 (the product of the matrix elements along it), under the basis state
+// it reaches there, a single traversal back from a final state gives that
+// state's whole row of the circuit's unitary, <out|U|in> for every input
+// state "in" at once, as a sparse vector.  The amplitude of that final state
+// for any number of input states is then just a lookup in it, instead of a
+// separate run for each.
+//
+// "option: input_sweep on" reads the input states, and the final states of
+// interest, from ..\data\qsweep.txt instead of qinput.txt, with lines like
+//
+//		output: a = 2, b = 3
+//		input: a = 1, b = 1
+//		input: a = 2, b = 1
+//
+// Each line gives a basis state, with "name = value" assignments as in
+// qinput.txt (the bits it doesn't name are 0).  There's one traversal for
+// each output, and then, for each input, the amplitude and probability of
+// each output are printed.  With "option: shots N", N shots are sampled for
+// each input, too, among the outputs listed;  whatever probability is left
+// over goes to the final states that weren't listed, which are lumped
+// together, since the traversals don't say anything more about them.
+//
+// A depth-first traversal, like recalc_amplitude()'s, goes back along each
+// path separately, so it never notices that paths have met again.  So the
+// row is first carried back one operation at a time as a whole, as a sparse
+// vector, adding up the entries for the same basis state as it goes, for as
+// long as that vector fits in "option: sweep_memory_mb X" (default
+// ns_sweep::default_memory_mb).  Only if it outgrows that does the rest of
+// the way back go depth-first, from each of its entries, which takes no more
+// memory than recalc_amplitude() does.  Either way, the traversal goes back
+// through Clifford segments all at once (see Clifford.h), but through
+// subcircuit instances one operation at a time, since their transfer tables
+// are kept by amplitude type in the engine's ScratchArena.  It doesn't depend
+// on the engine chosen.  Since it needs whole final states, it can't be used
+// together with "measure:" (and the light-cone pruning that comes with it).
+//-------------------------------------------------------------------------
+
+#include <iostream>				// cout
+#include <sstream>				// istringstream
+#include <vector>				// STL vector<> template.
+#include <map>					// For the rows, and the histograms of final states.
+#include "SEQCSim.h"
+#include "FileReader.h"			// FileReader, MagicCookie
+
+namespace ns_sweep {
+	static const string	default_sweep_filename	= "..\\data\\qsweep.txt";
+	static const double	negligible_prob			= 1e-12;	// Outputs less likely than this aren't listed for an input.
+	static const double	default_memory_mb		= 256;		// Default budget for the row, while it's carried back whole.
+	static const double	bytes_per_entry			= 128;		// Rough size of an entry of it (map node, Key & Complex).
+	static const size_t	bits_per_chunk			= 32;		// Bits of a basis state per word of its Key.
+
+	// A basis state, as the values of successive chunks of its bits.
+	typedef vector<size_t>	Key;
+
+	// One row of the circuit's unitary, as it is being worked out:  for each basis state
+	// reached at PC stop_pc so far, the sum of the weights of the paths reaching it.
+	class Row {
+	public:
+		vector< vector<qubit_index_t> >	chunks;		// The qubits in each word of a Key.
+		map<Key, Complex>				coeffs;		// The nonzero elements of the row, so far.
+		operation_index_t				stop_pc;	// The PC the traversal goes back to.
+		double							n_frames;	// The number of traversal frames it took.
+
+		Row(size_t nbits) : stop_pc(0), n_frames(0) {
+			for (size_t q = 0;  q < nbits;  q++) {
+				if (q % bits_per_chunk == 0) chunks.push_back(vector<qubit_index_t>());
+				chunks.back().push_back((qubit_index_t)q);
+			}
+		}
+
+		void	key_of(State& state, Key& key) const {
+			key.resize(chunks.size());
+			for (size_t c = 0;  c < chunks.size();  c++) key[c] = state.extractBits(chunks[c]);
+		}
+
+		void	set_state(State& state, const Key& key) const {
+			for (size_t c = 0;  c < chunks.size();  c++) state.setBits(chunks[c], key[c]);
+		}
+
+		Complex	coeff(State& state) const {
+			Key		key;
+			key_of(state, key);
+			map<Key, Complex>::const_iterator	found = coeffs.find(key);
+			return (found == coeffs.end()) ? Complex() : found->second;
+		}
+	};
+
+	// A basis state from a line of qsweep.txt, with the text it was given as.
+	class SweepState {
+	public:
+		string	label;
+		State	state;
+	};
+}
+
+using namespace ns_sweep;
+
+// Go back from the current state, at the current PC, to the row's stop_pc, along every path,
+// adding the weight of each path (times the given weight, of the path so far) into the row,
+// under the basis state it reaches.  Afterwards, the PC and current_state are back the way
+// they were.
+
+void SEQCSim::sweep_backwards(Complex weight, Row& row) {
+	row.n_frames++;
+
+	if (program_counter == row.stop_pc) {
+		Key		key;
+		row.key_of(current_state, key);
+		row.coeffs[key] += weight;
+		return;
+	}
+
+	// If a Clifford segment ends here, go back through all of it at once, as in recalc_through_clifford().
+	if (!segment_ending_at.empty() && segment_ending_at[program_counter] >= 0) {
+		const CliffordSegment&		seg = clifford_segments[segment_ending_at[program_counter]];
+		size_t						out = current_state.extractBits(seg.qubits);
+		ns_clifford::AffineState	st(out);
+		operation_index_t			saved_PC = program_counter;
+
+		for (size_t g = seg.gates.size();  g-- > 0;  ) {
+			const ns_clifford::Gate&	gate = seg.gates[g];
+			switch (gate.type) {
+			case ns_clifford::GATE_H:		st.apply_h(gate.a);  break;
+			case ns_clifford::GATE_S:		st.apply_s(gate.a);  st.apply_s(gate.a);  st.apply_s(gate.a);  break;	// S^-1 = S^3
+			case ns_clifford::GATE_CNOT:	st.apply_cnot(gate.a, gate.b);  break;
+			}
+		}
+
+		program_counter = seg.first;
+		for (size_t k = 0;  k < st.n_terms();  k++) {
+			Complex		a;
+			size_t		in = st.term(k, a);
+			current_state.setBits(seg.qubits, in);
+			sweep_backwards(weight * seg.phase * Complex(a.R, -a.I), row);
+		}
+		current_state.setBits(seg.qubits, out);
+		program_counter = saved_PC;
+		return;
+	}
+
+	program_counter--;
+	Operation&	cur_opn = opn_seq.at(program_counter);
+
+	if (!cur_opn.controls.empty() && current_state.extractBits(cur_opn.controls) != cur_opn.control_values) {
+		// The controls aren't satisfied, so the operation was the identity here.
+		sweep_backwards(weight, row);
+
+	} else if (cur_opn.isFunctional()) {
+		FunctionalOperator&	func = functions[cur_opn.function_id];
+		size_t				regs[ns_functions::max_registers], widths[ns_functions::max_registers];
+		size_t				saved_regs[ns_functions::max_registers];
+
+		load_registers(cur_opn, regs, widths);
+		for (size_t r = 0;  r < cur_opn.registers.size();  r++) saved_regs[r] = regs[r];
+		func.apply_inverse(regs, widths);
+		store_registers(cur_opn, regs);
+		sweep_backwards(weight * func.phase_of(regs, widths), row);
+		store_registers(cur_opn, saved_regs);
+
+	} else {
+		Operator&	cur_opr = operators.at(cur_opn.operator_id);
+		size_t		out_idx = current_state.extractBits(cur_opn.operands);
+
+		if (cur_opr.isMonomial()) {
+			size_t	pred_idx = cur_opr.mono_source[out_idx];
+			if (cur_opr.form == Operator::MONOMIAL) current_state.setBits(cur_opn.operands, pred_idx);
+			sweep_backwards(cur_opr.mono_unit[pred_idx] ? weight : weight * cur_opr.mono_elem[pred_idx], row);
+		} else {
+			SmartComplexVector&		cur_row = cur_opr.U.rows.at(out_idx);
+			vector<size_t>&			block_col_indices = cur_row.indices_of_nz_elems();
+			for (size_t k = 0;  k < block_col_indices.size();  k++) {
+				size_t	pred_idx = block_col_indices[k];
+				current_state.setBits(cur_opn.operands, pred_idx);
+				sweep_backwards(weight * (Complex)cur_row[pred_idx], row);
+			}
+		}
+		current_state.setBits(cur_opn.operands, out_idx);
+	}
+
+	program_counter++;
+}
+
+// Read the inputs and outputs from qsweep.txt, work out the outputs' rows of the unitary,
+// and report each input's amplitudes for them (and its shots).
+
+void SEQCSim::run_input_sweep(void)
+{
+	if (!measured_registers.empty()) {
+		cout << "SEQCSim::run_input_sweep(): Error!  An input sweep needs whole final states, so it can't be used with \"measure:\".\n";
+		exit(1);
+	}
+	if (engine != ENGINE_PATH_INTEGRAL) {
+		cout << "SEQCSim::run_input_sweep(): Note: The input sweep does its own traversals of the circuit, "
+			 << "so the engine chosen isn't used.\n";
+	}
+
+	// Read the sweep file.  It starts with a magic cookie, like qinput.txt.
+	FileReader			sweepReader(default_sweep_filename);
+	MagicCookie			sweep_file_cookie(sweepReader);
+	vector<SweepState>	inputs, outputs;
+
+	if (!sweep_file_cookie.valid()) {
+		cout << "SEQCSim::run_input_sweep(): Error! The file's magic cookie is not valid! Ignoring...\n";
+	}
+	while (true) {
+		auto_ptr<string>	contentLine = sweepReader.getLine_ignoreComments();
+		if (contentLine.get() == NULL) break;
+
+		istringstream	istr(*contentLine);
+		string			kind, rest, assignment;
+		istr >> kind;
+		getline(istr, rest);
+
+		if (kind != "input:" && kind != "output:") {
+			cout << "SEQCSim::run_input_sweep(): Error!  Expected \"input:\" or \"output:\" at the start of the line ["
+				 << *contentLine << "] in " << default_sweep_filename << ".\n";
+			exit(1);
+		}
+		vector<SweepState>&	list = (kind == "input:") ? inputs : outputs;
+
+		// The rest of the line is a comma-separated list of "name = value" assignments.
+		list.push_back(SweepState());
+		SweepState&		st = list.back();
+		size_t			first = rest.find_first_not_of(" \t"),  last = rest.find_last_not_of(" \t\r");
+		st.label = (first == string::npos) ? "" : rest.substr(first, last - first + 1);
+		st.state.bits.resize(qc_config.nbits);
+
+		istringstream	assignments(rest);
+		while (getline(assignments, assignment, ',')) {
+			istringstream	astr(assignment);
+			string			name, equal_sign;
+			unsigned int	value;
+			if (!(astr >> name >> equal_sign >> value) || equal_sign != "=" || !assign_named_value(st.state, name, value)) {
+				cout << "SEQCSim::run_input_sweep(): Error!  Can't make sense of the assignment [" << assignment
+					 << "] in " << default_sweep_filename << ".\n";
+				exit(1);
+			}
+		}
+	}
+	if (outputs.empty()) {
+		cout << "SEQCSim::run_input_sweep(): Error!  " << default_sweep_filename << " doesn't list any outputs.\n";
+		exit(1);
+	}
+	cout << "SEQCSim::run_input_sweep(): Sweeping " << inputs.size() << " inputs, for " << outputs.size() << " outputs.\n";
+
+	// One traversal for each output.  First, carry its row back whole, a step at a time (a
+	// whole Clifford segment, or else one operation), for as long as it fits in the budget.
+	double			budget_mb = qc_config.option_double("sweep_memory_mb", default_memory_mb);
+	size_t			max_entries = (size_t)(budget_mb*1024*1024/bytes_per_entry);
+	vector<Row>		rows(outputs.size(), Row(qc_config.nbits));
+	for (size_t o = 0;  o < outputs.size();  o++) {
+		Row&				row = rows[o];
+		operation_index_t	pc = opn_seq.size();
+		Key					key;
+		row.key_of(outputs[o].state, key);
+		row.coeffs[key] = Complex(1);
+
+		current_state = outputs[o].state;
+		while (pc > 0 && row.coeffs.size() <= max_entries) {
+			map<Key, Complex>	front;
+			front.swap(row.coeffs);
+			row.stop_pc = (!segment_ending_at.empty() && segment_ending_at[pc] >= 0)
+						? clifford_segments[segment_ending_at[pc]].first : pc - 1;
+			for (map<Key, Complex>::iterator it = front.begin();  it != front.end();  it++) {
+				row.set_state(current_state, it->first);
+				program_counter = pc;
+				sweep_backwards(it->second, row);
+			}
+			pc = row.stop_pc;
+		}
+		if (pc > 0) {
+			cout << "SEQCSim::run_input_sweep(): Output " << outputs[o].label << "'s row outgrew the "
+				 << budget_mb << " MB budget at PC " << pc << ", so it goes the rest of the way back depth-first.\n";
+			map<Key, Complex>	front;
+			front.swap(row.coeffs);
+			row.stop_pc = 0;
+			for (map<Key, Complex>::iterator it = front.begin();  it != front.end();  it++) {
+				row.set_state(current_state, it->first);
+				program_counter = pc;
+				sweep_backwards(it->second, row);
+			}
+		}
+
+		cout << "SEQCSim::run_input_sweep(): Output " << outputs[o].label << " is reachable from " << row.coeffs.size()
+			 << " basis states (its row took " << row.n_frames << " traversal frames).\n";
+	}
+
+	// Then just look up each input in each row.
+	unsigned long	n_shots = (unsigned long)qc_config.option_double("shots", 1);
+	vector<double>	probs(outputs.size());
+	for (size_t i = 0;  i < inputs.size();  i++) {
+		double	total = 0;
+		cout << "SEQCSim::run_input_sweep(): Input " << inputs[i].label << ":\n";
+		for (size_t o = 0;  o < outputs.size();  o++) {
+			Complex		amp = rows[o].coeff(inputs[i].state);
+			probs[o] = amp.squared_norm();
+			total += probs[o];
+			if (probs[o] < negligible_prob) continue;
+			cout << "   " << outputs[o].label << " : amplitude ";
+			amp.putTo(cout);
+			cout << ", probability " << probs[o] << "\n";
+		}
+		if (1 - total >= negligible_prob) cout << "   (other final states) : probability " << 1 - total << "\n";
+
+		if (n_shots <= 1) continue;
+		map<string, unsigned long>	histogram;
+		for (unsigned long shot = 0;  shot < n_shots;  shot++) {
+			double	marker = marker_picker(prng_engine);
+			size_t	o = 0;
+			while (o < outputs.size() && marker >= probs[o]) marker -= probs[o++];
+			histogram[(o < outputs.size()) ? outputs[o].label : "(other final states)"]++;
+		}
+		report_histogram("SEQCSim::run_input_sweep()", histogram, n_shots);
+	}
+}
@@ -0,0 +1,99 @@
+//========================================================================
+// SEQCSim version 0.8 - The Space-Efficient Quantum Computer Simulator
+// By Michael P. Frank, Liviu Oniciuc, Uwe Meyer-Baese, and Liviu Oniciuc.
+// Copyright (C) 2008-2009  Florida State University Board of Trustees
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// 
+// You may contact the author at michael.patrick.frank@gmail.com, or at
+// Michael P. Frank, PO Box 025250 #24985, Miami, FL  33102-5250.
+//========================================================================
+
+//-------------------------------------------------------------------------
+// LightCone.cpp - The light-cone pass, which drops every operation that
+//   can't affect the qubits that will be measured.
+//
+// Often only the distribution of one register matters, like the exponent
+// register a in Shor's algorithm.  If the configuration file names the
+// registers to be measured (with a line like "measure: a"), then working
+// backwards from the end of the circuit, an operation can only affect those
+// registers if it acts on a qubit in their backward light cone:  the measured
+// qubits, plus all the qubits of every operation already found to affect them.
+// Any other operation is dropped.  Dropping an operation that's outside the
+// light cone leaves the joint distribution of the measured qubits unchanged,
+// because everything it does happens on qubits that never interact with them
+// again, and it removes a step from both the forward pass and every backward
+// recursion through that point.
+//
+// Since the other qubits' final values then no longer mean anything, the
+// histogram of final states (see run_with()) only counts the measured values.
+//-------------------------------------------------------------------------
+
+#include <iostream>			// cout
+#include "SEQCSim.h"
+#include "OperationMatrix.h"	// ns_opmatrix::qubits_of()
+#include "debug.h"			// ns_debug::trace
+
+using namespace std;
+
+// Look up the qubits of the registers named in the configuration's "measure:" line,
+// into measured_registers.
+
+void SEQCSim::find_measured_registers() {
+	measured_registers.resize(qc_config.measuredNames.size());
+	for (size_t m = 0;  m < qc_config.measuredNames.size();  m++) {
+		const string&	name = qc_config.measuredNames[m];
+		if (name.find('[') != string::npos)	measured_registers[m].assign(1, qc_config.lookup_byName(name));
+		else								qc_config.lookup_register(name, measured_registers[m]);
+	}
+}
+
+// Run the light-cone pass over opn_seq (see the top of this file), if there's anything
+// to measure.
+
+void SEQCSim::prune_light_cone() {
+	find_measured_registers();
+	if (measured_registers.empty()) return;
+
+	// Which qubits are in the light cone so far?  Start with the measured ones.
+	vector<bool>	in_cone(qc_config.nbits, false);
+	for (size_t m = 0;  m < measured_registers.size();  m++)
+		for (size_t k = 0;  k < measured_registers[m].size();  k++) in_cone.at(measured_registers[m][k]) = true;
+
+	// Work backwards through the circuit.
+	vector<bool>	keep(opn_seq.size(), false);
+	size_t			n_kept = 0;
+	for (size_t i = opn_seq.size();  i > 0;  i--) {
+		vector<qubit_index_t>	qubits;
+		ns_opmatrix::qubits_of(opn_seq[i-1], qubits);
+
+		for (size_t k = 0;  k < qubits.size();  k++) if (in_cone.at(qubits[k])) keep[i-1] = true;
+		if (!keep[i-1]) {
+			if (ns_debug::trace) cout << "SEQCSim::prune_light_cone(): Operation #" << i-1 << " can't affect the measured qubits.\n";
+			continue;
+		}
+
+		// It's in the light cone, so all of its qubits are now too.
+		for (size_t k = 0;  k < qubits.size();  k++) in_cone.at(qubits[k]) = true;
+		n_kept++;
+	}
+
+	vector<Operation>	kept_seq;
+	kept_seq.reserve(n_kept);
+	for (size_t i = 0;  i < opn_seq.size();  i++) if (keep[i]) kept_seq.push_back(opn_seq[i]);
+
+	cout << "SEQCSim::prune_light_cone(): Kept " << n_kept << " of the " << opn_seq.size()
+		 << " operations; the rest can't affect the measured qubits.\n";
+	opn_seq.swap(kept_seq);
+}
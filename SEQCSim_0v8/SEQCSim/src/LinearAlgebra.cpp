@@ -0,0 +1,227 @@
+//========================================================================
+// SEQCSim version 0.8 - The Space-Efficient Quantum Computer Simulator
+// By Michael P. Frank, Liviu Oniciuc, Uwe Meyer-Baese, and Liviu Oniciuc.
+// Copyright (C) 2008-2009  Florida State University Board of Trustees
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// 
+// You may contact the author at michael.patrick.frank@gmail.com, or at
+// Michael P. Frank, PO Box 025250 #24985, Miami, FL  33102-5250.
+//========================================================================
+
+//-------------------------------------------------------------------------
+// LinearAlgebra.cpp - Dense complex linear algebra (see LinearAlgebra.h).
+//
+// The SVD uses the one-sided Jacobi method (Hestenes'):  we repeatedly apply
+// plane rotations to pairs of columns of the matrix, each of which makes the
+// two columns orthogonal, until all the columns are orthogonal to each other.
+// The column norms are then the singular values, the normalized columns are
+// the left singular vectors, and the product of the rotations gives the right
+// singular vectors.  It's slower than the textbook bidiagonalization for big
+// matrices, but it's short, it's very accurate for small singular values, and
+// the matrices we use it on are small.
+//-------------------------------------------------------------------------
+
+#include <iostream>				// cout
+#include <math.h>				// sqrt(), fabs()
+#include <algorithm>			// sort(), max()
+#include <utility>				// pair<>
+#include "LinearAlgebra.h"
+#include "debug.h"				// ns_debug::trace
+
+using namespace std;
+
+namespace ns_linalg {
+
+	// Complex conjugate.
+	static Complex conj(const Complex& c) { return Complex(c.R, -c.I); }
+
+	// Set column k of the (rows x cols) matrix u to unit vector e, minus its projections on
+	// columns 0..k-1 (which are orthonormal).  Returns the squared norm of what's left.
+	static double orthogonalize_unit(size_t rows, size_t cols, vector<Complex>& u, size_t k, size_t e) {
+		for (size_t i = 0;  i < rows;  i++) u[i*cols + k] = Complex(i == e ? 1 : 0);
+		for (size_t pass = 0;  pass < 2;  pass++) {			// (Twice, for accuracy.)
+			for (size_t m = 0;  m < k;  m++) {
+				Complex	dot;
+				for (size_t i = 0;  i < rows;  i++) dot += conj(u[i*cols + m]) * u[i*cols + k];
+				for (size_t i = 0;  i < rows;  i++) u[i*cols + k] = u[i*cols + k] - dot*u[i*cols + m];
+			}
+		}
+		double	norm_sq = 0;
+		for (size_t i = 0;  i < rows;  i++) norm_sq += u[i*cols + k].squared_norm();
+		return norm_sq;
+	}
+
+	// Fill in column k of u with a unit vector orthogonal to its columns 0..k-1, starting
+	// from whichever unit vector has the most left over after orthogonalizing it against them.
+	static void complete_column(size_t rows, size_t cols, vector<Complex>& u, size_t k) {
+		size_t	best = 0;
+		double	best_norm_sq = -1;
+		for (size_t e = 0;  e < rows;  e++) {
+			double	norm_sq = orthogonalize_unit(rows, cols, u, k, e);
+			if (norm_sq > best_norm_sq) {
+				best = e;
+				best_norm_sq = norm_sq;
+			}
+		}
+		double	norm = sqrt(orthogonalize_unit(rows, cols, u, k, best));
+		for (size_t i = 0;  i < rows;  i++) u[i*cols + k] = u[i*cols + k] * Complex(1/norm);
+	}
+
+	// The SVD of a (rows x cols) matrix with rows >= cols.  Returns false if the columns
+	// still weren't orthogonal after svd_max_sweeps sweeps.
+	static bool svd_tall(size_t rows, size_t cols, const vector<Complex>& a,
+						 vector<Complex>& u, vector<double>& s, vector<Complex>& v) {
+		// The Frobenius norm of a (computed relative to its largest element, so that it can't
+		// underflow either).
+		double	a_max = 0,  sum_sq = 0;
+		for (size_t i = 0;  i < rows*cols;  i++) a_max = max(a_max, max(fabs(a[i].R), fabs(a[i].I)));
+		for (size_t i = 0;  i < rows*cols && a_max > 0;  i++) sum_sq += (a[i] * Complex(1/a_max)).squared_norm();
+		double	scale = a_max*sqrt(sum_sq);
+
+		// Work on a/scale, whose columns all have norms of at most 1, so that the squared norms
+		// and inner products below can't underflow into denormals (which would make the phase
+		// computed from them less than unit-modulus, and the rotations not unitary).
+		vector<Complex>	w(rows*cols);					// The columns being orthogonalized.
+		vector<Complex>	rot(cols*cols);					// The product of the rotations so far.
+		if (scale > 0) {
+			for (size_t i = 0;  i < rows*cols;  i++) w[i] = a[i] * Complex(1/scale);
+		}
+		for (size_t j = 0;  j < cols;  j++) rot[j*cols + j] = Complex(1);
+
+		// Columns with squared norms below this are negligible, and left alone.
+		double	negligible = svd_negligible*svd_negligible;
+		bool	rotated = true;
+		for (size_t sweep = 0;  rotated && sweep < svd_max_sweeps;  sweep++) {
+			rotated = false;
+			for (size_t p = 0;  p + 1 < cols;  p++) {
+				for (size_t q = p + 1;  q < cols;  q++) {
+					// The norms of columns p and q, and their inner product gamma.
+					double	alpha = 0,  beta = 0;
+					Complex	gamma;
+					for (size_t i = 0;  i < rows;  i++) {
+						alpha += w[i*cols + p].squared_norm();
+						beta += w[i*cols + q].squared_norm();
+						gamma += conj(w[i*cols + p]) * w[i*cols + q];
+					}
+					if (alpha < negligible || beta < negligible) continue;
+					double	g = gamma.norm();
+					if (g <= svd_tolerance*sqrt(alpha)*sqrt(beta)) continue;
+					rotated = true;
+
+					// Take the phase out of column q, so that gamma is real, then do the real
+					// Jacobi rotation that makes the two columns orthogonal.
+					Complex	phase(gamma.R/g, -gamma.I/g);
+					double	zeta = (beta - alpha)/(2*g);
+					double	t = (zeta >= 0 ? 1 : -1)/(fabs(zeta) + sqrt(1 + zeta*zeta));
+					double	c = 1/sqrt(1 + t*t),  sn = c*t;
+					for (size_t i = 0;  i < rows;  i++) {
+						Complex	wp = w[i*cols + p],  wq = phase*w[i*cols + q];
+						w[i*cols + p] = Complex(c)*wp - Complex(sn)*wq;
+						w[i*cols + q] = Complex(sn)*wp + Complex(c)*wq;
+					}
+					for (size_t i = 0;  i < cols;  i++) {
+						Complex	vp = rot[i*cols + p],  vq = phase*rot[i*cols + q];
+						rot[i*cols + p] = Complex(c)*vp - Complex(sn)*vq;
+						rot[i*cols + q] = Complex(sn)*vp + Complex(c)*vq;
+					}
+				}
+			}
+		}
+
+		// The singular values are the column norms (those of negligible columns count as 0);
+		// sort them into decreasing order.
+		vector< pair<double, size_t> >	order(cols);
+		for (size_t j = 0;  j < cols;  j++) {
+			double	norm_sq = 0;
+			for (size_t i = 0;  i < rows;  i++) norm_sq += w[i*cols + j].squared_norm();
+			order[j] = make_pair(norm_sq < negligible ? 0.0 : -sqrt(norm_sq), j);
+		}
+		sort(order.begin(), order.end());
+
+		u.assign(rows*cols, Complex());
+		s.resize(cols);
+		v.resize(cols*cols);
+		for (size_t k = 0;  k < cols;  k++) {
+			size_t	j = order[k].second;
+			double	norm = -order[k].first;
+			s[k] = (norm > 0) ? norm*scale : 0;
+			if (norm > 0) {
+				for (size_t i = 0;  i < rows;  i++) u[i*cols + k] = w[i*cols + j] * Complex(1/norm);
+			} else {
+				complete_column(rows, cols, u, k);		// (The zero singular values come last.)
+			}
+			for (size_t i = 0;  i < cols;  i++) v[i*cols + k] = rot[i*cols + j];
+		}
+		return !rotated;
+	}
+
+	// How far the decomposition is from exact:  the largest of |u * diag(s) * v^H - a| (relative
+	// to a's largest element), |u^H u - I| and |v^H v - I|, in the max norm.
+	static double svd_error(size_t rows, size_t cols, const vector<Complex>& a,
+							const vector<Complex>& u, const vector<double>& s, const vector<Complex>& v) {
+		size_t	r = s.size();
+		double	a_max = 0,  err = 0;
+		for (size_t i = 0;  i < rows*cols;  i++) a_max = max(a_max, max(fabs(a[i].R), fabs(a[i].I)));
+		for (size_t i = 0;  i < rows;  i++) {
+			for (size_t j = 0;  j < cols;  j++) {
+				Complex	sum;
+				for (size_t k = 0;  k < r;  k++) sum += u[i*r + k] * Complex(s[k]) * conj(v[j*r + k]);
+				if (a_max > 0) err = max(err, ((sum - a[i*cols + j]) * Complex(1/a_max)).norm());
+			}
+		}
+		for (size_t k = 0;  k < r;  k++) {
+			for (size_t m = 0;  m < r;  m++) {
+				Complex	u_dot(k == m ? -1 : 0),  v_dot(k == m ? -1 : 0);
+				for (size_t i = 0;  i < rows;  i++) u_dot += conj(u[i*r + k]) * u[i*r + m];
+				for (size_t j = 0;  j < cols;  j++) v_dot += conj(v[j*r + k]) * v[j*r + m];
+				err = max(err, max(u_dot.norm(), v_dot.norm()));
+			}
+		}
+		return err;
+	}
+
+	bool svd(size_t rows, size_t cols, const vector<Complex>& a,
+			 vector<Complex>& u, vector<double>& s, vector<Complex>& v) {
+		bool	converged;
+		if (rows >= cols) {
+			converged = svd_tall(rows, cols, a, u, s, v);
+		} else {
+			// For a wide matrix, decompose its conjugate transpose a^H = v * diag(s) * u^H instead.
+			vector<Complex>	a_h(cols*rows);
+			for (size_t i = 0;  i < rows;  i++) {
+				for (size_t j = 0;  j < cols;  j++) a_h[j*rows + i] = conj(a[i*cols + j]);
+			}
+			converged = svd_tall(cols, rows, a_h, v, s, u);
+		}
+
+		static bool	noted = false;
+		if (!converged && !noted) {
+			cout << "ns_linalg::svd(): Note: The singular value decomposition of a " << rows << " x " << cols
+				 << " matrix had not converged after " << svd_max_sweeps << " sweeps;  using it anyway.\n";
+			noted = true;
+		}
+		if (ns_debug::trace) {
+			cout << "ns_linalg::svd(): The decomposition of a " << rows << " x " << cols << " matrix is off by "
+				 << svd_error(rows, cols, a, u, s, v) << ".\n";
+		}
+		return converged;
+	}
+
+	size_t numerical_rank(const vector<double>& s, double relative_tolerance) {
+		size_t	rank = 0;
+		while (rank < s.size() && s[rank] > 0 && s[rank] > relative_tolerance*s[0]) rank++;
+		return rank;
+	}
+}
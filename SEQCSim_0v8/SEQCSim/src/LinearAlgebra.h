@@ -0,0 +1,64 @@
+//========================================================================
+// SEQCSim version 0.8 - The Space-Efficient Quantum Computer Simulator
+// By Michael P. Frank, Liviu Oniciuc, Uwe Meyer-Baese, and Liviu Oniciuc.
+// Copyright (C) 2008-2009  Florida State University Board of Trustees
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// 
+// You may contact the author at michael.patrick.frank@gmail.com, or at
+// Michael P. Frank, PO Box 025250 #24985, Miami, FL  33102-5250.
+//========================================================================
+
+//-------------------------------------------------------------------------
+// LinearAlgebra.h - Dense complex linear algebra, for the engines that
+//   factor operators and states (such as the hybrid engine in Hybrid.cpp).
+//
+// Like the matrices in OperationMatrix.h, the matrices here are dense,
+// row-major vector<Complex>s.  They're meant for the small matrices that
+// come from splitting an operation, or a state, across a cut between two
+// sets of qubits, not for anything on the scale of a whole state vector.
+//-------------------------------------------------------------------------
+
+#pragma once
+
+#include <vector>				// STL vector<> template
+#include "Complex.h"			// Matrix elements
+
+using namespace std;
+
+namespace ns_linalg {
+
+	// The singular-value iteration stops once every pair of columns is orthogonal to within
+	// this (relative to their norms).
+	static const double		svd_tolerance = 1e-15;
+
+	// And gives up (with the best result so far) after this many sweeps over the columns.
+	static const size_t		svd_max_sweeps = 60;
+
+	// Columns whose norms fall below this (relative to the norm of the whole matrix) are
+	// treated as zero:  they aren't rotated any further, and their singular values come out 0.
+	static const double		svd_negligible = 1e-15;
+
+	// Singular value decomposition of the (rows x cols) matrix a:  a = u * diag(s) * v^H, where
+	// u is (rows x r), v is (cols x r), and s has r = min(rows, cols) entries, in decreasing
+	// order.  The columns of u and of v are orthonormal (even when a is rank-deficient).
+	// Returns false (and notes it, the first time) if it didn't converge within svd_max_sweeps.
+	// With ns_debug::trace on, it also checks and prints how far the result is from exact.
+	bool	svd(size_t rows, size_t cols, const vector<Complex>& a,
+				vector<Complex>& u, vector<double>& s, vector<Complex>& v);
+
+	// The number of singular values (from svd()) that are significant, that is, larger than
+	// relative_tolerance times the largest one.
+	size_t	numerical_rank(const vector<double>& s, double relative_tolerance);
+}
@@ -21,6 +21,7 @@
 //========================================================================
 
 #include <sstream>		// istringstream
+#include <algorithm>	// sort()
 #include "Matrix.h"
 #include "debug.h"
 
@@ -47,6 +48,78 @@ void Matrix::initColumns(void) {
 	}
 }
 
+// Partition the matrix into its diagonal blocks.  Two columns belong to the same
+// block iff they are connected by a chain of nonzero matrix elements (column to row
+// to column, etc.), so we find the blocks as the connected components of that graph,
+// using a simple worklist traversal.
+
+void Matrix::initBlocks(void) {
+	const size_t	unassigned = (size_t)-1;	// Marks a row or column not yet placed in a block.
+
+	blocks.clear();
+	col_block.assign(cols.size(), unassigned);
+	row_block.assign(rows.size(), unassigned);
+
+	for (size_t  seed_col = 0;  seed_col < cols.size();  seed_col++) {
+		if (col_block[seed_col] != unassigned) continue;	// Already part of some earlier block.
+
+		size_t			block_i = blocks.size();
+		blocks.resize(block_i + 1);
+		MatrixBlock&	block = blocks.back();
+
+		// Grow the block outwards from the seed column.
+		vector<size_t>	col_worklist(1, seed_col);
+		col_block[seed_col] = block_i;
+		while (!col_worklist.empty()) {
+			size_t			col_j = col_worklist.back();  col_worklist.pop_back();
+			block.col_indices.push_back(col_j);
+			vector<size_t>&	col_nzs = cols.at(col_j).indices_of_nz_elems();
+			for (size_t  k = 0;  k < col_nzs.size();  k++) {
+				size_t	row_i = col_nzs[k];
+				if (row_block[row_i] != unassigned) continue;
+				row_block[row_i] = block_i;
+				block.row_indices.push_back(row_i);
+				vector<size_t>&	row_nzs = rows.at(row_i).indices_of_nz_elems();
+				for (size_t  m = 0;  m < row_nzs.size();  m++) {
+					if (col_block[row_nzs[m]] == unassigned) {
+						col_block[row_nzs[m]] = block_i;
+						col_worklist.push_back(row_nzs[m]);
+					}
+				}
+			}
+		}
+		sort(block.row_indices.begin(), block.row_indices.end());
+		sort(block.col_indices.begin(), block.col_indices.end());
+
+		// Make the dense split-format copy of the block's submatrix.
+		size_t	nr = block.row_indices.size(),  nc = block.col_indices.size();
+		block.elems_re.resize(nr*nc);
+		block.elems_im.resize(nr*nc);
+		block.elems_exact.resize(nr*nc);
+		for (size_t  i = 0;  i < nr;  i++) {
+			for (size_t  j = 0;  j < nc;  j++) {
+				Complex	elem = rows.at(block.row_indices[i])[block.col_indices[j]];
+				block.elems_re[i*nc + j] = elem.R;
+				block.elems_im[i*nc + j] = elem.I;
+				block.elems_exact[i*nc + j] = RootOfUnityElem(elem);
+			}
+		}
+
+		if (ns_debug::trace) {
+			cout << "Matrix::initBlocks(): Block #" << block_i << " has rank " << block.rank() << ".\n";
+		}
+	}
+}
+
+// The largest rank of any block.  (This is the most branching the matrix can cause.)
+
+size_t Matrix::max_block_rank(void) {
+	size_t	max_rank = 0;
+	for (size_t  b = 0;  b < blocks.size();  b++)
+		if (blocks[b].rank() > max_rank) max_rank = blocks[b].rank();
+	return max_rank;
+}
+
 // Change this matrix to a square matrix of rank r.
 
 void Matrix::set_rank(size_t r) {
@@ -101,6 +174,25 @@ void Matrix::initializeFrom(FileReader& r){
 
 	// Initialize the column representation.
 	initColumns();
+
+	// Initialize the block-diagonal representation.
+	initBlocks();
+}
+
+// Initialize the matrix's contents from the given list of elements, in row-major order.
+// (This is used for operators that are generated, rather than read from a file.)
+
+void Matrix::initializeFrom(const vector<Complex>& elems){
+	if (ns_debug::trace) cout << "Matrix::initializeFrom(): Setting up a rank-" << rank() << " matrix from its elements.\n";
+
+	for(size_t i=0; i<rank(); i++){
+		for(size_t j=0; j<rank(); j++){
+			rows.at(i)[j] = elems.at(i*rank() + j);
+		}
+	}
+
+	initColumns();
+	initBlocks();
 }
 
 Matrix::~Matrix(void)
@@ -30,6 +30,24 @@
 #include "FileReader.h"				// Defines FileReader class used when reading matrix data from a file.
 #include "SmartComplexVector.h"		// Defines SmartComplexVector class.
 
+// A MatrixBlock describes one of the diagonal blocks of a unitary matrix, when the
+// matrix is viewed (after an appropriate reordering of its rows and columns) in
+// block-diagonal form.  The rows and columns of a block are exactly those that are
+// connected to each other through nonzero matrix elements.  We keep a dense copy of
+// the block's submatrix, with its real and imaginary parts in separate arrays, so
+// that it can be handed directly to the matrix-vector kernels in ComplexKernels.h.
+
+class MatrixBlock {
+public:
+	vector<size_t>	row_indices;	// Indices, within the full matrix, of this block's rows (ascending).
+	vector<size_t>	col_indices;	// Indices, within the full matrix, of this block's columns (ascending).
+	vector<double>	elems_re;		// Real parts of the block submatrix elements, in row-major order.
+	vector<double>	elems_im;		// Imaginary parts of the block submatrix elements, in row-major order.
+	vector<RootOfUnityElem>	elems_exact;	// The block submatrix elements in exact form, if they have one (see Amplitude.h).
+
+	size_t	rank(void) { return col_indices.size(); }		// Number of columns (= number of rows) in the block.
+};
+
 class Matrix {
 public:
 	// Our primary matrix representation is row-based.
@@ -38,11 +56,19 @@ public:
 	// The following, column-based representation is also used
 	// (redundantly) for faster access to individual columns.
 	vector<SmartComplexVector> cols;		// It can also be considered a (horizontal) vector of column vectors.
+
+	// The block-diagonal structure of the matrix, which is also computed redundantly
+	// when the matrix is initialized.
+	vector<MatrixBlock>	blocks;				// All the diagonal blocks of the matrix.
+	vector<size_t>		col_block;			// For each column, the index in blocks[] of the block containing it.
+	vector<size_t>		row_block;			// For each row, the index in blocks[] of the block containing it.
 	
 	// Private member functions.
 private:
 	void	initColumns(void);		// Initializes the internal column-based representation
 									//		from the row-based representation already stored.
+	void	initBlocks(void);		// Initializes the block-diagonal representation from
+									//		the row- and column-based representations.
 	
 	// Public member functions.
 public:
@@ -50,7 +76,9 @@ public:
 	
 	void	set_rank(size_t r);					// Change this matrix into a square matrix of rank r.
 	size_t	rank(void) { return rows.size(); }  // Assuming this is a square matrix, return its rank.
+	size_t	max_block_rank(void);				// The largest rank of any of its diagonal blocks.
 	void	initializeFrom(FileReader& r);		// Initialize this matrix using the given FileReader.
+	void	initializeFrom(const vector<Complex>& elems);	// Initialize it from the given elements (row-major).
 	
 	~Matrix(void);
 };
@@ -0,0 +1,482 @@
+//========================================================================
+// SEQCSim version 0.8 - The Space-Efficient Quantum Computer Simulator
+// By Michael P. Frank, Liviu Oniciuc, Uwe Meyer-Baese, and Liviu Oniciuc.
+// Copyright (C) 2008-2009  Florida State University Board of Trustees
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// 
+// You may contact the author at michael.patrick.frank@gmail.com, or at
+// Michael P. Frank, PO Box 025250 #24985, Miami, FL  33102-5250.
+//========================================================================
+
+//-------------------------------------------------------------------------
+// MatrixProductState.cpp - A matrix-product-state engine, for circuits that
+//   are too wide for a state vector, but don't entangle their qubits much.
+//
+// The state is kept as a chain of tensors, one for each qubit (a "site"),
+//
+//		psi(x_1 ... x_n) = A_1[x_1] A_2[x_2] ... A_n[x_n],
+//
+// where A_i[x] is a (left bond x right bond) matrix, so that the memory is
+// about n*chi^2, for chi the largest bond dimension, rather than 2^n.  The QFT
+// adders, for instance, only ever couple nearby positions of their registers.
+//
+// An operation on k qubits is applied by first moving its qubits next to each
+// other in the chain with swaps (swap routing;  the qubits stay where they were
+// moved to, so the order of the sites drifts as the circuit runs), merging
+// their k sites into one tensor, applying the operation's matrix to that, and
+// splitting it back into k sites with singular value decompositions (see
+// LinearAlgebra.h).  Each split keeps at most "option: mps_bond_dim N" (default
+// ns_mps::default_bond_dim) singular values, and drops those whose squared
+// magnitude is below "option: mps_cutoff X" (default ns_mps::default_cutoff)
+// times their total;  the weight of everything dropped is added up and
+// reported as the truncation error.  The chain is kept in canonical form
+// around one site (the "center"), with the sites to its left left-orthonormal
+// and those to its right right-orthonormal, so that each truncation is the
+// best possible one for that bond.
+//
+// At the end, the center is moved to the first site, and then the shots are
+// sampled one qubit at a time, from each site's conditional probabilities
+// given the values already chosen.  The same search, carried out over both
+// values at every site (but not into branches of negligible probability), lists
+// the exact probabilities of the final states, if there aren't too many.
+//
+// The engine is selected with "option: engine mps".  If some operation acts on
+// more than ns_mps::max_operation_qubits qubits, run() falls back to the
+// path-integral engine.
+//-------------------------------------------------------------------------
+
+#include <iostream>				// cout
+#include <sstream>				// ostringstream
+#include <vector>				// STL vector<> template.
+#include <map>					// For the histogram of final states.
+#include <algorithm>			// sort(), min(), max()
+#include <math.h>				// sqrt(), pow()
+#include "SEQCSim.h"
+#include "LinearAlgebra.h"		// ns_linalg::svd()
+#include "OperationMatrix.h"	// ns_opmatrix::embed(), qubits_of()
+#include "debug.h"				// ns_debug::trace
+
+using namespace std;
+
+namespace ns_mps {
+
+	// Default maximum bond dimension.
+	static const double		default_bond_dim = 64;
+
+	// By default, singular values whose squares are less than this fraction of the total are dropped.
+	static const double		default_cutoff = 1e-12;
+
+	// Operations on more qubits than this (including controls) aren't merged into a single tensor.
+	static const size_t		max_operation_qubits = 10;
+
+	// The exact probabilities are only listed if there are at most this many final states...
+	static const size_t		max_listed_states = 1 << 16;
+
+	// ...not counting those with a probability below this.
+	static const double		negligible_prob = 1e-12;
+
+	static Complex conj(const Complex& c) { return Complex(c.R, -c.I); }
+
+	// The tensor for one site:  element (l, x, r) is a[(l*2 + x)*right + r].
+	struct Site {
+		size_t				left, right;
+		vector<Complex>		a;
+	};
+
+	class Chain {
+	public:
+		vector<Site>			sites;
+		vector<qubit_index_t>	qubit_at;		// The qubit at each site.
+		vector<size_t>			site_of;		// The site of each qubit.
+		size_t					center;
+		size_t					max_bond,  peak_bond,  n_swaps;
+		double					cutoff,  discarded;
+
+		Chain(State& input, size_t nbits, size_t max_bond, double cutoff);
+
+		void	move_center(size_t to);
+		void	bring_together(const vector<qubit_index_t>& qubits, size_t& first);
+		void	apply(const vector<Complex>& m, size_t first, size_t k);
+
+	private:
+		void	swap_sites(size_t p);
+	};
+
+	// The product state |input>, with all bonds of dimension 1.
+	Chain::Chain(State& input, size_t nbits, size_t max_bond_, double cutoff_)
+		: sites(nbits), qubit_at(nbits), site_of(nbits), center(0), max_bond(max_bond_), peak_bond(1), n_swaps(0),
+		  cutoff(cutoff_), discarded(0) {
+		for (size_t q = 0;  q < nbits;  q++) {
+			sites[q].left = sites[q].right = 1;
+			sites[q].a.assign(2, Complex(0));
+			sites[q].a[input.bits[q] ? 1 : 0] = Complex(1);
+			qubit_at[q] = q;
+			site_of[q] = q;
+		}
+	}
+
+	// Move the center of the canonical form to the given site, one site at a time:  take the
+	// SVD of the center site, keep the orthonormal factor there, and push the rest into the
+	// next site along.
+	void Chain::move_center(size_t to) {
+		while (center < to) {
+			Site&			s = sites[center];
+			Site&			next = sites[center + 1];
+			size_t			rows = s.left*2,  cols = s.right;
+			vector<Complex>	u, v;
+			vector<double>	sv;
+			ns_linalg::svd(rows, cols, s.a, u, sv, v);
+			size_t			r = max((size_t)1, ns_linalg::numerical_rank(sv, 1e-14));
+			size_t			full = sv.size();
+
+			vector<Complex>	a(rows*r);
+			for (size_t i = 0;  i < rows;  i++) for (size_t j = 0;  j < r;  j++) a[i*r + j] = u[i*full + j];
+			vector<Complex>	b(r*2*next.right, Complex(0));
+			for (size_t j = 0;  j < r;  j++) {
+				for (size_t c = 0;  c < cols;  c++) {
+					Complex	w = Complex(sv[j]) * conj(v[c*full + j]);
+					if (w.isZero()) continue;
+					for (size_t x = 0;  x < 2*next.right;  x++) b[j*2*next.right + x] += w * next.a[c*2*next.right + x];
+				}
+			}
+			s.a.swap(a);
+			s.right = r;
+			next.a.swap(b);
+			next.left = r;
+			center++;
+		}
+		while (center > to) {
+			Site&			s = sites[center];
+			Site&			prev = sites[center - 1];
+			size_t			rows = s.left,  cols = 2*s.right;
+			vector<Complex>	u, v;
+			vector<double>	sv;
+			ns_linalg::svd(rows, cols, s.a, u, sv, v);
+			size_t			r = max((size_t)1, ns_linalg::numerical_rank(sv, 1e-14));
+			size_t			full = sv.size();
+
+			vector<Complex>	a(r*cols);
+			for (size_t j = 0;  j < r;  j++) for (size_t c = 0;  c < cols;  c++) a[j*cols + c] = conj(v[c*full + j]);
+			size_t			prow = prev.left*2;
+			vector<Complex>	b(prow*r, Complex(0));
+			for (size_t i = 0;  i < prow;  i++) {
+				for (size_t l = 0;  l < rows;  l++) {
+					Complex	p = prev.a[i*rows + l];
+					if (p.isZero()) continue;
+					for (size_t j = 0;  j < r;  j++) b[i*r + j] += p * u[l*full + j] * Complex(sv[j]);
+				}
+			}
+			s.a.swap(a);
+			s.left = r;
+			prev.a.swap(b);
+			prev.right = r;
+			center--;
+		}
+	}
+
+	// Apply the 2^k x 2^k matrix m to the k sites starting at first, where bit j of the row and
+	// column indices is the value at site first + j.  Leaves the center at the last of them.
+	void Chain::apply(const vector<Complex>& m, size_t first, size_t k) {
+		move_center(first);
+
+		// Merge the sites into one tensor theta, with element (l, x, r) at (l*dim + x)*right + r.
+		size_t			left = sites[first].left,  right = sites[first].right,  dim = 2;
+		vector<Complex>	theta(sites[first].a);
+		for (size_t j = 1;  j < k;  j++) {
+			const Site&		s = sites[first + j];
+			vector<Complex>	merged(left*dim*2*s.right, Complex(0));
+			for (size_t l = 0;  l < left;  l++) {
+				for (size_t x = 0;  x < dim;  x++) {
+					for (size_t c = 0;  c < right;  c++) {
+						Complex	t = theta[(l*dim + x)*right + c];
+						if (t.isZero()) continue;
+						for (size_t y = 0;  y < 2;  y++) {
+							for (size_t r = 0;  r < s.right;  r++) {
+								merged[(l*dim*2 + x + y*dim)*s.right + r] += t * s.a[(c*2 + y)*s.right + r];
+							}
+						}
+					}
+				}
+			}
+			theta.swap(merged);
+			dim *= 2;
+			right = s.right;
+		}
+
+		// Apply the matrix.
+		vector<Complex>	out(theta.size(), Complex(0));
+		for (size_t l = 0;  l < left;  l++) {
+			for (size_t col = 0;  col < dim;  col++) {
+				for (size_t r = 0;  r < right;  r++) {
+					Complex	t = theta[(l*dim + col)*right + r];
+					if (t.isZero()) continue;
+					for (size_t row = 0;  row < dim;  row++) {
+						const Complex&	e = m[row*dim + col];
+						if (!e.isZero()) out[(l*dim + row)*right + r] += e * t;
+					}
+				}
+			}
+		}
+		theta.swap(out);
+
+		// Split it back up, one site at a time from the left, truncating each bond.
+		for (size_t j = 0;  j + 1 < k;  j++) {
+			size_t			rest = dim/2,  rows = left*2,  cols = rest*right;
+			vector<Complex>	mat(rows*cols);
+			for (size_t l = 0;  l < left;  l++) {
+				for (size_t x = 0;  x < dim;  x++) {
+					for (size_t r = 0;  r < right;  r++) mat[(l*2 + (x & 1))*cols + (x >> 1)*right + r] = theta[(l*dim + x)*right + r];
+				}
+			}
+			vector<Complex>	u, v;
+			vector<double>	sv;
+			ns_linalg::svd(rows, cols, mat, u, sv, v);
+			size_t			full = sv.size();
+			double			total = 0,  kept_weight = 0;
+			for (size_t i = 0;  i < full;  i++) total += sv[i]*sv[i];
+			size_t			keep = 0;
+			while (keep < full && keep < max_bond && (keep == 0 || sv[keep]*sv[keep] > cutoff*total)) {
+				kept_weight += sv[keep]*sv[keep];
+				keep++;
+			}
+			if (total > 0) discarded += (total - kept_weight)/total;
+			peak_bond = max(peak_bond, keep);
+
+			Site&	s = sites[first + j];
+			s.left = left;
+			s.right = keep;
+			s.a.assign(rows*keep, Complex(0));
+			for (size_t i = 0;  i < rows;  i++) for (size_t a = 0;  a < keep;  a++) s.a[i*keep + a] = u[i*full + a];
+			vector<Complex>	next(keep*cols);
+			for (size_t a = 0;  a < keep;  a++) {
+				for (size_t c = 0;  c < cols;  c++) next[a*cols + c] = Complex(sv[a]) * conj(v[c*full + a]);
+			}
+			theta.swap(next);
+			left = keep;
+			dim = rest;
+		}
+		Site&	last = sites[first + k - 1];
+		last.left = left;
+		last.right = right;
+		last.a.swap(theta);
+		center = first + k - 1;
+	}
+
+	// Swap the qubits at sites p and p+1.
+	void Chain::swap_sites(size_t p) {
+		vector<Complex>	swap_matrix(16, Complex(0));
+		swap_matrix[0*4 + 0] = swap_matrix[1*4 + 2] = swap_matrix[2*4 + 1] = swap_matrix[3*4 + 3] = Complex(1);
+		apply(swap_matrix, p, 2);
+		swap(qubit_at[p], qubit_at[p + 1]);
+		site_of[qubit_at[p]] = p;
+		site_of[qubit_at[p + 1]] = p + 1;
+		n_swaps++;
+	}
+
+	// Swap the given qubits along the chain until they're at consecutive sites (keeping their
+	// order), moving each one as little as possible.  Sets first to the first of those sites.
+	void Chain::bring_together(const vector<qubit_index_t>& qubits, size_t& first) {
+		size_t			k = qubits.size();
+		vector<size_t>	pos(k),  offsets(k);
+		for (size_t i = 0;  i < k;  i++) pos[i] = site_of[qubits[i]];
+		sort(pos.begin(), pos.end());
+		for (size_t i = 0;  i < k;  i++) offsets[i] = pos[i] - i;
+		vector<size_t>	sorted_offsets(offsets);
+		sort(sorted_offsets.begin(), sorted_offsets.end());
+		first = sorted_offsets[k/2];		// The median minimizes the total distance moved.
+
+		// Those that move left go in order, then those that move right in reverse order, so
+		// that none of them has to cross another.
+		for (size_t i = 0;  i < k;  i++) {
+			for (size_t p = pos[i];  p > first + i;  p--) swap_sites(p - 1);
+		}
+		for (size_t i = k;  i-- > 0;  ) {
+			for (size_t p = pos[i];  p < first + i;  p++) swap_sites(p);
+		}
+	}
+
+	// Depth-first search over the values of the sites (from the first, with the center there),
+	// listing every final state (as bits by site) with a non-negligible probability.  left is
+	// the row vector for the values chosen so far.  Returns false if there are too many.
+	static bool list_states(const vector<Site>& sites, size_t i, const vector<Complex>& left, size_t bits,
+							double threshold, vector< pair<size_t, double> >& found) {
+		if (i == sites.size()) {
+			found.push_back(make_pair(bits, left[0].squared_norm()));
+			return found.size() <= max_listed_states;
+		}
+		const Site&	s = sites[i];
+		for (size_t x = 0;  x < 2;  x++) {
+			vector<Complex>	next(s.right, Complex(0));
+			double			weight = 0;
+			for (size_t r = 0;  r < s.right;  r++) {
+				for (size_t l = 0;  l < s.left;  l++) next[r] += left[l] * s.a[(l*2 + x)*s.right + r];
+				weight += next[r].squared_norm();
+			}
+			if (weight <= threshold) continue;
+			if (!list_states(sites, i + 1, next, bits | (x << i), threshold, found)) return false;
+		}
+		return true;
+	}
+}
+
+// Run the simulation with the matrix-product-state engine.  Returns false (having done nothing
+// but print why) if some operation is too big for it.
+
+bool SEQCSim::run_mps(void)
+{
+	size_t		nbits = qc_config.nbits;
+	size_t		max_bond = (size_t)qc_config.option_double("mps_bond_dim", ns_mps::default_bond_dim);
+	double		cutoff = qc_config.option_double("mps_cutoff", ns_mps::default_cutoff);
+
+	for (size_t pc = 0;  pc < opn_seq.size();  pc++) {
+		vector<qubit_index_t>	qubits;
+		ns_opmatrix::qubits_of(opn_seq[pc], qubits);
+		if (qubits.size() > ns_mps::max_operation_qubits) {
+			cout << "SEQCSim::run_mps(): Operation #" << pc << " acts on " << qubits.size() << " qubits, more than the "
+				 << ns_mps::max_operation_qubits << " the engine can merge; falling back to the path-integral engine.\n";
+			return false;
+		}
+	}
+	cout << "SEQCSim::run_mps(): Simulating " << nbits << " qubits as a matrix product state, with bond dimension at most "
+		 << max_bond << ".\n";
+
+	ns_mps::Chain	chain(input_state, nbits, max_bond, cutoff);
+
+	for (size_t pc = 0;  pc < opn_seq.size();  pc++) {
+		Operation&				opn = opn_seq[pc];
+		vector<qubit_index_t>	qubits,  site_qubits;
+		size_t					first;
+
+		if (ns_debug::trace) cout << "SEQCSim::run_mps(): Applying operation #" << pc << ", " << opn << ".\n";
+
+		ns_opmatrix::qubits_of(opn, qubits);
+		chain.bring_together(qubits, first);
+		size_t	k = qubits.size();
+		site_qubits.assign(chain.qubit_at.begin() + first, chain.qubit_at.begin() + first + k);
+
+		// The operation's matrix, on its qubits in the order of their sites.
+		vector<Complex>		m;
+		if (opn.isFunctional()) {
+			ns_opmatrix::embed_function(functions[opn.function_id], opn, site_qubits, m);
+		} else {
+			ns_opmatrix::embed(operators.at(opn.operator_id), opn, site_qubits, m);
+		}
+		chain.apply(m, first, k);
+	}
+
+	chain.move_center(0);
+	cout << "SEQCSim::run_mps(): The largest bond dimension was " << chain.peak_bond << ", and " << chain.n_swaps
+		 << " swaps were needed to bring the operations' qubits together.  The truncations discarded a total weight of "
+		 << chain.discarded << ".\n";
+
+	// The squared norm of the state is that of the first site, now that the rest are right-orthonormal.
+	double		total = 0;
+	for (size_t i = 0;  i < chain.sites[0].a.size();  i++) total += chain.sites[0].a[i].squared_norm();
+	Complex		scale = input_state.amp * Complex(1/sqrt(total));
+
+	// List the most likely final states (or values of the measured registers), with their exact
+	// probabilities, if there aren't too many.
+	vector< pair<size_t, double> >	listed;
+	if (nbits < 8*sizeof(size_t)
+		&& ns_mps::list_states(chain.sites, 0, vector<Complex>(1, Complex(1)), 0, ns_mps::negligible_prob*total, listed)) {
+		map<string, double>		exact_probs;
+		current_state = input_state;
+		for (size_t i = 0;  i < listed.size();  i++) {
+			for (size_t p = 0;  p < nbits;  p++) current_state.bits[chain.qubit_at[p]] = ((listed[i].first >> p) & 1) != 0;
+			exact_probs[final_state_key()] += listed[i].second/total;
+		}
+		report_final_probabilities("SEQCSim::run_mps()", exact_probs);
+	} else {
+		cout << "SEQCSim::run_mps(): There are too many final states to list their probabilities.\n";
+	}
+
+	// Now sample the shots, one site at a time.
+	unsigned long				n_shots = (unsigned long)qc_config.option_double("shots", 1);
+	map<string, unsigned long>	histogram;
+
+	for (unsigned long shot = 1;  shot <= n_shots;  shot++) {
+		vector<Complex>	left(1, Complex(1)),  next[2];
+		double			weight[2];
+		for (size_t p = 0;  p < nbits;  p++) {
+			const ns_mps::Site&	s = chain.sites[p];
+			for (size_t x = 0;  x < 2;  x++) {
+				next[x].assign(s.right, Complex(0));
+				weight[x] = 0;
+				for (size_t r = 0;  r < s.right;  r++) {
+					for (size_t l = 0;  l < s.left;  l++) next[x][r] += left[l] * s.a[(l*2 + x)*s.right + r];
+					weight[x] += next[x][r].squared_norm();
+				}
+			}
+			size_t	x = (marker_picker(prng_engine) * (weight[0] + weight[1]) < weight[0]) ? 0 : 1;
+			current_state.bits[chain.qubit_at[p]] = (x != 0);
+			left.swap(next[x]);
+		}
+		current_state.amp = left[0] * scale;
+		cout << "SEQCSim::run_mps(): Shot #" << shot << " ended in state " << current_state << ".\n";
+		histogram[final_state_key()]++;
+	}
+
+	report_histogram("SEQCSim::run_mps()", histogram, n_shots);
+	return true;
+}
+
+// The cost of running the circuit with the matrix-product-state engine (see CostModel.h).
+// An operation acting on k qubits on one side of a cut, and some on the other, multiplies
+// the bond dimension there by at most 4^k (its Schmidt rank across the cut), and no bond
+// can be bigger than the dimension of either side.  This is worked out for the qubits in
+// their original order, although swap routing moves them around.  If the bound is above
+// the maximum bond dimension, the engine might truncate, so it isn't exact.
+
+void SEQCSim::estimate_mps(EngineEstimate& est)
+{
+	size_t			nbits = qc_config.nbits;
+	double			max_bond = qc_config.option_double("mps_bond_dim", ns_mps::default_bond_dim);
+	vector<double>	bond(nbits, 1);		// bond[l] is for the cut between qubits l - 1 and l.
+	double			peak = 1,  flops = 0;
+	ostringstream	note;
+
+	for (size_t pc = 0;  pc < opn_seq.size();  pc++) {
+		vector<qubit_index_t>	qubits;
+		ns_opmatrix::qubits_of(opn_seq[pc], qubits);
+		if (qubits.size() > ns_mps::max_operation_qubits) {
+			est.possible = false;
+			note << "operation #" << pc << " acts on " << qubits.size() << " qubits, more than the "
+				 << ns_mps::max_operation_qubits << " the engine can merge";
+			est.note = note.str();
+			return;
+		}
+		double	chi = 1;
+		for (size_t l = 1;  l < nbits;  l++) {
+			size_t	below = 0;
+			for (size_t k = 0;  k < qubits.size();  k++) if (qubits[k] < l) below++;
+			size_t	across = min(below, qubits.size() - below);
+			if (across > 0) {
+				double	side = pow(2.0, (double)min(l, nbits - l));
+				bond[l] = min(ns_cost::times(bond[l], pow(4.0, (double)across)), side);
+			}
+			chi = max(chi, min(bond[l], max_bond));
+			peak = max(peak, bond[l]);
+		}
+		double	k_dim = pow(2.0, (double)qubits.size());
+		flops = ns_cost::plus(flops, ns_cost::times(ns_cost::times(chi*chi*chi, k_dim), k_dim));
+	}
+	est.exact = (peak <= max_bond);
+	peak = min(peak, max_bond);
+	est.seconds = ns_cost::times(flops, ns_cost::seconds_per_flop);
+	est.memory_mb = nbits * 2 * peak * peak * sizeof(Complex) / (1024*1024);
+	note << "bond dimension at most " << peak;
+	if (!est.exact) note << " (mps_bond_dim), which might truncate the state";
+	est.note = note.str();
+}
@@ -24,7 +24,8 @@
 
 
 ostream& operator<<(ostream& os, Operation& opn) {
-	os << (int)opn.operator_id << "(";
+	if (opn.isFunctional())	os << "f" << opn.function_id << "(";
+	else					os << (int)opn.operator_id << "(";
 	qubit_index_t			n_opds = opn.operands.size();
 	for (qubit_index_t		i = 0;
 							i < n_opds;
@@ -34,5 +35,13 @@ ostream& operator<<(ostream& os, Operation& opn) {
 		if (i < n_opds-1) os << ",";
 	}
 	os << ")";
+	if (!opn.controls.empty()) {
+		os << " if ";
+		for (size_t i = 0;  i < opn.controls.size();  i++) {
+			if (!((opn.control_values >> i) & 1)) os << "!";
+			os << opn.controls[i];
+			if (i < opn.controls.size()-1) os << ",";
+		}
+	}
 	return os;
 }
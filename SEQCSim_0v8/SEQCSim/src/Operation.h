@@ -26,6 +26,7 @@
 
 #include <iostream>				// ostream class, for operator<< overloading
 #include <vector>				// STL vector<> template
+#include <string>				// STL string class
 #include "index_types.h"		// Typedefs for operation_index_t, qubit_index_t
 
 using namespace std;
@@ -35,6 +36,26 @@ class Operation {
 		operation_index_t			operator_id;	// Unique ID of the quantum logic operator to be applied.
 		vector<qubit_index_t>		operands;		// Indices of the qubits to which the operator is to be applied.
 													//   These are stored in operator order.
+
+		// For an operation that applies a functional operator (see FunctionalOperator.h)
+		// rather than a matrix operator, function_id is its index in the simulator's list
+		// of functions, and registers holds the qubit addresses of each register operand
+		// (least significant bit first).  The operands list then holds all of those qubits.
+		int							function_id;	// -1 if this is an ordinary (matrix) operation.
+		vector< vector<qubit_index_t> >	registers;	// The register operands of a functional operation.
+		vector<string>				register_names;	// And their names, as given in qopseq.txt.
+
+		// An operation may also have control bits.  It then acts (on its operands) only in
+		// the basis states where each control has its required value, and is the identity
+		// in all the others.  Bit i of control_values is the required value of controls[i]
+		// (1 for an ordinary control, 0 for a negative control).  The controls are disjoint
+		// from the operands, so the operator's matrix only needs to cover the operands.
+		vector<qubit_index_t>		controls;		// Qubit addresses of the control bits.
+		size_t						control_values;	// Required control bit values, as an integer.
+
+		Operation(void) : operator_id(0), function_id(-1), control_values(0) {}
+
+		bool	isFunctional(void) const { return function_id >= 0; }
 };
 
 // Overloaded << operator for printing Operation objects to ostreams.
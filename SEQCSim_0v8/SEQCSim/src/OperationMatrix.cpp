@@ -0,0 +1,192 @@
+//========================================================================
+// SEQCSim version 0.8 - The Space-Efficient Quantum Computer Simulator
+// By Michael P. Frank, Liviu Oniciuc, Uwe Meyer-Baese, and Liviu Oniciuc.
+// Copyright (C) 2008-2009  Florida State University Board of Trustees
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// 
+// You may contact the author at michael.patrick.frank@gmail.com, or at
+// Michael P. Frank, PO Box 025250 #24985, Miami, FL  33102-5250.
+//========================================================================
+
+// OperationMatrix.cpp - Dense matrices of operations (see OperationMatrix.h).
+
+#include <math.h>				// fabs()
+#include "OperationMatrix.h"
+
+using namespace std;
+
+namespace ns_opmatrix {
+
+	size_t	position_of(const vector<qubit_index_t>& qubits, qubit_index_t q) {
+		size_t	i = 0;
+		while (i < qubits.size() && qubits[i] != q) i++;
+		return i;
+	}
+
+	void	qubits_of(const Operation& opn, vector<qubit_index_t>& qubits) {
+		qubits = opn.operands;
+		qubits.insert(qubits.end(), opn.controls.begin(), opn.controls.end());
+	}
+
+	bool	overlap(const Operation& a, const Operation& b) {
+		vector<qubit_index_t>	qa, qb;
+		qubits_of(a, qa);  qubits_of(b, qb);
+		for (size_t i = 0;  i < qb.size();  i++)
+			if (position_of(qa, qb[i]) < qa.size()) return true;
+		return false;
+	}
+
+	size_t	count_nonzeros(const vector<Complex>& m) {
+		size_t	n = 0;
+		for (size_t i = 0;  i < m.size();  i++) if (m[i].isNonzero()) n++;
+		return n;
+	}
+
+	void	embed(Operator& opr, const Operation& opn, const vector<qubit_index_t>& qubits, vector<Complex>& m) {
+		size_t			rank = (size_t)1 << qubits.size();
+		vector<size_t>	opd_pos(opn.operands.size()),  ctl_pos(opn.controls.size());
+		size_t			opd_mask = 0;
+
+		for (size_t k = 0;  k < opn.operands.size();  k++) {
+			opd_pos[k] = position_of(qubits, opn.operands[k]);
+			opd_mask |= (size_t)1 << opd_pos[k];
+		}
+		for (size_t k = 0;  k < opn.controls.size();  k++) ctl_pos[k] = position_of(qubits, opn.controls[k]);
+
+		m.assign(rank*rank, Complex(0));
+		for (size_t col = 0;  col < rank;  col++) {
+
+			// Where the controls aren't satisfied, it's the identity.
+			bool	satisfied = true;
+			for (size_t k = 0;  k < ctl_pos.size();  k++)
+				if (((col >> ctl_pos[k]) & 1) != ((opn.control_values >> k) & 1)) satisfied = false;
+			if (!satisfied) { m[col*rank + col] = Complex(1);  continue; }
+
+			// Otherwise, gather the operand bits into an index into the operator's matrix...
+			size_t	in_idx = 0;
+			for (size_t k = 0;  k < opd_pos.size();  k++) in_idx |= ((col >> opd_pos[k]) & 1) << k;
+
+			// ...and scatter the row indices of its nonzero elements in that column back out.
+			SmartComplexVector&	opr_col = opr.U.cols.at(in_idx);
+			vector<size_t>&		nz_rows = opr_col.indices_of_nz_elems();
+			for (size_t j = 0;  j < nz_rows.size();  j++) {
+				size_t	row = col & ~opd_mask;
+				for (size_t k = 0;  k < opd_pos.size();  k++) row |= ((nz_rows[j] >> k) & 1) << opd_pos[k];
+				Complex	elem = opr_col[nz_rows[j]];
+				m[row*rank + col] = elem;
+			}
+		}
+	}
+
+	void	embed_function(const FunctionalOperator& func, const Operation& opn, const vector<qubit_index_t>& qubits,
+						   vector<Complex>& m) {
+		size_t	rank = (size_t)1 << qubits.size();
+		size_t	regs[ns_functions::max_registers],  widths[ns_functions::max_registers];
+
+		for (size_t r = 0;  r < opn.registers.size();  r++) widths[r] = opn.registers[r].size();
+		m.assign(rank*rank, Complex(0));
+		for (size_t col = 0;  col < rank;  col++) {
+			size_t	row = col;
+			Complex	elem(1);
+			bool	active = true;
+			for (size_t c = 0;  c < opn.controls.size();  c++) {
+				size_t	bit = (col >> position_of(qubits, opn.controls[c])) & 1;
+				if (bit != ((opn.control_values >> c) & 1)) active = false;
+			}
+			if (active) {
+				for (size_t r = 0;  r < opn.registers.size();  r++) {
+					regs[r] = 0;
+					for (size_t b = 0;  b < widths[r];  b++) {
+						regs[r] |= ((col >> position_of(qubits, opn.registers[r][b])) & 1) << b;
+					}
+				}
+				if (func.kind == FunctionalOperator::PHASE_ORACLE) {
+					elem = func.phase_of(regs, widths);
+				} else {
+					func.apply(regs, widths);
+					for (size_t r = 0;  r < opn.registers.size();  r++) {
+						for (size_t b = 0;  b < widths[r];  b++) {
+							size_t	p = position_of(qubits, opn.registers[r][b]);
+							row = (row & ~((size_t)1 << p)) | (((regs[r] >> b) & 1) << p);
+						}
+					}
+				}
+			}
+			m[row*rank + col] = elem;
+		}
+	}
+
+	void	extend(vector<Complex>& m, size_t rank) {
+		vector<Complex>	bigger(4*rank*rank, Complex(0));
+		for (size_t r = 0;  r < rank;  r++) {
+			for (size_t c = 0;  c < rank;  c++) {
+				bigger[r*2*rank + c]					= m[r*rank + c];
+				bigger[(r + rank)*2*rank + (c + rank)]	= m[r*rank + c];
+			}
+		}
+		m.swap(bigger);
+	}
+
+	void	multiply(const vector<Complex>& a, const vector<Complex>& b, size_t rank, vector<Complex>& product) {
+		product.assign(rank*rank, Complex(0));
+		for (size_t r = 0;  r < rank;  r++) {
+			for (size_t k = 0;  k < rank;  k++) {
+				const Complex&	a_rk = a[r*rank + k];
+				if (a_rk.isZero()) continue;		// Skip over the zeros in a.
+				for (size_t c = 0;  c < rank;  c++) product[r*rank + c] += a_rk * b[k*rank + c];
+			}
+		}
+		for (size_t i = 0;  i < product.size();  i++) {
+			if (fabs(product[i].R) < negligible) product[i].R = 0;
+			if (fabs(product[i].I) < negligible) product[i].I = 0;
+		}
+	}
+
+	bool	equal(const vector<Complex>& a, const vector<Complex>& b) {
+		if (a.size() != b.size()) return false;
+		for (size_t i = 0;  i < a.size();  i++)
+			if (fabs(a[i].R - b[i].R) > tolerance || fabs(a[i].I - b[i].I) > tolerance) return false;
+		return true;
+	}
+
+	bool	is_identity(const vector<Complex>& m, size_t rank) {
+		for (size_t r = 0;  r < rank;  r++) {
+			for (size_t c = 0;  c < rank;  c++) {
+				Complex	expected = (r == c) ? Complex(1) : Complex(0);
+				if (fabs(m[r*rank + c].R - expected.R) > tolerance || fabs(m[r*rank + c].I - expected.I) > tolerance) return false;
+			}
+		}
+		return true;
+	}
+
+	bool	commute(Operator& opr_a, const Operation& a, Operator& opr_b, const Operation& b) {
+		if (!overlap(a, b)) return true;
+		if (opr_a.form == Operator::DIAGONAL && opr_b.form == Operator::DIAGONAL) return true;
+
+		vector<qubit_index_t>	qubits, qb;
+		qubits_of(a, qubits);  qubits_of(b, qb);
+		for (size_t i = 0;  i < qb.size();  i++)
+			if (position_of(qubits, qb[i]) == qubits.size()) qubits.push_back(qb[i]);
+		if (qubits.size() > max_commute_qubits) return false;
+
+		size_t			rank = (size_t)1 << qubits.size();
+		vector<Complex>	ma, mb, ab, ba;
+		embed(opr_a, a, qubits, ma);
+		embed(opr_b, b, qubits, mb);
+		multiply(ma, mb, rank, ab);
+		multiply(mb, ma, rank, ba);
+		return equal(ab, ba);
+	}
+}
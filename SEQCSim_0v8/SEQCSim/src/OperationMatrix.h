@@ -0,0 +1,98 @@
+//========================================================================
+// SEQCSim version 0.8 - The Space-Efficient Quantum Computer Simulator
+// By Michael P. Frank, Liviu Oniciuc, Uwe Meyer-Baese, and Liviu Oniciuc.
+// Copyright (C) 2008-2009  Florida State University Board of Trustees
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// 
+// You may contact the author at michael.patrick.frank@gmail.com, or at
+// Michael P. Frank, PO Box 025250 #24985, Miami, FL  33102-5250.
+//========================================================================
+
+//-------------------------------------------------------------------------
+// OperationMatrix.h - Dense matrices of operations, for the passes that
+//   transform the circuit before it is simulated (fusion, simplification,
+//   scheduling).
+//
+// These work with the full matrix of an operation (including its controls)
+// on an explicit list of qubits, where bit i of a matrix index is the value
+// of qubits[i].  The matrices are dense, row-major vector<Complex>s, so this
+// is only meant for small numbers of qubits.  (The engines that work with
+// whole operations at a time, like the matrix-product-state engine, use them
+// too.)
+//-------------------------------------------------------------------------
+
+#pragma once
+
+#include <vector>				// STL vector<> template
+#include "index_types.h"		// qubit_index_t
+#include "Complex.h"			// Matrix elements
+#include "Operator.h"			// class Operator
+#include "Operation.h"			// class Operation
+#include "FunctionalOperator.h"	// class FunctionalOperator
+
+using namespace std;
+
+namespace ns_opmatrix {
+
+	// Components of products smaller than this are taken to be rounding errors, and set
+	// to exactly 0.  (Otherwise, e.g., H times H would come out as only nearly diagonal.)
+	static const double		negligible = 1e-14;
+
+	// Two matrices whose elements all agree to within this are taken to be equal.
+	static const double		tolerance = 1e-10;
+
+	// Commutation of two operations is only checked numerically when they act on at
+	// most this many qubits between them.
+	static const size_t		max_commute_qubits = 8;
+
+	// The position of the given qubit in the list of qubits, or the list's size if it's not there.
+	size_t	position_of(const vector<qubit_index_t>& qubits, qubit_index_t q);
+
+	// All the qubits an operation acts on:  its operands, then its controls.
+	void	qubits_of(const Operation& opn, vector<qubit_index_t>& qubits);
+
+	// Do the two operations act on any of the same qubits?
+	bool	overlap(const Operation& a, const Operation& b);
+
+	// Number of nonzero elements in a dense matrix.
+	size_t	count_nonzeros(const vector<Complex>& m);
+
+	// Write out the dense matrix of the given (non-functional) operation, with the given
+	// operator, acting on the given list of qubits.  All of the operation's operands and
+	// controls must be among those qubits.
+	void	embed(Operator& opr, const Operation& opn, const vector<qubit_index_t>& qubits, vector<Complex>& m);
+
+	// The same, for a functional operation, whose register bits and controls must all be
+	// among the qubits.  It has a single nonzero element in each column.
+	void	embed_function(const FunctionalOperator& func, const Operation& opn, const vector<qubit_index_t>& qubits,
+						   vector<Complex>& m);
+
+	// Extend a dense matrix of the given rank (on n qubits) to n+1 qubits, acting as the
+	// identity on the new (most significant) one.
+	void	extend(vector<Complex>& m, size_t rank);
+
+	// The product a*b of two dense rank x rank matrices.  Negligible components are set to 0.
+	void	multiply(const vector<Complex>& a, const vector<Complex>& b, size_t rank, vector<Complex>& product);
+
+	// Are the two dense matrices equal (to within the tolerance)?  Is this one the identity?
+	bool	equal(const vector<Complex>& a, const vector<Complex>& b);
+	bool	is_identity(const vector<Complex>& m, size_t rank);
+
+	// Do the two (non-functional) operations commute?  Operations on disjoint qubits always
+	// do, and so do two diagonal operations.  Otherwise, if they don't act on too many qubits
+	// between them, their matrices are multiplied out both ways and compared.  (If they act
+	// on too many, they're assumed not to commute.)
+	bool	commute(Operator& opr_a, const Operation& a, Operator& opr_b, const Operation& b);
+}
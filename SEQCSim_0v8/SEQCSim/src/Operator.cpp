@@ -23,6 +23,8 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>		// istringstream
+#include <math.h>		// cos(), sin(), fabs(), for generated operators
+#include <ctype.h>		// isdigit(), isalpha()
 #include "Operator.h"
 #include "debug.h"
 
@@ -83,9 +85,185 @@ void Operator::initializeFrom(FileReader& r) {
 	if (ns_debug::trace) cout << "Operator::initializeFrom(): Matrix, please initialize yourself from the file.\n";
 	U.initializeFrom(r);
 
+	// See if it has a compact (monomial) form.
+	findCompactForm();
+
 	if (ns_debug::trace) cout << "Operator::initializeFrom(): We have finished initializing operator #" << id << " from the file!\n";
 }
 
+// Set up the monomial form of the operator (see Operator.h), if its matrix has one.
+
+void Operator::findCompactForm(void) {
+	size_t	rank = U.rank();
+
+	form = DIAGONAL;
+	for (size_t col_j = 0;  col_j < rank;  col_j++) {
+		if (!U.cols.at(col_j).isOnAxis()) { form = GENERAL;  break; }
+		if (U.cols.at(col_j).idx_1st_nz() != col_j) form = MONOMIAL;
+	}
+	if (form == GENERAL) {
+		mono_target.clear();  mono_source.clear();  mono_elem.clear();  mono_elem_exact.clear();  mono_unit.clear();
+		return;
+	}
+
+	mono_target.resize(rank);  mono_source.resize(rank);  mono_elem.resize(rank);  mono_elem_exact.resize(rank);  mono_unit.resize(rank);
+	for (size_t col_j = 0;  col_j < rank;  col_j++) {
+		SmartComplexVector&	col = U.cols.at(col_j);
+		mono_target[col_j]				= col.idx_1st_nz();
+		mono_source[col.idx_1st_nz()]	= col_j;
+		mono_elem[col_j]				= col.first_nz_elem();
+		mono_elem_exact[col_j]			= RootOfUnityElem(mono_elem[col_j]);
+		mono_unit[col_j]				= col.isClassical();
+	}
+
+	if (ns_debug::trace) {
+		cout << "Operator::findCompactForm(): Operator " << name << " is "
+			 << (form == DIAGONAL ? "diagonal" : "monomial") << ".\n";
+	}
+}
+
+namespace ns_operators {
+
+	static const double	pi = 3.14159265358979323846;
+
+	// Matrix element components smaller than this are taken to be rounding errors in
+	// cos() and sin(), and set to exactly 0.  (So that, e.g., U3(theta=pi,...) comes out
+	// monomial, and cPhase(k=2) has exactly i as its phase.)
+	static const double	negligible = 1e-15;
+
+	static double	clean(double x) { return (fabs(x) < negligible) ? 0 : x; }
+
+	static Complex	polar(double r, double angle) {
+		return Complex(clean(r*cos(angle)), clean(r*sin(angle)));
+	}
+
+	bool	parse_angle(const string& text, double& angle) {
+		istringstream	is(text);
+		double			sign = 1, mult = 1, divisor = 1;
+		bool			have_num = false, have_pi = false;
+
+		if (is.peek() == '-') { is.get();  sign = -1; }
+		if (isdigit(is.peek()) || is.peek() == '.') {
+			if (!(is >> mult)) return false;
+			have_num = true;
+		}
+		if (is.peek() == '*') is.get();
+		if (is.peek() == 'p') {
+			string	word;
+			while (isalpha(is.peek())) word += (char)is.get();
+			if (word != "pi") return false;
+			have_pi = true;
+		}
+		if (is.peek() == '/') {
+			is.get();
+			if (!(is >> divisor) || divisor == 0) return false;
+		}
+		if (is.peek() != EOF || !(have_num || have_pi)) return false;
+
+		angle = sign * mult * (have_pi ? pi : 1) / divisor;
+		return true;
+	}
+}
+
+// Generate an operator from one of the parametric families.  The specification is the
+// family name, followed by a parenthesized, comma-separated list of parameters of the form
+// name=value, with no spaces.  The families are:
+//
+//		Rz(theta=t)							diag(exp(-it/2), exp(it/2))
+//		Phase(theta=t)						diag(1, exp(it))
+//		cPhase(theta=t)						diag(1, 1, 1, exp(it))		(controlled phase)
+//		U3(theta=t,phi=p,lambda=l)			the general single-qubit unitary
+//
+// Instead of theta=t, Phase and cPhase also accept k=n, which means t = 2*pi/2^n (the
+// rotations used in the quantum Fourier transform), or t = -2*pi/2^|n| if n is negative.
+// So cPhase(k=1) is cZ, and cPhase(k=2) is the same as the cPiOver2 operator in the
+// QFT adder examples.  Angles can be given as multiples of pi (see parse_angle()).
+
+bool Operator::initFromSpec(const string& spec) {
+	if (ns_debug::trace) cout << "Operator::initFromSpec(): Generating operator " << spec << ".\n";
+
+	name = spec;
+
+	size_t	open = spec.find('('),  close = spec.rfind(')');
+	if (open == string::npos || close != spec.size()-1 || close < open) {
+		cout << "Operator::initFromSpec(): Error! Operator specification \"" << spec << "\" should look like family(param=value,...).\n";
+		return false;
+	}
+	string	family = spec.substr(0, open);
+
+	// Parse the parameters.
+	double	theta = 0, phi = 0, lambda = 0;
+	bool	have_theta = false, have_phi = false, have_lambda = false;
+
+	istringstream	paramStream(spec.substr(open+1, close-open-1));
+	string			param;
+	while (getline(paramStream, param, ',')) {
+		size_t	eq = param.find('=');
+		string	key = param.substr(0, eq),  value = (eq == string::npos) ? "" : param.substr(eq+1);
+		bool	ok;
+		if (key == "k") {
+			istringstream	kStream(value);
+			int				k = 0;
+			ok = (kStream >> k) && kStream.peek() == EOF && k != 0 && k >= -62 && k <= 62;
+			if (ok) theta = (k > 0 ? 2 : -2) * ns_operators::pi / (double)(1LL << (k > 0 ? k : -k));
+			have_theta = true;
+		}
+		else if (key == "theta")	{ ok = ns_operators::parse_angle(value, theta);		have_theta = true; }
+		else if (key == "phi")		{ ok = ns_operators::parse_angle(value, phi);		have_phi = true; }
+		else if (key == "lambda")	{ ok = ns_operators::parse_angle(value, lambda);	have_lambda = true; }
+		else ok = false;
+		if (!ok) {
+			cout << "Operator::initFromSpec(): Error! Bad parameter \"" << param << "\" in operator " << spec << ".\n";
+			return false;
+		}
+	}
+
+	// Work out the matrix elements.
+	vector<Complex>	elems;
+	bool			ok;
+	if (family == "Rz") {
+		ok = have_theta && !have_phi && !have_lambda;
+		arity = 1;
+		elems.resize(4);
+		elems[0] = ns_operators::polar(1, -theta/2);
+		elems[3] = ns_operators::polar(1, theta/2);
+	} else if (family == "Phase" || family == "cPhase") {
+		ok = have_theta && !have_phi && !have_lambda;
+		arity = (family == "Phase") ? 1 : 2;
+		size_t	rank = (size_t)1 << arity;
+		elems.resize(rank*rank);
+		for (size_t i = 0;  i < rank-1;  i++) elems[i*rank + i] = Complex(1);
+		elems[rank*rank - 1] = ns_operators::polar(1, theta);
+	} else if (family == "U3") {
+		ok = have_theta && have_phi && have_lambda;
+		arity = 1;
+		double	c = cos(theta/2),  s = sin(theta/2);
+		elems.resize(4);
+		elems[0] = Complex(ns_operators::clean(c));
+		elems[1] = ns_operators::polar(-s, lambda);
+		elems[2] = ns_operators::polar(s, phi);
+		elems[3] = ns_operators::polar(c, phi + lambda);
+	} else {
+		cout << "Operator::initFromSpec(): Error! There is no operator family named \"" << family << "\".\n";
+		return false;
+	}
+	if (!ok) {
+		cout << "Operator::initFromSpec(): Error! Wrong parameters for operator family " << family << " in " << spec << ".\n";
+		return false;
+	}
+
+	initFromElements(spec, arity, elems);
+	return true;
+}
+
+void Operator::initFromElements(const string& opName, operand_index_t nBits, const vector<Complex>& elems) {
+	name = opName;
+	arity = nBits;
+	U.set_rank((size_t)1 << arity);
+	U.initializeFrom(elems);
+	findCompactForm();
+}
+
 ostream& operator<<(ostream& os, Operator& opr){
 	os << opr.id << "`" << opr.name << "'[" << (int)opr.arity << "]";
 	// We don't bother printing the full matrix because that would be too verbose.
@@ -41,12 +41,52 @@ public:						// For simplicity, for now, let all fields be public.
 	Matrix				U;	 	        // Two-dimensional array (indexed by row, column) of complex numbers.
 										//   Note there are 2^arity rows and the same # of columns.	 
 										//   U must be unitary, but we do no error checking.
-	
+
+	// Many operators (X, cNOT, Toffoli, Z, the phase rotations, ...) have just one nonzero
+	// element in each column; i.e., they are a permutation of the basis states followed by
+	// a phase for each one.  For those, we also keep the following compact (monomial) form,
+	// which lets the simulator apply them with a couple of table lookups, without going
+	// through the matrix rows and columns at all.
+	enum form_t {
+		GENERAL,		// More than one nonzero element in some column.
+		MONOMIAL,		// One nonzero element in each column.
+		DIAGONAL		// One nonzero element in each column, on the diagonal.
+	};
+	form_t				form;
+	vector<size_t>		mono_target;	// For each column, the row of its nonzero element.
+	vector<size_t>		mono_source;	// For each row, the column of its nonzero element.
+	vector<Complex>		mono_elem;		// For each column, its nonzero element.
+	vector<RootOfUnityElem>	mono_elem_exact;	// The same elements in exact form, if they have one (see Amplitude.h).
+	vector<char>		mono_unit;		// For each column, whether that element is exactly 1.
+
 	// Public member functions.
 public:
+	Operator(void) : id(0), arity(0), form(GENERAL) {}
+
 	// This handy procedure initializes the operator from a text file using a FileReader object.
 	void initializeFrom(FileReader& r);
+
+	// Alternatively, generate a member of one of the built-in parametric families of
+	// operators, from a specification like "cPhase(k=5)" or "U3(theta=pi/2,phi=0,lambda=pi)".
+	// Prints an error message and returns false if the specification is bad.
+	bool initFromSpec(const string& spec);
+
+	// Or, set it up with the given name and arity, from a list of its matrix elements (in
+	// row-major order).  This is used for operators that are synthesized by the simulator.
+	void initFromElements(const string& opName, operand_index_t nBits, const vector<Complex>& elems);
+
+	bool isMonomial(void) const { return form != GENERAL; }
+
+private:
+	void findCompactForm(void);		// Set up the monomial form, if the matrix has one.
 };
 
+namespace ns_operators {
+	// Parse an angle, written as a plain number (in radians), or as a multiple of pi,
+	// in any of the forms "pi", "-pi/4", "3*pi/8", "3pi/8", "0.5*pi".  Returns false if
+	// it can't be parsed.
+	bool	parse_angle(const string& text, double& angle);
+}
+
 // For displaying an operator.
 ostream& operator<<(ostream& os, Operator& opr);
@@ -0,0 +1,745 @@
+//========================================================================
+// SEQCSim version 0.8 - The Space-Efficient Quantum Computer Simulator
+// By Michael P. Frank, Liviu Oniciuc, Uwe Meyer-Baese, and Liviu Oniciuc.
+// Copyright (C) 2008-2009  Florida State University Board of Trustees
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// 
+// You may contact the author at michael.patrick.frank@gmail.com, or at
+// Michael P. Frank, PO Box 025250 #24985, Miami, FL  33102-5250.
+//========================================================================
+
+//-------------------------------------------------------------------------
+// PhasePoly.cpp - A sum-over-paths engine, which compiles the circuit into
+//   a phase polynomial once, and then adds up its paths directly.
+//
+// Every operation in our circuits is either a Hadamard (or some other 1-qubit
+// operator whose elements all have magnitude 1/sqrt(2)), a diagonal operator
+// (the phase rotations, Z, phase oracles), or a permutation of the basis states
+// with phases (X, cNOT, Toffoli, the functional permutations).  For a circuit
+// like that, the amplitude of each final state is an exponential sum
+//
+//		<x|C|x0> = sqrt(2)^-h  sum_v  exp(2 pi i P(v))  [f(v) = x]
+//
+// over h path variables v_1..v_h, one for each Hadamard, where the value of
+// each qubit at each point in the circuit is a Boolean function of the v's
+// (kept as a polynomial over GF(2), i.e. an XOR of ANDs of the v's), and P is
+// a real polynomial in the v's (the "phase polynomial"), taken mod 1.  Going
+// through opn_seq once, we build the final values f(v) of the qubits, and P:
+//
+//	- A Hadamard on a qubit with value g introduces a new variable y, which
+//		becomes the qubit's value, and adds g*y/2 to P.
+//	- A diagonal operator adds its phases, as a function of its qubits'
+//		values, to P.  (Its table of phases is turned into a real polynomial
+//		in its qubits, and each qubit value g into the real polynomial that
+//		agrees with it on 0/1 values;  see lift().)
+//	- A permutation replaces its qubits' values by the GF(2) polynomials for
+//		the bits of its output, in terms of their old values.
+//
+// Variables that no longer appear in any qubit's value are then summed out
+// wherever that has a closed form.  If y appears in P only in terms y*m/2
+// (and perhaps y/4 or 3y/4), then with Q the XOR of those m's, the sum over y
+// is 2 [Q = 0] (or sqrt(2) exp(+-i pi/4) i^-+Q).  In the first case, if some
+// variable z appears in Q by itself, Q = z XOR R, the constraint just says
+// z = R, and substituting that for z eliminates z too.  (This is how a QFT
+// followed by its inverse collapses back to nothing at all.)
+//
+// The remaining variables are then enumerated in Gray-code order, so that
+// each step flips just one variable, and only the terms of P, and of the final
+// qubit values, that contain it need to be updated.  The amplitudes of the
+// paths are added up by final state, and then the exact probabilities are
+// reported, and the shots sampled, as in the other forward engines.
+//
+// The engine is selected with "option: engine phasepoly".  If some operation
+// doesn't have one of the forms above, or more than "option: phasepoly_max_vars
+// N" (default ns_phasepoly::default_max_vars) variables are left to enumerate,
+// run() falls back to the path-integral engine.
+//-------------------------------------------------------------------------
+
+#include <iostream>			// cout
+#include <sstream>			// ostringstream
+#include <vector>			// STL vector<> template.
+#include <map>				// For the phase polynomial, and the histogram of final states.
+#include <unordered_map>	// tr1::unordered_map, for the amplitudes of the final states.
+#include <algorithm>		// lower_bound(), upper_bound(), min()
+#include <math.h>			// atan2(), cos(), sin(), floor(), fabs(), pow()
+#include "SEQCSim.h"
+#include "OperationMatrix.h"	// ns_opmatrix::qubits_of()
+#include "debug.h"			// ns_debug::trace
+
+using namespace std;
+
+namespace ns_phasepoly {
+
+	// Variables are kept as bits of a size_t, so at most this many can be in use at once.
+	static const size_t		max_variables = 8*sizeof(size_t);
+
+	// By default, at most this many variables are left to enumerate (2^N paths).
+	static const double		default_max_vars = 24;
+
+	// Operations on more bits than this (including controls) aren't compiled.
+	static const size_t		max_table_bits = 12;
+
+	// Polynomials with more terms than this are given up on.
+	static const size_t		max_poly_terms = 1 << 16;
+
+	// Coefficients of P within this of a multiple of 1 (or of 1/4) are taken to be exactly that.
+	static const double		epsilon = 1e-9;
+
+	// Final amplitudes smaller in magnitude than this are taken to have cancelled out.
+	static const double		negligible_amp = 1e-12;
+
+	static const double		two_pi = 6.283185307179586476925286766559;
+
+	// A polynomial over GF(2):  the XOR of its monomials (sorted), each the AND of the variables
+	// whose bits are set.  Monomial 0 is the constant 1.
+	typedef vector<size_t>		Anf;
+
+	// A real polynomial:  the sum of coefficient times monomial.  Within P, the coefficients
+	// are in turns (units of 2 pi radians), taken mod 1.
+	typedef map<size_t, double>	RealPoly;
+
+	static inline size_t bit(size_t j) { return (size_t)1 << j; }
+
+	static int popcount(size_t x) {
+		int	n = 0;
+		for (;  x;  x &= x - 1) n++;
+		return n;
+	}
+
+	// Reduce a number of turns to [0,1), snapping values that are nearly 0 (or 1) to 0.
+	static double reduce_turns(double c) {
+		c -= floor(c);
+		return (c < epsilon || c > 1 - epsilon) ? 0 : c;
+	}
+
+	static bool near(double c, double target) { return fabs(c - target) < epsilon; }
+
+	// The phase of a (nonzero) complex number, in turns.
+	static double turns_of(const Complex& c) { return atan2(c.I, c.R) / two_pi; }
+
+	static void toggle(Anf& f, size_t m) {
+		Anf::iterator	it = lower_bound(f.begin(), f.end(), m);
+		if (it != f.end() && *it == m) {
+			f.erase(it);
+		} else {
+			f.insert(it, m);
+		}
+	}
+
+	static Anf product(const Anf& a, const Anf& b) {
+		Anf		p;
+		for (size_t i = 0;  i < a.size();  i++) {
+			for (size_t j = 0;  j < b.size();  j++) toggle(p, a[i] | b[j]);
+		}
+		return p;
+	}
+
+	// The real polynomial that agrees with the GF(2) polynomial f on all 0/1 values, using
+	// a XOR b = a + b - 2ab, one monomial at a time.  Returns false if it gets too big.
+	static bool lift(const Anf& f, RealPoly& p) {
+		p.clear();
+		for (size_t i = 0;  i < f.size();  i++) {
+			RealPoly	old(p);
+			p[f[i]] += 1;
+			for (RealPoly::const_iterator it = old.begin();  it != old.end();  it++) p[it->first | f[i]] -= 2*it->second;
+			if (p.size() > max_poly_terms) return false;
+		}
+		return true;
+	}
+
+	static bool product(const RealPoly& a, const RealPoly& b, RealPoly& p) {
+		p.clear();
+		for (RealPoly::const_iterator i = a.begin();  i != a.end();  i++) {
+			for (RealPoly::const_iterator j = b.begin();  j != b.end();  j++) p[i->first | j->first] += i->second * j->second;
+			if (p.size() > max_poly_terms) return false;
+		}
+		return true;
+	}
+
+	// The whole path sum (see the top of this file):  the current value of each qubit, the
+	// phase polynomial, and the normalization sqrt(2)^sqrt2_exp.
+	class PathSum {
+	public:
+		vector<Anf>	values;
+		RealPoly	phase;
+		size_t		live;			// The variables in use.
+		int			sqrt2_exp;
+		string		failure;		// Why it couldn't be compiled, if it couldn't.
+
+		PathSum(State& input, size_t nbits) : values(nbits), live(0), sqrt2_exp(0) {
+			for (size_t q = 0;  q < nbits;  q++) if (input.bits[q]) values[q].push_back(0);
+		}
+
+		bool	add_phase(const vector<double>& theta, const vector<qubit_index_t>& qubits);
+		bool	permute(const vector<size_t>& image, const vector<qubit_index_t>& qubits);
+		bool	hadamard(const vector<Complex>& m, qubit_index_t q);
+		void	eliminate(void);
+
+	private:
+		void	add_scaled(const RealPoly& p, double c);
+		size_t	new_variable(void);
+		bool	sum_out(size_t y);
+		bool	substitute(size_t z, const Anf& r);
+		size_t	reduce_table_args(const vector<qubit_index_t>& qubits, vector<size_t>& free_args, size_t& fixed);
+	};
+
+	// P += c*p, mod 1.
+	void PathSum::add_scaled(const RealPoly& p, double c) {
+		for (RealPoly::const_iterator it = p.begin();  it != p.end();  it++) {
+			double	sum = reduce_turns(phase[it->first] + c*it->second);
+			if (sum == 0) {
+				phase.erase(it->first);
+			} else {
+				phase[it->first] = sum;
+			}
+		}
+	}
+
+	// Of the given qubits, list (by position) those whose values aren't constant, and set
+	// fixed to the bits (by position) of the constant ones.  Returns the number not constant.
+	size_t PathSum::reduce_table_args(const vector<qubit_index_t>& qubits, vector<size_t>& free_args, size_t& fixed) {
+		free_args.clear();
+		fixed = 0;
+		for (size_t i = 0;  i < qubits.size();  i++) {
+			const Anf&	f = values[qubits[i]];
+			if (f.empty()) continue;
+			if (f.size() == 1 && f[0] == 0) {
+				fixed |= bit(i);
+			} else {
+				free_args.push_back(i);
+			}
+		}
+		return free_args.size();
+	}
+
+	// Add theta[z] to P, where z is the values of the given qubits (bit i for qubits[i]).  The
+	// table is turned into a real polynomial in the (non-constant) qubit values by a Moebius
+	// transform, and each qubit value is lifted to a real polynomial and substituted in.
+	bool PathSum::add_phase(const vector<double>& theta, const vector<qubit_index_t>& qubits) {
+		vector<size_t>	free_args;
+		size_t			fixed,  k = reduce_table_args(qubits, free_args, fixed),  size = (size_t)1 << k;
+		vector<double>	coef(size);
+		for (size_t z = 0;  z < size;  z++) {
+			size_t	full = fixed;
+			for (size_t i = 0;  i < k;  i++) if ((z >> i) & 1) full |= bit(free_args[i]);
+			coef[z] = theta[full];
+		}
+		for (size_t i = 0;  i < k;  i++) {
+			for (size_t z = 0;  z < size;  z++) if ((z >> i) & 1) coef[z] -= coef[z ^ bit(i)];
+		}
+
+		vector<RealPoly>	lifted(k);
+		for (size_t i = 0;  i < k;  i++) {
+			if (!lift(values[qubits[free_args[i]]], lifted[i])) {
+				failure = "a qubit's value got too complicated";
+				return false;
+			}
+		}
+		for (size_t z = 0;  z < size;  z++) {
+			double	c = reduce_turns(coef[z]);
+			if (c == 0) continue;
+			RealPoly	term,  next;
+			term[0] = 1;
+			for (size_t i = 0;  i < k;  i++) {
+				if (!((z >> i) & 1)) continue;
+				if (!product(term, lifted[i], next)) {
+					failure = "the phase polynomial got too big";
+					return false;
+				}
+				term.swap(next);
+			}
+			add_scaled(term, c);
+		}
+		return true;
+	}
+
+	// Replace the values of the given qubits by those of the bits of image[z], where z is their
+	// old values.  Each bit of the output is turned into a GF(2) polynomial in the (non-constant)
+	// old values by a Moebius transform, and the old values are substituted in.
+	bool PathSum::permute(const vector<size_t>& image, const vector<qubit_index_t>& qubits) {
+		vector<size_t>	free_args;
+		size_t			fixed,  k = reduce_table_args(qubits, free_args, fixed),  size = (size_t)1 << k;
+		vector<Anf>		new_values(qubits.size());
+		vector<char>	g(size);
+
+		for (size_t out = 0;  out < qubits.size();  out++) {
+			for (size_t z = 0;  z < size;  z++) {
+				size_t	full = fixed;
+				for (size_t i = 0;  i < k;  i++) if ((z >> i) & 1) full |= bit(free_args[i]);
+				g[z] = (char)((image[full] >> out) & 1);
+			}
+			for (size_t i = 0;  i < k;  i++) {
+				for (size_t z = 0;  z < size;  z++) if ((z >> i) & 1) g[z] ^= g[z ^ bit(i)];
+			}
+			for (size_t z = 0;  z < size;  z++) {
+				if (!g[z]) continue;
+				Anf		term(1, 0);
+				for (size_t i = 0;  i < k;  i++) if ((z >> i) & 1) term = product(term, values[qubits[free_args[i]]]);
+				for (size_t t = 0;  t < term.size();  t++) toggle(new_values[out], term[t]);
+				if (new_values[out].size() > max_poly_terms) {
+					failure = "a qubit's value got too complicated";
+					return false;
+				}
+			}
+		}
+		for (size_t i = 0;  i < qubits.size();  i++) values[qubits[i]] = new_values[i];
+		return true;
+	}
+
+	// Apply a 1-qubit operator whose elements all have magnitude 1/sqrt(2).  Any such unitary
+	// is diag(b0,b1) H diag(a0,a1), up to a phase, so its element in row y, column x has phase
+	// alpha(x) + beta(y) + xy/2.
+	bool PathSum::hadamard(const vector<Complex>& m, qubit_index_t q) {
+		for (size_t i = 0;  i < 4;  i++) {
+			if (!near(m[i].squared_norm(), 0.5)) {
+				failure = "an operation isn't a Hadamard-like, diagonal or permutation operator";
+				return false;
+			}
+		}
+		vector<double>	alpha(2),  theta(4);
+		alpha[0] = turns_of(m[0]);
+		alpha[1] = turns_of(m[1]);
+		double			beta1 = turns_of(m[2]) - alpha[0];
+		if (!near(reduce_turns(turns_of(m[3]) - alpha[1] - beta1), 0.5)) {
+			failure = "an operation isn't a Hadamard-like, diagonal or permutation operator";
+			return false;
+		}
+
+		vector<qubit_index_t>	one(1, q);
+		if (!add_phase(alpha, one)) return false;
+
+		size_t	y = new_variable();
+		if (y == max_variables) return false;
+		Anf		old = values[q];
+		values[q] = Anf(1, bit(y));
+
+		// Add beta(y) + g*y/2, where g was the qubit's old value.
+		RealPoly	g,  gy;
+		if (!lift(old, g)) {
+			failure = "a qubit's value got too complicated";
+			return false;
+		}
+		for (RealPoly::const_iterator it = g.begin();  it != g.end();  it++) gy[it->first | bit(y)] += it->second;
+		add_scaled(gy, 0.5);
+		RealPoly	yp;
+		yp[bit(y)] = 1;
+		add_scaled(yp, beta1);
+		sqrt2_exp -= 1;
+		return true;
+	}
+
+	size_t PathSum::new_variable(void) {
+		if (live == ~(size_t)0) eliminate();
+		for (size_t y = 0;  y < max_variables;  y++) {
+			if (!((live >> y) & 1)) {
+				live |= bit(y);
+				return y;
+			}
+		}
+		failure = "more path variables were needed at once than fit in a word";
+		return max_variables;
+	}
+
+	// Replace variable z by the GF(2) polynomial r (which doesn't contain it) everywhere.
+	bool PathSum::substitute(size_t z, const Anf& r) {
+		RealPoly	lifted;
+		if (!lift(r, lifted)) return false;
+
+		RealPoly	terms;
+		for (RealPoly::iterator it = phase.begin();  it != phase.end();  ) {
+			if ((it->first >> z) & 1) {
+				terms[it->first & ~bit(z)] = it->second;
+				phase.erase(it++);
+			} else {
+				it++;
+			}
+		}
+		for (RealPoly::const_iterator t = terms.begin();  t != terms.end();  t++) {
+			RealPoly	shifted;
+			for (RealPoly::const_iterator it = lifted.begin();  it != lifted.end();  it++) shifted[it->first | t->first] += it->second;
+			add_scaled(shifted, t->second);
+		}
+
+		for (size_t q = 0;  q < values.size();  q++) {
+			Anf		kept,  added;
+			for (size_t i = 0;  i < values[q].size();  i++) {
+				size_t	m = values[q][i];
+				if ((m >> z) & 1) {
+					Anf	sub = product(Anf(1, m & ~bit(z)), r);
+					for (size_t t = 0;  t < sub.size();  t++) toggle(added, sub[t]);
+				} else {
+					kept.push_back(m);
+				}
+			}
+			for (size_t t = 0;  t < added.size();  t++) toggle(kept, added[t]);
+			values[q].swap(kept);
+		}
+		live &= ~bit(z);
+		return true;
+	}
+
+	// Sum over variable y (which no qubit's value contains), if it has a closed form.
+	bool PathSum::sum_out(size_t y) {
+		double	c_lin = 0;
+		Anf		q;
+		for (RealPoly::const_iterator it = phase.begin();  it != phase.end();  it++) {
+			if (!((it->first >> y) & 1)) continue;
+			if (it->first == bit(y)) {
+				c_lin = it->second;
+			} else if (near(it->second, 0.5)) {
+				toggle(q, it->first & ~bit(y));
+			} else {
+				return false;
+			}
+		}
+		if (near(c_lin, 0.5)) {
+			toggle(q, 0);
+			c_lin = 0;
+		}
+
+		size_t	z = max_variables;
+		if (c_lin == 0 && !q.empty()) {
+			// The sum is 2 [q = 0].  Look for a variable that appears in q only by itself.
+			for (size_t i = 0;  i < q.size() && z == max_variables;  i++) {
+				if (popcount(q[i]) != 1) continue;
+				size_t	cand = 0;
+				while (!((q[i] >> cand) & 1)) cand++;
+				bool	alone = true;
+				for (size_t j = 0;  j < q.size();  j++) if (j != i && ((q[j] >> cand) & 1)) alone = false;
+				if (alone) z = cand;
+			}
+			if (z == max_variables) return false;
+		} else if (c_lin != 0 && !near(c_lin, 0.25) && !near(c_lin, 0.75)) {
+			return false;
+		}
+
+		for (RealPoly::iterator it = phase.begin();  it != phase.end();  ) {
+			if ((it->first >> y) & 1) {
+				phase.erase(it++);
+			} else {
+				it++;
+			}
+		}
+		live &= ~bit(y);
+
+		if (c_lin == 0) {
+			sqrt2_exp += 2;
+			if (z != max_variables) {
+				toggle(q, bit(z));
+				substitute(z, q);
+			}
+		} else {
+			// 1 + i^s (-1)^q = sqrt(2) exp(s i pi/4) i^(-s q), for s = +-1.
+			double		s = near(c_lin, 0.25) ? 1 : -1;
+			RealPoly	lifted,  one;
+			lift(q, lifted);
+			one[0] = 1;
+			add_scaled(one, s/8);
+			add_scaled(lifted, -s/4);
+			sqrt2_exp += 1;
+		}
+		return true;
+	}
+
+	// Sum out every variable we can, until there are none left to sum out.  (Each one summed
+	// out can change which others are used, so we start over after each.)
+	void PathSum::eliminate(void) {
+		for (bool progress = true;  progress;  ) {
+			progress = false;
+			size_t	used = 0;
+			for (size_t q = 0;  q < values.size();  q++) {
+				for (size_t i = 0;  i < values[q].size();  i++) used |= values[q][i];
+			}
+			for (size_t y = 0;  y < max_variables && !progress;  y++) {
+				if (((live & ~used) >> y) & 1) progress = sum_out(y);
+			}
+		}
+	}
+
+	// For the enumeration:  a term of P, or of the final value of some qubits, that contains a
+	// given variable, with the rest of its monomial.
+	struct PhaseTerm {
+		size_t	rest;
+		double	coef;
+	};
+	struct FlipTerm {
+		size_t	rest;
+		size_t	qubits;			// The qubits whose values it appears in.
+	};
+}
+
+// Compile opn_seq into the given path sum (which starts out as the input state), and sum
+// out every variable that can be.  Sets n_hadamards to the number of variables introduced.
+// Returns false if some operation can't be compiled, setting failed_pc to its index (and
+// sum.failure to the reason).
+
+bool SEQCSim::compile_phase_poly(ns_phasepoly::PathSum& sum, size_t& n_hadamards, size_t& failed_pc)
+{
+	n_hadamards = 0;
+	for (size_t pc = 0;  pc < opn_seq.size();  pc++) {
+		Operation&				opn = opn_seq[pc];
+		vector<qubit_index_t>	qubits;
+		bool					ok = true;
+
+		if (ns_debug::trace) cout << "SEQCSim::compile_phase_poly(): Compiling operation #" << pc << ", " << opn << ".\n";
+
+		if (opn.isFunctional()) {
+			// The bits of a functional operation's table are its registers' bits, then its controls.
+			FunctionalOperator&	func = functions[opn.function_id];
+			vector<size_t>		widths(opn.registers.size());
+			for (size_t r = 0;  r < opn.registers.size();  r++) {
+				qubits.insert(qubits.end(), opn.registers[r].begin(), opn.registers[r].end());
+				widths[r] = opn.registers[r].size();
+			}
+			size_t	n_reg_bits = qubits.size();
+			qubits.insert(qubits.end(), opn.controls.begin(), opn.controls.end());
+			if (qubits.size() > ns_phasepoly::max_table_bits) {
+				sum.failure = "a functional operation acts on too many bits";
+				ok = false;
+			} else {
+				size_t			size = (size_t)1 << qubits.size();
+				vector<double>	theta(size, 0.0);
+				vector<size_t>	image(size);
+				size_t			regs[ns_functions::max_registers];
+				for (size_t z = 0;  z < size;  z++) {
+					image[z] = z;
+					if ((z >> n_reg_bits) != opn.control_values) continue;
+					for (size_t r = 0, shift = 0;  r < widths.size();  shift += widths[r], r++) {
+						regs[r] = (z >> shift) & (((size_t)1 << widths[r]) - 1);
+					}
+					if (func.kind == FunctionalOperator::PHASE_ORACLE) {
+						theta[z] = ns_phasepoly::turns_of(func.phase_of(regs, &widths[0]));
+					} else {
+						func.apply(regs, &widths[0]);
+						image[z] = z & ~(((size_t)1 << n_reg_bits) - 1);
+						for (size_t r = 0, shift = 0;  r < widths.size();  shift += widths[r], r++) image[z] |= regs[r] << shift;
+					}
+				}
+				ok = (func.kind == FunctionalOperator::PHASE_ORACLE) ? sum.add_phase(theta, qubits) : sum.permute(image, qubits);
+			}
+
+		} else {
+			Operator&	opr = operators.at(opn.operator_id);
+			ns_opmatrix::qubits_of(opn, qubits);		// (Operands, then controls.)
+			size_t		n_ops = opn.operands.size();
+
+			if (opr.form == Operator::GENERAL) {
+				if (n_ops == 1 && opn.controls.empty()) {
+					vector<Complex>	m;
+					ns_opmatrix::embed(opr, opn, qubits, m);
+					ok = sum.hadamard(m, qubits[0]);
+					n_hadamards++;
+				} else {
+					sum.failure = "an operation isn't a Hadamard-like, diagonal or permutation operator";
+					ok = false;
+				}
+			} else if (qubits.size() > ns_phasepoly::max_table_bits) {
+				sum.failure = "an operation acts on too many bits";
+				ok = false;
+			} else {
+				// A phase for each column (as a function of the old values), then the permutation.
+				size_t			size = (size_t)1 << qubits.size(),  op_mask = ((size_t)1 << n_ops) - 1;
+				vector<double>	theta(size, 0.0);
+				vector<size_t>	image(size);
+				bool			any_phase = false;
+				for (size_t z = 0;  z < size;  z++) {
+					image[z] = z;
+					if ((z >> n_ops) != opn.control_values) continue;
+					size_t	j = z & op_mask;
+					if (!opr.mono_unit[j]) {
+						theta[z] = ns_phasepoly::turns_of(opr.mono_elem[j]);
+						any_phase = true;
+					}
+					image[z] = (z & ~op_mask) | opr.mono_target[j];
+				}
+				if (any_phase) ok = sum.add_phase(theta, qubits);
+				if (ok && opr.form == Operator::MONOMIAL) ok = sum.permute(image, qubits);
+			}
+		}
+
+		if (!ok) {
+			failed_pc = pc;
+			return false;
+		}
+		// Sum out what we can after each Hadamard, to keep P small.
+		if (!opn.isFunctional() && operators.at(opn.operator_id).form == Operator::GENERAL) sum.eliminate();
+	}
+	sum.eliminate();
+	return true;
+}
+
+// Run the simulation with the phase-polynomial engine.  Returns false (having done nothing but
+// print why) if the circuit can't be compiled, or leaves too many paths to enumerate.
+
+bool SEQCSim::run_phase_poly(void)
+{
+	size_t		nbits = qc_config.nbits;
+	size_t		max_vars = (size_t)qc_config.option_double("phasepoly_max_vars", ns_phasepoly::default_max_vars);
+
+	if (nbits > ns_phasepoly::max_variables) {
+		cout << "SEQCSim::run_phase_poly(): There are too many qubits (" << nbits
+			 << ") for the final states to fit in a word; falling back to the path-integral engine.\n";
+		return false;
+	}
+
+	// Compile the circuit into the path sum.
+	ns_phasepoly::PathSum	sum(input_state, nbits);
+	size_t					n_hadamards,  failed_pc;
+	if (!compile_phase_poly(sum, n_hadamards, failed_pc)) {
+		cout << "SEQCSim::run_phase_poly(): Can't compile operation #" << failed_pc << " into a phase polynomial ("
+			 << sum.failure << "); falling back to the path-integral engine.\n";
+		return false;
+	}
+
+	// Number the variables that are left consecutively, for the enumeration.
+	vector<size_t>	var_index(ns_phasepoly::max_variables, 0);
+	size_t			n_vars = 0;
+	for (size_t y = 0;  y < ns_phasepoly::max_variables;  y++) if ((sum.live >> y) & 1) var_index[y] = n_vars++;
+
+	cout << "SEQCSim::run_phase_poly(): Compiled the circuit into a sum over " << n_hadamards << " path variables; "
+		 << n_hadamards - n_vars << " of them were summed out, leaving " << n_vars << ", with "
+		 << sum.phase.size() << " terms in the phase polynomial.\n";
+	if (n_vars > max_vars) {
+		cout << "SEQCSim::run_phase_poly(): That's more than phasepoly_max_vars = " << max_vars
+			 << "; falling back to the path-integral engine.\n";
+		return false;
+	}
+
+	// For each variable, the terms of P, and of the final qubit values, that contain it.
+	vector< vector<ns_phasepoly::PhaseTerm> >	phase_terms(n_vars);
+	vector< vector<ns_phasepoly::FlipTerm> >	flip_terms(n_vars);
+	double		phase = 0;
+	size_t		out = 0;
+	for (ns_phasepoly::RealPoly::const_iterator it = sum.phase.begin();  it != sum.phase.end();  it++) {
+		size_t	m = 0;
+		for (size_t y = 0;  y < ns_phasepoly::max_variables;  y++) if ((it->first >> y) & 1) m |= ns_phasepoly::bit(var_index[y]);
+		if (m == 0) phase = it->second;
+		for (size_t k = 0;  k < n_vars;  k++) {
+			if (!((m >> k) & 1)) continue;
+			ns_phasepoly::PhaseTerm	term = { m & ~ns_phasepoly::bit(k), it->second };
+			phase_terms[k].push_back(term);
+		}
+	}
+	vector< map<size_t, size_t> >	flips(n_vars);
+	for (size_t q = 0;  q < nbits;  q++) {
+		for (size_t i = 0;  i < sum.values[q].size();  i++) {
+			size_t	m = 0;
+			for (size_t y = 0;  y < ns_phasepoly::max_variables;  y++) if ((sum.values[q][i] >> y) & 1) m |= ns_phasepoly::bit(var_index[y]);
+			if (m == 0) out ^= ns_phasepoly::bit(q);
+			for (size_t k = 0;  k < n_vars;  k++) if ((m >> k) & 1) flips[k][m & ~ns_phasepoly::bit(k)] ^= ns_phasepoly::bit(q);
+		}
+	}
+	for (size_t k = 0;  k < n_vars;  k++) {
+		for (map<size_t, size_t>::const_iterator it = flips[k].begin();  it != flips[k].end();  it++) {
+			ns_phasepoly::FlipTerm	term = { it->first, it->second };
+			if (term.qubits) flip_terms[k].push_back(term);
+		}
+	}
+
+	// Add up the paths, in Gray-code order.  Step t flips the variable numbered by the lowest
+	// set bit of t, and a term containing it changes only if the rest of its monomial is 1.
+	typedef tr1::unordered_map<size_t, Complex>	FinalAmps;
+	FinalAmps	amps;
+	Complex		scale = input_state.amp * Complex(pow(2.0, sum.sqrt2_exp/2.0));
+	size_t		v = 0,  n_paths = (size_t)1 << n_vars;
+	for (size_t t = 1;  ;  t++) {
+		amps[out] += Complex(cos(ns_phasepoly::two_pi*phase), sin(ns_phasepoly::two_pi*phase));
+		if (t == n_paths) break;
+
+		size_t	k = 0;
+		while (!((t >> k) & 1)) k++;
+		v ^= ns_phasepoly::bit(k);
+		double	sign = ((v >> k) & 1) ? 1 : -1;
+		const vector<ns_phasepoly::PhaseTerm>&	pt = phase_terms[k];
+		for (size_t i = 0;  i < pt.size();  i++) if (!(pt[i].rest & ~v)) phase += sign*pt[i].coef;
+		const vector<ns_phasepoly::FlipTerm>&	ft = flip_terms[k];
+		for (size_t i = 0;  i < ft.size();  i++) if (!(ft[i].rest & ~v)) out ^= ft[i].qubits;
+	}
+
+	// Collect the final states, with their cumulative probabilities, for sampling.
+	vector< pair<size_t, Complex> >	final_states;
+	vector<double>					cumulative;
+	map<string, double>				exact_probs;
+	double							total = 0;
+	for (FinalAmps::const_iterator it = amps.begin();  it != amps.end();  it++) {
+		Complex		amp = it->second * scale;
+		if (amp.norm() < ns_phasepoly::negligible_amp) continue;
+		final_states.push_back(make_pair(it->first, amp));
+		total += amp.squared_norm();
+		cumulative.push_back(total);
+	}
+	cout << "SEQCSim::run_phase_poly(): Added up " << n_paths << " paths, into " << final_states.size()
+		 << " final states, with total squared norm " << total << ".\n";
+
+	// List the most likely final states (or values of the measured registers), with their exact probabilities.
+	current_state = input_state;
+	for (size_t i = 0;  i < final_states.size();  i++) {
+		for (size_t q = 0;  q < nbits;  q++) current_state.bits[q] = ((final_states[i].first >> q) & 1) != 0;
+		exact_probs[final_state_key()] += final_states[i].second.squared_norm()/total;
+	}
+	report_final_probabilities("SEQCSim::run_phase_poly()", exact_probs);
+
+	// Now sample the shots.
+	unsigned long				n_shots = (unsigned long)qc_config.option_double("shots", 1);
+	map<string, unsigned long>	histogram;
+
+	for (unsigned long shot = 1;  shot <= n_shots;  shot++) {
+		double	marker_position = marker_picker(prng_engine) * total;
+		size_t	i = upper_bound(cumulative.begin(), cumulative.end(), marker_position) - cumulative.begin();
+		if (i >= final_states.size()) i = final_states.size() - 1;
+
+		for (size_t q = 0;  q < nbits;  q++) current_state.bits[q] = ((final_states[i].first >> q) & 1) != 0;
+		current_state.amp = final_states[i].second;
+		cout << "SEQCSim::run_phase_poly(): Shot #" << shot << " ended in state " << current_state << ".\n";
+		histogram[final_state_key()]++;
+	}
+
+	report_histogram("SEQCSim::run_phase_poly()", histogram, n_shots);
+	return true;
+}
+
+// The cost of running the circuit with the phase-polynomial engine (see CostModel.h).  The
+// compilation is cheap, so we just do it, and see how many variables are left to enumerate.
+
+void SEQCSim::estimate_phase_poly(EngineEstimate& est)
+{
+	size_t			nbits = qc_config.nbits;
+	size_t			max_vars = (size_t)qc_config.option_double("phasepoly_max_vars", ns_phasepoly::default_max_vars);
+	ostringstream	note;
+
+	if (nbits > ns_phasepoly::max_variables) {
+		est.possible = false;
+		note << "there are too many qubits (" << nbits << ") for the final states to fit in a word";
+		est.note = note.str();
+		return;
+	}
+	ns_phasepoly::PathSum	sum(input_state, nbits);
+	size_t					n_hadamards,  failed_pc,  n_vars = 0;
+	if (!compile_phase_poly(sum, n_hadamards, failed_pc)) {
+		est.possible = false;
+		note << "operation #" << failed_pc << " can't be compiled:  " << sum.failure;
+		est.note = note.str();
+		return;
+	}
+	for (size_t y = 0;  y < ns_phasepoly::max_variables;  y++) if ((sum.live >> y) & 1) n_vars++;
+
+	double	n_paths = pow(2.0, (double)n_vars);
+	est.possible = (n_vars <= max_vars);
+	est.seconds = ns_cost::times(n_paths, (double)(sum.phase.size() + nbits)) * ns_cost::seconds_per_flop;
+	est.memory_mb = min(n_paths, support_bounds.back()) * (sizeof(size_t) + sizeof(Complex) + 32) / (1024*1024);
+	note << n_vars << " of the " << n_hadamards << " path variables are left after summing out";
+	if (!est.possible) note << ", more than phasepoly_max_vars = " << max_vars;
+	est.note = note.str();
+}
@@ -23,11 +23,17 @@
 #include <string>			// Needed for string class.
 #include <iostream>
 #include <fstream>			// For ifstream
-#include <sstream>			// Needed for istringstream.
+#include <sstream>			// Needed for istringstream, ostringstream.
+#include <map>				// For the histogram of final states.
+#include <algorithm>			// find(), for checking control bits.
 #include <random>			// uniform_real class (pseudo-random number generator)
 #include "index_types.h"		// For operators_index_t etc.
 #include "SEQCSim.h"				// Header file declaring the class we're defining.
 #include "SmartComplexVector.h"		// Includes a redundant sparse representation for fast iteration over nonzero entries.
+#include "ComplexKernels.h"			// ns_kernels::cgemv(), cdot() - SIMD complex matrix-vector kernels.
+#include "ScratchArena.h"			// Preallocated working storage for the engine.
+#include "AllocCounter.h"			// ns_alloc::allocation_count()
+#include "OperationMatrix.h"		// ns_opmatrix::equal(), for finding inverse operators.
 #include "debug.h"			// ns_debug::trace
 
 using namespace std;
@@ -37,6 +43,152 @@ namespace ns_SEQCSim {
 	static const string default_config_filename			= "..\\data\\qconfig.txt";
 	static const string default_opseq_filename			= "..\\data\\qopseq.txt";
 	static const string default_input_filename			= "..\\data\\qinput.txt";
+
+	// If the smallest possible path contribution through the circuit could be smaller
+	// than 2^(this), choose_arith_mode() automatically switches to extended-range
+	// arithmetic.  (The smallest normal double is 2^-1022; this leaves some headroom
+	// for the partial sums and the squared norms taken in Bohm_step_forwards().)
+	static const double extended_range_threshold_log2	= -480;
+
+	// When an engine can work out the exact probabilities of the final states (see
+	// report_final_probabilities()), those below this aren't listed, and at most
+	// max_listed of them are, in order of decreasing probability.
+	static const double negligible_prob		= 1e-12;
+	static const size_t max_listed			= 64;
+
+	// Multiply the input amplitudes for a block's columns (arena.input_amps) by the block's
+	// submatrix, giving the output amplitudes for its rows (arena.output_amps).  This generic
+	// version works for any amplitude type (see Amplitude.h); if compensated is true, each
+	// row's sum is accumulated using Kahan summation.
+
+	template<class Amp>
+	void block_matvec(MatrixBlock& blk, ScratchArena<Amp>& arena, bool compensated) {
+		vector<Amp>&	in_amps = arena.input_amps;
+		vector<Amp>&	out_amps = arena.output_amps;
+		size_t	rank = blk.rank();
+		for (size_t r = 0;  r < rank;  r++) {
+			AmpAccumulator<Amp>	accum(compensated);
+			for (size_t c = 0;  c < rank;  c++) {
+				size_t	k = r*rank + c;		// Row-major position of element (r,c).
+				accum.add(Amp(Complex(blk.elems_re[k], blk.elems_im[k])) * in_amps[c]);
+			}
+			out_amps[r] = accum.value();
+		}
+	}
+
+	// For plain double-precision Complex amplitudes, use the SIMD kernel instead (unless
+	// compensated summation was requested, which the kernels don't do).
+
+	void block_matvec(MatrixBlock& blk, ScratchArena<Complex>& arena, bool compensated) {
+		if (compensated) { block_matvec<Complex>(blk, arena, compensated);  return; }
+
+		vector<Complex>&	in_amps = arena.input_amps;
+		vector<Complex>&	out_amps = arena.output_amps;
+		vector<double>		&in_re = arena.in_re,  &in_im = arena.in_im,  &out_re = arena.out_re,  &out_im = arena.out_im;
+		size_t				rank = blk.rank();
+		for (size_t c = 0;  c < rank;  c++) { in_re[c] = in_amps[c].R;  in_im[c] = in_amps[c].I; }
+
+		ns_kernels::cgemv(rank, rank, &blk.elems_re[0], &blk.elems_im[0],
+						  &in_re[0], &in_im[0], &out_re[0], &out_im[0]);
+
+		for (size_t r = 0;  r < rank;  r++) out_amps[r] = Complex(out_re[r], out_im[r]);
+	}
+
+	// Add up the given amplitudes, weighted by the nonzero elements of the given matrix
+	// row (in the same order).  Only the first row.nNonzeros() elements of amps are used.
+	// Generic version, for any amplitude type.
+
+	template<class Amp>
+	Amp weighted_sum(SmartComplexVector& row, vector<Amp>& amps, ScratchArena<Amp>& arena, bool compensated) {
+		vector<double>&		w_re = row.nz_elems_real_parts();
+		vector<double>&		w_im = row.nz_elems_imag_parts();
+		AmpAccumulator<Amp>	accum(compensated);
+		for (size_t i = 0;  i < row.nNonzeros();  i++)
+			accum.add(Amp(Complex(w_re[i], w_im[i])) * amps[i]);
+		return accum.value();
+	}
+
+	// Compute the squared norms of the given amplitudes, all scaled by the same (unspecified)
+	// factor.  Only their ratios matter, since Bohm_step_forwards() normalizes them into
+	// probabilities.  Only the first n amplitudes are used.  For the ordinary amplitude
+	// types, the scale factor is just 1.
+
+	template<class Amp>
+	void relative_squared_norms(vector<Amp>& amps, size_t n, vector<double>& sq_norms) {
+		for (size_t i = 0;  i < n;  i++) sq_norms[i] = amps[i].squared_norm();
+	}
+
+	// For extended-range amplitudes, the squared norms themselves may be far outside the
+	// range of a double, so we scale them all relative to the largest exponent present.
+
+	void relative_squared_norms(vector<ExtComplex>& amps, size_t n, vector<double>& sq_norms) {
+		bool	any = false;
+		int		max_e = 0;
+		for (size_t i = 0;  i < n;  i++) {
+			if (amps[i].isZero()) continue;
+			ExtComplex	a = amps[i];  a.normalize();
+			if (!any || a.E > max_e) { max_e = a.E;  any = true; }
+		}
+		for (size_t i = 0;  i < n;  i++) sq_norms[i] = amps[i].squared_norm_scaled(max_e);
+	}
+
+	// For exact amplitudes, use the exact forms of the matrix elements that were worked out
+	// when the operators were loaded, instead of converting from Complex each time.  Terms
+	// with a zero amplitude (exactly zero, in this arithmetic) are skipped.
+
+	template<int M>
+	void block_matvec(MatrixBlock& blk, ScratchArena<CyclotomicAmp<M> >& arena, bool compensated) {
+		vector<CyclotomicAmp<M> >&	in_amps = arena.input_amps;
+		vector<CyclotomicAmp<M> >&	out_amps = arena.output_amps;
+		size_t	rank = blk.rank();
+		for (size_t r = 0;  r < rank;  r++) {
+			CyclotomicAmp<M>	sum;
+			for (size_t c = 0;  c < rank;  c++) {
+				RootOfUnityElem&	elem = blk.elems_exact[r*rank + c];
+				if (elem.zero || in_amps[c].isZero()) continue;
+				sum += CyclotomicAmp<M>(elem) * in_amps[c];
+			}
+			out_amps[r] = sum;
+		}
+	}
+
+	template<int M>
+	CyclotomicAmp<M> weighted_sum(SmartComplexVector& row, vector<CyclotomicAmp<M> >& amps,
+								  ScratchArena<CyclotomicAmp<M> >& arena, bool compensated) {
+		vector<RootOfUnityElem>&	w = row.nz_elems_exact_form();
+		CyclotomicAmp<M>			sum;
+		for (size_t i = 0;  i < row.nNonzeros();  i++)
+			if (!amps[i].isZero()) sum += CyclotomicAmp<M>(w[i]) * amps[i];
+		return sum;
+	}
+
+	// Multiply an amplitude by element j of a monomial operator's compact form.  For exact
+	// amplitudes, this too uses the exact form worked out when the operator was loaded.
+
+	template<class Amp>
+	void mul_mono_elem(Amp& amp, Operator& opr, size_t j) {
+		amp *= Amp(opr.mono_elem[j]);
+	}
+
+	template<int M>
+	void mul_mono_elem(CyclotomicAmp<M>& amp, Operator& opr, size_t j) {
+		amp *= CyclotomicAmp<M>(opr.mono_elem_exact[j]);
+	}
+
+	// For plain double-precision Complex amplitudes, use the SIMD dot-product kernel.
+
+	Complex weighted_sum(SmartComplexVector& row, vector<Complex>& amps, ScratchArena<Complex>& arena, bool compensated) {
+		if (compensated) return weighted_sum<Complex>(row, amps, arena, compensated);
+
+		size_t			n = row.nNonzeros();
+		vector<double>	&a_re = arena.in_re,  &a_im = arena.in_im;
+		for (size_t i = 0;  i < n;  i++) { a_re[i] = amps[i].R;  a_im[i] = amps[i].I; }
+
+		Complex		result;
+		ns_kernels::cdot(n, &row.nz_elems_real_parts()[0], &row.nz_elems_imag_parts()[0],
+						 &a_re[0], &a_im[0], &result.R, &result.I);
+		return result;
+	}
 }
 
 void SEQCSim::read_operators() {
@@ -104,6 +256,279 @@ void SEQCSim::read_config() {
 	qc_config.initFromFile(ns_SEQCSim::default_config_filename);
 }
 
+// Find the index (in functions) of the function with the given name, for operation number
+// op_index, or set up a new one.
+
+int SEQCSim::find_function(const string& funcName, operation_index_t op_index) {
+	for (size_t i = 0;  i < functions.size();  i++) {
+		if (functions[i].name == funcName) return (int)i;
+	}
+	FunctionalOperator	func;
+	if (!func.initFromName(funcName)) {
+		cout << "SEQCSim::find_function(): Error! Can't set up function \"" << funcName << "\" for operation #" << op_index << ".\n";
+		exit(1);
+	}
+	functions.push_back(func);
+	return (int)functions.size() - 1;
+}
+
+// Set up operation number op_index as an application of the functional operator with the
+// given name (see FunctionalOperator.h) to the registers with the given names.  If an
+// identical function (same name and parameters) has already been used, it's shared.
+
+void SEQCSim::read_function_opn(operation_index_t op_index, const string& funcName, vector<string>& regNames) {
+	Operation&	cur_op = opn_seq.at(op_index);
+
+	cur_op.function_id = find_function(funcName, op_index);
+	FunctionalOperator&	func = functions[cur_op.function_id];
+
+	if (regNames.size() != func.n_registers) {
+		cout << "SEQCSim::read_function_opn(): Error! Function " << funcName << " takes " << func.n_registers
+			 << " registers, but operation #" << op_index << " gives it " << regNames.size() << ".\n";
+		exit(1);
+	}
+
+	// Look up the registers.  The operand list is all of their bits, in order.
+	cur_op.registers.resize(regNames.size());
+	cur_op.register_names = regNames;
+	cur_op.operands.clear();
+	for (size_t r = 0;  r < regNames.size();  r++) {
+		qc_config.lookup_register(regNames[r], cur_op.registers[r]);
+		if (cur_op.registers[r].size() > 8*sizeof(size_t)) {
+			cout << "SEQCSim::read_function_opn(): Error! Register " << regNames[r] << " is too wide for a function operand.\n";
+			exit(1);
+		}
+		cur_op.operands.insert(cur_op.operands.end(), cur_op.registers[r].begin(), cur_op.registers[r].end());
+	}
+
+	// The function works in place on the registers' values, so they mustn't share any bits.
+	vector<bool>	used(qc_config.nbits, false);
+	for (size_t k = 0;  k < cur_op.operands.size();  k++) {
+		if (used.at(cur_op.operands[k])) {
+			cout << "SEQCSim::read_function_opn(): Error! The registers of operation #" << op_index
+				 << " overlap (at bit " << qc_config.name_of_bit(cur_op.operands[k]) << ").\n";
+			exit(1);
+		}
+		used[cur_op.operands[k]] = true;
+	}
+
+	// And a function mod N is only a permutation if the register holding the values mod N can hold N-1.
+	if (func.modulus_register >= 0) {
+		size_t	width = cur_op.registers[func.modulus_register].size();
+		if (width < 63 && func.params[1] > (1LL << width)) {
+			cout << "SEQCSim::read_function_opn(): Error! Operation #" << op_index << " applies " << funcName
+				 << " to register " << regNames[func.modulus_register] << ", whose " << width
+				 << " bits can't hold all the values mod " << func.params[1] << ".\n";
+			exit(1);
+		}
+	}
+
+	if (ns_debug::trace) {
+		cout << "SEQCSim::read_function_opn(): Operation #" << op_index << " applies function " << funcName
+			 << " to " << regNames.size() << " registers, " << cur_op.operands.size() << " bits in all.\n";
+	}
+}
+
+// Set up the control bits of operation number op_index, from the given list of bit names.
+// A name preceded by "!" is a negative control (the operation happens only if it's 0).
+
+void SEQCSim::read_controls(operation_index_t op_index, vector<string>& controlNames) {
+	Operation&	cur_op = opn_seq.at(op_index);
+
+	cur_op.controls.clear();
+	cur_op.control_values = 0;
+	if (controlNames.size() > 8*sizeof(size_t)) {
+		cout << "SEQCSim::read_controls(): Error! Operation #" << op_index << " has more than " << 8*sizeof(size_t) << " controls.\n";
+		exit(1);
+	}
+	for (size_t i = 0;  i < controlNames.size();  i++) {
+		bool	negative = (controlNames[i][0] == '!');
+		string	bitName = negative ? controlNames[i].substr(1) : controlNames[i];
+		qubit_index_t	bit = qc_config.lookup_byName(bitName);
+
+		// A control can't also be an operand (or another control), since the operation
+		// must leave its controls alone.
+		bool	reused = (find(cur_op.operands.begin(), cur_op.operands.end(), bit) != cur_op.operands.end())
+					  || (find(cur_op.controls.begin(), cur_op.controls.end(), bit) != cur_op.controls.end());
+		if (reused) {
+			cout << "SEQCSim::read_controls(): Error! Control bit " << bitName << " of operation #" << op_index << " is used more than once.\n";
+			exit(1);
+		}
+
+		if (!negative) cur_op.control_values |= ((size_t)1 << i);
+		cur_op.controls.push_back(bit);
+	}
+
+	if (ns_debug::trace && !controlNames.empty()) {
+		cout << "SEQCSim::read_controls(): Operation #" << op_index << " has " << cur_op.controls.size() << " controls.\n";
+	}
+}
+
+// Find the ID of the operator with the given name, for operation number op_index.  If it isn't
+// in the operator library, but it's a parametric operator specification, like "cPhase(k=5)",
+// generate it now, and add it to the list of operators, so that any later uses of it get shared.
+// (See Operator::initFromSpec().)  A name ending in "^-1" means the inverse (the conjugate
+// transpose) of the operator named by the rest of it, which is generated the same way, unless
+// that operator is its own inverse (like H or cNOT), in which case it's simply used again.
+
+operator_index_t SEQCSim::find_operator(const string& opName, operation_index_t op_index) {
+	for (operator_index_t i = 0;  i < operators.size();  i++) {
+		if (operators[i].name == opName) {
+			if (ns_debug::trace) cout << "SEQCSim::find_operator(): The operator ID #of the operator name is " << operators[i].id << ".\n";
+			return operators[i].id;
+		}
+	}
+
+	bool				inverse = (opName.size() > 3 && opName.compare(opName.size() - 3, 3, "^-1") == 0);
+	operand_index_t		inv_arity = 0;
+	vector<Complex>		inv_elems;
+
+	if (inverse) {
+		operator_index_t	base_id = find_operator(opName.substr(0, opName.size() - 3), op_index);
+		Operator&			base = operators[base_id];
+		size_t				rank = base.U.rank();
+		vector<Complex>		elems(rank*rank);
+		inv_elems.resize(rank*rank);
+		for (size_t r = 0;  r < rank;  r++) {
+			for (size_t c = 0;  c < rank;  c++) {
+				Complex		elem = base.U.rows[c][r];
+				inv_elems[r*rank + c] = Complex(elem.R, -elem.I);
+				elems[r*rank + c] = base.U.rows[r][c];
+			}
+		}
+		if (ns_opmatrix::equal(elems, inv_elems)) return base_id;
+		inv_arity = base.arity;
+	} else if (opName.find('(') == string::npos) {
+		cout << "SEQCSim::find_operator(): Error! Operator name \"" << opName << "\" is not defined.\n";
+		exit(1);
+	}
+
+	operators.resize(operators.size() + 1);
+	Operator&	new_opr = operators.back();
+	new_opr.id = operators.size() - 1;
+	if (inverse) {
+		new_opr.initFromElements(opName, inv_arity, inv_elems);
+	} else if (!new_opr.initFromSpec(opName)) {
+		cout << "SEQCSim::find_operator(): Error! Can't generate operator \"" << opName << "\" for operation #" << op_index << ".\n";
+		exit(1);
+	}
+	if (ns_debug::trace) cout << "SEQCSim::find_operator(): Generated operator " << new_opr << ".\n";
+	return new_opr.id;
+}
+
+// Set up operation number op_index in opn_seq from the given statement, which is expected to
+// be "apply <type> operator <opName> to bits <bitName1>, <bitName2>, ...", where <type> is
+// "unary", "binary", "ternary", "quaternary", or "n-ary", and there may be any number of operand
+// bits.  Alternatively, it may be "apply function <funcName> to registers <regName1>, ...".
+// Either kind may be followed by "controlled by <bitName1>, !<bitName2>, ...", giving control
+// bits (see Operation.h).  (In qopseq.txt, the statement may be preceded by "operation #0:",
+// which read_statements() has already removed.)
+
+void SEQCSim::read_operation(operation_index_t op_index, const string& statement) {
+	if (ns_debug::trace) cout << "SEQCSim::read_operation(): Operation #" << op_index << " is [" << statement << "].\n";
+
+	istringstream istrOperationLine(statement);
+	string ignore1, opType, ignore2, opName, ignore3, ignore4;
+	Operation& cur_op = opn_seq.at(op_index);
+
+	// Parse the statement as follows:
+	//                   apply      unary     operator   H         to         bits
+	istrOperationLine >> ignore1 >> opType;
+	if (opType == "function") {
+		//                   modexp_7_15  to         registers
+		istrOperationLine >> opName >> ignore3 >> ignore4;
+	} else {
+		istrOperationLine >> ignore2 >> opName >> ignore3 >> ignore4;
+	}
+	
+	// The rest of the line is a comma-separated list of operand names, optionally followed
+	// by "controlled by" and a comma-separated list of control bit names.
+	string			restOfLine, controlList;
+	getline(istrOperationLine, restOfLine);
+	size_t			controlsAt = restOfLine.find(" controlled by ");
+	if (controlsAt != string::npos) {
+		controlList = restOfLine.substr(controlsAt + string(" controlled by ").size());
+		restOfLine.erase(controlsAt);
+	}
+	vector<string>	operandNames, controlNames;
+	ns_subcircuits::split_names(restOfLine, operandNames);
+	ns_subcircuits::split_names(controlList, controlNames);
+	string			bitName;
+
+	// A functional operation gets handled separately (see read_function_opn()).
+	if (opType == "function") {
+		read_function_opn(op_index, opName, operandNames);
+		read_controls(op_index, controlNames);
+		return;
+	}
+
+	// Look up the operand bits' addresses, and append them to the operation's operand list.
+	cur_op.operands.clear();
+	for (size_t name_i = 0;  name_i < operandNames.size();  name_i++) {
+		bitName = operandNames[name_i];
+		cur_op.operands.push_back(qc_config.lookup_byName(bitName));
+
+		if (ns_debug::trace) cout << "SEQCSim::read_operation(): The qubit address of operand #" << cur_op.operands.size()-1
+								  << " (" << bitName << ") is " << cur_op.operands.back() << ".\n";
+	}
+
+	// If the operation type word names a specific arity, make sure it matches the number of operands given.
+	size_t	typeArity = 0;		// 0 means the type word doesn't say ("n-ary").
+	if		(opType == "unary")			typeArity = 1;
+	else if (opType == "binary")		typeArity = 2;
+	else if (opType == "ternary")		typeArity = 3;
+	else if (opType == "quaternary")	typeArity = 4;
+	else if (opType != "n-ary") {
+		cout << "SEQCSim::read_operation(): Error! Operation #" << op_index << " has unknown type \"" << opType << "\".\n";
+		exit(1);
+	}
+	if (typeArity != 0 && typeArity != cur_op.operands.size()) {
+		cout << "SEQCSim::read_operation(): Error! Operation #" << op_index << " is " << opType << ", but has "
+			 << cur_op.operands.size() << " operands.\n";
+		exit(1);
+	}
+
+	// Look up the ID number of this operation's operator from its name.
+	cur_op.operator_id = find_operator(opName, op_index);
+
+	// The number of operands must match the arity of the operator.
+	if (cur_op.operands.size() != operators[cur_op.operator_id].arity) {
+		cout << "SEQCSim::read_operation(): Error! Operator " << opName << " takes " << (int)operators[cur_op.operator_id].arity
+			 << " operands, but operation #" << op_index << " gives it " << cur_op.operands.size() << ".\n";
+		exit(1);
+	}
+
+	if (ns_debug::trace) cout << "SEQCSim::read_operation(): Our current operation number is just " << op_index << ".\n";
+
+	// This next loop reverses the operand order for purposes of internal storage
+	// because we are assuming that operand bits are given in big-endian order
+	// where the most significant bit (with respect to matrix rank ordering) is 
+	// first.  Thus, for example, in cNOT(a,b), a is the control bit, and is 
+	// also the most-significant bit with respect to the ordering of matrix 
+	// rows and columns, so that the operand matrix looks like this:
+	//
+	//    0  1  2  3 <- columns
+	//   00 01 10 11
+	// [(1, 0, 0, 0);   (row 0=00)
+	//  (0, 1, 0, 0);   (row 1=01)
+	//  (0, 0, 0, 1);   (row 2=10)
+	//  (0, 0, 1, 0)]   (row 3=11)
+
+	for (operand_index_t	early_opd_idx = 0;
+							early_opd_idx < (cur_op.operands.size() >> 1);	// floor(size/2)
+							early_opd_idx++) {
+
+		operand_index_t		late_opd_idx = cur_op.operands.size() - 1 - early_opd_idx;
+
+		qubit_index_t		early_opd = cur_op.operands.at(early_opd_idx);
+
+		cur_op.operands.at(early_opd_idx) = cur_op.operands.at(late_opd_idx);
+		cur_op.operands.at(late_opd_idx)  = early_opd;
+	}							
+
+	read_controls(op_index, controlNames);
+}
+
 void SEQCSim::read_opseq() {
 	//bool pushed_trace = ns_debug::trace; ns_debug::trace=false;
 
@@ -138,107 +563,60 @@ void SEQCSim::read_opseq() {
 	istr >> ignored >> nOperations;
 	if (ns_debug::trace) cout << "SEQCSim::read_opseq(): Parsed it into the ignored word [" << ignored << "] and the number " << nOperations << ".\n";
 
-	// Go ahead and resize the vector of operations to be the appropriate size.
-	opn_seq.resize(nOperations);
-	if (ns_debug::trace) cout << "SEQCSim::read_opseq(): We're now expecting to read " << opn_seq.size() << " operations.\n";
-
-	// OK, now we're going to expect that many operations to actually be defined.
-	for (operation_index_t	op_index = 0;
-							op_index < nOperations;
-							op_index++) 
-	{
-
-		if (ns_debug::trace) cout << "SEQCSim::read_opseq(): Getting ready to read operation number " << op_index << "...\n";
-
-		// Get the next non-comment line, expected to be "operation #0: apply binary/unary operator <opName> to bits <bitName1>, <bitName2>"
-		auto_ptr<string>	operationIdxLine = operationReader.getLine_ignoreComments();
-		if (ns_debug::trace) cout << "SEQCSim::read_opseq(): Got the line: [" << *operationIdxLine << "].\n";
-		
-		if (ns_debug::trace) cout << "SEQCSim::read_opseq(): We expect that it has the operation number, but we're ignoring it.\n";
-
-		istringstream istrOperationLine(*operationIdxLine);
-		string ignore1, ignore2, ignore3, opType, ignore4, opName, ignore5, ignore6, bitName1, bitName2;
-		Operation& cur_op = opn_seq.at(op_index);
-
-		// Parse the operation line as follows:
-		//                   Operation  #0:        apply      unary     operator   H         to         bits
-		istrOperationLine >> ignore1 >> ignore2 >> ignore3 >> opType >> ignore4 >> opName >> ignore5 >> ignore6;
-		
-		// Get the name of the first bit.
-		getline(istrOperationLine, bitName1, ',');
-		bitName1 = bitName1.substr(1);
-
-		if (ns_debug::trace) cout << "SEQCSim::read_opseq(): The first operand is " << bitName1 << ".\n";
-
-		cur_op.operands.resize(1);	// Make sure the operation has room for at least one operand.
-		
-		// Set the first operand of the current operation to the address of the first bit.
-		cur_op.operands[0] = qc_config.lookup_byName(bitName1);
+	// Now read the rest of the file's statements.  Most files just list the operations, one per
+	// line, but there may also be subcircuit definitions, loops and calls (see Subcircuit.h),
+	// which get expanded here, so that opn_seq ends up holding the whole sequence of operations.
+	vector<string>	statements;
+	read_statements(operationReader, statements);
+
+	map<string, long long>	no_values;
+	map<string, string>		no_names;
+	expand_statements(statements, 0, statements.size(), no_values, no_names, 0);
+	expanded_calls.clear();
+	for (size_t i = 0;  i < subcircuit_instances.size();  i++) {
+		SubcircuitInstance&	inst = subcircuit_instances[i];
+		inst.signature = ns_subcircuits::signature_of(opn_seq, inst.first, inst.end);
+	}
 
-		if (ns_debug::trace) cout << "SEQCSim::read_opseq(): The qubit address of the first operand is " << cur_op.operands[0] << ".\n";
+	if (opn_seq.size() != nOperations) {
+		cout << "SEQCSim::read_opseq(): Note: The file's header says there are " << nOperations
+			 << " operations, but it expands to " << opn_seq.size() << ".\n";
+	}
+	if (ns_debug::trace) cout << "SEQCSim::read_opseq(): Read " << opn_seq.size() << " operations, in "
+							  << subcircuit_instances.size() << " subcircuit instances and otherwise.\n";
+	//ns_debug::trace=pushed_trace;
+}
 
-		// If the operation type is binary,
-		if(opType == "binary") {
-			// Resize the current operation's operand list to be size 2.
-			cur_op.operands.resize(2);
-			
-			// Read the name of the second operand bit.
-			istrOperationLine >> bitName2;
 
-			// Look up its bit address and store it as this operator's 2nd operand.
-			cur_op.operands[1] = qc_config.lookup_byName(bitName2);
+// Set the named bit, or named bit array, with the given name in the given state to the
+// given value, as in a "name = value" line of qinput.txt.  Returns false if there's no
+// bit or bit array with that name (which read_input() just ignores).
 
-			if (ns_debug::trace) cout << "SEQCSim::read_opseq(): The qubit address of the second operand is " << cur_op.operands[1] << ".\n";
+bool SEQCSim::assign_named_value(State& state, const string& name, unsigned int value) {
+	for(unsigned int i = 0; i < this->qc_config.nNamedBits; i++)
+	{
+		if(this->qc_config.namedBits[i].name == name)
+		{
+			state[this->qc_config.namedBits[i].address] = (value>0?1:0) ;
+			return true;
 		}
+	}
 
-		// Look up the ID number of this operation's operator from its name.
-		cur_op.operator_id = operators.size();
-		for(operator_index_t i = 0; i < operators.size(); i++)
+	for(unsigned int i = 0; i < this->qc_config.nNamedBitArrays; i++)
+	{
+		if(this->qc_config.namedBitArrays[i].name == name)
 		{
-			if(operators[i].name == opName)
+			for(unsigned int ii = 0; ii < this->qc_config.namedBitArrays[i].length; ii++)
 			{
-				cur_op.operator_id = operators[i].id;
-				if (ns_debug::trace) cout << "SEQCSim::read_opseq(): The operator ID #of the operator name is " << cur_op.operator_id << ".\n";
-				break;
+				unsigned int mask = 1 << ii;
+				state[this->qc_config.namedBitArrays[i].baseAddress + ii] = ((value & mask) > 0 ? 1 : 0);
 			}
+			return true;
 		}
-		if (cur_op.operator_id == operators.size()) {
-			cout << "SEQCSim::read_opseq(): Error! Operator name \"" << opName << "\" is not defined.\n";
-			exit(1);
-		}
-
-		if (ns_debug::trace) cout << "SEQCSim::read_opseq(): Our current operation number is just " << op_index << ".\n";
-
-		// This next loop reverses the operand order for purposes of internal storage
-		// because we are assuming that operand bits are given in big-endian order
-		// where the most significant bit (with respect to matrix rank ordering) is 
-		// first.  Thus, for example, in cNOT(a,b), a is the control bit, and is 
-		// also the most-significant bit with respect to the ordering of matrix 
-		// rows and columns, so that the operand matrix looks like this:
-		//
-		//    0  1  2  3 <- columns
-		//   00 01 10 11
-		// [(1, 0, 0, 0);   (row 0=00)
-		//  (0, 1, 0, 0);   (row 1=01)
-		//  (0, 0, 0, 1);   (row 2=10)
-		//  (0, 0, 1, 0)]   (row 3=11)
-
-		for (operand_index_t	early_opd_idx = 0;
-								early_opd_idx < (cur_op.operands.size() >> 1);	// floor(size/2)
-								early_opd_idx++) {
-
-			operand_index_t		late_opd_idx = cur_op.operands.size() - 1 - early_opd_idx;
-
-			qubit_index_t		early_opd = cur_op.operands.at(early_opd_idx);
-
-			cur_op.operands.at(early_opd_idx) = cur_op.operands.at(late_opd_idx);
-			cur_op.operands.at(late_opd_idx)  = early_opd;
-		}							
 	}
-	//ns_debug::trace=pushed_trace;
+	return false;
 }
 
-
 void SEQCSim::read_input() {
 	
 	if (ns_debug::trace) cout << "SEQCSim::read_input(): ..\n";
@@ -273,36 +651,325 @@ void SEQCSim::read_input() {
 		istringstream istr(*contentLine);	// Make an input string-stream out of it.
 		istr >> name >> equal_sign >> value;
 		
-		for(unsigned int i = 0; i < this->qc_config.nNamedBits; i++)
-		{
-			//NamedBit &curentNamedBit = this->qc_config. namedBits.at(nNamedBits-1);
-			if(this->qc_config.namedBits[i].name == name)
-			{
-				this->input_state[this->qc_config.namedBits[i].address] = (value>0?1:0) ;
-				break;
+		assign_named_value(input_state, name, value);
+	}while(!inputReader.eof());
+
+	if (ns_debug::trace) {
+		cout << "SEQCSim::read_input():  Finished reading the input state.  It is:\n\t"
+			<< input_state << ".\n";
+	}
+}
+
+// Decide which simulation engine to use.  By default ("option: engine path"), it's the
+// space-efficient path-integral engine that the rest of this file implements.  "option:
+// engine statevector" selects the state-vector engine in StateVector.cpp instead, as long
+// as the state vector fits in its memory budget; otherwise we stay with the path integral.
+// "option: engine sparse" selects the sparse engine in Sparse.cpp, which can only tell
+// whether it fits once it's running, so it falls back to the path integral itself.
+// "option: engine hybrid" selects the hybrid engine in Hybrid.cpp, if there's a suitable
+// partition of the qubits (and it too may fall back while running).  "option: engine
+// phasepoly" selects the phase-polynomial engine in PhasePoly.cpp, which falls back if the
+// circuit doesn't compile, or leaves too many paths.  "option: engine tensornet" keeps the
+// path-integral engine, but has recalc_amplitude() contract a tensor network (see
+// TensorNetwork.h) instead of recursing, as long as every operation is small enough.
+// "option: engine mps" selects the matrix-product-state engine in MatrixProductState.cpp,
+// which is approximate if its bond dimension is too small (and reports the error).
+// "option: engine dd" selects the decision-diagram engine in DecisionDiagram.cpp, which
+// falls back if the diagram grows too big.  Finally, "option: engine auto" estimates what
+// each engine would cost, and picks the cheapest (see CostModel.h).
+
+void SEQCSim::choose_engine() {
+	string	engine_option = qc_config.option_string("engine", "path");
+	string	why;
+
+	find_cost_bounds();
+	if (engine_option == "auto") {
+		engine_option = choose_engine_automatically();
+	} else if (qc_config.option_flag("cost_report", false)) {
+		vector<EngineEstimate>	estimates;
+		estimate_costs(estimates);
+		report_costs(estimates);
+	}
+
+	if (engine_option == "path") {
+		engine = ENGINE_PATH_INTEGRAL;
+	} else if (engine_option == "statevector") {
+		if (state_vector_fits(why)) {
+			engine = ENGINE_STATE_VECTOR;
+			cout << "SEQCSim::choose_engine(): Using the state-vector engine (" << why << ").\n";
+		} else {
+			engine = ENGINE_PATH_INTEGRAL;
+			cout << "SEQCSim::choose_engine(): Using the path-integral engine, although the state-vector engine was requested ("
+				 << why << ").\n";
+		}
+	} else if (engine_option == "hybrid") {
+		if (choose_partition(why)) {
+			engine = ENGINE_HYBRID;
+			cout << "SEQCSim::choose_engine(): Using the hybrid engine (" << why << ").\n";
+		} else {
+			engine = ENGINE_PATH_INTEGRAL;
+			cout << "SEQCSim::choose_engine(): Using the path-integral engine, although the hybrid engine was requested ("
+				 << why << ").\n";
+		}
+	} else if (engine_option == "sparse") {
+		engine = ENGINE_SPARSE;
+		cout << "SEQCSim::choose_engine(): Using the sparse engine (with a fallback to the path-integral engine).\n";
+	} else if (engine_option == "tensornet") {
+		if (tensor_network_fits(why)) {
+			engine = ENGINE_TENSOR_NETWORK;
+			cout << "SEQCSim::choose_engine(): Using the tensor-network engine (" << why << ").\n";
+			if (arith_mode == ARITH_EXACT) {
+				arith_mode = ARITH_COMPLEX_DOUBLE;
+				cout << "SEQCSim::choose_engine(): Note: The tensor-network engine doesn't do exact arithmetic, "
+					 << "so it will use complex, double-precision arithmetic instead.\n";
+			}
+			build_tensor_network();
+		} else {
+			engine = ENGINE_PATH_INTEGRAL;
+			cout << "SEQCSim::choose_engine(): Using the path-integral engine, although the tensor-network engine was requested ("
+				 << why << ").\n";
+		}
+	} else if (engine_option == "mps") {
+		engine = ENGINE_MPS;
+		cout << "SEQCSim::choose_engine(): Using the matrix-product-state engine (with a fallback to the path-integral engine).\n";
+	} else if (engine_option == "dd") {
+		engine = ENGINE_DECISION_DIAGRAM;
+		cout << "SEQCSim::choose_engine(): Using the decision-diagram engine (with a fallback to the path-integral engine).\n";
+	} else if (engine_option == "phasepoly") {
+		engine = ENGINE_PHASE_POLY;
+		cout << "SEQCSim::choose_engine(): Using the phase-polynomial engine (with a fallback to the path-integral engine).\n";
+	} else {
+		cout << "SEQCSim::choose_engine(): Error!  Unknown engine option \"" << engine_option << "\".\n";
+		exit(1);
+	}
+}
+
+// Decide which kind of arithmetic the simulation engine should use.  By default
+// ("option: arithmetic auto"), we use real-only arithmetic if every operator matrix
+// used by the circuit, and the input amplitude, are purely real (as they are for
+// circuits built from e.g. Hadamard, NOT and CNOT gates), since then all amplitudes
+// along every path are real too.  This can be overridden with "option: arithmetic
+// complex" or "option: arithmetic real".  Independently, "option: precision float"
+// selects single-precision arithmetic (default is "double"), and "option:
+// compensated_summation on" turns on Kahan summation of path contributions.
+//
+// Finally, for very deep circuits, the individual path contributions can become too
+// small to represent as doubles.  We estimate the smallest one as the product of the
+// smallest-magnitude nonzero matrix element of each branching operation in the circuit,
+// and if that is below 2^extended_range_threshold_log2, we switch to extended-range
+// (ExtComplex) arithmetic.  "option: range extended" or "option: range normal"
+// overrides this estimate.  Extended-range arithmetic is always complex & double.
+//
+// "option: arithmetic exact" selects exact arithmetic (see CyclotomicAmp in Amplitude.h),
+// which is possible if every matrix element used, and the input amplitude, is of the
+// form w^p/sqrt(2)^h for w some power-of-2 root of unity (at most 64th).  This is never
+// chosen automatically, since it is usually slower than double-precision arithmetic.
+
+void SEQCSim::choose_arith_mode() {
+	if (ns_debug::trace) cout << "SEQCSim::choose_arith_mode(): Deciding what kind of arithmetic to use...\n";
+
+	string	arith_option	= qc_config.option_string("arithmetic", "auto");
+	string	prec_option		= qc_config.option_string("precision", "double");
+	compensated_sums		= qc_config.option_flag("compensated_summation", false);
+
+	if (prec_option != "double" && prec_option != "float") {
+		cout << "SEQCSim::choose_arith_mode(): Error!  Unknown precision option \"" << prec_option << "\".\n";
+		exit(1);
+	}
+	bool	single_prec = (prec_option == "float");
+
+	if (arith_option == "exact") {
+		// Check that every matrix element used (and the input amplitude) has an exact form,
+		// and find the smallest root of unity that all of them are powers of.
+		RootOfUnityElem	input_elem(input_state.amp);
+		if (!input_elem.recognized) {
+			cout << "SEQCSim::choose_arith_mode(): Error!  Exact arithmetic was requested, but the input amplitude has no exact form.\n";
+			exit(1);
+		}
+		exact_root_order = input_elem.min_root_order();
+		for (size_t i = 0;  i < opn_seq.size();  i++) {
+			if (opn_seq[i].isFunctional()) {
+				FunctionalOperator&	func = functions[opn_seq[i].function_id];
+				if (func.phase_root_order == 0) {
+					cout << "SEQCSim::choose_arith_mode(): Error!  Exact arithmetic was requested, but function "
+						 << func.name << " produces phases that aren't roots of unity of order 2^k.\n";
+					exit(1);
+				}
+				if (func.phase_root_order > exact_root_order) exact_root_order = func.phase_root_order;
+				continue;
+			}
+			Operator&	opr = operators.at(opn_seq[i].operator_id);
+			for (size_t b = 0;  b < opr.U.blocks.size();  b++) {
+				vector<RootOfUnityElem>&	elems = opr.U.blocks[b].elems_exact;
+				for (size_t k = 0;  k < elems.size();  k++) {
+					if (!elems[k].recognized) {
+						cout << "SEQCSim::choose_arith_mode(): Error!  Exact arithmetic was requested, but operator "
+							 << opr.name << " has a matrix element that isn't a root of unity over a power of sqrt(2).\n";
+						exit(1);
+					}
+					if (elems[k].min_root_order() > exact_root_order) exact_root_order = elems[k].min_root_order();
+				}
 			}
 		}
+		if (exact_root_order > ns_amplitude::max_exact_root_order) {
+			cout << "SEQCSim::choose_arith_mode(): Error!  Exact arithmetic was requested, but the circuit needs "
+				 << exact_root_order << "th roots of unity (at most " << ns_amplitude::max_exact_root_order << " are supported).\n";
+			exit(1);
+		}
+		arith_mode = ARITH_EXACT;
+		cout << "SEQCSim::choose_arith_mode(): Using exact arithmetic over the " << exact_root_order
+			 << "th roots of unity (exact arithmetic was requested).\n";
+		return;
+	}
 
-		for(unsigned int i = 0; i < this->qc_config.nNamedBitArrays; i++)
-		{
-			if(this->qc_config.namedBitArrays[i].name == name)
-			{
-				for(unsigned int ii = 0; ii < this->qc_config.namedBitArrays[i].length; ii++)
-				{
-					unsigned int mask = 1 << ii;
-					this->input_state[this->qc_config.namedBitArrays[i].baseAddress + ii] = ((value & mask) > 0 ? 1 : 0);
+	// Find out whether all the amplitudes the engine will see are real.  First the input amplitude...
+	bool	all_real = input_state.amp.isReal();
+	string	why_not_real = "the input amplitude is complex";
+
+	// ...and then every nonzero element of every operator that is actually used in the circuit.
+	for (size_t i = 0;  all_real && i < opn_seq.size();  i++) {
+		if (opn_seq[i].isFunctional()) {
+			FunctionalOperator&	func = functions[opn_seq[i].function_id];
+			if (!func.real_phases) {
+				all_real = false;
+				why_not_real = "function " + func.name + " produces complex phases";
+			}
+			continue;
+		}
+		Operator&	opr = operators.at(opn_seq[i].operator_id);
+		for (size_t b = 0;  all_real && b < opr.U.blocks.size();  b++) {
+			vector<double>&	elems_im = opr.U.blocks[b].elems_im;
+			for (size_t k = 0;  k < elems_im.size();  k++) {
+				if (elems_im[k] != 0) {
+					all_real = false;
+					why_not_real = "operator " + opr.name + " has a complex matrix element";
+					break;
 				}
-				break;
 			}
 		}
-	}while(!inputReader.eof());
+	}
+
+	bool	use_real;
+	if (arith_option == "auto") {
+		use_real = all_real;
+		arith_mode_reason = all_real ? "all operators used and the input amplitude are real"
+									 : why_not_real;
+	} else if (arith_option == "complex") {
+		use_real = false;
+		arith_mode_reason = "complex arithmetic was requested";
+	} else if (arith_option == "real") {
+		if (!all_real) {
+			cout << "SEQCSim::choose_arith_mode(): Error!  Real arithmetic was requested, but " << why_not_real << ".\n";
+			exit(1);
+		}
+		use_real = true;
+		arith_mode_reason = "real arithmetic was requested";
+	} else {
+		cout << "SEQCSim::choose_arith_mode(): Error!  Unknown arithmetic option \"" << arith_option << "\".\n";
+		exit(1);
+	}
+
+	if (use_real)	arith_mode = single_prec ? ARITH_REAL_FLOAT    : ARITH_REAL_DOUBLE;
+	else			arith_mode = single_prec ? ARITH_COMPLEX_FLOAT : ARITH_COMPLEX_DOUBLE;
 
+	if (single_prec) arith_mode_reason += "; single precision was requested";
+
+	// Now decide whether we need an extended exponent range.  Estimate (the log2 of) the smallest
+	// possible magnitude of any single path contribution.  Operations whose columns all have a
+	// single nonzero (unit-magnitude) element don't shrink it, so only branching ones count.
+
+	string	range_option = qc_config.option_string("range", "auto");
+	double	min_contrib_log2 = input_state.amp.isZero() ? 0 : log(input_state.amp.norm())/log(2.0);
+
+	for (size_t i = 0;  i < opn_seq.size();  i++) {
+		if (opn_seq[i].isFunctional()) continue;	// Functions never branch, so don't shrink it.
+		Operator&	opr = operators.at(opn_seq[i].operator_id);
+		double		min_elem_norm = 1;
+		for (size_t b = 0;  b < opr.U.blocks.size();  b++) {
+			MatrixBlock&	blk = opr.U.blocks[b];
+			if (blk.rank() < 2) continue;			// Not a branching block.
+			for (size_t k = 0;  k < blk.elems_re.size();  k++) {
+				double	n = Complex(blk.elems_re[k], blk.elems_im[k]).norm();
+				if (n != 0 && n < min_elem_norm) min_elem_norm = n;
+			}
+		}
+		min_contrib_log2 += log(min_elem_norm)/log(2.0);
+	}
+
+	bool	use_extended;
+	if (range_option == "auto") {
+		use_extended = (min_contrib_log2 < ns_SEQCSim::extended_range_threshold_log2);
+		if (use_extended) {
+			ostringstream	why;
+			why << "path contributions may be as small as 2^" << (int)min_contrib_log2;
+			arith_mode_reason = why.str();
+		}
+	} else if (range_option == "extended") {
+		use_extended = true;
+		arith_mode_reason = "extended range was requested";
+	} else if (range_option == "normal") {
+		use_extended = false;
+	} else {
+		cout << "SEQCSim::choose_arith_mode(): Error!  Unknown range option \"" << range_option << "\".\n";
+		exit(1);
+	}
+
+	if (use_extended) {
+		arith_mode = ARITH_COMPLEX_EXTENDED;
+		cout << "SEQCSim::choose_arith_mode(): Using complex, extended-range arithmetic"
+			 << (compensated_sums ? " with compensated summation" : "")
+			 << " (" << arith_mode_reason << ").\n";
+		if (single_prec || arith_option == "real") {
+			cout << "SEQCSim::choose_arith_mode(): Note: Extended-range arithmetic is always complex and double-precision, "
+				 << "so the " << (single_prec ? "single precision" : "") << (single_prec && arith_option == "real" ? " and " : "")
+				 << (arith_option == "real" ? "real arithmetic" : "") << " requested won't be used.\n";
+		}
+		return;
+	}
+
+	cout << "SEQCSim::choose_arith_mode(): Using " << (use_real ? "real" : "complex") << ", "
+		 << (single_prec ? "single" : "double") << "-precision arithmetic"
+		 << (compensated_sums ? " with compensated summation" : "")
+		 << " (" << arith_mode_reason << ").\n";
+}
+
+// Find the largest rank of any block of any operator used in the circuit.  This bounds
+// the length of every amplitude vector the engine needs (see ScratchArena.h).  With the
+// operand values handled as integers (see State::extractBits()), the maximum arity
+// doesn't need separate storage, but it is reported too since it bounds max_block_rank.
+
+void SEQCSim::find_scratch_sizes() {
+	max_block_rank = 1;
+	operand_index_t	max_arity = 0;
+	for (size_t i = 0;  i < opn_seq.size();  i++) {
+		if (opn_seq[i].isFunctional()) continue;	// Functions need no amplitude vectors.
+		Operator&	opr = operators.at(opn_seq[i].operator_id);
+		if (opr.arity > max_arity) max_arity = opr.arity;
+		for (size_t b = 0;  b < opr.U.blocks.size();  b++)
+			if (opr.U.blocks[b].rank() > max_block_rank) max_block_rank = opr.U.blocks[b].rank();
+	}
 	if (ns_debug::trace) {
-		cout << "SEQCSim::read_input():  Finished reading the input state.  It is:\n\t"
-			<< input_state << ".\n";
+		cout << "SEQCSim::find_scratch_sizes(): Max. arity is " << (int)max_arity << ", max. block rank is "
+			 << max_block_rank << ", max. recursion depth is " << opn_seq.size() << ".\n";
+	}
+}
+
+// Read the values (and widths) of the register operands of the given functional operation
+// out of the current state, and write them back into it.  Each register's qubits are listed
+// least significant bit first, as extractBits() and setBits() expect.
+
+void SEQCSim::load_registers(const Operation& opn, size_t* regs, size_t* widths) {
+	for (size_t r = 0;  r < opn.registers.size();  r++) {
+		regs[r]		= current_state.extractBits(opn.registers[r]);
+		widths[r]	= opn.registers[r].size();
 	}
 }
 
+void SEQCSim::store_registers(const Operation& opn, const size_t* regs) {
+	for (size_t r = 0;  r < opn.registers.size();  r++)
+		current_state.setBits(opn.registers[r], regs[r]);
+}
+
 // Returns TRUE iff the program_counter is already at the end of the quantum algorithm (operation sequence)
 // to be simulated.
 bool SEQCSim::done() {
@@ -315,7 +982,13 @@ bool SEQCSim::done() {
 	return isDone;	
 }
 
-void SEQCSim::Bohm_step_forwards() {
+// Take one step forwards.  The amplitude of the current state is passed in (and updated)
+// separately from current_state, since it is held in the engine's amplitude type Amp.
+// All the working vectors come from the given scratch arena, so that no heap memory
+// is allocated here (or in recalc_amplitude()).
+
+template<class Amp>
+void SEQCSim::Bohm_step_forwards(Amp& cur_amp, ScratchArena<Amp>& arena) {
 
 	// Algorithm outline:
 	//  -1. Make sure we're not already at the end of the program; if so exit.
@@ -346,6 +1019,40 @@ void SEQCSim::Bohm_step_forwards() {
 	Operation&		cur_opn = opn_seq.at(program_counter);
 
 	if (ns_debug::trace) cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") The operation to be applied is " << cur_opn << "\n";
+
+	// If the operation has controls, and they aren't all satisfied, it does nothing.
+	if (!cur_opn.controls.empty() && current_state.extractBits(cur_opn.controls) != cur_opn.control_values) {
+		if (ns_debug::trace) cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") Its controls aren't satisfied, so it's the identity here.\n";
+
+		cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ")\n   The new current state is " << current_state << ".\n";
+
+		program_counter ++;
+		top_PC = program_counter;
+		return;
+	}
+
+	// A functional operator never branches, so it's simply applied to the current state.
+	if (cur_opn.isFunctional()) {
+		FunctionalOperator&	func = functions[cur_opn.function_id];
+		size_t				regs[ns_functions::max_registers], widths[ns_functions::max_registers];
+
+		if (ns_debug::trace) cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") The function to be applied is " << func.name << "\n";
+
+		load_registers(cur_opn, regs, widths);
+		if (func.kind == FunctionalOperator::PHASE_ORACLE) {
+			cur_amp *= Amp(func.phase_of(regs, widths));
+		} else {
+			func.apply(regs, widths);
+			store_registers(cur_opn, regs);
+		}
+
+		current_state.amp = cur_amp.toComplex();
+		cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ")\n   The new current state is " << current_state << ".\n";
+
+		program_counter ++;
+		top_PC = program_counter;
+		return;
+	}
 	
 	// Identify which operator is to be applied in that particular operation.
 	Operator&		cur_opr = operators.at(cur_opn.operator_id);
@@ -365,6 +1072,23 @@ void SEQCSim::Bohm_step_forwards() {
 
 	if (ns_debug::trace) cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") The input index value is " << in_idx << ".\n";
 
+	// If the operator is monomial (one nonzero element per column; see Operator.h), we can
+	// just look up the output index and matrix element directly in its compact form.
+
+	if (cur_opr.isMonomial()) {
+		if (cur_opr.form == Operator::MONOMIAL) current_state.setBits(cur_opn.operands, cur_opr.mono_target[in_idx]);
+		if (!cur_opr.mono_unit[in_idx]) ns_SEQCSim::mul_mono_elem(cur_amp, cur_opr, in_idx);
+
+		if (ns_debug::trace) cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") The operator is monomial; the output index is " << cur_opr.mono_target[in_idx] << ".\n";
+
+		current_state.amp = cur_amp.toComplex();
+		cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ")\n   The new current state is " << current_state << ".\n";
+
+		program_counter ++;
+		top_PC = program_counter;
+		return;
+	}
+
 	// At this point, the bit-vector representation of the input index should be fully calculated.
 	// Now we can figure out what column of the operator matrix is indicated.
 
@@ -388,15 +1112,14 @@ void SEQCSim::Bohm_step_forwards() {
 		if (ns_debug::trace) cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") This vector lies on an axis of the vector space.\n";
 
 		// Get the index of the first nonzero element of the column vector, 
-		// as a bit-vector with 1 bit per operand of the current operator.
-		BitVector	out_idx_bv(arity);
-		out_idx_bv = cur_col.idx_1st_nz();	
+		// as an integer with 1 bit per operand of the current operator.
+		size_t		out_idx = cur_col.idx_1st_nz();	
 
-		if (ns_debug::trace) cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") The first nonzero vector element is at position " << (int)out_idx_bv << ".\n";
+		if (ns_debug::trace) cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") The first nonzero vector element is at position " << (int)out_idx << ".\n";
 
 		// In the current state, set the qubits corresponding to the current operation's operands
 		// to the bit-values corresponding to the unique output index in the current operator column.
-		current_state.setBits(cur_opn.operands, out_idx_bv);
+		current_state.setBits(cur_opn.operands, out_idx);
 
 		if (ns_debug::trace) cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") The new state is now: " << current_state << ".\n";
 
@@ -413,11 +1136,11 @@ void SEQCSim::Bohm_step_forwards() {
 				matrix_element.putTo(cout); cout << ".\n";
 			}
 
-			current_state.amp *= matrix_element;
+			cur_amp *= Amp(matrix_element);
 
 			if (ns_debug::trace) {
 				cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") The new state amplitude is ";
-				current_state.amp.putTo(cout); cout << ".\n";
+				cur_amp.putTo(cout); cout << ".\n";
 			}
 		}
 	} else { // THE HARD PART.
@@ -466,19 +1189,20 @@ void SEQCSim::Bohm_step_forwards() {
 		// 110 (row 6) with appropriate relative probabilities.
 		//---------------------------------------------------------------------------------
 
-		// First, figure out the rank of the submatrix corresponding to the current
-		// sector of the (possibly block-diagonal) current operator.  This is the 
-		// same as the number of nonzero elements in the current column.
+		// First, find the block of the (possibly block-diagonal) current operator
+		// that contains the current column.  Its rank is the same as the number of
+		// nonzero elements in the current column.
 
-		size_t				block_rank = cur_col.nNonzeros();
+		MatrixBlock&		cur_block = cur_opr.U.blocks.at(cur_opr.U.col_block.at(in_idx));
+		size_t				block_rank = cur_block.rank();
 		
-		if (ns_debug::trace) cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") The number of nonzero elements of the column is " << block_rank << ".\n";
+		if (ns_debug::trace) cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") The rank of the current block is " << block_rank << ".\n";
 
-		// Next, go ahead and collect a list of all the row indices in the current sector.
-		// This is the same as the list of indices, within the current column, of all its 
+		// Next, get the list of all the row indices in the current sector.  This is 
+		// the same as the list of indices, within the current column, of all its 
 		// nonzero elements.
 
-		vector<size_t>&		block_row_indices = cur_col.indices_of_nz_elems();
+		vector<size_t>&		block_row_indices = cur_block.row_indices;
 
 		if (ns_debug::trace) {
 			cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") The indices of the nonzero elements are: ";
@@ -489,18 +1213,10 @@ void SEQCSim::Bohm_step_forwards() {
 			cout << ".\n";
 		}
 		
-		// Next, get a hold of the index of one of the rows in the current block
-		// of the matrix.  This corresponds to the index, within the current column, of
-		// the first non-zero matrix element in that column.
-		
-		size_t  exemplar_row_index = block_row_indices.at(0); 
+		// Similarly, the list of all the columns that we need to care about is the
+		// list of the indices of the nonzero elements in any one row of the block.
 
-		if (ns_debug::trace) cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") An example row-index in the current block is: " << exemplar_row_index << ".\n";
-
-		// Now, to get a list of all the columns that we need to care about, ask that
-		// matrix row for the list of the indices of all its nonzero elements.
-
-		vector<size_t>&  block_column_indices = cur_opr.U.rows.at(exemplar_row_index).indices_of_nz_elems();
+		vector<size_t>&  block_column_indices = cur_block.col_indices;
 
 		if (ns_debug::trace) {
 			cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") The number of columns that we need to care about is: " << block_column_indices.size() << ".\n";
@@ -514,9 +1230,9 @@ void SEQCSim::Bohm_step_forwards() {
 		}
 
 		// Now we're ready to assemble the input vector of amplitudes to the block.
-		// We'll start with a null vector of appropriate dimensions (the block rank).
+		// Its storage comes from the scratch arena; only the first block_rank elements are used.
 
-		vector<Complex>  input_amplitudes(block_rank);
+		vector<Amp>&  input_amplitudes = arena.input_amps;
 
 		// Now we iterate through the column indices in the block.  For the one corresponding
 		// to the current column, we already have its amplitude (that of the current state),
@@ -542,12 +1258,12 @@ void SEQCSim::Bohm_step_forwards() {
 
 				if (ns_debug::trace) cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") That matches our current input index " << in_idx << ".\n";
 
-				input_amplitudes.at(blockrel_col_idx) = current_state.amp;
+				input_amplitudes.at(blockrel_col_idx) = cur_amp;
 
 				if (ns_debug::trace) {
 					cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") So the input amplitude for block column #" <<
 						blockrel_col_idx << " is ";
-					input_amplitudes.at(blockrel_col_idx).putTo(cout); cout << ".\n";
+					cur_amp.putTo(cout); cout << ".\n";
 				}
 
 			} else {
@@ -556,35 +1272,26 @@ void SEQCSim::Bohm_step_forwards() {
 				// calculate its amplitude.  This is the "hard" part of the whole algorithm.
 
 				// Outline:
-				// 1. Save current state's amplitude.
+				// 1. (No longer needed:  The current state's amplitude is held separately, in
+				//		cur_amp, so the recursion below cannot disturb it.)
 				// 2. Change operand bits in state to values at neighbor index.
 				// 3. Call a function to recursively calculate state amplitude via a backwards
 				//		depth-first traversal of the execution tree (Feynman path integral).
-				// 4. Take resultant amplitude and put it in input_amplitudes vector.
+				// 4. Take resultant amplitude and put it in the input amplitudes vector.
 				// 5. Restore operand bits of current state to what they were originally (in_idx).
-				// 6. Restore the amplitude of the current state to what it was originally.
-
-				// 1. Temporarily save the amplitude of the current state for later restoration.
-				Complex pushed_cur_state_amp = current_state.amp;
-
-				if (ns_debug::trace) {
-					cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") We temporarily push the current state amplitude of ";
-					pushed_cur_state_amp.putTo(cout); cout << " onto the stack.\n";
-				}
 
 				// 2. Temporarily change the current state's operand bits to the values at the neighbor index.
-				BitVector nbr_idx_bv(arity);
-				nbr_idx_bv = block_column_indices.at(blockrel_col_idx);	// Current neighbor's column index (operand configuration).
+				size_t nbr_idx = block_column_indices[blockrel_col_idx];	// Current neighbor's column index (operand configuration).
 				
 				if (ns_debug::trace) {
-					cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") The neighbor column's index is " << nbr_idx_bv << ".\n";
+					cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") The neighbor column's index is " << nbr_idx << ".\n";
 					cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") Now we're about to move to the neighbor state.\n";
 					cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") Before moving, our state is: " << current_state << ".\n";
 				}
 
 				current_state.setBits(
 					cur_opn.operands,		// Qubit addresses of the current op's operands.
-					nbr_idx_bv					// Neighbor's index, as a bit vector.
+					nbr_idx					// Neighbor's index, as an integer.
 				);
 
 				if (ns_debug::trace) {
@@ -599,7 +1306,7 @@ void SEQCSim::Bohm_step_forwards() {
 
 				if (ns_debug::trace) cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") Now we're going to recursively recalculate the amplitude of that neighbor state.\n";
 				recursion_depth = 1;  // About to go into 1st level of recursive algorithm
-				Complex neighbor_amp = recalc_amplitude();	// Recalculate the amplitude of the neighbor state.
+				Amp neighbor_amp = recalc_amplitude<Amp>(arena);	// Recalculate the amplitude of the neighbor state.
 				recursion_depth = 0;  // We're out of the recursion.
 
 				if (ns_debug::trace) {
@@ -607,7 +1314,7 @@ void SEQCSim::Bohm_step_forwards() {
 					neighbor_amp.putTo(cout); cout << " for the neighbor state.\n";
 				}
 
-				// 4. Stick the resulting amplitude into the input_amplitudes vector we're building up.
+				// 4. Stick the resulting amplitude into the input amplitudes vector we're building up.
 
 				input_amplitudes.at(blockrel_col_idx) = neighbor_amp;
 
@@ -616,23 +1323,13 @@ void SEQCSim::Bohm_step_forwards() {
 				if (ns_debug::trace) {
 					cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") Now we're going to return to the current state.\n";
 				}
-				BitVector in_idx_bv(arity);
-				in_idx_bv = in_idx;
 				current_state.setBits(
 					cur_opn.operands,	// Qubit addresses of the current op's operands.
-					in_idx_bv	// Input index to current operation - values of operands in current state. (We extracted these earlier.)
+					in_idx		// Input index to current operation - values of operands in current state. (We extracted these earlier.)
 				);
 				if (ns_debug::trace) {
 					cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") We're back at state: " << current_state << ".\n";
 				}
-
-				// 6. Restore the current_state object's amplitude to what it really is.
-				current_state.amp = pushed_cur_state_amp;
-
-				if (ns_debug::trace) {
-					cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") We restored the amplitude to: "; 
-					current_state.amp.putTo(cout); cout << ".\n";
-				}
 			} // end "else" case looking at neighbor state
 
 			if (ns_debug::trace) cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") Finished considering block column #" << blockrel_col_idx << ".\n";
@@ -640,80 +1337,26 @@ void SEQCSim::Bohm_step_forwards() {
 		} // end "for" loop iterating over columns of the current block
 		if (ns_debug::trace) cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") Finished going through the block columns.\n";
 
-		// Next, we have to extract the sub-matrix for the current block,
-		// then multiply the input_amplitudes vector by this sub-matrix,
-		// then select a new next state based on the resultant vector.
+		// Next, we have to multiply the input amplitudes vector by the sub-matrix for
+		// the current block, then select a new next state based on the resultant vector.
+		// The sub-matrix was already extracted (in split form) when the operator was
+		// loaded, so this is just a single call to block_matvec(), which for plain
+		// Complex amplitudes goes to the SIMD matrix-vector kernel.
 
-		// Rather than explicitly constructing the sub-matrix, we'll just
-		// specialize the matrix multiplication operation to a form that
-		// dynamically selects the appropriate subsets of rows and columns.
-		// This will avoid the overhead of constructing and deconstructing
-		// the sub-matrix.
-
-		if (ns_debug::trace) cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") Creating an uninitialized vector of " << block_rank << " output amplitudes.\n";
+		if (ns_debug::trace) cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") Multiplying the input amplitudes by the rank-" << block_rank << " block submatrix.\n";
 
 		// This will be the resultant vector of amplitudes for the different possible outputs in the block.		
-		vector<Complex>  output_amplitudes(block_rank);
-
-		if (ns_debug::trace) cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") Now we're about to go through the rows for the block matrix multiply.\n";
-		
-		// Iterate through the rows of the block, calculating the sum-of-products for each.
-		for (size_t  blockrel_row_i = 0;  blockrel_row_i < block_rank;  blockrel_row_i++) {
-
-			if (ns_debug::trace) cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") We're on block row #" << blockrel_row_i << ".\n";
-
-			// Find the row's index within the entire operator U matrix.
-			size_t  row_i = block_row_indices.at(blockrel_row_i);
-
-			if (ns_debug::trace) cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") The operator row index is " << row_i << ".\n";
-
-			output_amplitudes[blockrel_row_i] = 0;	// Initialize the output amplitude accumulator for this row to 0.
-			
-			if (ns_debug::trace) cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") Initialized that row's output amplitude to 0.\n";
-			
-			// Iterate through the columns of the block, adding each product into the accumulated sum.
-			for (size_t  blockrel_col_j = 0;  blockrel_col_j < block_rank;  blockrel_col_j++) {
-
-				if (ns_debug::trace) cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") Now looking at block column #" << blockrel_col_j << ".\n";
-
-				// Find the column's index within the entire operator U matrix.
-				size_t  col_j = block_column_indices.at(blockrel_col_j);
-
-				if (ns_debug::trace) cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") The operator column is " << col_j << ".\n";
-
-				// The amplitude of the current output state is incremented by the product of the
-				// matrix element at the present row-column intersection, and the amplitude of the
-				// current input state.
-
-				if (ns_debug::trace) {
-					cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") The input amplitude for column " << blockrel_col_j << " is ";
-					input_amplitudes[blockrel_col_j].putTo(cout); cout << ".\n";
-		
-					cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") The current matrix element is ";
-					cur_opr.U.rows.at(row_i)[col_j].putTo(cout); cout << ".\n";
-				}
+		vector<Amp>&  output_amplitudes = arena.output_amps;
 
-				// Here we compute the product of complex matrix element with a complex vector element.
-				// The "*" is supposed to be invoking the operator*() method on class Complex.
-				Complex product = static_cast<Complex>(cur_opr.U.rows[row_i][col_j]) 
-					* input_amplitudes[blockrel_col_j];
+		ns_SEQCSim::block_matvec(cur_block, arena, compensated_sums);
 
-				if (ns_debug::trace) {
-					cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") The product of matrix and vector elements is ";
-					product.putTo(cout); cout << ".\n";
-				}
-
-				output_amplitudes[blockrel_row_i] += product;
-
-				if (ns_debug::trace) {
-					cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") Now this row's output amplitude is ";
-					output_amplitudes[blockrel_row_i].putTo(cout);  cout << ".\n";
-				}
-
-			} // end "for" loop over block columns
-			if (ns_debug::trace) cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") Finished going through the columns for this row.\n";
-		} // end "for" loop over block rows
-		if (ns_debug::trace) cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") Finished going through the rows.\n";
+		for (size_t  blockrel_row_i = 0;  blockrel_row_i < block_rank;  blockrel_row_i++) {
+			if (ns_debug::trace) {
+				cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") The output amplitude for block row #" << blockrel_row_i << 
+					" (operator row " << block_row_indices.at(blockrel_row_i) << ") is ";
+				output_amplitudes[blockrel_row_i].putTo(cout);  cout << ".\n";
+			}
+		}
 
 		// At this point the vector of output amplitudes for the current block should be all calculated.
 		// Now we need to calculate their (normalized) probabilities.
@@ -722,23 +1365,26 @@ void SEQCSim::Bohm_step_forwards() {
 		//
 		// First, calculate the squared norms of the output amplitudes, which are proportional to
 		// the conditional probabilities of the output states, and their sum ("partition function").
+		// (With extended-range amplitudes, these are all scaled by a common factor to keep them
+		// within the range of a double; that factor cancels out in the normalization below.)
+
+		vector<double>& output_squared_norms = arena.sq_norms;
+		ns_SEQCSim::relative_squared_norms(output_amplitudes, block_rank, output_squared_norms);
 
-		vector<double> output_squared_norms(block_rank);
 		double Z = 0;  // "Partition function" - sum of (unnormalized) norms of output amplitudes
 		for (size_t  i = 0;  i < block_rank;  i++){
 			if (ns_debug::trace) {
 				cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") For element " << i << " the squared norm is ";
 			}
-			double squared_norm = output_amplitudes.at(i).squared_norm();  // Calculate the squared norm of the output amp.
+			double squared_norm = output_squared_norms.at(i);  // The (relative) squared norm of the output amp.
 			if (ns_debug::trace) cout << squared_norm;
-			output_squared_norms.at(i) = squared_norm;	// Store it for later use.
 			Z += squared_norm;	// Increment the partition function accumulator.
 			if (ns_debug::trace) cout << " and the new Z value is " << Z << ".\n";
 		}
 
 		if (ns_debug::trace) cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") Calculating the normalized output amplitudes.\n";
 		// Now calculate the normalized conditional probabilities (summing to 1.0).
-		vector<double> output_probs(block_rank);
+		vector<double>& output_probs = arena.probs;
 		for (size_t  i = 0;  i < block_rank;  i++){
 			output_probs[i] = output_squared_norms[i]/Z;
 			if (ns_debug::trace) cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ") For element " << i << " the output probability is " << output_probs[i] << ".\n";
@@ -789,11 +1435,9 @@ void SEQCSim::Bohm_step_forwards() {
 				// The below code is where FINALLY our record of the real "current" state is updated.
 
 				// Now, modify the current state's operand bits to correspond to that output index.
-				BitVector out_idx_bv(arity);
-				out_idx_bv = out_idx;
 				current_state.setBits(
 					cur_opn.operands,	// Qubit addresses of the current op's operands.
-					out_idx_bv		// Output state's column index (configuration of operand bits).
+					out_idx			// Output state's column index (configuration of operand bits).
 				);
 
 				if (ns_debug::trace) {
@@ -803,7 +1447,7 @@ void SEQCSim::Bohm_step_forwards() {
 				}
 
 				// The current state's amplitude is the one we calculated for this resultant state earlier.
-				current_state.amp = output_amplitudes.at(blockrel_output_i);
+				cur_amp = output_amplitudes.at(blockrel_output_i);
 
 				break;		// Terminate the loop early - no reason to continue.
 			} // End "if" statement selecting the output state.
@@ -813,6 +1457,7 @@ void SEQCSim::Bohm_step_forwards() {
 
 	} // end "else" case handling off-axis operator columns (with >1 nonzero entry)
 
+	current_state.amp = cur_amp.toComplex();		// Keep the printable copy of the amplitude up to date.
 	cout << "SEQCSim::Bohm_step_forwards(): (tPC=" << top_PC << ")\n   The new current state is " << current_state << ".\n";
 
 	if (ns_debug::trace) {
@@ -836,9 +1481,13 @@ static void showRD(int rd){
 // same function), and multiplying the resultant vector of amplitudes by the 
 // appropriate row of the operator matrix.  The base case is that, at time 0, the
 // amplitude is that of the input state if the current state is the same as the input
-// state, and 0 otherwise.
+// state, and 0 otherwise.  Unlike in earlier versions, the recalculated amplitude is
+// only returned, not stored in current_state.amp (which is just the printable copy of
+// the real current state's amplitude, maintained by Bohm_step_forwards()).  Each level
+// of the recursion keeps its predecessors' amplitudes in its own vector in the arena.
 
-Complex SEQCSim::recalc_amplitude() {
+template<class Amp>
+Amp SEQCSim::recalc_amplitude(ScratchArena<Amp>& arena) {
 
 	if (ns_debug::trace) {
 		cout << "SEQCSim::recalc_amplitude():   (tPC=" << top_PC << ") "; 
@@ -858,6 +1507,10 @@ Complex SEQCSim::recalc_amplitude() {
 	//		matrix elements.
 	// 6. The result is the current state's amplitude.
 
+	// With the tensor-network engine, there's no recursion; the amplitude comes straight from
+	// contracting the network for the operations before the program counter.
+	if (engine == ENGINE_TENSOR_NETWORK) return Amp(tensor_amplitude());
+
 	// 1. Base case.  If we're at the initial (number 0) step of the program, no operations
 	// have been performed yet, so we can't go backwards in the operation sequence any 
 	// farther.  So, just directly compare the current state to the initial state.  If 
@@ -880,7 +1533,20 @@ Complex SEQCSim::recalc_amplitude() {
 				cout << "(PC=" << program_counter << ") The current state doesn't match the input state.  Returning 0 amplitude.\n";
 			}
 		}
-		return (current_state == input_state) ? input_state.amp : 0;
+		return (current_state == input_state) ? Amp(input_state.amp) : Amp();
+	}
+
+	// If a subcircuit instance with a transfer table ends here, go back through all of it at once
+	// (unless the row needed isn't in the table, and the tables have used up their budget).
+	if (!instance_ending_at.empty() && instance_ending_at[program_counter] >= 0) {
+		const SubcircuitInstance&			inst = subcircuit_instances[instance_ending_at[program_counter]];
+		const vector< pair<size_t, Amp> >*	row = transfer_row<Amp>(inst, current_state.extractBits(inst.qubits), arena);
+		if (row != NULL) return recalc_through_subcircuit<Amp>(inst, *row, arena);
+	}
+
+	// Likewise, if a Clifford segment ends here, go back through all of it at once.
+	if (!segment_ending_at.empty() && segment_ending_at[program_counter] >= 0) {
+		return recalc_through_clifford<Amp>(clifford_segments[segment_ending_at[program_counter]], arena);
 	}
 	
 	// Recursive case.  We have to generate the possible predecessor states by applying
@@ -909,6 +1575,52 @@ Complex SEQCSim::recalc_amplitude() {
 		cout << "(PC=" << program_counter << ") We have to go back through operation " << cur_opn << ".\n";
 	}
 	
+	// If the operation's controls aren't all satisfied, it was the identity, and the current
+	// state is its own (only) predecessor.  (The operation never changes its controls.)
+	if (!cur_opn.controls.empty() && current_state.extractBits(cur_opn.controls) != cur_opn.control_values) {
+		if (ns_debug::trace) {
+			cout << "SEQCSim::recalc_amplitude():   (tPC=" << top_PC << ") "; 
+			showRD(recursion_depth); 
+			cout << "(PC=" << program_counter << ") Its controls aren't satisfied, so it was the identity here.\n";
+		}
+
+		recursion_depth ++;
+		Amp		amp = recalc_amplitude<Amp>(arena);
+		recursion_depth --;
+
+		program_counter++;
+		return amp;
+	}
+
+	// A functional operator has a single predecessor, which its inverse gives us directly.
+	if (cur_opn.isFunctional()) {
+		FunctionalOperator&	func = functions[cur_opn.function_id];
+		size_t				regs[ns_functions::max_registers], widths[ns_functions::max_registers];
+		size_t				saved_regs[ns_functions::max_registers];
+
+		if (ns_debug::trace) {
+			cout << "SEQCSim::recalc_amplitude():   (tPC=" << top_PC << ") "; 
+			showRD(recursion_depth); 
+			cout << "(PC=" << program_counter << ") The function applied in that operation was " << func.name << ".\n";
+		}
+
+		load_registers(cur_opn, regs, widths);
+		for (size_t r = 0;  r < cur_opn.registers.size();  r++) saved_regs[r] = regs[r];
+
+		func.apply_inverse(regs, widths);
+		store_registers(cur_opn, regs);
+
+		recursion_depth ++;
+		Amp		amp = recalc_amplitude<Amp>(arena);
+		recursion_depth --;
+
+		if (func.kind == FunctionalOperator::PHASE_ORACLE) amp *= Amp(func.phase_of(regs, widths));
+
+		store_registers(cur_opn, saved_regs);
+		program_counter++;
+		return amp;
+	}
+
 	// Identify which operator was supposed to have been applied in that particular operation.
 	Operator&  cur_opr = operators.at(cur_opn.operator_id);
 
@@ -930,6 +1642,29 @@ Complex SEQCSim::recalc_amplitude() {
 		cout << "(PC=" << program_counter << ") The output index after that operation was " << out_idx << ".\n";
 	}
 
+	// If the operator is monomial, there's a single predecessor, found in its compact form.
+	if (cur_opr.isMonomial()) {
+		size_t	pred_idx = cur_opr.mono_source[out_idx];
+
+		if (ns_debug::trace) {
+			cout << "SEQCSim::recalc_amplitude():   (tPC=" << top_PC << ") "; 
+			showRD(recursion_depth); 
+			cout << "(PC=" << program_counter << ") The operator is monomial; the predecessor index is " << pred_idx << ".\n";
+		}
+
+		if (cur_opr.form == Operator::MONOMIAL) current_state.setBits(cur_opn.operands, pred_idx);
+
+		recursion_depth ++;
+		Amp		amp = recalc_amplitude<Amp>(arena);
+		recursion_depth --;
+
+		if (!cur_opr.mono_unit[pred_idx]) ns_SEQCSim::mul_mono_elem(amp, cur_opr, pred_idx);
+
+		if (cur_opr.form == Operator::MONOMIAL) current_state.setBits(cur_opn.operands, out_idx);
+		program_counter++;
+		return amp;
+	}
+
 	// Now we can figure out what row of the operator matrix is indicated.
 
 	SmartComplexVector&		cur_row = cur_opr.U.rows.at(out_idx);
@@ -969,17 +1704,11 @@ Complex SEQCSim::recalc_amplitude() {
 		cout << ".\n";
 	}
 
-	// Next, we're going to loop through all those nonzero matrix elements, accumulating
-	// predecessor amplitude through each of them.  Initialize an amplitude accumulator to 0.
+	// Next, we're going to loop through all those nonzero matrix elements, collecting
+	// the amplitudes of the corresponding predecessor states into a batch, which we'll
+	// then weight & sum all at once.  (The batch lives in this recursion level's slot in the arena.)
 
-	Complex					amp_accum = 0;
-
-	if (ns_debug::trace) {
-		cout << "SEQCSim::recalc_amplitude():   (tPC=" << top_PC << ") "; 
-		showRD(recursion_depth); 
-		cout << "(PC=" << program_counter << ") Initialized accumulated amplitude from predecessors to ";
-		amp_accum.putTo(cout); cout << ".\n";
-	}
+	vector<Amp>&			pred_amps = arena.pred_amps[recursion_depth];
 
 	// Loop through the columns of the current block...
 	for (size_t blockrel_col_idx = 0;  blockrel_col_idx < block_rank;  blockrel_col_idx++) {
@@ -1006,11 +1735,9 @@ Complex SEQCSim::recalc_amplitude() {
 		}
 
 		// Temporarily change the current state's operand bits to the values for the predecessor.
-		BitVector		pred_idx_bv(cur_opr.arity);
-		pred_idx_bv = pred_idx;
 		current_state.setBits(
 					cur_opn.operands,	// Qubit addresses of the current op's operands.
-					pred_idx_bv	// Current predecessor's column index (operand configuration).
+					pred_idx	// Current predecessor's column index (operand configuration).
 		);
 
 		if (ns_debug::trace) {
@@ -1027,7 +1754,7 @@ Complex SEQCSim::recalc_amplitude() {
 
 		// Calculate the predecessor state's amplitude, by using this same procedure recursively.
 		recursion_depth ++; // to aid debugging
-		Complex			pred_amp = recalc_amplitude();
+		Amp				pred_amp = recalc_amplitude<Amp>(arena);
 		recursion_depth --; // to aid debugging
 
 		if (ns_debug::trace) {
@@ -1037,9 +1764,6 @@ Complex SEQCSim::recalc_amplitude() {
 			pred_amp.putTo(cout); cout << ".\n";
 		}
 		
-		// Add the predecessor state's amplitude, weighted by its matrix element, into the
-		// accumulated amplitude.
-
 		if (ns_debug::trace) {
 			cout << "SEQCSim::recalc_amplitude():   (tPC=" << top_PC << ") "; 
 			showRD(recursion_depth); 
@@ -1048,26 +1772,21 @@ Complex SEQCSim::recalc_amplitude() {
 			cout << ".\n";
 		}
 
-		// Compute product of predecessor amplitude and corresponding matrix element.
-		// The "*" here is supposed to be invoking the operator*(Complex) method on class Complex.
-		Complex product = pred_amp * Complex(cur_row[pred_idx]);
-		//Complex product = pred_amp.operator *(Complex(cur_row[pred_idx]));	// Use this form to suppress automatic conversions
-		
-		if (ns_debug::trace) {
-			cout << "SEQCSim::recalc_amplitude():   (tPC=" << top_PC << ") "; 
-			showRD(recursion_depth); 
-			cout << "(PC=" << program_counter << ") The matrix-vector element product is "; 
-			product.putTo(cout); cout << ".\n";
-		}
+		// Add the predecessor state's amplitude to the batch.
+		pred_amps.at(blockrel_col_idx) = pred_amp;
+	}
 
-		amp_accum.operator +=(product);
+	// Add up the predecessor states' amplitudes, each weighted by its matrix element.
+	// The nonzero elements of the current row are already cached, in the same order
+	// as the block column indices, so this is a single weighted sum (dot product).
 
-		if (ns_debug::trace) {
-			cout << "SEQCSim::recalc_amplitude():   (tPC=" << top_PC << ") "; 
-			showRD(recursion_depth); 
-			cout << "(PC=" << program_counter << ") The accumulated amplitude is ";
-			amp_accum.putTo(cout); cout << ".\n";
-		}
+	Amp						amp_accum = ns_SEQCSim::weighted_sum(cur_row, pred_amps, arena, compensated_sums);
+
+	if (ns_debug::trace) {
+		cout << "SEQCSim::recalc_amplitude():   (tPC=" << top_PC << ") "; 
+		showRD(recursion_depth); 
+		cout << "(PC=" << program_counter << ") The accumulated amplitude from the predecessors is ";
+		amp_accum.putTo(cout); cout << ".\n";
 	}
 
 	if (ns_debug::trace) {
@@ -1077,18 +1796,13 @@ Complex SEQCSim::recalc_amplitude() {
 	}
 
 	// Restore the current state's operand bits to the values at the previously-saved output index.
-	BitVector out_idx_bv(cur_opr.arity);
-	out_idx_bv = out_idx;
 	current_state.setBits(
 			cur_opn.operands,	// Qubit addresses of the current op's operands.
-			out_idx_bv			// Output index (operand bit values from the orig. current state).
+			out_idx				// Output index (operand bit values from the orig. current state).
 	);
 
-	// Set the current state's amplitude to the accumulated amplitude from the precedessors.
-	current_state.amp = amp_accum;
-
 	if (ns_debug::trace) {
-		cout << "SEQCSim::recalc_amplitude():   (tPC=" << top_PC << ") "; showRD(recursion_depth); cout << "(PC=" << program_counter << ") The successor state (with recalculated amplitude) has been restored: " << current_state << ".\n";
+		cout << "SEQCSim::recalc_amplitude():   (tPC=" << top_PC << ") "; showRD(recursion_depth); cout << "(PC=" << program_counter << ") The successor state has been restored: " << current_state << ".\n";
 		cout << "SEQCSim::recalc_amplitude():   (tPC=" << top_PC << ") "; showRD(recursion_depth); cout << "(PC=" << program_counter << ") Now re-incrementing the PC from " << program_counter << " to " << program_counter+1 << ".\n";
 	}
 
@@ -1099,11 +1813,173 @@ Complex SEQCSim::recalc_amplitude() {
 		cout << "SEQCSim::recalc_amplitude():   (tPC=" << top_PC << ") "; 
 		showRD(recursion_depth); 
 		cout << "(PC=" << program_counter << ") Returning the new current-state amplitude "; 
-		current_state.amp.putTo(cout); cout << ".\n";
+		amp_accum.putTo(cout); cout << ".\n";
+	}
+
+	// Return the recalculated amplitude of the current state.
+	return		amp_accum;
+}
+
+// Recalculate the amplitude of the current_state, where the program counter is at the end of
+// the given subcircuit instance (see Subcircuit.h).  Its predecessors at the start of the
+// instance, and their transfer amplitudes, are given by the row of its transfer table for
+// the current state, and the amplitude is the sum, over those predecessors, of their
+// (recursively recalculated) amplitudes, weighted by the transfer amplitudes.
+
+template<class Amp>
+Amp SEQCSim::recalc_through_subcircuit(const SubcircuitInstance& inst, const vector< pair<size_t, Amp> >& row, ScratchArena<Amp>& arena) {
+	size_t								out = current_state.extractBits(inst.qubits);
+	operation_index_t					saved_PC = program_counter;
+
+	if (ns_debug::trace) {
+		cout << "SEQCSim::recalc_through_subcircuit():   (tPC=" << top_PC << ") "; 
+		showRD(recursion_depth); 
+		cout << "(PC=" << program_counter << ") Going back through subcircuit instance " << inst.name
+			 << " to PC value " << inst.first << ", with " << row.size() << " predecessors.\n";
+	}
+
+	AmpAccumulator<Amp>	accum(compensated_sums);
+	program_counter = inst.first;
+	for (size_t k = 0;  k < row.size();  k++) {
+		current_state.setBits(inst.qubits, row[k].first);
+		recursion_depth ++;
+		Amp		pred_amp = recalc_amplitude<Amp>(arena);
+		recursion_depth --;
+		accum.add(pred_amp * row[k].second);
+	}
+	current_state.setBits(inst.qubits, out);
+	program_counter = saved_PC;
+	return accum.value();
+}
+
+// Recalculate the amplitude of the current_state, where the program counter is at the end of
+// the given Clifford segment (see Clifford.h).  Applying the inverse of the segment's gates
+// to the current values of its qubits gives a stabilizer state, whose terms are exactly the
+// predecessors at the start of the segment, with the conjugates of their transfer amplitudes.
+
+template<class Amp>
+Amp SEQCSim::recalc_through_clifford(const CliffordSegment& seg, ScratchArena<Amp>& arena) {
+	size_t					out = current_state.extractBits(seg.qubits);
+	ns_clifford::AffineState	st(out);
+	operation_index_t		saved_PC = program_counter;
+
+	for (size_t g = seg.gates.size();  g-- > 0;  ) {
+		const ns_clifford::Gate&	gate = seg.gates[g];
+		switch (gate.type) {
+		case ns_clifford::GATE_H:		st.apply_h(gate.a);  break;
+		case ns_clifford::GATE_S:		st.apply_s(gate.a);  st.apply_s(gate.a);  st.apply_s(gate.a);  break;	// S^-1 = S^3
+		case ns_clifford::GATE_CNOT:	st.apply_cnot(gate.a, gate.b);  break;
+		}
+	}
+
+	if (ns_debug::trace) {
+		cout << "SEQCSim::recalc_through_clifford():   (tPC=" << top_PC << ") "; 
+		showRD(recursion_depth); 
+		cout << "(PC=" << program_counter << ") Going back through a Clifford segment to PC value " << seg.first
+			 << ", with " << st.n_terms() << " predecessors.\n";
+	}
+
+	AmpAccumulator<Amp>	accum(compensated_sums);
+	program_counter = seg.first;
+	for (size_t k = 0;  k < st.n_terms();  k++) {
+		Complex		a;
+		size_t		in = st.term(k, a);
+		current_state.setBits(seg.qubits, in);
+		recursion_depth ++;
+		Amp		pred_amp = recalc_amplitude<Amp>(arena);
+		recursion_depth --;
+		accum.add(pred_amp * Amp(seg.phase * Complex(a.R, -a.I)));
+	}
+	current_state.setBits(seg.qubits, out);
+	program_counter = saved_PC;
+	return accum.value();
+}
+
+// Return the row of the given instance's transfer table for the given output values of its
+// qubits, working it out first if it isn't there yet.  This is done by setting the instance's
+// qubits in current_state to each of the values in a sparse vector, which starts out as just
+// "out" (with amplitude 1), and going backwards through the instance's operations, replacing
+// each value by its predecessors through the operation, weighted by the matrix elements (just
+// as recalc_amplitude() does), and adding up the weights of any that turn up more than once.
+// Afterwards, current_state is back the way it was.  Once the tables have outgrown their
+// budget (see Subcircuit.h), no more rows are worked out, and this returns NULL instead.
+// The allocations done while working out a row are counted separately, in the arena.
+
+template<class Amp>
+const vector< pair<size_t, Amp> >* SEQCSim::transfer_row(const SubcircuitInstance& inst, size_t out, ScratchArena<Amp>& arena) {
+	map<size_t, vector< pair<size_t, Amp> > >&	table = arena.transfers[inst.table_id];
+	typename map<size_t, vector< pair<size_t, Amp> > >::iterator	found = table.find(out);
+	if (found != table.end()) return &found->second;
+
+	if (arena.transfer_bytes >= arena.max_transfer_bytes) {
+		if (!arena.transfer_budget_noted) {
+			cout << "SEQCSim::transfer_row(): Note: The subcircuit transfer tables have used up their "
+				 << arena.max_transfer_bytes/(1024*1024) << " MB budget, so from now on, rows that aren't in them "
+				 << "are gone through one operation at a time.\n";
+			arena.transfer_budget_noted = true;
+		}
+		return NULL;
+	}
+	unsigned long		allocs_before = ns_alloc::allocation_count();
+
+	map<size_t, Amp>	cur_values,  pred_values;
+	cur_values[out] = Amp(Complex(1));
+
+	for (size_t pc = inst.end;  pc > inst.first;  pc--) {
+		Operation&	opn = opn_seq[pc-1];
+		pred_values.clear();
+
+		for (typename map<size_t, Amp>::iterator it = cur_values.begin();  it != cur_values.end();  it++) {
+			current_state.setBits(inst.qubits, it->first);
+
+			if (!opn.controls.empty() && current_state.extractBits(opn.controls) != opn.control_values) {
+				pred_values[it->first] += it->second;
+				continue;
+			}
+
+			if (opn.isFunctional()) {
+				FunctionalOperator&	func = functions[opn.function_id];
+				size_t				regs[ns_functions::max_registers], widths[ns_functions::max_registers];
+				load_registers(opn, regs, widths);
+				func.apply_inverse(regs, widths);
+				store_registers(opn, regs);
+				Amp		weight = it->second;
+				if (func.kind == FunctionalOperator::PHASE_ORACLE) weight *= Amp(func.phase_of(regs, widths));
+				pred_values[current_state.extractBits(inst.qubits)] += weight;
+				continue;
+			}
+
+			Operator&	opr = operators.at(opn.operator_id);
+			size_t		out_idx = current_state.extractBits(opn.operands);
+
+			if (opr.isMonomial()) {
+				size_t	pred_idx = opr.mono_source[out_idx];
+				if (opr.form == Operator::MONOMIAL) current_state.setBits(opn.operands, pred_idx);
+				Amp		weight = it->second;
+				if (!opr.mono_unit[pred_idx]) ns_SEQCSim::mul_mono_elem(weight, opr, pred_idx);
+				pred_values[current_state.extractBits(inst.qubits)] += weight;
+				continue;
+			}
+
+			SmartComplexVector&	opr_row = opr.U.rows.at(out_idx);
+			vector<size_t>&		col_indices = opr_row.indices_of_nz_elems();
+			for (size_t k = 0;  k < col_indices.size();  k++) {
+				current_state.setBits(opn.operands, col_indices[k]);
+				pred_values[current_state.extractBits(inst.qubits)] += it->second * Amp((Complex)opr_row[col_indices[k]]);
+			}
+		}
+		cur_values.swap(pred_values);
 	}
+	current_state.setBits(inst.qubits, out);
 
-	// Return the amplitude of the current state (not strictly needed, since it is stored in this object too).
-	return		current_state.amp;
+	// Paths that cancel out leave some values with an amplitude of exactly 0; those are left out.
+	vector< pair<size_t, Amp> >&	row = table[out];
+	for (typename map<size_t, Amp>::iterator it = cur_values.begin();  it != cur_values.end();  it++) {
+		if (!it->second.isZero()) row.push_back(*it);
+	}
+	arena.transfer_bytes += ns_subcircuits::bytes_per_row + row.capacity()*sizeof(pair<size_t, Amp>);
+	arena.transfer_allocations += ns_alloc::allocation_count() - allocs_before;
+	return &row;
 }
 
 SEQCSim::SEQCSim(void)
@@ -1117,43 +1993,176 @@ SEQCSim::SEQCSim(void)
 	read_config();			// Read the configuration file
 	read_opseq();			// (This routine still needs to be written.)
 	read_input();			// (This routine still needs to be written.)
+	prune_light_cone();		// If only some registers are measured, drop what can't affect them.
+	drop_small_phases();	// Optionally, drop rotations by very small angles (approximate QFT).
+	simplify_operations();	// Optionally, remove pairs of operations that cancel out.
+	schedule_operations();	// Optionally, reorder them to make the recursion cheaper.
+	fuse_operations();		// Optionally, merge runs of operations together.
+	index_subcircuits();	// Set up the transfer tables for the subcircuit instances that are left.
+	find_clifford_segments();	// Find the runs of Clifford operations the engine can skip over.
+	choose_arith_mode();	// Decide what kind of arithmetic the engine will use.
+	find_scratch_sizes();	// Work out how much working storage the engine will need.
+	choose_engine();		// Decide which simulation engine to use.
+
+	// Let the user know which SIMD instruction set the block kernels will be using on this CPU.
+	cout << "SEQCSim::SEQCSim(): The complex matrix-vector kernels are using "
+		 << ns_kernels::isa_name(ns_kernels::active_isa()) << " instructions.\n";
 }
 
-// Runs the entire quantum algorithm (starting from the beginning).
+// The key under which the current state is counted in the histogram of final states:  its
+// bits, or, if only some registers are being measured, just their values.
 
-void SEQCSim::run(void)
+string SEQCSim::final_state_key(void) {
+	ostringstream	final_bits;
+	if (measured_registers.empty()) {
+		current_state.bits.putTo(final_bits);
+	} else {
+		for (size_t m = 0;  m < measured_registers.size();  m++) {
+			final_bits << (m > 0 ? ", " : "") << qc_config.measuredNames[m] << " = "
+					   << current_state.extractBits(measured_registers[m]);
+		}
+	}
+	return final_bits.str();
+}
+
+// For the engines that work out the exact probability of each final state (or each value
+// of the measured registers), print the most likely ones, with their probabilities.
+// caller is the name of the method doing the reporting, for the messages.
+
+void SEQCSim::report_final_probabilities(const string& caller, const map<string, double>& probs) {
+	vector< pair<double, string> >	by_prob;
+	for (map<string, double>::const_iterator it = probs.begin();  it != probs.end();  it++) {
+		if (it->second < ns_SEQCSim::negligible_prob) continue;
+		by_prob.push_back(make_pair(-it->second, it->first));
+	}
+	sort(by_prob.begin(), by_prob.end());
+	cout << caller << ": " << by_prob.size() << " final states have nonzero probability";
+	if (by_prob.size() > ns_SEQCSim::max_listed) cout << "; the " << ns_SEQCSim::max_listed << " most likely are";
+	cout << ":\n";
+	for (size_t k = 0;  k < by_prob.size() && k < ns_SEQCSim::max_listed;  k++) {
+		cout << "   " << by_prob[k].second << " : " << -by_prob[k].first << "\n";
+	}
+}
+
+// Print the histogram of the final states over all the shots (if there was more than one).
+
+void SEQCSim::report_histogram(const string& caller, const map<string, unsigned long>& histogram, unsigned long n_shots) {
+	if (n_shots <= 1) return;
+	cout << caller << ": Histogram of final states over " << n_shots << " shots:\n";
+	for (map<string, unsigned long>::const_iterator it = histogram.begin();  it != histogram.end();  it++) {
+		cout << "   " << it->first << " : " << it->second << " (" << (double)it->second/n_shots << ")\n";
+	}
+}
+
+// Runs the simulation using amplitude type Amp.  The amplitude of the current state
+// is kept in cur_amp (in type Amp), and copied back into current_state.amp (as an
+// ordinary Complex) after every step for printing.
+//
+// If the configuration file says "option: shots N", the whole circuit is run N times
+// (with independent random choices), and a histogram of the final states is printed
+// at the end.  For each shot, we also report how many heap allocations were done in
+// the simulation loop; with the scratch arena allocated up front, this should be 0.
+// The allocations done filling in the subcircuit transfer tables (see Subcircuit.h)
+// are left out of that count, and reported separately.
+
+template<class Amp>
+void SEQCSim::run_with(void)
 {
-	if (ns_debug::trace) cout << "SEQCSim::run(): Resetting virtual quantum computer to prep it for running...\n";
+	ScratchArena<Amp>			arena(max_block_rank, opn_seq.size(), n_transfer_tables, transfer_budget_mb);	// All the engine's working storage.
+	unsigned long				n_shots = (unsigned long)qc_config.option_double("shots", 1);
+	map<string, unsigned long>	histogram;		// Number of shots ending in each final state.
 
-	// Reset the program counter to zero.
+	for (unsigned long shot = 1;  shot <= n_shots;  shot++) {
 
-	program_counter = 0;
-	
-	// Initialize some debugging variables.
-	top_PC = 0;		recursion_depth = 0;
-	
-	// Set the machine's current state equal to its input state.
+		// Reset the program counter to zero, and the machine's current state to its input state.
+		program_counter = 0;
+		top_PC = 0;		recursion_depth = 0;		// Initialize some debugging variables.
+		current_state = input_state;
 
-	current_state = input_state;
+		Amp		cur_amp(input_state.amp);		// Amplitude of the current state.
 
-	cout << "SEQCSim::run(): Initial state is " << current_state << ".\n";
+		// Until the program counter runs off the end of the circuit,
+		// take us forward through the program, one step at a time,
+		// using Bohm's interpretation (stochastic Monte Carlo sim).
 
-	// Until the program counter runs off the end of the circuit,
-	// take us forward through the program, one step at a time,
-	// using Bohm's interpretation (stochastic Monte Carlo sim).
+		if (ns_debug::trace) cout << "SEQCSim::run_with(): About to begin main loop iterating through quantum algorithm...\n";
 
-	if (ns_debug::trace) cout << "SEQCSim::run(): About to begin main loop iterating through quantum algorithm...\n";
+		unsigned long	allocs_before = ns_alloc::allocation_count();
+		unsigned long	transfer_allocs_before = arena.transfer_allocations;
+
+		// Until we reach the end of the program,
+		while (!done()) {
+			if (ns_debug::trace) cout << "SEQCSim::run_with():   We're not done yet, so let's take a step forwards...\n";
+			// Take a single randomized step forwards through the quantum
+			// algorithm.  NOTE: The method used here gets exponentially
+			// slower as we get farther and farther into the program.
+			// (frame_bounds says how much slower;  see CostModel.cpp.)
+			Bohm_step_forwards(cur_amp, arena);
+		}
 
-	// Until we reach the end of the program,
-	while (!done()) {
-		if (ns_debug::trace) cout << "SEQCSim::run():   We're not done yet, so let's take a step forwards...\n";
-		// Take a single randomized step forwards through the quantum
-		// algorithm.  NOTE: The method used here gets exponentially
-		// slower as we get farther and farther into the program.
-		Bohm_step_forwards();
+		unsigned long	transfer_allocs = arena.transfer_allocations - transfer_allocs_before;
+		unsigned long	allocs = ns_alloc::allocation_count() - allocs_before - transfer_allocs;
+
+		if (ns_debug::trace) cout << "SEQCSim::run_with(): Finished running the virtual quantum computer.\n";
+
+		cout << "SEQCSim::run_with(): Shot #" << shot << " ended in state " << current_state
+			 << ", with " << allocs << " heap allocations in the simulation loop";
+		if (transfer_allocs > 0) cout << " (plus " << transfer_allocs << " filling in subcircuit transfer tables)";
+		cout << ".\n";
+
+		// Record the final state in the histogram.
+		histogram[final_state_key()]++;
 	}
 
-	if (ns_debug::trace) cout << "SEQCSim::run(): Finished running the virtual quantum computer.\n";
+	report_histogram("SEQCSim::run_with()", histogram, n_shots);
+}
+
+// Runs the entire quantum algorithm (starting from the beginning).
+
+void SEQCSim::run(void)
+{
+	if (ns_debug::trace) cout << "SEQCSim::run(): Resetting virtual quantum computer to prep it for running...\n";
+
+	// An input sweep evaluates a whole file of input states instead (see InputSweep.cpp).
+	if (qc_config.option_flag("input_sweep", false)) {
+		run_input_sweep();
+		return;
+	}
+
+	cout << "SEQCSim::run(): Initial state is " << input_state << ".\n";
+
+	// If the whole state vector fits in memory, and that engine was chosen, use it instead.
+	if (engine == ENGINE_STATE_VECTOR) {
+		run_state_vector();
+		return;
+	}
+
+	// Likewise for the sparse, hybrid and phase-polynomial engines, unless the state grows too
+	// large for them (or the circuit has too many paths).
+	if (engine == ENGINE_SPARSE && run_sparse()) return;
+	if (engine == ENGINE_HYBRID && run_hybrid()) return;
+	if (engine == ENGINE_PHASE_POLY && run_phase_poly()) return;
+	if (engine == ENGINE_MPS && run_mps()) return;
+	if (engine == ENGINE_DECISION_DIAGRAM && run_dd()) return;
+
+	// Run the engine with the kind of arithmetic chosen by choose_arith_mode().  (run_with()
+	// resets the program counter and current state at the start of each shot.)
+
+	switch (arith_mode) {
+	case ARITH_COMPLEX_DOUBLE:	run_with<Complex>();	break;
+	case ARITH_REAL_DOUBLE:		run_with<RealD>();		break;
+	case ARITH_COMPLEX_FLOAT:	run_with<ComplexF>();	break;
+	case ARITH_REAL_FLOAT:		run_with<RealF>();		break;
+	case ARITH_COMPLEX_EXTENDED:	run_with<ExtComplex>();	break;
+	case ARITH_EXACT:
+		switch (exact_root_order) {
+		case 8:		run_with<CyclotomicAmp<4> >();		break;
+		case 16:	run_with<CyclotomicAmp<8> >();		break;
+		case 32:	run_with<CyclotomicAmp<16> >();		break;
+		case 64:	run_with<CyclotomicAmp<32> >();		break;
+		}
+		break;
+	}
 
 	// At this point, current_state contains the final "measured" 
 	// (i.e. fully classical) state of the quantum computer, and
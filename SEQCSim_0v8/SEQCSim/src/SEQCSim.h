@@ -25,16 +25,53 @@
 #pragma once
 
 #include <vector>			// We're using STL vectors instead of plain C++ arrays, for safety & flexibility.
+#include <map>				// STL map<> template.
 #include <random>			// For tr1::uniform_real.  TR1 (Tech. Report 1) is a forthcoming extension to the C++ standard.
 #include "Operator.h"		// Defines Operator class for quantum logic operators (gate types).
 #include "Configuration.h"	// Defines Configuration class for general configuration of quantum computer.
 #include "Operation.h"		// Defines Operation class, for quantum logic operations (gate instances).
+#include "FunctionalOperator.h"	// Defines FunctionalOperator class, for operators defined by code.
 #include "State.h"			// Defines State class for computational basis states.
+#include "Amplitude.h"		// Alternative amplitude types (real-only, single-precision) for the engine.
+#include "ScratchArena.h"	// Preallocated working storage for the engine.
+#include "Subcircuit.h"		// Subcircuits, and where they were called (SubcircuitInstance).
+#include "Clifford.h"		// Clifford segments of the circuit (CliffordSegment).
+#include "TensorNetwork.h"	// The tensor network for the tensor-network engine.
+#include "CostModel.h"		// Estimates of what each engine would cost (EngineEstimate).
+
+namespace ns_phasepoly { class PathSum; }	// The compiled circuit, for the phase-polynomial engine (see PhasePoly.cpp).
+namespace ns_sweep { class Row; }			// A row of the circuit's unitary, for input sweeps (see InputSweep.cpp).
 
 
 // Create a specialization of the uniform_real distribution class which we'll use.
 typedef  std::tr1::uniform_real<double>  uniform_double;
 
+// The kinds of arithmetic that the simulation engine can be run with.  Each one
+// corresponds to an instantiation of the engine's templated member functions
+// with one of the amplitude types from Amplitude.h.
+
+enum arith_mode_t {
+	ARITH_COMPLEX_DOUBLE,		// Complex, double precision (the Complex class).  The default.
+	ARITH_REAL_DOUBLE,			// Real-only, double precision (RealD).
+	ARITH_COMPLEX_FLOAT,		// Complex, single precision (ComplexF).
+	ARITH_REAL_FLOAT,			// Real-only, single precision (RealF).
+	ARITH_COMPLEX_EXTENDED,		// Complex, with an extended exponent range (ExtComplex), for very deep circuits.
+	ARITH_EXACT					// Exact, in Z[w]/sqrt(2)^h for w a root of unity (CyclotomicAmp).
+};
+
+// The simulation engines available.
+
+enum engine_t {
+	ENGINE_PATH_INTEGRAL,		// The space-efficient path-integral engine (Bohm_step_forwards() etc.).  The default.
+	ENGINE_STATE_VECTOR,		// The full state vector, for small numbers of qubits (see StateVector.cpp).
+	ENGINE_SPARSE,				// Just the nonzero amplitudes, for circuits with small support (see Sparse.cpp).
+	ENGINE_HYBRID,				// A state vector for each of two partitions of the qubits (see Hybrid.cpp).
+	ENGINE_PHASE_POLY,			// A sum over paths, compiled into a phase polynomial (see PhasePoly.cpp).
+	ENGINE_TENSOR_NETWORK,		// The path integral, but with amplitudes from tensor networks (see TensorNetwork.h).
+	ENGINE_MPS,					// A matrix product state, for circuits with little entanglement (see MatrixProductState.cpp).
+	ENGINE_DECISION_DIAGRAM		// A decision diagram with shared nodes, for structured states (see DecisionDiagram.cpp).
+};
+
 // Objects of the SEQCSim class hold all the information needed to simulate the execution
 // of a given quantum algorithm.
 
@@ -43,9 +80,29 @@ class SEQCSim {
 
 	vector<Operator>	operators;			// List of the available quantum logic operators.
 	Configuration		qc_config;			// General configuration of the quantum computer.
+	vector<FunctionalOperator>	functions;	// List of the functional operators used (see FunctionalOperator.h).
 	vector<Operation>	opn_seq;			// Sequence of quantum operators to be executed (quantum circuit, quantum algorithm).
+	map<string, Subcircuit>		subcircuits;			// The subcircuits defined in qopseq.txt (see Subcircuit.h).
+	vector<SubcircuitInstance>	subcircuit_instances;	// Where they were called, in opn_seq.
+	vector<int>			instance_ending_at;	// For each PC, the instance that ends just before it (to use its transfer table), or -1.
+	size_t				n_transfer_tables;	// Number of distinct transfer tables needed by those instances.
+	double				transfer_budget_mb;	// How much memory those tables may take up, altogether.
+	vector<CliffordSegment>	clifford_segments;	// The runs of Clifford operations in opn_seq (see Clifford.h).
+	vector<int>			segment_ending_at;	// For each PC, the segment that ends just before it, or -1.
+	vector< vector<qubit_index_t> >	measured_registers;	// Qubits of each register named in "measure:" (see LightCone.cpp).
 	State				input_state;		// The quantum computer is initialized in this computational basis state.
 
+	engine_t			engine;				// Which simulation engine to use.  Chosen at load time.
+	arith_mode_t		arith_mode;			// Which kind of arithmetic the engine will use.  Chosen at load time.
+	string				arith_mode_reason;	// Human-readable explanation of why that mode was chosen.
+	bool				compensated_sums;	// Use Kahan (compensated) summation when accumulating amplitudes?
+	int					exact_root_order;	// In ARITH_EXACT mode, the order N of the root of unity w needed.
+	size_t				max_block_rank;		// Largest rank of any operator block used.  Sizes the ScratchArena.
+	vector<char>		hybrid_side;		// For the hybrid engine, which partition (0 or 1) each qubit is in.
+	ns_tensornet::Network	tensor_net;		// For the tensor-network engine, the operations' tensors, and the plans so far.
+	vector<double>		frame_bounds;		// For each PC, a bound on the recursion frames recalc_amplitude() takes from there.
+	vector<double>		support_bounds;		// For each PC, a bound on the number of basis states with nonzero amplitudes.
+
 	// These data members are dynamically modified in the course of running the simulation.
 
 	operation_index_t	program_counter;	// Which operation in the quantum algorithm are we currently executing (or about to execute)?
@@ -64,6 +121,7 @@ private:
 
 	operation_index_t	top_PC;				// Remembers the original "topmost" PC as we are going into depths of the algorithm.  For debugging.
 	int					recursion_depth;	// How deep are we into the recursion in recalc_amplitude()
+	map<string, size_t>	expanded_calls;		// While reading opseq, the instance first expanded for each distinct call.
 
 
 	// Private member functions.
@@ -72,13 +130,96 @@ private:
 	void read_operators();
 	void read_config();
 	void read_opseq();
+	void read_operation(operation_index_t op_index, const string& statement);
+	operator_index_t find_operator(const string& opName, operation_index_t op_index);
+	void read_statements(FileReader& reader, vector<string>& statements);	// (These are in Subcircuit.cpp.)
+	void expand_statements(const vector<string>& statements, size_t first, size_t end,
+						   map<string, long long>& values, const map<string, string>& names, int depth);
+	void expand_call(const string& statement, map<string, long long>& values, const map<string, string>& names, int depth);
+	void invert_operations(size_t first, size_t end);
+	void index_subcircuits();		// Find the transfer tables the engine can use (see Subcircuit.h).
+	void find_clifford_segments();	// Find the runs of Clifford operations (see Clifford.cpp).
+	void read_function_opn(operation_index_t op_index, const string& funcName, vector<string>& regNames);
+	int find_function(const string& funcName, operation_index_t op_index);
+	void read_controls(operation_index_t op_index, vector<string>& controlNames);
+	void prune_light_cone();		// Drop operations that can't affect the measured qubits (see LightCone.cpp).
+	void find_measured_registers();
+	void drop_small_phases();		// Drop phase rotations by small angles (see Approximate.cpp).
+	void simplify_operations();		// Remove pairs of operations that cancel out (see Simplify.cpp).
+	bool operations_cancel(const Operation& first, const Operation& second);
+	bool is_branching(const Operation& opn);
+	void schedule_operations();		// Reorder commuting operations to reduce the recursion (see Schedule.cpp).
+	size_t branching_factor(const Operation& opn);
+	double recursion_cost_estimate(const vector<Operation>& seq);
+	void fuse_operations();			// Merge runs of operations into synthesized operators (see Fusion.cpp).
+	void write_circuit(const string& operatorsFilename, const string& opseqFilename);
 	void read_input();
-
-	// These are used during simulation.
+	bool assign_named_value(State& state, const string& name, unsigned int value);	// Set a bit or bit array, as in qinput.txt.
+	void choose_arith_mode();		// Decide what kind of arithmetic to use, based on the circuit & options.
+	void find_scratch_sizes();		// Find the sizes needed for the engine's ScratchArena.
+	void choose_engine();			// Decide which simulation engine to use.
+	bool state_vector_fits(string& why);	// Is the state-vector engine possible?  (See StateVector.cpp.)
+	bool choose_partition(string& why);		// Split the qubits for the hybrid engine.  (See Hybrid.cpp.)
+	bool partition_fits(size_t na, size_t nb);
+	double partition_cost(const vector<char>& side);
+	bool tensor_network_fits(string& why);	// Can the circuit be made into a tensor network?  (See TensorNetwork.cpp.)
+	void build_tensor_network();
+	double state_vector_mb(void);	// Memory the state-vector engine needs.
+	bool compile_phase_poly(ns_phasepoly::PathSum& sum, size_t& n_hadamards, size_t& failed_pc);
+	void find_cost_bounds();		// Bound the recursion and the support at each PC (see CostModel.cpp).
+	void estimate_costs(vector<EngineEstimate>& estimates);	// Estimate what each engine would cost.
+	void report_costs(const vector<EngineEstimate>& estimates);
+	string choose_engine_automatically();	// The cheapest engine, for "option: engine auto".
+	void estimate_path_integral(EngineEstimate& est);	// The estimates for each engine (each in the engine's own file).
+	void estimate_state_vector(EngineEstimate& est);
+	void estimate_sparse(EngineEstimate& est);
+	void estimate_hybrid(EngineEstimate& est);
+	void estimate_phase_poly(EngineEstimate& est);
+	void estimate_tensor_network(EngineEstimate& est);
+	void estimate_mps(EngineEstimate& est);
+	void estimate_dd(EngineEstimate& est);
+
+	// These are used during simulation.  The engine is templated on the amplitude type
+	// (Complex, or one of the types in Amplitude.h); see choose_arith_mode().
 	bool done();					// Returns TRUE if the quantum algorithm is finished running.
-	void Bohm_step_forwards();		// Take one step forwards through the program using Bohm's algorithm.
-	Complex recalc_amplitude();		// Recalculate the amplitude of the current_state recursively
+	void load_registers(const Operation& opn, size_t* regs, size_t* widths);	// Get a functional op's register values.
+	void store_registers(const Operation& opn, const size_t* regs);			// Put them back.
+	string final_state_key(void);	// How the current state is counted in the histogram of final states.
+	void report_final_probabilities(const string& caller, const map<string, double>& probs);
+	void report_histogram(const string& caller, const map<string, unsigned long>& histogram, unsigned long n_shots);
+	void run_state_vector(void);	// Run the simulation with the state-vector engine instead.
+	bool run_sparse(void);			// Or with the sparse engine, if the support stays small enough.
+	bool run_hybrid(void);			// Or with the hybrid engine, if the number of terms stays small enough.
+	bool run_phase_poly(void);		// Or with the phase-polynomial engine, if the circuit compiles to few enough paths.
+	Complex tensor_amplitude(void);	// The current state's amplitude, from the tensor network (see TensorNetwork.cpp).
+	bool run_mps(void);				// Run the simulation with the matrix-product-state engine, if the operations are small enough.
+	bool run_dd(void);				// Or with the decision-diagram engine, if the diagram stays small enough.
+	void run_input_sweep(void);		// Evaluate many input states against shared backward traversals (see InputSweep.cpp).
+	void sweep_backwards(Complex weight, ns_sweep::Row& row);	// One such traversal, from the current state.
+
+	template<class Amp>
+	void run_with(void);			// Run the simulation using amplitude type Amp.
+
+	template<class Key>
+	bool run_sparse_with(void);		// The sparse engine, with basis states kept as Keys (see Sparse.cpp).
+
+	template<class Amp>
+	void Bohm_step_forwards(Amp& cur_amp, ScratchArena<Amp>& arena);
+									// Take one step forwards through the program using Bohm's algorithm.
+									//		cur_amp is the amplitude of the current state.
+	template<class Amp>
+	Amp recalc_amplitude(ScratchArena<Amp>& arena);	// Recalculate the amplitude of the current_state recursively
 									//		via (somewhat optimized) Feynman path-integral approach.
+	template<class Amp>
+	Amp recalc_through_subcircuit(const SubcircuitInstance& inst, const vector< pair<size_t, Amp> >& row, ScratchArena<Amp>& arena);
+									// Same, going back through a whole subcircuit instance at once.
+	template<class Amp>
+	Amp recalc_through_clifford(const CliffordSegment& seg, ScratchArena<Amp>& arena);
+									// Or through a whole Clifford segment at once.
+	template<class Amp>
+	const vector< pair<size_t, Amp> >* transfer_row(const SubcircuitInstance& inst, size_t out, ScratchArena<Amp>& arena);
+									// The instance's transfer amplitudes into the given output values of its qubits
+									//		(or NULL, if the tables have used up their budget).
 	
 	// Public member functions.
 public:
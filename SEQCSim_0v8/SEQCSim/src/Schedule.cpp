@@ -0,0 +1,142 @@
+//========================================================================
+// SEQCSim version 0.8 - The Space-Efficient Quantum Computer Simulator
+// By Michael P. Frank, Liviu Oniciuc, Uwe Meyer-Baese, and Liviu Oniciuc.
+// Copyright (C) 2008-2009  Florida State University Board of Trustees
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// 
+// You may contact the author at michael.patrick.frank@gmail.com, or at
+// Michael P. Frank, PO Box 025250 #24985, Miami, FL  33102-5250.
+//========================================================================
+
+//-------------------------------------------------------------------------
+// Schedule.cpp - The scheduling pass, which reorders commuting operations
+//   to make the path-integral recursion cheaper.
+//
+// The work done by recalc_amplitude() depends on where the branching
+// operations are in the sequence, not just on how many there are.  If the
+// operation at position t has blocks of rank (at most) b_t, then going back
+// from position t visits
+//
+//		F(t) = b_(t-1) * (1 + F(t-1)),		F(0) = 0
+//
+// recursion frames, and each forward step through a branching operation
+// calls recalc_amplitude() once for each of the b_t columns of its block.  So
+// the estimated cost of the whole run is the number of forward steps, plus
+// the sum of b_t * F(t) over the branching operations.  (This is an upper
+// bound, since it assumes every operation branches as much as it can.)
+//
+// Operations that commute can be done in either order (see
+// ns_opmatrix::commute()).  The pass starts from the given order, and keeps
+// swapping adjacent commuting operations wherever that lowers the estimated
+// cost, until no swap helps (or it runs out of passes).  Functional operations
+// are never moved past operations that overlap them.
+//
+// The pass is enabled by the option "schedule on".  The reordered circuit is
+// written out to qoperators_scheduled.txt and qopseq_scheduled.txt.
+//-------------------------------------------------------------------------
+
+#include <iostream>			// cout
+#include <map>				// For caching which pairs of operations commute.
+#include "SEQCSim.h"
+#include "OperationMatrix.h"	// ns_opmatrix::commute()
+#include "debug.h"			// ns_debug::trace
+
+using namespace std;
+
+namespace ns_schedule {
+	static const string		scheduled_operators_filename	= "..\\data\\qoperators_scheduled.txt";
+	static const string		scheduled_opseq_filename		= "..\\data\\qopseq_scheduled.txt";
+
+	static const size_t		max_passes = 1000;		// Max. number of passes of swaps over the sequence.
+}
+
+// The most that the given operation can branch:  the largest rank of any block of its
+// operator's matrix (1 for a functional operation, which never branches).
+
+size_t SEQCSim::branching_factor(const Operation& opn) {
+	return opn.isFunctional() ? 1 : operators.at(opn.operator_id).U.max_block_rank();
+}
+
+// The estimated cost (in recursion frames and steps) of simulating the given sequence
+// of operations, as described at the top of this file.  It grows exponentially with the
+// number of branching operations, so it's worked out with the saturating arithmetic of
+// CostModel.h, which stops at ns_cost::huge instead of overflowing to infinity.
+
+double SEQCSim::recursion_cost_estimate(const vector<Operation>& seq) {
+	double	cost = (double)seq.size(),  frames = 0;
+	for (size_t t = 0;  t < seq.size();  t++) {
+		double	b = (double)branching_factor(seq[t]);
+		if (b > 1) cost = ns_cost::plus(cost, ns_cost::times(b, frames));
+		frames = ns_cost::times(b, ns_cost::plus(1, frames));
+	}
+	return cost;
+}
+
+// Run the scheduling pass over opn_seq (see the top of this file), if it's enabled.
+
+void SEQCSim::schedule_operations() {
+	if (!qc_config.option_flag("schedule", false)) return;
+
+	// Remember where each operation started out, so we can cache which pairs commute.
+	vector<size_t>		orig_index(opn_seq.size());
+	for (size_t i = 0;  i < opn_seq.size();  i++) orig_index[i] = i;
+	map<pair<size_t,size_t>, bool>	commutes;
+
+	double		cost_before = recursion_cost_estimate(opn_seq),  cost = cost_before;
+	size_t		n_swaps = 0,  pass;
+
+	for (pass = 0;  pass < ns_schedule::max_passes;  pass++) {
+		bool	improved = false;
+		for (size_t i = 0;  i + 1 < opn_seq.size();  i++) {
+			Operation&	a = opn_seq[i];
+			Operation&	b = opn_seq[i+1];
+
+			// Swapping only matters if they branch differently.
+			if (branching_factor(a) == branching_factor(b)) continue;
+
+			// Can they be swapped?
+			pair<size_t,size_t>	key(orig_index[i] < orig_index[i+1] ? orig_index[i] : orig_index[i+1],
+									orig_index[i] < orig_index[i+1] ? orig_index[i+1] : orig_index[i]);
+			map<pair<size_t,size_t>, bool>::iterator	it = commutes.find(key);
+			bool		can_swap;
+			if (it != commutes.end()) {
+				can_swap = it->second;
+			} else {
+				if (a.isFunctional() || b.isFunctional())	can_swap = !ns_opmatrix::overlap(a, b);
+				else	can_swap = ns_opmatrix::commute(operators.at(a.operator_id), a, operators.at(b.operator_id), b);
+				commutes[key] = can_swap;
+			}
+			if (!can_swap) continue;
+
+			// Try it, and keep it if it helps.
+			swap(opn_seq[i], opn_seq[i+1]);
+			double	new_cost = recursion_cost_estimate(opn_seq);
+			if (new_cost < cost) {
+				swap(orig_index[i], orig_index[i+1]);
+				cost = new_cost;
+				n_swaps++;
+				improved = true;
+			} else {
+				swap(opn_seq[i], opn_seq[i+1]);		// Put them back.
+			}
+		}
+		if (!improved) break;
+	}
+
+	cout << "SEQCSim::schedule_operations(): Estimated recursion cost went from " << cost_before << " to " << cost
+		 << " (" << n_swaps << " swaps in " << pass << " passes).\n";
+
+	write_circuit(ns_schedule::scheduled_operators_filename, ns_schedule::scheduled_opseq_filename);
+}
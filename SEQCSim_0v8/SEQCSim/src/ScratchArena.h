@@ -0,0 +1,86 @@
+//========================================================================
+// SEQCSim version 0.8 - The Space-Efficient Quantum Computer Simulator
+// By Michael P. Frank, Liviu Oniciuc, Uwe Meyer-Baese, and Liviu Oniciuc.
+// Copyright (C) 2008-2009  Florida State University Board of Trustees
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// 
+// You may contact the author at michael.patrick.frank@gmail.com, or at
+// Michael P. Frank, PO Box 025250 #24985, Miami, FL  33102-5250.
+//========================================================================
+
+//-------------------------------------------------------------------------
+// ScratchArena.h - Preallocated working storage for the simulation engine.
+//
+// The innermost loops of the engine (SEQCSim::Bohm_step_forwards() and
+// SEQCSim::recalc_amplitude()) need a few short vectors of amplitudes and
+// probabilities at every step and every level of the recursion.  Allocating
+// these on the heap each time would dominate the cost of the cheaper steps,
+// so instead they are all carved out of a ScratchArena, which is allocated
+// once per run (per thread) with sizes taken from the circuit at load time:
+//
+//	- max_rank, the largest rank of any block of any operator used, bounds
+//		the length of every amplitude vector;  and
+//
+//	- max_depth, the number of operations in the circuit, bounds the depth
+//		of the recursion in recalc_amplitude(), each level of which needs its
+//		own vector of predecessor amplitudes.
+//
+// After construction, nothing in the arena is ever resized, so the engine's
+// steady state does no heap allocation at all (see AllocCounter.h).  The one
+// exception is the subcircuit transfer tables (see Subcircuit.h), whose rows
+// are filled in the first time each one is needed, and kept from then on, up
+// to a budget.  The arena keeps track of their size, and of the allocations
+// done filling them in, so those can be left out of the count.
+//-------------------------------------------------------------------------
+
+#pragma once
+
+#include <vector>			// STL vector<> template.
+#include <map>				// STL map<> template, for the transfer tables.
+#include <utility>			// STL pair<> template.
+
+using namespace std;
+
+template<class Amp>
+class ScratchArena {
+public:
+	// Used by Bohm_step_forwards():
+	vector<Amp>				input_amps;		// Amplitudes of the columns of the current block.
+	vector<Amp>				output_amps;	// Amplitudes of the rows of the current block.
+	vector<double>			sq_norms;		// Squared norms of the output amplitudes.
+	vector<double>			probs;			// Normalized output probabilities.
+
+	// Used by recalc_amplitude(), one per level of recursion:
+	vector< vector<Amp> >	pred_amps;		// Amplitudes of the predecessor states.
+
+	// Used by the SIMD kernels (for Complex amplitudes only), in split real/imaginary form:
+	vector<double>			in_re, in_im, out_re, out_im;
+
+	// Used by recalc_through_subcircuit(), one per transfer table:  For each output value of
+	// the instance's qubits seen so far, the input values with nonzero transfer amplitudes,
+	// and those amplitudes.
+	vector< map<size_t, vector< pair<size_t, Amp> > > >	transfers;
+	double					transfer_bytes;			// Rough size of all those tables so far...
+	double					max_transfer_bytes;		//	...and the most they may take up.
+	unsigned long			transfer_allocations;	// Heap allocations done filling them in.
+	bool					transfer_budget_noted;	// Have we said they've used up their budget?
+
+	ScratchArena(size_t max_rank, size_t max_depth, size_t n_tables = 0, double transfer_budget_mb = 0)
+		: input_amps(max_rank), output_amps(max_rank), sq_norms(max_rank), probs(max_rank),
+		  pred_amps(max_depth + 2, vector<Amp>(max_rank)),
+		  in_re(max_rank), in_im(max_rank), out_re(max_rank), out_im(max_rank),
+		  transfers(n_tables), transfer_bytes(0), max_transfer_bytes(transfer_budget_mb*1024*1024),
+		  transfer_allocations(0), transfer_budget_noted(false) {}
+};
@@ -0,0 +1,126 @@
+//========================================================================
+// SEQCSim version 0.8 - The Space-Efficient Quantum Computer Simulator
+// By Michael P. Frank, Liviu Oniciuc, Uwe Meyer-Baese, and Liviu Oniciuc.
+// Copyright (C) 2008-2009  Florida State University Board of Trustees
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// 
+// You may contact the author at michael.patrick.frank@gmail.com, or at
+// Michael P. Frank, PO Box 025250 #24985, Miami, FL  33102-5250.
+//========================================================================
+
+//-------------------------------------------------------------------------
+// Simplify.cpp - The peephole simplification pass, which removes pairs of
+//   operations that cancel each other out.
+//
+// Circuits (especially generated ones) often contain an operation followed,
+// sooner or later, by its inverse:  H...H, X...X, cNOT...cNOT, or a rotation
+// and the opposite rotation.  If every operation in between commutes with the
+// first one, it can be moved up next to the second one, and then both can be
+// removed.  Removing a branching operation (like H) halves the number of paths
+// through that part of the circuit, so this can save a lot of simulation time.
+//
+// Commutation is decided as in ns_opmatrix::commute():  operations on disjoint
+// qubits, and pairs of diagonal operations, always commute; other pairs of
+// operations on few enough qubits are checked by multiplying out their matrices.
+// An operation and a later one are taken to cancel if they act on the same set
+// of qubits (in any order, with the same controls) and the product of their
+// matrices is the identity.  Functional operations are never removed, and
+// nothing is moved past them.
+//
+// The pass is enabled by the option "simplify on".
+//-------------------------------------------------------------------------
+
+#include <iostream>			// cout
+#include "SEQCSim.h"
+#include "OperationMatrix.h"	// ns_opmatrix::commute(), etc.
+#include "debug.h"			// ns_debug::trace
+
+using namespace std;
+
+// Do the two operations cancel each other out?  (See the top of this file.)
+
+bool SEQCSim::operations_cancel(const Operation& first, const Operation& second) {
+	if (first.isFunctional() || second.isFunctional()) return false;
+
+	vector<qubit_index_t>	qubits, second_qubits;
+	ns_opmatrix::qubits_of(first, qubits);
+	ns_opmatrix::qubits_of(second, second_qubits);
+	if (qubits.size() != second_qubits.size() || qubits.size() > ns_opmatrix::max_commute_qubits) return false;
+	for (size_t k = 0;  k < second_qubits.size();  k++)
+		if (ns_opmatrix::position_of(qubits, second_qubits[k]) == qubits.size()) return false;
+
+	size_t			rank = (size_t)1 << qubits.size();
+	vector<Complex>	m_first, m_second, product;
+	ns_opmatrix::embed(operators.at(first.operator_id), first, qubits, m_first);
+	ns_opmatrix::embed(operators.at(second.operator_id), second, qubits, m_second);
+	ns_opmatrix::multiply(m_second, m_first, rank, product);
+	return ns_opmatrix::is_identity(product, rank);
+}
+
+// Is the given operation branching?  (I.e., can it have more than one output for some input?)
+
+bool SEQCSim::is_branching(const Operation& opn) {
+	return !opn.isFunctional() && !operators.at(opn.operator_id).isMonomial();
+}
+
+// Run the simplification pass over opn_seq (see the top of this file), if it's enabled.
+
+void SEQCSim::simplify_operations() {
+	if (!qc_config.option_flag("simplify", false)) return;
+
+	size_t	n_orig = opn_seq.size(),  n_removed = 0,  n_branching_removed = 0;
+
+	size_t	first = 0;
+	while (first < opn_seq.size()) {
+		Operation&	first_opn = opn_seq[first];
+		bool		cancelled = false;
+
+		if (!first_opn.isFunctional()) {
+			Operator&	first_opr = operators.at(first_opn.operator_id);
+
+			// Look forwards for an operation that cancels it, for as long as it can be
+			// moved past the ones in between.
+			for (size_t later = first + 1;  later < opn_seq.size();  later++) {
+				Operation&	later_opn = opn_seq[later];
+				if (!ns_opmatrix::overlap(first_opn, later_opn)) continue;
+
+				if (operations_cancel(first_opn, later_opn)) {
+					if (ns_debug::trace) cout << "SEQCSim::simplify_operations(): Operation " << first_opn << " cancels with " << later_opn << ".\n";
+					n_removed += 2;
+					if (is_branching(first_opn))	n_branching_removed++;
+					if (is_branching(later_opn))	n_branching_removed++;
+					opn_seq.erase(opn_seq.begin() + later);
+					opn_seq.erase(opn_seq.begin() + first);
+					cancelled = true;
+					break;
+				}
+
+				if (later_opn.isFunctional()
+					|| !ns_opmatrix::commute(first_opr, first_opn, operators.at(later_opn.operator_id), later_opn)) break;
+			}
+		}
+
+		// After a cancellation, go back one operation, in case the one before can now
+		// cancel with something that used to be blocked.
+		if (cancelled)	first = (first > 0) ? first - 1 : 0;
+		else			first++;
+	}
+
+	size_t	n_branching = 0;
+	for (size_t i = 0;  i < opn_seq.size();  i++) if (is_branching(opn_seq[i])) n_branching++;
+
+	cout << "SEQCSim::simplify_operations(): Removed " << n_removed << " of the " << n_orig << " operations ("
+		 << n_branching_removed << " of them branching), leaving " << opn_seq.size() << " (" << n_branching << " branching).\n";
+}
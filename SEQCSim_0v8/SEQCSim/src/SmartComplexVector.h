@@ -37,6 +37,7 @@
 #include <vector>
 #include <iostream>
 #include "Complex.h"
+#include "Amplitude.h"		// RootOfUnityElem, the exact form of a matrix element.
 #include "debug.h"
 
 using namespace std;
@@ -46,15 +47,22 @@ class SmartComplexVector {
 private:
 	vector<Complex>		elements;		// All of the elements of the vector.
 	vector<size_t>		nz_elem_idxs;	// Indices of the non-zero elements of the vector.
+	vector<double>		nz_elems_re;	// Real parts of the non-zero elements, in the same order as nz_elem_idxs.
+	vector<double>		nz_elems_im;	// Imaginary parts of the non-zero elements, likewise.
+	vector<RootOfUnityElem>	nz_elems_exact;	// The non-zero elements in exact form (if they have one), likewise.
 
 	// Private member functions.
 private:
 	// Re-scan all elements and reconstruct the nz_elem_idxs vector from scratch.
 	void __rescan_elems(void) {
 		nz_elem_idxs.clear();				// Turns the current list of nonzero elements to the empty list.
+		nz_elems_re.clear();  nz_elems_im.clear();  nz_elems_exact.clear();
 		for (size_t i=0; i<size(); i++) {
 			if (elements[i].isNonzero()) {						// If the current complex is nonzero,
-				nz_elem_idxs.insert(nz_elem_idxs.end(), i);		//   add the current index to the list.
+				nz_elem_idxs.insert(nz_elem_idxs.end(), i);		//   add the current index to the list,
+				nz_elems_re.push_back(elements[i].R);			//   and its value to the split lists
+				nz_elems_im.push_back(elements[i].I);			//   used by the vectorized kernels,
+				nz_elems_exact.push_back(RootOfUnityElem(elements[i]));	// and in exact form.
 			}
 		}
 	}
@@ -145,6 +153,15 @@ public:
 	// could cause havoc.
 	vector<size_t>& indices_of_nz_elems(void) { return nz_elem_idxs; }
 
+	// Return references to the real and imaginary parts of the nonzero elements of this
+	// vector (in the same order as indices_of_nz_elems()), stored as separate arrays for
+	// the benefit of the kernels in ComplexKernels.h.  Again, the caller must not modify them.
+	vector<double>& nz_elems_real_parts(void) { return nz_elems_re; }
+	vector<double>& nz_elems_imag_parts(void) { return nz_elems_im; }
+
+	// Likewise, the nonzero elements in the exact form used by CyclotomicAmp (see Amplitude.h).
+	vector<RootOfUnityElem>& nz_elems_exact_form(void) { return nz_elems_exact; }
+
 	void		putTo(ostream& os);
 };
 
@@ -0,0 +1,358 @@
+//========================================================================
+// SEQCSim version 0.8 - The Space-Efficient Quantum Computer Simulator
+// By Michael P. Frank, Liviu Oniciuc, Uwe Meyer-Baese, and Liviu Oniciuc.
+// Copyright (C) 2008-2009  Florida State University Board of Trustees
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// 
+// You may contact the author at michael.patrick.frank@gmail.com, or at
+// Michael P. Frank, PO Box 025250 #24985, Miami, FL  33102-5250.
+//========================================================================
+
+//-------------------------------------------------------------------------
+// Sparse.cpp - A sparse simulation engine, which keeps only the basis states
+//   with nonzero amplitudes.
+//
+// Many of our circuits (the adders especially) keep only a small number of
+// basis states with nonzero amplitude at any point:  the classical parts of the
+// computation don't branch at all, and the quantum parts often branch only over
+// a few qubits at a time.  For these, it's much quicker than the path integral
+// to evolve the state forwards through the circuit, one operation at a time,
+// but without the 2^nbits memory of the state-vector engine (StateVector.cpp).
+// Instead, we keep a hash table from the bits of each basis state in the
+// support of the state (i.e., with a nonzero amplitude) to its amplitude, so
+// that the memory needed scales with the size of the support.  Each operation
+// maps each basis state to the (few) states its column of the operator's matrix
+// reaches, and then any amplitudes that came out exactly zero, or smaller in
+// magnitude than "option: sparse_threshold X" (default ns_sparse::default_
+// threshold; 0 means prune only exact zeros), are dropped.
+//
+// The engine is selected with "option: engine sparse".  Since we can't know in
+// advance how large the support will get, there is an explicit memory cap,
+// "option: sparse_memory_mb N" (default ns_sparse::default_memory_mb); if the
+// support outgrows it, we give up, and run() falls back to the path-integral
+// engine.  Otherwise, we report the size of the support after each operation
+// (and its peak size while the operation was being applied), along with the
+// exact probabilities of the final states, and then sample the shots from the
+// final state, just as the state-vector engine does.
+//
+// When there are few enough qubits, the bits of a basis state are kept in a
+// single machine word;  otherwise, they're kept in a vector of words.  The
+// engine is templated on which.
+//-------------------------------------------------------------------------
+
+#include <iostream>			// cout
+#include <sstream>			// ostringstream
+#include <vector>			// STL vector<> template.
+#include <map>				// For the histogram of final states.
+#include <unordered_map>	// tr1::unordered_map, for the amplitudes of the states in the support.
+#include <algorithm>		// upper_bound(), max()
+#include "SEQCSim.h"
+#include "debug.h"			// ns_debug::trace
+
+using namespace std;
+
+namespace ns_sparse {
+
+	// Default memory cap for the sparse state, in megabytes.
+	static const double		default_memory_mb = 1024;
+
+	// Amplitudes smaller in magnitude than this are pruned, by default.
+	static const double		default_threshold = 1e-12;
+
+	// Rough memory cost of a hash table entry, besides its key and amplitude:  the node's link,
+	// its cached hash, and the bucket array.
+	static const size_t		entry_overhead_bytes = 32;
+
+	static const size_t		bits_per_word = 8*sizeof(size_t);
+
+	// The bits of a basis state on more than bits_per_word qubits (qubit q is bit q%bits_per_word
+	// of word q/bits_per_word).
+	typedef vector<size_t>	BasisKey;
+
+	// The bit for qubit q, in either kind of key.
+	static inline size_t get_bit(size_t key, qubit_index_t q)			{ return (key >> q) & 1; }
+	static inline size_t get_bit(const BasisKey& key, qubit_index_t q)	{ return (key[q/bits_per_word] >> (q%bits_per_word)) & 1; }
+
+	static inline void set_bit(size_t& key, qubit_index_t q, size_t bit) {
+		key = (key & ~((size_t)1 << q)) | (bit << q);
+	}
+	static inline void set_bit(BasisKey& key, qubit_index_t q, size_t bit) {
+		size_t&	word = key[q/bits_per_word];
+		word = (word & ~((size_t)1 << (q%bits_per_word))) | (bit << (q%bits_per_word));
+	}
+
+	// An all-zero key for nbits qubits.
+	static void clear_key(size_t& key, size_t nbits)	{ key = 0; }
+	static void clear_key(BasisKey& key, size_t nbits)	{ key.assign((nbits + bits_per_word - 1)/bits_per_word, 0); }
+
+	// The memory used by the key itself, besides the entry holding it.
+	static size_t key_heap_bytes(const size_t& key)		{ return 0; }
+	static size_t key_heap_bytes(const BasisKey& key)	{ return key.size()*sizeof(size_t); }
+
+	// The bits of key at the positions of the given qubits, as an integer (like State::extractBits()).
+	template<class Key>
+	static size_t gather_bits(const Key& key, const vector<qubit_index_t>& qubits) {
+		size_t	value = 0;
+		for (size_t i = 0;  i < qubits.size();  i++) value |= get_bit(key, qubits[i]) << i;
+		return value;
+	}
+
+	// Set the bits of key at the positions of the given qubits to the bits of value (the inverse of gather_bits()).
+	template<class Key>
+	static void scatter_bits(Key& key, size_t value, const vector<qubit_index_t>& qubits) {
+		for (size_t i = 0;  i < qubits.size();  i++) set_bit(key, qubits[i], (value >> i) & 1);
+	}
+
+	// Hash functions for both kinds of key.  Basis states that differ in only a few bits are
+	// common, so the bits are mixed (by Fibonacci hashing) rather than used directly.
+	struct KeyHash {
+		size_t operator()(size_t key) const {
+			size_t	h = key * (size_t)2654435761u;
+			return h ^ (h >> 15);
+		}
+		size_t operator()(const BasisKey& key) const {
+			size_t	h = 0;
+			for (size_t i = 0;  i < key.size();  i++) h = (*this)(h ^ key[i]);
+			return h;
+		}
+	};
+
+	// Should an amplitude be pruned from the support?
+	static inline bool negligible(const Complex& amp, double threshold_sq) {
+		return amp.isZero() || amp.squared_norm() < threshold_sq;
+	}
+}
+
+// Run the simulation with the sparse engine (see the top of this file).  Returns false,
+// having done nothing visible besides saying so, if the support outgrows the memory cap.
+
+bool SEQCSim::run_sparse(void)
+{
+	if (qc_config.nbits <= ns_sparse::bits_per_word) {
+		return run_sparse_with<size_t>();
+	} else {
+		return run_sparse_with<ns_sparse::BasisKey>();
+	}
+}
+
+// The sparse engine itself, with the bits of the basis states kept in keys of type Key
+// (either a size_t, or an ns_sparse::BasisKey).
+
+template<class Key>
+bool SEQCSim::run_sparse_with(void)
+{
+	typedef tr1::unordered_map<Key, Complex, ns_sparse::KeyHash>	SparseState;
+
+	size_t		nbits = qc_config.nbits;
+	double		threshold = qc_config.option_double("sparse_threshold", ns_sparse::default_threshold);
+	double		threshold_sq = threshold*threshold;
+	double		budget_mb = qc_config.option_double("sparse_memory_mb", ns_sparse::default_memory_mb);
+
+	// Start out in the input state.
+	Key			input_key;
+	ns_sparse::clear_key(input_key, nbits);
+	for (size_t q = 0;  q < nbits;  q++) ns_sparse::set_bit(input_key, q, input_state.bits[q] ? 1 : 0);
+
+	// Work out how many entries the cap allows.  (While applying an operation, we have both
+	// the old and the new state in memory.)
+	double		bytes_per_entry = sizeof(Key) + ns_sparse::key_heap_bytes(input_key) + sizeof(Complex)
+								  + ns_sparse::entry_overhead_bytes;
+	size_t		max_entries = (size_t)(budget_mb*1024*1024 / bytes_per_entry / 2);
+
+	cout << "SEQCSim::run_sparse(): Simulating " << nbits << " qubits with a sparse state, of at most "
+		 << max_entries << " basis states.\n";
+
+	SparseState		psi,  next;
+	psi[input_key] = input_state.amp;
+
+	vector<size_t>	support(opn_seq.size()),  peak(opn_seq.size());		// Support size after and during each operation.
+	size_t			max_peak = 1,  max_peak_pc = 0;
+
+	for (size_t pc = 0;  pc < opn_seq.size();  pc++) {
+		Operation&	opn = opn_seq[pc];
+		bool		in_place = false;		// Does the operation just multiply each amplitude by a phase?
+
+		if (ns_debug::trace) cout << "SEQCSim::run_sparse(): Applying operation #" << pc << ", " << opn << ".\n";
+
+		if (opn.isFunctional()) {
+			// A functional operator moves each basis state to its image under the function (if its
+			// controls are satisfied), or multiplies its amplitude by the function's phase.
+			FunctionalOperator&	func = functions[opn.function_id];
+			size_t				regs[ns_functions::max_registers], widths[ns_functions::max_registers];
+			in_place = (func.kind == FunctionalOperator::PHASE_ORACLE);
+
+			for (typename SparseState::iterator it = psi.begin();  it != psi.end();  it++) {
+				if (ns_sparse::gather_bits(it->first, opn.controls) != opn.control_values) {
+					if (!in_place) next.insert(*it);
+					continue;
+				}
+				for (size_t r = 0;  r < opn.registers.size();  r++) {
+					regs[r] = ns_sparse::gather_bits(it->first, opn.registers[r]);
+					widths[r] = opn.registers[r].size();
+				}
+				if (in_place) {
+					it->second *= func.phase_of(regs, widths);
+				} else {
+					Key		image = it->first;
+					func.apply(regs, widths);
+					for (size_t r = 0;  r < opn.registers.size();  r++) ns_sparse::scatter_bits(image, regs[r], opn.registers[r]);
+					next.insert(make_pair(image, it->second));
+				}
+			}
+		} else {
+			Operator&	opr = operators.at(opn.operator_id);
+			in_place = (opr.form == Operator::DIAGONAL);
+
+			for (typename SparseState::iterator it = psi.begin();  it != psi.end();  it++) {
+				if (ns_sparse::gather_bits(it->first, opn.controls) != opn.control_values) {
+					if (!in_place) next.insert(*it);
+					continue;
+				}
+				size_t	j = ns_sparse::gather_bits(it->first, opn.operands);
+
+				if (opr.form == Operator::DIAGONAL) {
+					// Just multiply the amplitude by the diagonal element.
+					if (!opr.mono_unit[j]) it->second *= opr.mono_elem[j];
+
+				} else if (opr.form == Operator::MONOMIAL) {
+					// The basis state moves to a single other one.  This is a bijection, so no two
+					// states move to the same place, and there's nothing to add up.
+					Key		image = it->first;
+					ns_sparse::scatter_bits(image, opr.mono_target[j], opn.operands);
+					next.insert(make_pair(image, opr.mono_unit[j] ? it->second : opr.mono_elem[j]*it->second));
+
+				} else {
+					// In general, the basis state spreads out over the rows of its column's block,
+					// and the contributions to each new state are added up.
+					MatrixBlock&	blk = opr.U.blocks[opr.U.col_block[j]];
+					size_t			rank = blk.rank();
+					size_t			c = lower_bound(blk.col_indices.begin(), blk.col_indices.end(), j) - blk.col_indices.begin();
+					for (size_t r = 0;  r < rank;  r++) {
+						Complex		elem(blk.elems_re[r*rank + c], blk.elems_im[r*rank + c]);
+						if (elem.isZero()) continue;
+						Key		image = it->first;
+						ns_sparse::scatter_bits(image, blk.row_indices[r], opn.operands);
+						next[image] += elem*it->second;
+					}
+				}
+
+				if (next.size() > max_entries) break;
+			}
+		}
+
+		// Check the cap, then prune the amplitudes that cancelled out (or nearly).
+		size_t	during = in_place ? psi.size() : max(psi.size(), next.size());
+		if (during > max_entries) {
+			cout << "SEQCSim::run_sparse(): The support grew to more than " << max_entries << " basis states at operation #"
+				 << pc << ", which is over the memory cap (sparse_memory_mb = " << budget_mb
+				 << "); falling back to the path-integral engine.\n";
+			return false;
+		}
+		if (!in_place) {
+			psi.swap(next);
+			next.clear();
+		}
+		for (typename SparseState::iterator it = psi.begin();  it != psi.end();  ) {
+			if (ns_sparse::negligible(it->second, threshold_sq)) {
+				it = psi.erase(it);
+			} else {
+				it++;
+			}
+		}
+
+		support[pc] = psi.size();
+		peak[pc] = during;
+		if (during > max_peak) {
+			max_peak = during;
+			max_peak_pc = pc;
+		}
+	}
+
+	cout << "SEQCSim::run_sparse(): Size of the support after each operation (and its peak while applying it):\n";
+	for (size_t pc = 0;  pc < opn_seq.size();  pc++) {
+		cout << "   #" << pc << ": " << support[pc] << " (" << peak[pc] << ")\n";
+	}
+	cout << "SEQCSim::run_sparse(): The largest support was " << max_peak << " basis states, at operation #" << max_peak_pc << ".\n";
+
+	// Collect the final states, with their cumulative probabilities, for sampling.  (The squared
+	// norm of the final state should be that of the input amplitude, less whatever was pruned.)
+	vector< pair<Key, Complex> >	final_states(psi.begin(), psi.end());
+	vector<double>					cumulative(final_states.size());
+	map<string, double>				exact_probs;
+	double							total = 0;
+	for (size_t i = 0;  i < final_states.size();  i++) {
+		total += final_states[i].second.squared_norm();
+		cumulative[i] = total;
+	}
+	cout << "SEQCSim::run_sparse(): The final state has squared norm " << total << ".\n";
+	if (final_states.empty()) {
+		cout << "SEQCSim::run_sparse(): Error!  Every amplitude was pruned; sparse_threshold is too large.\n";
+		exit(1);
+	}
+
+	// List the most likely final states (or values of the measured registers), with their exact probabilities.
+	current_state = input_state;
+	for (size_t i = 0;  i < final_states.size();  i++) {
+		for (size_t q = 0;  q < nbits;  q++) current_state.bits[q] = (ns_sparse::get_bit(final_states[i].first, q) != 0);
+		exact_probs[final_state_key()] += final_states[i].second.squared_norm()/total;
+	}
+	report_final_probabilities("SEQCSim::run_sparse()", exact_probs);
+
+	// Now sample the shots.
+	unsigned long				n_shots = (unsigned long)qc_config.option_double("shots", 1);
+	map<string, unsigned long>	histogram;
+
+	for (unsigned long shot = 1;  shot <= n_shots;  shot++) {
+		double	marker_position = marker_picker(prng_engine) * total;
+		size_t	i = upper_bound(cumulative.begin(), cumulative.end(), marker_position) - cumulative.begin();
+		if (i >= final_states.size()) i = final_states.size() - 1;
+
+		for (size_t q = 0;  q < nbits;  q++) current_state.bits[q] = (ns_sparse::get_bit(final_states[i].first, q) != 0);
+		current_state.amp = final_states[i].second;
+		cout << "SEQCSim::run_sparse(): Shot #" << shot << " ended in state " << current_state << ".\n";
+		histogram[final_state_key()]++;
+	}
+
+	report_histogram("SEQCSim::run_sparse()", histogram, n_shots);
+	return true;
+}
+
+// The cost of running the circuit with the sparse engine (see CostModel.h), from the bound
+// on the support at each PC (see CostModel.cpp).  Each operation updates each entry from
+// (at most) as many others as its blocks' rank.
+
+void SEQCSim::estimate_sparse(EngineEstimate& est)
+{
+	size_t		nbits = qc_config.nbits;
+	double		budget_mb = qc_config.option_double("sparse_memory_mb", ns_sparse::default_memory_mb);
+	double		key_bytes = (nbits <= ns_sparse::bits_per_word) ? sizeof(size_t)
+							: sizeof(ns_sparse::BasisKey) + sizeof(size_t)*((nbits + ns_sparse::bits_per_word - 1)/ns_sparse::bits_per_word);
+	double		bytes_per_entry = key_bytes + sizeof(Complex) + ns_sparse::entry_overhead_bytes;
+	double		max_support = 1,  updates = 0;
+
+	for (size_t pc = 0;  pc < opn_seq.size();  pc++) {
+		double	b = (double)branching_factor(opn_seq[pc]);
+		updates = ns_cost::plus(updates, ns_cost::times(support_bounds[pc], b));
+		max_support = max(max_support, support_bounds[pc + 1]);
+	}
+	est.seconds = ns_cost::times(updates, ns_cost::seconds_per_entry);
+	est.memory_mb = ns_cost::times(2*max_support, bytes_per_entry) / (1024*1024);
+	est.possible = (est.memory_mb <= budget_mb);
+
+	ostringstream	note;
+	note << "the support has at most " << max_support << " basis states";
+	if (!est.possible) note << ", which might not fit in the budget (sparse_memory_mb) of " << budget_mb << " MB";
+	est.note = note.str();
+}
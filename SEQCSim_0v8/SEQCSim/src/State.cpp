@@ -1,32 +1,32 @@
 #include "State.h"
 #include "BitVector.h"
 
-size_t State::extractBits(vector<qubit_index_t> whichOnes) {
+size_t State::extractBits(const vector<qubit_index_t>& whichOnes) {
 
 	// Identify just how many bits we're talking about.
 	size_t howMany = whichOnes.size();
 	
-	// We'll assemble the output in a bit-vector of the same length as the input vector of indices.
-	BitVector  qb_val_bv(howMany);
+	// We'll assemble the output directly in an integer, with the (opd_i)th operand's value
+	// in bit opd_i.  (This used to go through a temporary BitVector, which meant a heap
+	// allocation on every call; this function is called in the innermost loop of the simulator.)
+	size_t  qb_vals = 0;
 	
 	for (operand_index_t  opd_i = 0;		// Loop an index over the bit indices...
 						  opd_i < howMany;
 						  opd_i++)
 	{
 		// Get the bit-address of the qubit that is the (opd_i)th operand of the current operation.
-		qubit_index_t	qub_i = whichOnes.at(opd_i);	  
-
-		// Get the (classical) value of the qubit located at that bit-address in the current basis state.
-		bool			qub_val = (*this)[qub_i];
+		qubit_index_t	qub_i = whichOnes[opd_i];	  
 
-		// Store that bit-value in the bit-vector representation of the input index to the operation.
-		qb_val_bv[opd_i] = qub_val;
+		// Get the (classical) value of the qubit located at that bit-address in the current basis state,
+		// and store it in the corresponding bit of the result.
+		if ((*this)[qub_i]) qb_vals |= ((size_t)1 << opd_i);
 	}
 
-	return qb_val_bv;	// Convert vector of results to an integer and return it.
+	return qb_vals;
 }
 
-void State::setBits(vector<qubit_index_t> whichOnes, BitVector &bitValues) {
+void State::setBits(const vector<qubit_index_t>& whichOnes, BitVector &bitValues) {
 	
 	// Identify just how many bits we're talking about.
 	size_t howMany = whichOnes.size();
@@ -44,6 +44,20 @@ void State::setBits(vector<qubit_index_t> whichOnes, BitVector &bitValues) {
 	}
 }
 
+void State::setBits(const vector<qubit_index_t>& whichOnes, size_t bitValues) {
+	
+	// Identify just how many bits we're talking about.
+	size_t howMany = whichOnes.size();
+	
+	for (operand_index_t  opd_i = 0;		// Loop an index over the bit indices...
+						  opd_i < howMany;
+						  opd_i++)
+	{
+		// Set the qubit that is the (opd_i)th operand to bit opd_i of the given integer.
+		(*this)[whichOnes[opd_i]] = ((bitValues >> opd_i) & 1) != 0;
+	}
+}
+
 int State::hammingDistanceFrom(State& other) {
 
 	// If the two states aren't the same size, return -1 (incomparable).
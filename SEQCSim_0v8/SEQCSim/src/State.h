@@ -48,15 +48,22 @@ public:
 	// Returns a bit-vector (in integer form) giving the values of all 
 	// the qubits selected by the given vector<qubit_index_t>.  Needless to say,
 	// the number of qubits extracted should not be too large to fit in an integer.
+	// (The vector is passed by reference, to avoid copying it on every call.)
 
-	size_t  extractBits(vector<qubit_index_t> whichOnes);
+	size_t  extractBits(const vector<qubit_index_t>& whichOnes);
 
 	// Given a vector of qubit indices, and a corresponding-length vector of bit values,
 	// modify the current state to set the qubit values equal to the given bit values.
 	// Does not change the state's amplitude.  NOTE: In this function, is no limit to
 	// how many bits we can set in a single call (other than memory limits).
 
-	void  setBits(vector<qubit_index_t> whichOnes, BitVector &bitValues);
+	void  setBits(const vector<qubit_index_t>& whichOnes, BitVector &bitValues);
+
+	// Same, but with the bit values given as an integer (bit i of which is the value for
+	// qubit whichOnes[i]), like the one returned by extractBits().  This is the version
+	// used in the simulator's inner loops, since unlike a BitVector it needs no heap memory.
+
+	void  setBits(const vector<qubit_index_t>& whichOnes, size_t bitValues);
 
 	// Returns the number of bits that differ between this state and the given other state.
 	// Or, returns -1 if the two states are incomparable (because of differing sizes).
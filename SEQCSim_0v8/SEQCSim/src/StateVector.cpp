@@ -0,0 +1,420 @@
+//========================================================================
+// SEQCSim version 0.8 - The Space-Efficient Quantum Computer Simulator
+// By Michael P. Frank, Liviu Oniciuc, Uwe Meyer-Baese, and Liviu Oniciuc.
+// Copyright (C) 2008-2009  Florida State University Board of Trustees
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// 
+// You may contact the author at michael.patrick.frank@gmail.com, or at
+// Michael P. Frank, PO Box 025250 #24985, Miami, FL  33102-5250.
+//========================================================================
+//-------------------------------------------------------------------------
+// StateVector.cpp - A conventional state-vector simulation engine, for
+//   circuits on few enough qubits that all 2^nbits amplitudes fit in memory.
+//
+// The path-integral engine in SEQCSim.cpp needs almost no memory, but its
+// running time grows exponentially with the number of branching operations.
+// When 2^nbits amplitudes fit comfortably within the memory budget, it's far
+// quicker to just keep the whole state vector, apply each operation to it in
+// turn, and then sample the final states of all the shots from it.  The
+// result is also exact (up to rounding), so it serves as a reference for
+// checking the space-efficient engine.  It's selected with "option: engine
+// statevector"; the budget is "option: statevector_memory_mb N" (default
+// ns_statevector::default_memory_mb).  If the state vector wouldn't fit, we
+// fall back to the path-integral engine.
+//
+// The state vector is kept in split form (separate arrays of real and
+// imaginary parts), where bit q of the index of an amplitude is the value of
+// qubit q.  An operation on k operands is applied to each of the 2^(n-k)
+// groups of 2^k amplitudes that differ only in the operands (and that satisfy
+// its controls), as follows:
+//
+//	- a diagonal operator just multiplies each amplitude by its element;
+//	- a monomial operator permutes the amplitudes within each group, and
+//		multiplies them by their elements;
+//	- a general single-qubit operator is applied to each pair of amplitudes,
+//		in a simple loop that the compiler can vectorize;
+//	- any other operator is applied block by block (see Matrix.h), using the
+//		complex matrix-vector kernel (ns_kernels::cgemv()) on each group;  and
+//	- a functional operator (see FunctionalOperator.h) moves each amplitude
+//		to its image under the function, in a second state vector.
+//
+// The groups are independent, so each kind of update is spread over all the
+// processor's cores with OpenMP (when the compiler supports it).
+//-------------------------------------------------------------------------
+
+#include <iostream>			// cout
+#include <sstream>			// ostringstream
+#include <vector>			// STL vector<> template.
+#include <map>				// For the histogram of final states.
+#include <algorithm>		// sort(), upper_bound()
+#include <math.h>			// pow()
+#ifdef _OPENMP
+#include <omp.h>			// omp_get_max_threads(), omp_get_thread_num()
+#endif
+#include "SEQCSim.h"
+#include "StateVector.h"	// The pieces of this engine shared with the others.
+#include "ComplexKernels.h"	// ns_kernels::cgemv()
+#include "debug.h"			// ns_debug::trace
+
+using namespace std;
+
+namespace ns_statevector {
+
+	// Default memory budget for the state vector (and its working storage), in megabytes.
+	static const double		default_memory_mb = 1024;
+
+	// Basis states with probabilities below this aren't counted when listing the final states
+	// (which would otherwise mean formatting the key of nearly every one of them).
+	static const double		negligible_prob = 1e-12;
+
+	// The parallel regions below take their scratch space from a buffer allocated beforehand,
+	// with a slice for each thread (see n_threads()), so that there's no allocation going on
+	// inside them.
+#ifdef _OPENMP
+	size_t	n_threads(void)		{ return (size_t)omp_get_max_threads(); }
+	size_t	thread_num(void)	{ return (size_t)omp_get_thread_num(); }
+#else
+	size_t	n_threads(void)		{ return 1; }
+	size_t	thread_num(void)	{ return 0; }
+#endif
+
+	// A mask with a 1 in the position of each of the given qubits.
+	size_t mask_of(const vector<qubit_index_t>& qubits) {
+		size_t	mask = 0;
+		for (size_t i = 0;  i < qubits.size();  i++) mask |= (size_t)1 << qubits[i];
+		return mask;
+	}
+
+	// Spread the bits of value out to the positions of the given qubits (the inverse of gather_bits()).
+	size_t scatter_bits(size_t value, const vector<qubit_index_t>& qubits) {
+		size_t	index = 0;
+		for (size_t i = 0;  i < qubits.size();  i++) index |= ((value >> i) & 1) << qubits[i];
+		return index;
+	}
+
+	// The bits of index at the positions of the given qubits, as an integer (like State::extractBits()).
+	size_t gather_bits(size_t index, const vector<qubit_index_t>& qubits) {
+		size_t	value = 0;
+		for (size_t i = 0;  i < qubits.size();  i++) value |= ((index >> qubits[i]) & 1) << i;
+		return value;
+	}
+
+	// The index of the g'th group's first amplitude:  g, with a 0 bit inserted at each of the
+	// given (sorted) positions.
+	size_t group_base(size_t g, const vector<qubit_index_t>& sorted_positions) {
+		for (size_t i = 0;  i < sorted_positions.size();  i++) {
+			size_t	p = sorted_positions[i];
+			g = (g & (((size_t)1 << p) - 1)) | ((g >> p) << (p + 1));
+		}
+		return g;
+	}
+
+	// Apply the (non-functional) operator opr, on the given operands, to each group of
+	// amplitudes whose controls match (index & ctrl_mask) == ctrl_value.
+	void apply_operator(Operator& opr, const vector<qubit_index_t>& operands, size_t ctrl_mask, size_t ctrl_value,
+						size_t nbits, Amplitudes& psi) {
+		size_t					k = operands.size(),  rank = (size_t)1 << k;
+		int						n_groups = (int)((size_t)1 << (nbits - k));
+		vector<qubit_index_t>	sorted_operands(operands);
+		sort(sorted_operands.begin(), sorted_operands.end());
+
+		// Offsets of the amplitudes within a group, by operator index.
+		vector<size_t>			offset(rank);
+		for (size_t j = 0;  j < rank;  j++) offset[j] = scatter_bits(j, operands);
+
+		double*		re = &psi.re[0];
+		double*		im = &psi.im[0];
+
+		if (opr.form == Operator::DIAGONAL) {
+			#pragma omp parallel for
+			for (int g = 0;  g < n_groups;  g++) {
+				size_t	base = group_base(g, sorted_operands);
+				if ((base & ctrl_mask) != ctrl_value) continue;
+				for (size_t j = 0;  j < rank;  j++) {
+					if (opr.mono_unit[j]) continue;
+					const Complex&	e = opr.mono_elem[j];
+					size_t			i = base + offset[j];
+					double			r = re[i];
+					re[i] = e.R*r - e.I*im[i];
+					im[i] = e.R*im[i] + e.I*r;
+				}
+			}
+			return;
+		}
+
+		if (opr.form == Operator::MONOMIAL) {
+			vector<double>	scratch(2*rank*n_threads());
+			#pragma omp parallel
+			{
+				double*		tmp_re = &scratch[2*rank*thread_num()];
+				double*		tmp_im = tmp_re + rank;
+				#pragma omp for
+				for (int g = 0;  g < n_groups;  g++) {
+					size_t	base = group_base(g, sorted_operands);
+					if ((base & ctrl_mask) != ctrl_value) continue;
+					for (size_t j = 0;  j < rank;  j++) {
+						const Complex&	e = opr.mono_elem[j];
+						size_t			i = base + offset[j],  t = opr.mono_target[j];
+						tmp_re[t] = e.R*re[i] - e.I*im[i];
+						tmp_im[t] = e.R*im[i] + e.I*re[i];
+					}
+					for (size_t j = 0;  j < rank;  j++) {
+						re[base + offset[j]] = tmp_re[j];
+						im[base + offset[j]] = tmp_im[j];
+					}
+				}
+			}
+			return;
+		}
+
+		if (k == 1 && ctrl_mask == 0) {
+			// A general single-qubit operator, without controls:  For each pair of amplitudes
+			// (i0, i1) differing only in the operand, (i0, i1) <- U (i0, i1).  The pairs come in
+			// runs of consecutive indices, so the inner loop vectorizes.
+			size_t		stride = offset[1];
+			Complex		u00 = opr.U.rows[0][0],  u01 = opr.U.rows[0][1],  u10 = opr.U.rows[1][0],  u11 = opr.U.rows[1][1];
+			int			n_runs = (int)((size_t)1 << nbits) / (int)(2*stride);
+			#pragma omp parallel for
+			for (int run = 0;  run < n_runs;  run++) {
+				double*		re0 = re + 2*stride*run;
+				double*		im0 = im + 2*stride*run;
+				double*		re1 = re0 + stride;
+				double*		im1 = im0 + stride;
+				for (size_t i = 0;  i < stride;  i++) {
+					double	ar = re0[i],  ai = im0[i],  br = re1[i],  bi = im1[i];
+					re0[i] = u00.R*ar - u00.I*ai + u01.R*br - u01.I*bi;
+					im0[i] = u00.R*ai + u00.I*ar + u01.R*bi + u01.I*br;
+					re1[i] = u10.R*ar - u10.I*ai + u11.R*br - u11.I*bi;
+					im1[i] = u10.R*ai + u10.I*ar + u11.R*bi + u11.I*br;
+				}
+			}
+			return;
+		}
+
+		// The general case:  Copy the group's amplitudes out first (a block's rows aren't
+		// necessarily the same indices as its columns, so writing one block's results straight
+		// back could clobber another block's inputs), then gather each block's columns from the
+		// copy, multiply them by the block's submatrix, and scatter the results into its rows.
+		size_t			max_rank = opr.U.max_block_rank(),  per_thread = 2*rank + 4*max_rank;
+		vector<double>	scratch(per_thread*n_threads());
+		#pragma omp parallel
+		{
+			double*		grp_re = &scratch[per_thread*thread_num()];
+			double*		grp_im = grp_re + rank;
+			double*		x_re = grp_im + rank;
+			double*		x_im = x_re + max_rank;
+			double*		y_re = x_im + max_rank;
+			double*		y_im = y_re + max_rank;
+			#pragma omp for
+			for (int g = 0;  g < n_groups;  g++) {
+				size_t	base = group_base(g, sorted_operands);
+				if ((base & ctrl_mask) != ctrl_value) continue;
+				for (size_t j = 0;  j < rank;  j++) {
+					grp_re[j] = re[base + offset[j]];
+					grp_im[j] = im[base + offset[j]];
+				}
+				for (size_t b = 0;  b < opr.U.blocks.size();  b++) {
+					MatrixBlock&	blk = opr.U.blocks[b];
+					size_t			r = blk.rank();
+					for (size_t c = 0;  c < r;  c++) {
+						x_re[c] = grp_re[blk.col_indices[c]];
+						x_im[c] = grp_im[blk.col_indices[c]];
+					}
+					ns_kernels::cgemv(r, r, &blk.elems_re[0], &blk.elems_im[0], x_re, x_im, y_re, y_im);
+					for (size_t c = 0;  c < r;  c++) {
+						re[base + offset[blk.row_indices[c]]] = y_re[c];
+						im[base + offset[blk.row_indices[c]]] = y_im[c];
+					}
+				}
+			}
+		}
+	}
+
+	// Apply the functional operator func, on the given registers, to each amplitude whose
+	// controls match.  (A permutation goes through the second state vector, moved.)
+	void apply_function(FunctionalOperator& func, const vector< vector<qubit_index_t> >& registers,
+						size_t ctrl_mask, size_t ctrl_value, size_t nbits, Amplitudes& psi, Amplitudes& moved) {
+		// Each amplitude moves to the image of its index under the function (if its controls
+		// are satisfied), and picks up the function's phase.
+		size_t	dim = (size_t)1 << nbits;
+		bool	permute = (func.kind == FunctionalOperator::PERMUTATION);
+		if (permute) {
+			moved.re.resize(dim);
+			moved.im.resize(dim);
+		}
+		#pragma omp parallel for
+		for (int i = 0;  i < (int)dim;  i++) {
+			size_t	index = (size_t)i,  new_index = index;
+			if ((index & ctrl_mask) == ctrl_value) {
+				size_t	regs[ns_functions::max_registers], widths[ns_functions::max_registers];
+				for (size_t r = 0;  r < registers.size();  r++) {
+					regs[r] = gather_bits(index, registers[r]);
+					widths[r] = registers[r].size();
+				}
+				if (permute) {
+					func.apply(regs, widths);
+					for (size_t r = 0;  r < registers.size();  r++) {
+						new_index &= ~mask_of(registers[r]);
+						new_index |= scatter_bits(regs[r], registers[r]);
+					}
+				} else {
+					Complex	phase = func.phase_of(regs, widths);
+					double	r = psi.re[index];
+					psi.re[index] = phase.R*r - phase.I*psi.im[index];
+					psi.im[index] = phase.R*psi.im[index] + phase.I*r;
+				}
+			}
+			if (permute) {
+				moved.re[new_index] = psi.re[index];
+				moved.im[new_index] = psi.im[index];
+			}
+		}
+		if (permute) {
+			psi.re.swap(moved.re);
+			psi.im.swap(moved.im);
+		}
+	}
+}
+
+// The memory the state-vector engine needs, in megabytes.  Besides the state vector itself,
+// we need the cumulative probabilities for sampling, and, if there are any functional
+// permutations, a second state vector to move amplitudes into.
+
+double SEQCSim::state_vector_mb(void) {
+	bool	any_permutations = false;
+	for (size_t i = 0;  i < opn_seq.size();  i++) {
+		if (opn_seq[i].isFunctional() && functions[opn_seq[i].function_id].kind == FunctionalOperator::PERMUTATION)
+			any_permutations = true;
+	}
+	double	bytes_per_amp = any_permutations ? 40 : 24;
+	return bytes_per_amp * pow(2.0, (double)qc_config.nbits) / (1024*1024);
+}
+
+// Can the whole state vector fit within the memory budget?  If so, returns true, and
+// sets why to a description of how much memory it needs.  If not, returns false, and
+// sets why to the reason.
+
+bool SEQCSim::state_vector_fits(string& why) {
+	double	budget_mb = qc_config.option_double("statevector_memory_mb", ns_statevector::default_memory_mb);
+	double	needed_mb = state_vector_mb();
+
+	ostringstream	reason;
+	if (qc_config.nbits > ns_statevector::max_qubits) {
+		reason << "the engine is limited to " << ns_statevector::max_qubits << " qubits, and there are " << qc_config.nbits;
+		why = reason.str();
+		return false;
+	}
+	if (needed_mb > budget_mb) {
+		reason << "the state vector needs " << needed_mb << " MB, but the budget (statevector_memory_mb) is " << budget_mb << " MB";
+		why = reason.str();
+		return false;
+	}
+	reason << "the state vector needs " << needed_mb << " MB, within the budget of " << budget_mb << " MB";
+	why = reason.str();
+	return true;
+}
+
+// The cost of running the circuit with the state-vector engine (see CostModel.h):  each
+// operation updates every amplitude, from (at most) as many others as its blocks' rank.
+
+void SEQCSim::estimate_state_vector(EngineEstimate& est) {
+	est.possible = state_vector_fits(est.note);
+	est.memory_mb = state_vector_mb();
+
+	double	n_amps = pow(2.0, (double)qc_config.nbits),  updates = 0;
+	for (size_t i = 0;  i < opn_seq.size();  i++) {
+		updates = ns_cost::plus(updates, ns_cost::times(n_amps, (double)branching_factor(opn_seq[i])));
+	}
+	est.seconds = ns_cost::times(updates, ns_cost::seconds_per_update);
+}
+
+// Run the simulation with the state-vector engine (see the top of this file).  The shots
+// are all sampled from the final state vector, and reported just as run_with() does, along
+// with the exact probabilities of the most likely final states.
+
+void SEQCSim::run_state_vector(void)
+{
+	size_t							nbits = qc_config.nbits,  dim = (size_t)1 << nbits;
+	ns_statevector::Amplitudes		psi,  moved;
+	vector<qubit_index_t>			all_qubits(nbits);
+	for (size_t q = 0;  q < nbits;  q++) all_qubits[q] = q;
+
+#ifdef _OPENMP
+	cout << "SEQCSim::run_state_vector(): Simulating " << nbits << " qubits with a full state vector, using "
+		 << omp_get_max_threads() << " threads.\n";
+#else
+	cout << "SEQCSim::run_state_vector(): Simulating " << nbits << " qubits with a full state vector, in a single thread.\n";
+#endif
+
+	// Start out in the input state.
+	current_state = input_state;
+	psi.re.assign(dim, 0.0);
+	psi.im.assign(dim, 0.0);
+	size_t	input_index = 0;
+	for (size_t q = 0;  q < nbits;  q++) if (input_state.bits[q]) input_index |= (size_t)1 << q;
+	psi.re[input_index] = input_state.amp.R;
+	psi.im[input_index] = input_state.amp.I;
+
+	for (size_t pc = 0;  pc < opn_seq.size();  pc++) {
+		Operation&	opn = opn_seq[pc];
+		size_t		ctrl_mask = ns_statevector::mask_of(opn.controls);
+		size_t		ctrl_value = ns_statevector::scatter_bits(opn.control_values, opn.controls);
+
+		if (ns_debug::trace) cout << "SEQCSim::run_state_vector(): Applying operation #" << pc << ", " << opn << ".\n";
+
+		if (opn.isFunctional()) {
+			ns_statevector::apply_function(functions[opn.function_id], opn.registers, ctrl_mask, ctrl_value, nbits, psi, moved);
+		} else {
+			ns_statevector::apply_operator(operators.at(opn.operator_id), opn.operands, ctrl_mask, ctrl_value, nbits, psi);
+		}
+	}
+
+	// Work out the cumulative probabilities, for sampling.  (The squared norm of the final state
+	// should be that of the input amplitude; any difference is rounding error.)
+	vector<double>	cumulative(dim);
+	double			total = 0;
+	for (size_t i = 0;  i < dim;  i++) {
+		total += psi.re[i]*psi.re[i] + psi.im[i]*psi.im[i];
+		cumulative[i] = total;
+	}
+	cout << "SEQCSim::run_state_vector(): The final state vector has squared norm " << total << ".\n";
+
+	// List the most likely final states (or values of the measured registers), with their exact probabilities.
+	map<string, double>		exact_probs;
+	for (size_t i = 0;  i < dim;  i++) {
+		double	p = psi.re[i]*psi.re[i] + psi.im[i]*psi.im[i];
+		if (p < ns_statevector::negligible_prob) continue;
+		current_state.setBits(all_qubits, i);
+		exact_probs[final_state_key()] += p/total;
+	}
+	report_final_probabilities("SEQCSim::run_state_vector()", exact_probs);
+
+	// Now sample the shots.
+	unsigned long				n_shots = (unsigned long)qc_config.option_double("shots", 1);
+	map<string, unsigned long>	histogram;
+
+	for (unsigned long shot = 1;  shot <= n_shots;  shot++) {
+		double	marker_position = marker_picker(prng_engine) * total;
+		size_t	i = upper_bound(cumulative.begin(), cumulative.end(), marker_position) - cumulative.begin();
+		if (i >= dim) i = dim - 1;
+
+		current_state.setBits(all_qubits, i);
+		current_state.amp = Complex(psi.re[i], psi.im[i]);
+		cout << "SEQCSim::run_state_vector(): Shot #" << shot << " ended in state " << current_state << ".\n";
+		histogram[final_state_key()]++;
+	}
+
+	report_histogram("SEQCSim::run_state_vector()", histogram, n_shots);
+}
@@ -0,0 +1,81 @@
+//========================================================================
+// SEQCSim version 0.8 - The Space-Efficient Quantum Computer Simulator
+// By Michael P. Frank, Liviu Oniciuc, Uwe Meyer-Baese, and Liviu Oniciuc.
+// Copyright (C) 2008-2009  Florida State University Board of Trustees
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// 
+// You may contact the author at michael.patrick.frank@gmail.com, or at
+// Michael P. Frank, PO Box 025250 #24985, Miami, FL  33102-5250.
+//========================================================================
+
+//-------------------------------------------------------------------------
+// StateVector.h - The pieces of the state-vector engine (StateVector.cpp)
+//   that other engines reuse to evolve state vectors on subsets of the qubits.
+//
+// A state vector on nbits qubits is kept in split form (separate arrays of
+// real and imaginary parts), where bit q of the index of an amplitude is the
+// value of qubit q.  The qubit indices passed to these functions are positions
+// within that index, so an engine that keeps a state vector for just some of
+// the qubits (like the hybrid engine in Hybrid.cpp) renumbers them first.
+//-------------------------------------------------------------------------
+
+#pragma once
+
+#include <vector>					// STL vector<> template.
+#include "index_types.h"			// qubit_index_t
+#include "Operator.h"				// The operators applied.
+#include "FunctionalOperator.h"		// Functional operators, too.
+
+using namespace std;
+
+namespace ns_statevector {
+
+	// The engine indexes amplitudes with ints, for the OpenMP loops, so this is a hard limit.
+	static const size_t		max_qubits = 30;
+
+	// A state vector, in split form.
+	struct Amplitudes {
+		vector<double>	re, im;
+	};
+
+	// The number of threads an OpenMP parallel region may use, and which one this is (for
+	// dividing up scratch space allocated before the region).
+	size_t	n_threads(void);
+	size_t	thread_num(void);
+
+	// A mask with a 1 in the position of each of the given qubits.
+	size_t	mask_of(const vector<qubit_index_t>& qubits);
+
+	// Spread the bits of value out to the positions of the given qubits (the inverse of gather_bits()).
+	size_t	scatter_bits(size_t value, const vector<qubit_index_t>& qubits);
+
+	// The bits of index at the positions of the given qubits, as an integer (like State::extractBits()).
+	size_t	gather_bits(size_t index, const vector<qubit_index_t>& qubits);
+
+	// The index of the g'th group's first amplitude:  g, with a 0 bit inserted at each of the
+	// given (sorted) positions.
+	size_t	group_base(size_t g, const vector<qubit_index_t>& sorted_positions);
+
+	// Apply the (non-functional) operator opr, on the given operands, to each group of
+	// amplitudes whose controls match (index & ctrl_mask) == ctrl_value.
+	void	apply_operator(Operator& opr, const vector<qubit_index_t>& operands, size_t ctrl_mask, size_t ctrl_value,
+						   size_t nbits, Amplitudes& psi);
+
+	// Apply the functional operator func, on the given registers, to each amplitude whose
+	// controls match.  A permutation moves the amplitudes into moved, which is then swapped
+	// with psi.
+	void	apply_function(FunctionalOperator& func, const vector< vector<qubit_index_t> >& registers,
+						   size_t ctrl_mask, size_t ctrl_value, size_t nbits, Amplitudes& psi, Amplitudes& moved);
+}
@@ -0,0 +1,488 @@
+//========================================================================
+// SEQCSim version 0.8 - The Space-Efficient Quantum Computer Simulator
+// By Michael P. Frank, Liviu Oniciuc, Uwe Meyer-Baese, and Liviu Oniciuc.
+// Copyright (C) 2008-2009  Florida State University Board of Trustees
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// 
+// You may contact the author at michael.patrick.frank@gmail.com, or at
+// Michael P. Frank, PO Box 025250 #24985, Miami, FL  33102-5250.
+//========================================================================
+//-------------------------------------------------------------------------
+// Subcircuit.cpp - Reading and expanding the subcircuits, loops and calls
+//   in qopseq.txt, and setting up their transfer tables (see Subcircuit.h).
+//-------------------------------------------------------------------------
+
+#include <iostream>			// cout
+#include <sstream>			// istringstream, ostringstream
+#include <algorithm>		// reverse(), sort(), unique()
+#include <ctype.h>			// isspace(), isdigit(), isalpha(), isalnum()
+#include "SEQCSim.h"
+#include "OperationMatrix.h"	// ns_opmatrix::qubits_of()
+#include "debug.h"			// ns_debug::trace
+
+using namespace std;
+
+namespace ns_subcircuits {
+
+	void split_names(const string& list, vector<string>& names) {
+		istringstream	listStream(list);
+		string			name;
+		while (getline(listStream, name, ',')) {
+			size_t	first = name.find_first_not_of(" \t"),  last = name.find_last_not_of(" \t\r");
+			if (first == string::npos) continue;		// Empty (e.g. trailing comma); skip it.
+			names.push_back(name.substr(first, last - first + 1));
+		}
+	}
+
+	// Remove any whitespace from the start and end of the text.
+	static string trim(const string& text) {
+		size_t	first = text.find_first_not_of(" \t\r"),  last = text.find_last_not_of(" \t\r");
+		return (first == string::npos) ? string() : text.substr(first, last - first + 1);
+	}
+
+	// Does the text start with the given word (followed by a space, or nothing)?
+	static bool starts_with_word(const string& text, const string& word) {
+		return text.compare(0, word.size(), word) == 0 && (text.size() == word.size() || isspace(text[word.size()]));
+	}
+
+	// A little recursive-descent parser for evaluate().  Each of these parses one level of
+	// the grammar, starting at text[pos], and leaves pos just after it.
+
+	static bool parse_sum(const string& text, size_t& pos, const map<string, long long>& vars, long long& value);
+
+	static void skip_spaces(const string& text, size_t& pos) {
+		while (pos < text.size() && isspace(text[pos])) pos++;
+	}
+
+	// A number, a variable, a parenthesized expression, or a factor with a sign in front.
+	static bool parse_factor(const string& text, size_t& pos, const map<string, long long>& vars, long long& value) {
+		skip_spaces(text, pos);
+		if (pos >= text.size()) return false;
+		char	c = text[pos];
+		if (c == '(') {
+			pos++;
+			if (!parse_sum(text, pos, vars, value)) return false;
+			skip_spaces(text, pos);
+			if (pos >= text.size() || text[pos] != ')') return false;
+			pos++;
+			return true;
+		}
+		if (c == '-' || c == '+') {
+			pos++;
+			if (!parse_factor(text, pos, vars, value)) return false;
+			if (c == '-') value = -value;
+			return true;
+		}
+		if (isdigit(c)) {
+			value = 0;
+			while (pos < text.size() && isdigit(text[pos])) value = 10*value + (text[pos++] - '0');
+			return true;
+		}
+		if (isalpha(c) || c == '_') {
+			size_t	start = pos;
+			while (pos < text.size() && (isalnum(text[pos]) || text[pos] == '_')) pos++;
+			map<string, long long>::const_iterator	var = vars.find(text.substr(start, pos - start));
+			if (var == vars.end()) return false;
+			value = var->second;
+			return true;
+		}
+		return false;
+	}
+
+	// Factors, multiplied, divided, or taken modulo each other.
+	static bool parse_product(const string& text, size_t& pos, const map<string, long long>& vars, long long& value) {
+		if (!parse_factor(text, pos, vars, value)) return false;
+		for (;;) {
+			skip_spaces(text, pos);
+			if (pos >= text.size()) return true;
+			char		op = text[pos];
+			long long	rhs;
+			if (op != '*' && op != '/' && op != '%') return true;
+			pos++;
+			if (!parse_factor(text, pos, vars, rhs)) return false;
+			if (op == '*')			value *= rhs;
+			else if (rhs == 0)		return false;
+			else if (op == '/')		value /= rhs;
+			else					value %= rhs;
+		}
+	}
+
+	// Products, added or subtracted.
+	static bool parse_sum(const string& text, size_t& pos, const map<string, long long>& vars, long long& value) {
+		if (!parse_product(text, pos, vars, value)) return false;
+		for (;;) {
+			skip_spaces(text, pos);
+			if (pos >= text.size()) return true;
+			char		op = text[pos];
+			long long	rhs;
+			if (op != '+' && op != '-') return true;
+			pos++;
+			if (!parse_product(text, pos, vars, rhs)) return false;
+			value = (op == '+') ? value + rhs : value - rhs;
+		}
+	}
+
+	bool evaluate(const string& expr, const map<string, long long>& vars, long long& value) {
+		size_t	pos = 0;
+		if (!parse_sum(expr, pos, vars, value)) return false;
+		skip_spaces(expr, pos);
+		return pos == expr.size();
+	}
+
+	bool substitute_values(string& text, const map<string, long long>& vars) {
+		for (size_t open = text.find('{');  open != string::npos;  open = text.find('{', open)) {
+			size_t		close = text.find('}', open);
+			long long	value;
+			if (close == string::npos || !evaluate(text.substr(open + 1, close - open - 1), vars, value)) return false;
+			ostringstream	valueText;
+			valueText << value;
+			text.replace(open, close - open + 1, valueText.str());
+		}
+		return true;
+	}
+
+	void substitute_names(string& text, const map<string, string>& names) {
+		size_t	pos = 0;
+		while (pos < text.size()) {
+			if (!isalpha(text[pos]) && text[pos] != '_') { pos++;  continue; }
+			size_t	start = pos;
+			while (pos < text.size() && (isalnum(text[pos]) || text[pos] == '_')) pos++;
+			map<string, string>::const_iterator	name = names.find(text.substr(start, pos - start));
+			if (name == names.end()) continue;
+			text.replace(start, pos - start, name->second);
+			pos = start + name->second.size();
+		}
+	}
+
+	string signature_of(const vector<Operation>& seq, size_t first, size_t end) {
+		ostringstream	sig;
+		for (size_t i = first;  i < end;  i++) {
+			const Operation&	opn = seq[i];
+			if (opn.isFunctional())	sig << "f" << opn.function_id;
+			else					sig << opn.operator_id;
+			sig << "(";
+			for (size_t k = 0;  k < opn.operands.size();  k++) sig << opn.operands[k] << ",";
+			sig << ")";
+			if (!opn.controls.empty()) {
+				sig << "c" << opn.control_values << "(";
+				for (size_t k = 0;  k < opn.controls.size();  k++) sig << opn.controls[k] << ",";
+				sig << ")";
+			}
+			sig << ";";
+		}
+		return sig.str();
+	}
+
+	// The name of the inverse of the operator or function with the given name.
+	static string inverse_name(const string& name) {
+		if (name.size() > 3 && name.compare(name.size() - 3, 3, "^-1") == 0) return name.substr(0, name.size() - 3);
+		return name + "^-1";
+	}
+}
+
+// Read the statements in the rest of the opseq file.  Subcircuit definitions are kept in
+// subcircuits (as they are, to be expanded when they're called), and all the other statements
+// are appended to the given list.  The "operation #k:" in front of a statement, if there is one,
+// is removed.
+
+void SEQCSim::read_statements(FileReader& reader, vector<string>& statements) {
+	Subcircuit*			cur_def = NULL;		// The subcircuit being defined, if any.
+
+	for (auto_ptr<string> line = reader.getLine_ignoreComments();  line.get() != NULL;  line = reader.getLine_ignoreComments()) {
+		string	statement = ns_subcircuits::trim(*line);
+		if (statement.compare(0, 9, "operation") == 0 && statement.find(':') != string::npos) {
+			statement = ns_subcircuits::trim(statement.substr(statement.find(':') + 1));
+		}
+
+		if (ns_subcircuits::starts_with_word(statement, "subcircuit")) {
+			if (cur_def != NULL) {
+				cout << "SEQCSim::read_statements(): Error! Subcircuit definitions can't be nested (in " << cur_def->name << ").\n";
+				exit(1);
+			}
+			size_t	open = statement.find('('),  close = statement.rfind(')');
+			string	name = ns_subcircuits::trim(statement.substr(10, open == string::npos ? string::npos : open - 10));
+			if (name.empty() || subcircuits.count(name) > 0 || (open != string::npos && close < open)) {
+				cout << "SEQCSim::read_statements(): Error! Bad or repeated subcircuit definition \"" << statement << "\".\n";
+				exit(1);
+			}
+			cur_def = &subcircuits[name];
+			cur_def->name = name;
+			if (open != string::npos) ns_subcircuits::split_names(statement.substr(open + 1, close - open - 1), cur_def->params);
+			if (ns_debug::trace) cout << "SEQCSim::read_statements(): Defining subcircuit " << name << ", with "
+									  << cur_def->params.size() << " parameters.\n";
+		} else if (statement == "end subcircuit") {
+			if (cur_def == NULL) {
+				cout << "SEQCSim::read_statements(): Error! \"end subcircuit\" without a subcircuit.\n";
+				exit(1);
+			}
+			cur_def = NULL;
+		} else if (cur_def != NULL) {
+			cur_def->body.push_back(statement);
+		} else {
+			statements.push_back(statement);
+		}
+	}
+
+	if (cur_def != NULL) {
+		cout << "SEQCSim::read_statements(): Error! Subcircuit " << cur_def->name << " has no \"end subcircuit\".\n";
+		exit(1);
+	}
+}
+
+// Expand statements[first..end-1] onto the end of opn_seq.  The values of the numeric parameters
+// and loop variables in scope are in values, and the names that the register parameters stand for
+// are in names.  depth is the number of calls we're inside of.
+
+void SEQCSim::expand_statements(const vector<string>& statements, size_t first, size_t end,
+								map<string, long long>& values, const map<string, string>& names, int depth) {
+	for (size_t i = first;  i < end;  i++) {
+		const string&	statement = statements[i];
+
+		if (ns_subcircuits::starts_with_word(statement, "apply")) {
+			string	text = statement;
+			if (!ns_subcircuits::substitute_values(text, values)) {
+				cout << "SEQCSim::expand_statements(): Error! Can't work out the values of the expressions in \"" << statement << "\".\n";
+				exit(1);
+			}
+			size_t	operands_at = text.find(" to ");
+			if (operands_at != string::npos) {
+				string	operands = text.substr(operands_at);
+				ns_subcircuits::substitute_names(operands, names);
+				text.replace(operands_at, string::npos, operands);
+			}
+			if (opn_seq.size() >= (operation_index_t)-1) {
+				cout << "SEQCSim::expand_statements(): Error! The circuit has too many operations.\n";
+				exit(1);
+			}
+			opn_seq.resize(opn_seq.size() + 1);
+			read_operation(opn_seq.size() - 1, text);
+
+		} else if (ns_subcircuits::starts_with_word(statement, "call")) {
+			expand_call(statement, values, names, depth);
+
+		} else if (ns_subcircuits::starts_with_word(statement, "for")) {
+			// Find the matching "end for".
+			size_t	body_end = i + 1;
+			for (int nesting = 0;  body_end < end;  body_end++) {
+				if (ns_subcircuits::starts_with_word(statements[body_end], "for")) {
+					nesting++;
+				} else if (statements[body_end] == "end for") {
+					if (nesting == 0) break;
+					nesting--;
+				}
+			}
+			if (body_end == end) {
+				cout << "SEQCSim::expand_statements(): Error! \"" << statement << "\" has no \"end for\".\n";
+				exit(1);
+			}
+
+			// Parse "for <var> = <from> to <last>", or "... downto <last>".
+			size_t		equals_at = statement.find('='),  downto_at = statement.find(" downto ");
+			bool		down = (downto_at != string::npos);
+			size_t		bound_at = down ? downto_at : statement.find(" to "),  bound_len = down ? 8 : 4;
+			string		var;
+			long long	from = 0,  last = 0;
+			if (equals_at != string::npos && bound_at != string::npos && bound_at > equals_at) {
+				var = ns_subcircuits::trim(statement.substr(3, equals_at - 3));
+			}
+			if (var.empty()
+					|| !ns_subcircuits::evaluate(statement.substr(equals_at + 1, bound_at - equals_at - 1), values, from)
+					|| !ns_subcircuits::evaluate(statement.substr(bound_at + bound_len), values, last)) {
+				cout << "SEQCSim::expand_statements(): Error! Can't make sense of the loop \"" << statement << "\".\n";
+				exit(1);
+			}
+
+			// Run the loop, putting back any variable of the same name afterwards.
+			bool		shadows = (values.count(var) > 0);
+			long long	shadowed = shadows ? values[var] : 0;
+			for (long long v = from;  down ? v >= last : v <= last;  down ? v-- : v++) {
+				values[var] = v;
+				expand_statements(statements, i + 1, body_end, values, names, depth);
+			}
+			if (shadows) values[var] = shadowed;  else values.erase(var);
+			i = body_end;
+
+		} else {
+			cout << "SEQCSim::expand_statements(): Error! Unknown statement \"" << statement << "\".\n";
+			exit(1);
+		}
+	}
+}
+
+// Expand the given "call [inverse] <name>(<arg1>, <arg2>, ...)" statement onto the end of
+// opn_seq, and record where it went, as a SubcircuitInstance.  If the same call was already
+// expanded, its operations (and any instances within it) are just copied.
+
+void SEQCSim::expand_call(const string& statement, map<string, long long>& values, const map<string, string>& names, int depth) {
+	string	call = ns_subcircuits::trim(statement.substr(4));
+	bool	inverse = ns_subcircuits::starts_with_word(call, "inverse");
+	if (inverse) call = ns_subcircuits::trim(call.substr(7));
+
+	size_t	open = call.find('('),  close = call.rfind(')');
+	string	name = ns_subcircuits::trim(call.substr(0, open));
+	map<string, Subcircuit>::iterator	def = subcircuits.find(name);
+	if (def == subcircuits.end()) {
+		cout << "SEQCSim::expand_call(): Error! There's no subcircuit named \"" << name << "\" (in \"" << statement << "\").\n";
+		exit(1);
+	}
+	vector<string>	args;
+	if (open != string::npos && close != string::npos && close > open) ns_subcircuits::split_names(call.substr(open + 1, close - open - 1), args);
+	if (args.size() != def->second.params.size()) {
+		cout << "SEQCSim::expand_call(): Error! Subcircuit " << name << " takes " << def->second.params.size()
+			 << " arguments, but \"" << statement << "\" gives it " << args.size() << ".\n";
+		exit(1);
+	}
+	if (depth >= ns_subcircuits::max_call_depth) {
+		cout << "SEQCSim::expand_call(): Error! Subcircuit calls are nested more than " << ns_subcircuits::max_call_depth
+			 << " deep (is " << name << " calling itself?).\n";
+		exit(1);
+	}
+
+	// Bind the parameters.  An argument that's an integer expression is a number; anything else
+	// is the name of a register or bit.  The full name of the call has all of them worked out.
+	map<string, long long>	new_values;
+	map<string, string>		new_names;
+	ostringstream			call_name;
+	call_name << (inverse ? "inverse " : "") << name << "(";
+	for (size_t k = 0;  k < args.size();  k++) {
+		string		arg = args[k];
+		long long	value;
+		if (!ns_subcircuits::substitute_values(arg, values)) {
+			cout << "SEQCSim::expand_call(): Error! Can't work out the value of argument \"" << args[k] << "\" in \"" << statement << "\".\n";
+			exit(1);
+		}
+		if (ns_subcircuits::evaluate(arg, values, value)) {
+			new_values[def->second.params[k]] = value;
+			call_name << (k > 0 ? ", " : "") << value;
+		} else {
+			ns_subcircuits::substitute_names(arg, names);
+			new_names[def->second.params[k]] = arg;
+			call_name << (k > 0 ? ", " : "") << arg;
+		}
+	}
+	call_name << ")";
+
+	SubcircuitInstance	inst;
+	inst.name = call_name.str();
+	inst.first = opn_seq.size();
+	inst.table_id = -1;
+
+	map<string, size_t>::iterator	prev = expanded_calls.find(inst.name);
+	if (prev != expanded_calls.end()) {
+		// Copy the operations of the earlier instance, and the instances inside it.
+		size_t	prev_first = subcircuit_instances[prev->second].first,  prev_end = subcircuit_instances[prev->second].end;
+		if (ns_debug::trace) cout << "SEQCSim::expand_call(): Copying the earlier expansion of " << inst.name << ".\n";
+		opn_seq.reserve(opn_seq.size() + (prev_end - prev_first));
+		for (size_t k = prev_first;  k < prev_end;  k++) opn_seq.push_back(opn_seq[k]);
+		for (size_t j = 0;  j < prev->second;  j++) {
+			if (subcircuit_instances[j].first >= prev_first && subcircuit_instances[j].end <= prev_end) {
+				SubcircuitInstance	inner = subcircuit_instances[j];
+				inner.first = inner.first - prev_first + inst.first;
+				inner.end = inner.end - prev_first + inst.first;
+				subcircuit_instances.push_back(inner);
+			}
+		}
+	} else {
+		if (ns_debug::trace) cout << "SEQCSim::expand_call(): Expanding " << inst.name << ".\n";
+		size_t	first_instance = subcircuit_instances.size();
+		expand_statements(def->second.body, 0, def->second.body.size(), new_values, new_names, depth + 1);
+		if (inverse) {
+			invert_operations(inst.first, opn_seq.size());
+
+			// The instances inside this one are now backwards too.
+			for (size_t j = first_instance;  j < subcircuit_instances.size();  j++) {
+				SubcircuitInstance&	inner = subcircuit_instances[j];
+				size_t				inner_first = inner.first;
+				inner.first = inst.first + opn_seq.size() - inner.end;
+				inner.end = inst.first + opn_seq.size() - inner_first;
+				inner.name = (inner.name.compare(0, 8, "inverse ") == 0) ? inner.name.substr(8) : "inverse " + inner.name;
+			}
+		}
+	}
+	inst.end = opn_seq.size();
+	if (inst.end == inst.first) return;		// Nothing to remember.
+
+	if (prev == expanded_calls.end()) expanded_calls[inst.name] = subcircuit_instances.size();
+	subcircuit_instances.push_back(inst);
+}
+
+// Replace the operations opn_seq[first..end-1] by their inverses, in the reverse order.
+
+void SEQCSim::invert_operations(size_t first, size_t end) {
+	reverse(opn_seq.begin() + first, opn_seq.begin() + end);
+	for (size_t i = first;  i < end;  i++) {
+		Operation&	opn = opn_seq[i];
+		if (opn.isFunctional())	opn.function_id = find_function(ns_subcircuits::inverse_name(functions[opn.function_id].name), i);
+		else					opn.operator_id = find_operator(ns_subcircuits::inverse_name(operators[opn.operator_id].name), i);
+	}
+}
+
+// Decide which subcircuit instances the engine can go back through in one step, using a transfer
+// table (see Subcircuit.h), and number the tables.  An instance whose operations were changed by
+// one of the passes (simplification, fusion, etc.) since it was read in is just forgotten.
+
+void SEQCSim::index_subcircuits() {
+	n_transfer_tables = 0;
+	instance_ending_at.clear();
+	transfer_budget_mb = qc_config.option_double("subcircuit_memory_mb", ns_subcircuits::default_memory_mb);
+	if (subcircuit_instances.empty()) return;
+
+	if (!qc_config.option_flag("subcircuit_cache", true)) {
+		cout << "SEQCSim::index_subcircuits(): Not using transfer tables for the subcircuits (subcircuit_cache is off).\n";
+		return;
+	}
+
+	instance_ending_at.assign(opn_seq.size() + 1, -1);
+	map<string, int>	table_of_signature;
+	size_t				n_unchanged = 0,  n_cached = 0;
+
+	for (size_t i = 0;  i < subcircuit_instances.size();  i++) {
+		SubcircuitInstance&	inst = subcircuit_instances[i];
+		inst.table_id = -1;
+		if (inst.end > opn_seq.size() || ns_subcircuits::signature_of(opn_seq, inst.first, inst.end) != inst.signature) continue;
+		n_unchanged++;
+
+		inst.qubits.clear();
+		for (size_t k = inst.first;  k < inst.end;  k++) {
+			vector<qubit_index_t>	qubits;
+			ns_opmatrix::qubits_of(opn_seq[k], qubits);
+			inst.qubits.insert(inst.qubits.end(), qubits.begin(), qubits.end());
+		}
+		sort(inst.qubits.begin(), inst.qubits.end());
+		inst.qubits.erase(unique(inst.qubits.begin(), inst.qubits.end()), inst.qubits.end());
+		if (inst.qubits.size() > ns_subcircuits::max_cached_qubits) continue;
+
+		// Instances made of exactly the same operations share a table.
+		map<string, int>::iterator	table = table_of_signature.find(inst.signature);
+		if (table == table_of_signature.end()) {
+			inst.table_id = table_of_signature[inst.signature] = (int)n_transfer_tables++;
+		} else {
+			inst.table_id = table->second;
+		}
+		n_cached++;
+
+		// If more than one instance ends at the same place, use the outermost one.
+		int&	ending = instance_ending_at[inst.end];
+		if (ending < 0 || subcircuit_instances[ending].first > inst.first) ending = (int)i;
+
+		if (ns_debug::trace) cout << "SEQCSim::index_subcircuits(): Instance " << inst.name << " (operations #" << inst.first
+								  << " to #" << inst.end - 1 << ", on " << inst.qubits.size() << " qubits) uses transfer table #" << inst.table_id << ".\n";
+	}
+
+	cout << "SEQCSim::index_subcircuits(): " << n_cached << " of the " << subcircuit_instances.size()
+		 << " subcircuit instances will use transfer tables (" << n_transfer_tables << " distinct ones).";
+	if (n_unchanged < subcircuit_instances.size()) cout << "  " << subcircuit_instances.size() - n_unchanged << " were changed by the passes.";
+	cout << "\n";
+}
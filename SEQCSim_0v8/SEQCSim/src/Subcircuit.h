@@ -0,0 +1,146 @@
+//========================================================================
+// SEQCSim version 0.8 - The Space-Efficient Quantum Computer Simulator
+// By Michael P. Frank, Liviu Oniciuc, Uwe Meyer-Baese, and Liviu Oniciuc.
+// Copyright (C) 2008-2009  Florida State University Board of Trustees
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// 
+// You may contact the author at michael.patrick.frank@gmail.com, or at
+// Michael P. Frank, PO Box 025250 #24985, Miami, FL  33102-5250.
+//========================================================================
+//-------------------------------------------------------------------------
+// Subcircuit.h - Named subcircuits (with parameters), loops and calls in
+//   the qopseq.txt file, and the transfer tables the engine keeps for them.
+//
+// Circuits like the QFT adders use the same block of operations more than
+// once (a QFT and its inverse, say), and arithmetic circuits are mostly
+// loops over the bits of a register.  Rather than writing out every single
+// operation, qopseq.txt may define subcircuits, and use loops and calls, as
+// in this example (see "data/4x4 QFT adder hierarchical"):
+//
+//		subcircuit qft(x, n)
+//			for i = n-1 downto 0
+//				apply unary operator H to bits x[{i}]
+//				for j = i-1 downto 0
+//					apply binary operator cPhase(k={i-j+1}) to bits x[{i}], x[{j}]
+//				end for
+//			end for
+//		end subcircuit
+//
+//		call qft(a, 4)
+//		...
+//		call inverse qft(a, 4)
+//
+// Each parameter of a subcircuit is either a number or the name of a
+// register (or bit), depending on the argument it's called with.  Anywhere
+// in an apply statement, {expr} is replaced by the value of the integer
+// expression expr (which may use the loop variables and the numeric
+// parameters, with + - * / % and parentheses), and the register parameters
+// are replaced by the names they were called with.  Loops run over "from
+// to last" or "from downto last", inclusive (and not at all if that's
+// empty).  "call inverse" applies the subcircuit backwards, with every
+// operation replaced by its inverse.  The plain "operation #k: apply ..."
+// lines of the original format are still accepted, with or without their
+// numbers, so any existing file is also a valid file in this format.
+//
+// Subcircuit definitions are only parsed when they're first called, and
+// each distinct call (the same subcircuit, with the same arguments, in the
+// same direction) is expanded only once; later calls just copy the result.
+// The engine still sees a flat sequence of operations (opn_seq), but it also
+// gets the list of SubcircuitInstances, which says where each call ended up.
+//
+// Going backwards through a whole instance at once, recalc_amplitude() needs
+// the instance's transfer amplitudes <out|U|in>, for the given values "out"
+// of its qubits at the end, and all the values "in" at its start.  These are
+// worked out once (by pushing a sparse vector backwards through its
+// operations), and kept in a transfer table, shared by all the instances that
+// consist of exactly the same operations, on the same qubits.  So, after the
+// first time, the recursion goes back through a repeated subcircuit in one
+// step, summing over just its distinct predecessors, instead of branching at
+// each of its operations in turn.  The transfer tables are the only storage
+// the engine allocates while it runs (the first time each entry is needed),
+// so those allocations are reported separately from the rest (see run_with()).
+// Once the tables take up more than "option: subcircuit_memory_mb X" (default
+// ns_subcircuits::default_memory_mb), no more rows are added to them, and the
+// recursion goes back through instances whose rows aren't there one operation
+// at a time, as if they had no table.  The option "subcircuit_cache off" turns
+// them off altogether, and instances on more than
+// ns_subcircuits::max_cached_qubits qubits don't get one.
+//-------------------------------------------------------------------------
+
+#pragma once
+
+#include <string>				// STL string class.
+#include <vector>				// STL vector<> template.
+#include <map>					// STL map<> template, for variable bindings.
+#include "index_types.h"		// operation_index_t, qubit_index_t
+#include "Operation.h"			// class Operation
+
+using namespace std;
+
+namespace ns_subcircuits {
+	// Subcircuits can call each other, but not (even indirectly) themselves.  This
+	// limits the depth of nested calls, which catches that.
+	static const int		max_call_depth = 64;
+
+	// Instances acting on more qubits than this don't get a transfer table, since
+	// it could have up to 2^n entries for each of its 2^n rows.
+	static const size_t		max_cached_qubits = 16;
+
+	// Default budget for all the transfer tables together, and the rough size of a row
+	// of one, besides its entries (map node and vector header).
+	static const double		default_memory_mb = 256;
+	static const size_t		bytes_per_row = 64;
+
+	// Split a comma-separated list of names, trimming any whitespace around them.  (This
+	// is also used for the lists of operands in apply statements.)
+	void	split_names(const string& list, vector<string>& names);
+
+	// Evaluate the integer expression expr, with the given variable values.  Returns
+	// false if it can't be parsed, or uses an unknown variable, or divides by 0.
+	bool	evaluate(const string& expr, const map<string, long long>& vars, long long& value);
+
+	// Replace each {expr} in the text by the value of expr.  Returns false if one of
+	// them can't be evaluated.
+	bool	substitute_values(string& text, const map<string, long long>& vars);
+
+	// Replace each whole-word occurrence of one of the given names in the text by
+	// the name it's mapped to.
+	void	substitute_names(string& text, const map<string, string>& names);
+
+	// A string that identifies everything the operations seq[first..end-1] do, for
+	// recognizing identical instances.
+	string	signature_of(const vector<Operation>& seq, size_t first, size_t end);
+}
+
+// A subcircuit definition, as written in qopseq.txt.
+
+class Subcircuit {
+public:
+	string			name;
+	vector<string>	params;			// Names of its parameters.
+	vector<string>	body;			// Its statements, not yet expanded.
+};
+
+// One place where a subcircuit was called, in the expanded operation sequence.
+
+class SubcircuitInstance {
+public:
+	string					name;		// The call, with its arguments (e.g. "inverse qft(a, 4)").
+	operation_index_t		first;		// Index in opn_seq of its first operation...
+	operation_index_t		end;		//	...and just past its last one.
+	string					signature;	// Concatenated signatures of its operations.
+	vector<qubit_index_t>	qubits;		// All the qubits it acts on, in increasing order.
+	int						table_id;	// Which transfer table it uses, or -1 if none.
+};
@@ -0,0 +1,432 @@
+//========================================================================
+// SEQCSim version 0.8 - The Space-Efficient Quantum Computer Simulator
+// By Michael P. Frank, Liviu Oniciuc, Uwe Meyer-Baese, and Liviu Oniciuc.
+// Copyright (C) 2008-2009  Florida State University Board of Trustees
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// 
+// You may contact the author at michael.patrick.frank@gmail.com, or at
+// Michael P. Frank, PO Box 025250 #24985, Miami, FL  33102-5250.
+//========================================================================
+
+//-------------------------------------------------------------------------
+// TensorNetwork.cpp - The tensor-network engine (see TensorNetwork.h).
+//-------------------------------------------------------------------------
+
+#include <iostream>				// cout
+#include <sstream>				// ostringstream
+#include <vector>				// STL vector<> template.
+#include <map>					// STL map<> template.
+#include <algorithm>			// find(), min()
+#include <math.h>				// ldexp(), log(), pow()
+#include "SEQCSim.h"
+#include "TensorNetwork.h"
+#include "OperationMatrix.h"	// ns_opmatrix::embed(), qubits_of()
+#include "debug.h"				// ns_debug::trace
+
+using namespace std;
+
+namespace ns_tensornet {
+
+	// contract() finds the positions of elements in its operands with two table lookups each,
+	// one for the lowest (at most) this many bits of the position in the combined index space,
+	// and one for the rest.
+	static const size_t		table_bits = 12;
+
+	static bool contains(const vector<size_t>& v, size_t e) { return find(v.begin(), v.end(), e) != v.end(); }
+
+	// One pass of the greedy ordering, on tensors with the given indices.  Also counts, for each
+	// index, how many intermediate tensors with more than max_rank indices it appears in.
+	static void greedy(vector< vector<size_t> > t, size_t max_rank, Plan& plan, map<size_t, size_t>& oversized) {
+		map<size_t, vector<size_t> >	holders;		// The tensors having each index.
+		for (size_t i = 0;  i < t.size();  i++) {
+			for (size_t k = 0;  k < t[i].size();  k++) holders[t[i][k]].push_back(i);
+		}
+		vector<char>	alive(t.size(), 1);
+		plan.steps.clear();
+		plan.max_rank = 0;
+		plan.cost = 0;
+
+		for (size_t remaining = t.size();  remaining > 1;  remaining--) {
+			// Find the best pair of tensors sharing an index.  An index of the pair's result is one
+			// that some other tensor also has.
+			Step	best;
+			double	best_score = 0;
+			size_t	best_union = 0;
+			bool	found = false;
+			for (map<size_t, vector<size_t> >::const_iterator h = holders.begin();  h != holders.end();  h++) {
+				const vector<size_t>&	hs = h->second;
+				for (size_t i = 0;  i < hs.size();  i++) {
+					for (size_t j = i + 1;  j < hs.size();  j++) {
+						size_t			a = hs[i],  b = hs[j];
+						vector<size_t>	all(t[a]),  result;
+						for (size_t k = 0;  k < t[b].size();  k++) if (!contains(all, t[b][k])) all.push_back(t[b][k]);
+						for (size_t k = 0;  k < all.size();  k++) {
+							size_t	in_pair = (contains(t[a], all[k]) ? 1 : 0) + (contains(t[b], all[k]) ? 1 : 0);
+							if (holders[all[k]].size() > in_pair) result.push_back(all[k]);
+						}
+						double	score = ldexp(1.0, (int)result.size()) - ldexp(1.0, (int)t[a].size()) - ldexp(1.0, (int)t[b].size());
+						if (!found || score < best_score || (score == best_score && all.size() < best_union)) {
+							found = true;
+							best_score = score;
+							best_union = all.size();
+							best.a = a;
+							best.b = b;
+							best.result = result;
+						}
+					}
+				}
+			}
+
+			// If no two tensors share an index, they're all scalars by now;  just multiply two of them.
+			if (!found) {
+				best.a = best.b = t.size();
+				for (size_t i = 0;  i < t.size();  i++) {
+					if (!alive[i]) continue;
+					if (best.a == t.size()) {
+						best.a = i;
+					} else if (best.b == t.size()) {
+						best.b = i;
+					}
+				}
+				best.result.clear();
+				best_union = 0;
+			}
+
+			// Do the step.
+			for (size_t k = 0;  k < t[best.a].size();  k++) {
+				vector<size_t>&	hs = holders[t[best.a][k]];
+				hs.erase(find(hs.begin(), hs.end(), best.a));
+			}
+			for (size_t k = 0;  k < t[best.b].size();  k++) {
+				vector<size_t>&	hs = holders[t[best.b][k]];
+				hs.erase(find(hs.begin(), hs.end(), best.b));
+				if (hs.empty()) holders.erase(t[best.b][k]);
+			}
+			for (size_t k = 0;  k < t[best.a].size();  k++) {
+				if (holders.count(t[best.a][k]) && holders[t[best.a][k]].empty()) holders.erase(t[best.a][k]);
+			}
+			for (size_t k = 0;  k < best.result.size();  k++) holders[best.result[k]].push_back(best.a);
+			t[best.a] = best.result;
+			t[best.b].clear();
+			alive[best.b] = 0;
+
+			plan.cost += ldexp(1.0, (int)best_union);
+			plan.max_rank = max(plan.max_rank, best.result.size());
+			if (best.result.size() > max_rank) {
+				for (size_t k = 0;  k < best.result.size();  k++) oversized[best.result[k]]++;
+			}
+			plan.steps.push_back(best);
+		}
+	}
+
+	void plan_contraction(const vector< vector<size_t> >& tensors, size_t max_rank, Plan& plan) {
+		plan.sliced.clear();
+		for (;;) {
+			vector< vector<size_t> >	t(tensors.size());
+			for (size_t i = 0;  i < tensors.size();  i++) {
+				for (size_t k = 0;  k < tensors[i].size();  k++) {
+					if (!contains(plan.sliced, tensors[i][k])) t[i].push_back(tensors[i][k]);
+				}
+			}
+			map<size_t, size_t>		oversized;
+			greedy(t, max_rank, plan, oversized);
+			if (plan.max_rank <= max_rank || oversized.empty()) return;
+
+			// Slice the index that appears in the most oversized intermediates.
+			map<size_t, size_t>::const_iterator	worst = oversized.begin();
+			for (map<size_t, size_t>::const_iterator it = oversized.begin();  it != oversized.end();  it++) {
+				if (it->second > worst->second) worst = it;
+			}
+			plan.sliced.push_back(worst->first);
+		}
+	}
+
+	void contract(const Tensor& a, const Tensor& b, const vector<size_t>& result, Tensor& c) {
+		// The combined index space:  the result's indices (so that the position in the result is
+		// just the low bits), then those summed over.
+		vector<size_t>	all(result);
+		for (size_t k = 0;  k < a.indices.size();  k++) if (!contains(all, a.indices[k])) all.push_back(a.indices[k]);
+		for (size_t k = 0;  k < b.indices.size();  k++) if (!contains(all, b.indices[k])) all.push_back(b.indices[k]);
+		size_t			n = all.size(),  lo = min(n, table_bits),  hi = n - lo;
+
+		vector<size_t>	a_bit(n, 0),  b_bit(n, 0);
+		for (size_t k = 0;  k < a.indices.size();  k++) a_bit[find(all.begin(), all.end(), a.indices[k]) - all.begin()] = (size_t)1 << k;
+		for (size_t k = 0;  k < b.indices.size();  k++) b_bit[find(all.begin(), all.end(), b.indices[k]) - all.begin()] = (size_t)1 << k;
+
+		vector<size_t>	a_lo((size_t)1 << lo, 0),  b_lo((size_t)1 << lo, 0),  a_hi((size_t)1 << hi, 0),  b_hi((size_t)1 << hi, 0);
+		for (size_t u = 0;  u < a_lo.size();  u++) {
+			for (size_t k = 0;  k < lo;  k++) if ((u >> k) & 1) { a_lo[u] += a_bit[k];  b_lo[u] += b_bit[k]; }
+		}
+		for (size_t u = 0;  u < a_hi.size();  u++) {
+			for (size_t k = 0;  k < hi;  k++) if ((u >> k) & 1) { a_hi[u] += a_bit[lo + k];  b_hi[u] += b_bit[lo + k]; }
+		}
+
+		c.indices = result;
+		c.elems.assign((size_t)1 << result.size(), Complex(0));
+		size_t	r_mask = ((size_t)1 << result.size()) - 1;
+		for (size_t h = 0;  h < a_hi.size();  h++) {
+			for (size_t l = 0;  l < a_lo.size();  l++) {
+				c.elems[((h << lo) | l) & r_mask] += a.elems[a_lo[l] + a_hi[h]] * b.elems[b_lo[l] + b_hi[h]];
+			}
+		}
+	}
+
+	// The tensor t, with each of the given sliced indices that it has fixed to the value of the
+	// corresponding bit of values.
+	static void project(const Tensor& t, const vector<size_t>& sliced, size_t values, Tensor& p) {
+		vector<size_t>	kept_bits;
+		size_t			fixed = 0;
+		p.indices.clear();
+		for (size_t k = 0;  k < t.indices.size();  k++) {
+			size_t	s = find(sliced.begin(), sliced.end(), t.indices[k]) - sliced.begin();
+			if (s < sliced.size()) {
+				if ((values >> s) & 1) fixed |= (size_t)1 << k;
+			} else {
+				kept_bits.push_back(k);
+				p.indices.push_back(t.indices[k]);
+			}
+		}
+		p.elems.resize((size_t)1 << kept_bits.size());
+		for (size_t j = 0;  j < p.elems.size();  j++) {
+			size_t	pos = fixed;
+			for (size_t k = 0;  k < kept_bits.size();  k++) if ((j >> k) & 1) pos |= (size_t)1 << kept_bits[k];
+			p.elems[j] = t.elems[pos];
+		}
+	}
+}
+
+// The qubits an operation acts on, for its tensor:  a functional operation's registers' bits
+// (in order), then its controls;  otherwise, its operands, then its controls.
+
+static void tensor_qubits(const Operation& opn, vector<qubit_index_t>& qubits) {
+	if (opn.isFunctional()) {
+		qubits.clear();
+		for (size_t r = 0;  r < opn.registers.size();  r++) qubits.insert(qubits.end(), opn.registers[r].begin(), opn.registers[r].end());
+		qubits.insert(qubits.end(), opn.controls.begin(), opn.controls.end());
+	} else {
+		ns_opmatrix::qubits_of(opn, qubits);
+	}
+}
+
+// Can the circuit be turned into a tensor network?  (Only if no operation is too big.)
+
+bool SEQCSim::tensor_network_fits(string& why) {
+	for (size_t pc = 0;  pc < opn_seq.size();  pc++) {
+		vector<qubit_index_t>	qubits;
+		tensor_qubits(opn_seq[pc], qubits);
+		if (qubits.size() > ns_tensornet::max_operation_qubits) {
+			ostringstream	reason;
+			reason << "operation #" << pc << " acts on " << qubits.size() << " qubits, more than the "
+				   << ns_tensornet::max_operation_qubits << " a tensor can have";
+			why = reason.str();
+			return false;
+		}
+	}
+	double	budget_mb = qc_config.option_double("tn_memory_mb", ns_tensornet::default_memory_mb);
+	ostringstream	reason;
+	if (!(budget_mb*1024*1024 >= sizeof(Complex))) {		// (Also catches a NaN budget.)
+		reason << "the tn_memory_mb budget of " << budget_mb << " MB cannot hold even one amplitude";
+		why = reason.str();
+		return false;
+	}
+	reason << "with a memory budget of " << budget_mb << " MB for each intermediate tensor";
+	why = reason.str();
+	return true;
+}
+
+// Set up the tensors for all of the operations (see TensorNetwork.h).
+
+void SEQCSim::build_tensor_network() {
+	size_t		nbits = qc_config.nbits;
+	size_t		next_index = nbits;			// Qubit q's index at the start is q.
+	double		budget_mb = qc_config.option_double("tn_memory_mb", ns_tensornet::default_memory_mb);
+
+	double		budget_elems = budget_mb*1024*1024/sizeof(Complex);
+
+	// tensor_network_fits() has already turned away budgets of less than one element, but
+	// clamp here anyway, since converting a negative (or infinite) log to size_t is undefined.
+	tensor_net.max_rank = (budget_elems >= 2) ? (size_t)floor(log(budget_elems) / log(2.0)) : 0;
+	tensor_net.operations.resize(opn_seq.size());
+	tensor_net.wires.resize(opn_seq.size() + 1);
+	tensor_net.plans.clear();
+	tensor_net.wires[0].resize(nbits);
+	for (size_t q = 0;  q < nbits;  q++) tensor_net.wires[0][q] = q;
+
+	for (size_t pc = 0;  pc < opn_seq.size();  pc++) {
+		Operation&				opn = opn_seq[pc];
+		ns_tensornet::Tensor&	t = tensor_net.operations[pc];
+		vector<qubit_index_t>	qubits;
+		tensor_qubits(opn, qubits);
+		size_t					k = qubits.size(),  rank = (size_t)1 << k;
+		tensor_net.wires[pc + 1] = tensor_net.wires[pc];
+		for (size_t i = 0;  i < k;  i++) t.indices.push_back(tensor_net.wires[pc][qubits[i]]);
+
+		bool	diagonal = opn.isFunctional() ? (functions[opn.function_id].kind == FunctionalOperator::PHASE_ORACLE)
+											  : (operators.at(opn.operator_id).form == Operator::DIAGONAL);
+		if (!diagonal) {
+			// The new indices (for the values coming out) go first, so element (row, col) of the
+			// operation's matrix is at position row | col << k.
+			vector<size_t>	in(t.indices);
+			t.indices.clear();
+			for (size_t i = 0;  i < k;  i++) {
+				t.indices.push_back(next_index);
+				tensor_net.wires[pc + 1][qubits[i]] = next_index++;
+			}
+			t.indices.insert(t.indices.end(), in.begin(), in.end());
+		}
+		t.elems.assign(diagonal ? rank : rank*rank, Complex(0));
+
+		if (opn.isFunctional()) {
+			FunctionalOperator&	func = functions[opn.function_id];
+			size_t				regs[ns_functions::max_registers],  widths[ns_functions::max_registers];
+			size_t				n_reg_bits = k - opn.controls.size();
+			for (size_t r = 0;  r < opn.registers.size();  r++) widths[r] = opn.registers[r].size();
+			for (size_t z = 0;  z < rank;  z++) {
+				size_t	image = z;
+				Complex	phase(1);
+				if ((z >> n_reg_bits) == opn.control_values) {
+					for (size_t r = 0, shift = 0;  r < opn.registers.size();  shift += widths[r], r++) {
+						regs[r] = (z >> shift) & (((size_t)1 << widths[r]) - 1);
+					}
+					if (diagonal) {
+						phase = func.phase_of(regs, widths);
+					} else {
+						func.apply(regs, widths);
+						image = z & ~(((size_t)1 << n_reg_bits) - 1);
+						for (size_t r = 0, shift = 0;  r < opn.registers.size();  shift += widths[r], r++) image |= regs[r] << shift;
+					}
+				}
+				if (diagonal) {
+					t.elems[z] = phase;
+				} else {
+					t.elems[image | (z << k)] = Complex(1);
+				}
+			}
+		} else {
+			vector<Complex>		m;
+			ns_opmatrix::embed(operators.at(opn.operator_id), opn, qubits, m);
+			for (size_t row = 0;  row < rank;  row++) {
+				if (diagonal) {
+					t.elems[row] = m[row*rank + row];
+				} else {
+					for (size_t col = 0;  col < rank;  col++) t.elems[row | (col << k)] = m[row*rank + col];
+				}
+			}
+		}
+	}
+	if (ns_debug::trace) cout << "SEQCSim::build_tensor_network(): The network has " << next_index << " indices.\n";
+}
+
+// The amplitude of current_state at program_counter, found by contracting the network of the
+// operations before it, between the input state and current_state.
+
+Complex SEQCSim::tensor_amplitude() {
+	size_t		nbits = qc_config.nbits;
+	operation_index_t	pc = program_counter;
+	const vector<size_t>&	wires = tensor_net.wires[pc];
+
+	// The tensors are the input values, then the operations, then the current values.
+	size_t		n_tensors = 2*nbits + pc;
+	vector<const ns_tensornet::Tensor*>	slot(n_tensors);
+	vector<ns_tensornet::Tensor>		owned(n_tensors);
+	for (size_t q = 0;  q < nbits;  q++) {
+		owned[q].indices.assign(1, q);
+		owned[q].elems.assign(2, Complex(0));
+		owned[q].elems[input_state.bits[q] ? 1 : 0] = Complex(1);
+		owned[nbits + pc + q].indices.assign(1, wires[q]);
+		owned[nbits + pc + q].elems.assign(2, Complex(0));
+		owned[nbits + pc + q].elems[current_state.bits[q] ? 1 : 0] = Complex(1);
+	}
+	for (size_t i = 0;  i < n_tensors;  i++) slot[i] = (i >= nbits && i < nbits + pc) ? &tensor_net.operations[i - nbits] : &owned[i];
+
+	// Work out the plan for this pc, if we haven't yet.
+	map<operation_index_t, ns_tensornet::Plan>::iterator	found = tensor_net.plans.find(pc);
+	if (found == tensor_net.plans.end()) {
+		vector< vector<size_t> >	structure(n_tensors);
+		for (size_t i = 0;  i < n_tensors;  i++) structure[i] = slot[i]->indices;
+		found = tensor_net.plans.insert(make_pair(pc, ns_tensornet::Plan())).first;
+		ns_tensornet::plan_contraction(structure, tensor_net.max_rank, found->second);
+		cout << "SEQCSim::tensor_amplitude(): The network for the first " << pc << " operations has " << n_tensors
+			 << " tensors;  contracting it takes " << found->second.cost << " multiply-adds for each of "
+			 << ((size_t)1 << found->second.sliced.size()) << " slices, with at most 2^" << found->second.max_rank
+			 << " elements in any intermediate tensor.\n";
+	}
+	const ns_tensornet::Plan&	plan = found->second;
+
+	// Contract each slice, and add them up.
+	Complex		total(0);
+	size_t		n_slices = (size_t)1 << plan.sliced.size();
+	for (size_t s = 0;  s < n_slices;  s++) {
+		vector<const ns_tensornet::Tensor*>	work(slot);
+		vector<ns_tensornet::Tensor>		results(n_tensors);
+		for (size_t i = 0;  i < n_tensors && !plan.sliced.empty();  i++) {
+			ns_tensornet::project(*slot[i], plan.sliced, s, results[i]);
+			work[i] = &results[i];
+		}
+		size_t	last = 0;
+		for (size_t k = 0;  k < plan.steps.size();  k++) {
+			const ns_tensornet::Step&	step = plan.steps[k];
+			ns_tensornet::Tensor		c;
+			ns_tensornet::contract(*work[step.a], *work[step.b], step.result, c);
+			results[step.a].indices.swap(c.indices);
+			results[step.a].elems.swap(c.elems);
+			work[step.a] = &results[step.a];
+			results[step.b] = ns_tensornet::Tensor();
+			work[step.b] = 0;
+			last = step.a;
+		}
+		total += work[last]->elems[0];
+	}
+	return input_state.amp * total;
+}
+
+// The cost of running the circuit with the tensor-network engine (see CostModel.h).  We
+// plan the contraction of the network for the whole circuit, and take that as the cost of
+// each amplitude the forward steps need (b of them for each branching operation, in each
+// shot), although the networks for earlier PCs are smaller.
+
+void SEQCSim::estimate_tensor_network(EngineEstimate& est)
+{
+	if (!tensor_network_fits(est.note)) {
+		est.possible = false;
+		return;
+	}
+	size_t		nbits = qc_config.nbits,  n_opns = opn_seq.size();
+	double		n_shots = qc_config.option_double("shots", 1);
+
+	build_tensor_network();
+	vector< vector<size_t> >	structure(2*nbits + n_opns);
+	for (size_t q = 0;  q < nbits;  q++) {
+		structure[q].assign(1, q);
+		structure[nbits + n_opns + q].assign(1, tensor_net.wires[n_opns][q]);
+	}
+	for (size_t pc = 0;  pc < n_opns;  pc++) structure[nbits + pc] = tensor_net.operations[pc].indices;
+	ns_tensornet::Plan	plan;
+	ns_tensornet::plan_contraction(structure, tensor_net.max_rank, plan);
+	tensor_net = ns_tensornet::Network();		// (choose_engine() builds it again, if it's used.)
+
+	double		n_amps = 0;
+	for (size_t pc = 0;  pc < n_opns;  pc++) {
+		double	b = (double)branching_factor(opn_seq[pc]);
+		if (b > 1) n_amps += b;
+	}
+	double		flops = ns_cost::times(plan.cost, pow(2.0, (double)plan.sliced.size()));
+	est.seconds = ns_cost::times(ns_cost::times(ns_cost::times(flops, n_amps), n_shots), ns_cost::seconds_per_flop);
+	est.memory_mb = 3 * pow(2.0, (double)plan.max_rank) * sizeof(Complex) / (1024*1024);
+
+	ostringstream	note;
+	note << n_amps << " amplitudes for each shot, each taking up to " << flops << " multiply-adds";
+	est.note = note.str();
+}
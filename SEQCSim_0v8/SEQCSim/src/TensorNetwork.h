@@ -0,0 +1,109 @@
+//========================================================================
+// SEQCSim version 0.8 - The Space-Efficient Quantum Computer Simulator
+// By Michael P. Frank, Liviu Oniciuc, Uwe Meyer-Baese, and Liviu Oniciuc.
+// Copyright (C) 2008-2009  Florida State University Board of Trustees
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// 
+// You may contact the author at michael.patrick.frank@gmail.com, or at
+// Michael P. Frank, PO Box 025250 #24985, Miami, FL  33102-5250.
+//========================================================================
+
+//-------------------------------------------------------------------------
+// TensorNetwork.h - A tensor-network engine, which finds single amplitudes
+//   <x| U_pc ... U_1 |input> by contracting a network of the operations.
+//
+// The path-integral engine only ever needs the amplitude of one basis state
+// at a time, at some point pc in the circuit.  Its recursion costs time
+// exponential in the number of branching operations before pc, however the
+// circuit is laid out.  Instead, we can write the amplitude as a tensor network,
+// with a tensor for each operation (its matrix, with one index for each qubit
+// going in, and one for each coming out), and a boundary tensor for the value
+// of each qubit at the start (the input state) and at pc (the state x), and
+// sum over the shared indices.  A diagonal operation, such as a phase rotation,
+// doesn't change its qubits' values, so it just has one index per qubit, shared
+// with whatever comes before and after it (a "hyperedge").
+//
+// The order in which the tensors are contracted is what matters.  We choose
+// it greedily, each time contracting the pair of tensors whose result is
+// smallest relative to the two of them, which tends to follow the tree width
+// of the network rather than the depth of the circuit.  If some intermediate
+// tensor would still be too large for the memory budget, "option: tn_memory_mb
+// N" (default ns_tensornet::default_memory_mb), we "slice" the network:  fix the
+// value of the index that appears in the most oversized intermediates, find a
+// new order, and repeat, and then add up the contractions for each value of the
+// sliced indices.  Since the network for a given pc only depends on x through
+// its boundary tensors, the order (a Plan) is worked out once for each pc.
+//
+// The engine is selected with "option: engine tensornet".  It uses the rest of
+// the path-integral engine (Bohm_step_forwards() etc.) as it is;  only
+// recalc_amplitude() contracts the network, instead of recursing.
+//-------------------------------------------------------------------------
+
+#pragma once
+
+#include <vector>				// STL vector<> template.
+#include <map>					// STL map<> template.
+#include "index_types.h"		// operation_index_t, qubit_index_t
+#include "Complex.h"			// Tensor elements.
+
+using namespace std;
+
+namespace ns_tensornet {
+
+	// Default memory budget for the largest intermediate tensor, in megabytes.
+	static const double		default_memory_mb = 256;
+
+	// Operations acting on more qubits than this (including controls) can't be turned into
+	// tensors, so the engine isn't used for circuits that have them.
+	static const size_t		max_operation_qubits = 10;
+
+	// A tensor:  bit i of the position of an element is the value of its i'th index.  Indices
+	// are numbered across the whole network.
+	struct Tensor {
+		vector<size_t>		indices;
+		vector<Complex>		elems;
+	};
+
+	// One step of a contraction:  contract the tensors in slots a and b, leaving the result,
+	// with the given indices, in slot a.
+	struct Step {
+		size_t				a, b;
+		vector<size_t>		result;
+	};
+
+	// The order of contraction for the network at some pc, and which indices are sliced.
+	struct Plan {
+		vector<size_t>		sliced;
+		vector<Step>		steps;
+		size_t				max_rank;		// The most indices of any intermediate tensor.
+		double				cost;			// Number of multiply-adds per slice.
+	};
+
+	// The tensors for all the operations, and the indices of the qubits between them.
+	struct Network {
+		vector<Tensor>		operations;		// One for each operation in opn_seq.
+		vector< vector<size_t> >	wires;	// For each pc, the index of each qubit's value just before operation #pc.
+		map<operation_index_t, Plan>	plans;	// The plans worked out so far, by pc.
+		size_t				max_rank;		// The most indices an intermediate tensor may have.
+	};
+
+	// Work out a plan for contracting the network whose tensors have the given indices,
+	// slicing it if needed so that no intermediate tensor has more than max_rank indices.
+	void	plan_contraction(const vector< vector<size_t> >& tensors, size_t max_rank, Plan& plan);
+
+	// Contract the tensors a and b, leaving the result, with the given indices, in c.  Any
+	// other index of a or b is summed over.
+	void	contract(const Tensor& a, const Tensor& b, const vector<size_t>& result, Tensor& c);
+}
@@ -42,7 +42,7 @@ typedef		u16_t	operator_index_t;		// Can't have more than 65,536 different quant
 
 // operation_index_t - Type for an index of a quantum logic operation (operator application) in a sequence of such.
 
-typedef		u16_t	operation_index_t;		// Can't have more than 65,536 quantum logic operations making up a given circuit.
+typedef		u32_t	operation_index_t;		// Can't have more than 2^32 quantum logic operations making up a given circuit.
 
 
 // qubit_index_t - Type for an index of a qubit within our quantum computer.